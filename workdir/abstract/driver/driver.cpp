@@ -0,0 +1,614 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lhf/lhf.hpp"
+#include "lhf/profiling.hpp"
+#include "lhf/workload.hpp"
+
+// Both implementations of the test interface, side by side. The headers share
+// their include guard and namespace, so each is wrapped in a namespace of its
+// own. Everything they include is already included above.
+
+namespace naive_impl {
+#include "implementation_naive.hpp"
+}
+
+#undef LHF_INTERFACE_IMPLEMENTATION
+
+namespace lhf_impl {
+#include "implementation_lhf.hpp"
+}
+
+/**
+ * Runs the workloads of all four test series on both implementations from a
+ * single optimised binary, in place of recompiling `test.cpp` for every run.
+ *
+ * Every (series, implementation) variant is instantiated from the same
+ * templates and does what the series' `test.cpp` does: build the corpus (for
+ * closed-world series), then time every operation (for random series,
+ * including building its operands). Every measured run happens in a forked
+ * child, so the LHF instances, which are global, start out empty. The child
+ * reports its internal timers and the growth of its peak RSS (`getrusage`)
+ * over the loaded workload.
+ *
+ * Workloads are read from the text files of `benchmark.py` or `workload_gen`,
+ * or generated in memory (`lhf/workload.hpp`). `bulk` runs the matrix of
+ * `run_bulk.sh` in one invocation.
+ */
+
+/// A workload in memory. Sets are flattened tuples of `arity` integers.
+struct Workload {
+	struct Op {
+		/// `U`, `I`, `D`, or `S` to duplicate corpus entries `a` to `b`.
+		char type;
+
+		/// Corpus indices of the operands, or for operations with inline
+		/// operands, their indices in `sets`.
+		uint32_t a = 0, b = 0;
+
+		/// Index of the expected result in `sets`, or -1.
+		int64_t result = -1;
+	};
+
+	int arity = 1;
+	std::vector<std::vector<int>> corpus;
+	std::vector<std::vector<int>> sets;
+	std::vector<Op> ops;
+	uint64_t op_count = 0;
+
+	uint32_t add_set(const int64_t *data, std::size_t n) {
+		sets.emplace_back(data, data + n);
+		return sets.size() - 1;
+	}
+
+	// Sink interface of `lhf::WorkloadGenerator`.
+
+	void corpus_set(const std::vector<int64_t> &elements) {
+		corpus.emplace_back(elements.begin(), elements.end());
+	}
+
+	void corpus_duplicate(uint64_t start, uint64_t stop) {
+		ops.push_back({ 'S', uint32_t(start), uint32_t(stop) });
+	}
+
+	void operation(
+		lhf::TraceOpcode opcode,
+		const lhf::TraceWriter::Operand &a,
+		const lhf::TraceWriter::Operand &b,
+		const std::vector<int64_t> *result) {
+		Op op;
+		op.type = opcode == lhf::TRACE_UNION ? 'U' : opcode == lhf::TRACE_INTERSECTION ? 'I' : 'D';
+		op.a = a.is_corpus ? a.corpus_index : add_set(a.data, a.count * arity);
+		op.b = b.is_corpus ? b.corpus_index : add_set(b.data, b.count * arity);
+		if (result) {
+			op.result = add_set(result->data(), result->size());
+		}
+		ops.push_back(op);
+		op_count++;
+	}
+};
+
+/// The four test series.
+struct Series {
+	const char *name;
+	lhf::WorkloadKind kind;
+	int arity;
+};
+
+static const Series SERIES[] = {
+	{ "closed_world", lhf::WORKLOAD_CLOSED_WORLD, 1 },
+	{ "closed_world_pointsto", lhf::WORKLOAD_CLOSED_WORLD, 2 },
+	{ "random", lhf::WORKLOAD_RANDOM, 1 },
+	{ "random_pointsto", lhf::WORKLOAD_RANDOM, 2 },
+};
+
+static const Series *find_series(const std::string &name) {
+	for (const Series &s : SERIES) {
+		if (name == s.name) {
+			return &s;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Reads a text workload of `benchmark.py` (see `trace_convert` for the
+ * format). Expected results are kept only if `results` is set.
+ */
+static void read_workload(const std::string &path, const Series &series, bool results, Workload &w) {
+	std::ifstream in(path);
+	if (!in) {
+		throw std::runtime_error("File not found: " + path);
+	}
+
+	std::vector<int64_t> buffer;
+	auto read_set = [&]() {
+		long long len;
+		if (!(in >> len)) {
+			throw std::runtime_error("Malformed set in " + path);
+		}
+		buffer.resize(len * series.arity);
+		for (int64_t &v : buffer) {
+			in >> v;
+		}
+	};
+
+	w = Workload();
+	w.arity = series.arity;
+
+	if (series.kind == lhf::WORKLOAD_CLOSED_WORLD) {
+		long long n;
+		in >> n;
+		for (long long i = 0; i < n; i++) {
+			read_set();
+			w.corpus_set(buffer);
+		}
+	}
+
+	long long count;
+	if (!(in >> count)) {
+		throw std::runtime_error("Expected the number of operations in " + path);
+	}
+
+	std::string type;
+	while (int64_t(w.op_count) < count && in >> type) {
+		if (type == "S") {
+			uint64_t start, stop;
+			in >> start >> stop;
+			w.corpus_duplicate(start, stop);
+			continue;
+		}
+
+		Workload::Op op;
+		op.type = type[0];
+		if (series.kind == lhf::WORKLOAD_CLOSED_WORLD) {
+			in >> op.a >> op.b;
+		} else {
+			read_set();
+			op.a = w.add_set(buffer.data(), buffer.size());
+			read_set();
+			op.b = w.add_set(buffer.data(), buffer.size());
+		}
+
+		read_set();
+		if (results) {
+			op.result = w.add_set(buffer.data(), buffer.size());
+		}
+		w.ops.push_back(op);
+		w.op_count++;
+	}
+}
+
+/// Measurements of one run, passed from the child process.
+struct RunResult {
+	uint64_t operations = 0;
+	double build_ns = 0;
+	double op_ns = 0;
+	long rss_delta_kb = 0;
+	long peak_rss_kb = 0;
+	char error[160] = "";
+};
+
+static long peak_rss_kb() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+ * Builds sets of one implementation's `PointeeSet` (arity 1) or `PointsToSet`
+ * (arity 2) the way the series' `test.cpp` does.
+ */
+template<typename Set, bool is_lhf, int arity>
+struct SetOps {
+	static Set make(const std::vector<int> &flat) {
+		if constexpr (arity == 1) {
+			std::set<int> s(flat.begin(), flat.end());
+			return Set(s.begin(), s.end());
+		} else {
+			std::set<std::pair<int, int>> s;
+			for (std::size_t i = 0; i + 1 < flat.size(); i += 2) {
+				s.insert({ flat[i], flat[i + 1] });
+			}
+
+			Set ret;
+			for (auto &p : s) {
+				ret = ret.insert_pointee(p.first, p.second);
+			}
+			return ret;
+		}
+	}
+
+	static Set apply(char type, Set &a, Set &b) {
+		switch (type) {
+		case 'U': return a.set_union(b);
+		case 'I': return a.set_intersection(b);
+		default: return a.set_difference(b);
+		}
+	}
+
+	/// Drops keys with empty pointee sets, which intersections and
+	/// differences leave behind.
+	static Set normalize(const Set &s) {
+		if constexpr (arity == 2) {
+			Set ret;
+			for (auto i : s) {
+				if (!i.value().is_empty()) {
+					if constexpr (is_lhf) {
+						ret = ret.set_insert_single({ i.key(), i.value().set_index });
+					} else {
+						ret = ret.set_insert_single({ i.key(), i.value().data });
+					}
+				}
+			}
+			return ret;
+		} else {
+			return s;
+		}
+	}
+};
+
+template<typename Set, bool is_lhf, int arity>
+static void run_variant(const Workload &w, bool closed_world, bool verify, RunResult &r) {
+	using Ops = SetOps<Set, is_lhf, arity>;
+	const double ticks_per_ns = lhf::probe_ticks_per_ns();
+	const long rss_before = peak_rss_kb();
+
+	uint64_t t0 = lhf::probe_ticks();
+	std::vector<Set> corpus;
+	for (const auto &s : w.corpus) {
+		corpus.push_back(Ops::make(s));
+	}
+	r.build_ns = (lhf::probe_ticks() - t0) / ticks_per_ns;
+
+	uint64_t op_ticks = 0;
+	for (const Workload::Op &op : w.ops) {
+		if (op.type == 'S') {
+			for (uint32_t i = op.a; i <= op.b; i++) {
+				corpus.push_back(corpus[i]);
+			}
+			continue;
+		}
+
+		Set result;
+		Set left_inline, right_inline;
+
+		uint64_t start = lhf::probe_ticks();
+		if (closed_world) {
+			result = Ops::apply(op.type, corpus[op.a], corpus[op.b]);
+		} else {
+			left_inline = Ops::make(w.sets[op.a]);
+			right_inline = Ops::make(w.sets[op.b]);
+			result = Ops::apply(op.type, left_inline, right_inline);
+		}
+		op_ticks += lhf::probe_ticks() - start;
+		r.operations++;
+
+		if (verify && op.result >= 0) {
+			Set expected = Ops::make(w.sets[op.result]);
+			if (!(Ops::normalize(result) == expected)) {
+				std::snprintf(r.error, sizeof(r.error), "result mismatch at operation %llu",
+					(unsigned long long) r.operations);
+				return;
+			}
+		}
+	}
+
+	r.op_ns = op_ticks / ticks_per_ns;
+	r.peak_rss_kb = peak_rss_kb();
+	r.rss_delta_kb = r.peak_rss_kb - rss_before;
+}
+
+/// Pre-instantiated variants, by implementation name.
+struct Implementation {
+	const char *name;
+	void (*run[2])(const Workload &, bool, bool, RunResult &);
+};
+
+static const Implementation IMPLEMENTATIONS[] = {
+	{ "lhf", {
+		run_variant<lhf_impl::test::PointeeSet, true, 1>,
+		run_variant<lhf_impl::test::PointsToSet, true, 2> } },
+	{ "naive", {
+		run_variant<naive_impl::test::PointeeSet, false, 1>,
+		run_variant<naive_impl::test::PointsToSet, false, 2> } },
+};
+
+static const Implementation *find_implementation(const std::string &name) {
+	for (const Implementation &i : IMPLEMENTATIONS) {
+		if (name == i.name) {
+			return &i;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Runs one variant on a workload in a child process.
+ */
+static RunResult run_isolated(const Implementation &impl, const Series &series, const Workload &w, bool verify) {
+	RunResult result;
+	int fds[2];
+	if (pipe(fds) < 0) {
+		std::snprintf(result.error, sizeof(result.error), "pipe: %s", strerror(errno));
+		return result;
+	}
+
+	std::cout.flush();
+	pid_t pid = fork();
+	if (pid < 0) {
+		std::snprintf(result.error, sizeof(result.error), "fork: %s", strerror(errno));
+		return result;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+		RunResult r;
+		try {
+			impl.run[series.arity - 1](w, series.kind == lhf::WORKLOAD_CLOSED_WORLD, verify, r);
+		} catch (const std::exception &e) {
+			std::snprintf(r.error, sizeof(r.error), "%s", e.what());
+		}
+		ssize_t written = write(fds[1], &r, sizeof(r));
+		_exit(written == sizeof(r) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	ssize_t got = read(fds[0], &result, sizeof(result));
+	close(fds[0]);
+
+	int status;
+	waitpid(pid, &status, 0);
+	if (got != sizeof(result)) {
+		result = RunResult();
+		std::snprintf(result.error, sizeof(result.error), "child exited abnormally (status %d)", status);
+	}
+	return result;
+}
+
+struct Options {
+	int repetitions = 1;
+	int warmup = 0;
+	bool verify = false;
+	std::string csv_path;
+	std::vector<uint64_t> counts;
+	lhf::WorkloadConfig workload;
+};
+
+static const char *CSV_HEADER =
+	"series,implementation,workload,operations,repetition,build_ms,op_ms,ops_per_s,rss_delta_kb,peak_rss_kb,status";
+
+/**
+ * Runs the warm-up and measured repetitions of one variant, and reports every
+ * measured one.
+ */
+static bool measure(
+	const Implementation &impl,
+	const Series &series,
+	const std::string &label,
+	const Workload &w,
+	const Options &opt) {
+	std::ofstream csv;
+	if (!opt.csv_path.empty()) {
+		bool is_new = !std::ifstream(opt.csv_path).good();
+		csv.open(opt.csv_path, std::ios::app);
+		if (is_new) {
+			csv << CSV_HEADER << "\n";
+		}
+	}
+
+	bool ok = true;
+	for (int i = 0; i < opt.warmup; i++) {
+		run_isolated(impl, series, w, false);
+	}
+
+	for (int rep = 0; rep < opt.repetitions; rep++) {
+		RunResult r = run_isolated(impl, series, w, opt.verify);
+		std::string status = r.error[0] ? r.error : "ok";
+		ok = ok && !r.error[0];
+
+		double op_ms = r.op_ns / 1e6;
+		double ops_per_s = r.op_ns > 0 ? r.operations / (r.op_ns / 1e9) : 0;
+
+		printf("%-22s %-6s %-34s rep %d: build %9.3f ms, ops %10.3f ms (%12.0f ops/s), RSS +%ld KB (peak %ld KB) %s\n",
+			series.name, impl.name, label.c_str(), rep,
+			r.build_ns / 1e6, op_ms, ops_per_s, r.rss_delta_kb, r.peak_rss_kb, status.c_str());
+
+		if (csv.is_open()) {
+			std::string quoted = status;
+			std::replace(quoted.begin(), quoted.end(), ',', ';');
+			csv << series.name << "," << impl.name << "," << label << "," << r.operations << ","
+			    << rep << "," << r.build_ns / 1e6 << "," << op_ms << "," << ops_per_s << ","
+			    << r.rss_delta_kb << "," << r.peak_rss_kb << "," << quoted << "\n";
+		}
+	}
+
+	std::fflush(stdout);
+	return ok;
+}
+
+static void generate(const Series &series, lhf::WorkloadConfig config, Workload &w) {
+	config.kind = series.kind;
+	config.arity = series.arity;
+
+	w = Workload();
+	w.arity = series.arity;
+	lhf::WorkloadGenerator(config).generate(w);
+}
+
+static std::string workload_label(const lhf::WorkloadConfig &c) {
+	const char *dist[] = { "uniform", "normal", "optimistic" };
+	return std::string(dist[c.dist]) + "/" + std::to_string(c.count);
+}
+
+/// Operation counts of `run_all_tests_closedworld.sh`.
+static const std::vector<uint64_t> CLOSED_WORLD_COUNTS = {
+	100000, 200000, 500000, 1000000, 2000000, 4000000, 6000000, 8000000, 10000000
+};
+
+/// Operation counts of `run_all_tests_random.sh`.
+static const std::vector<uint64_t> RANDOM_COUNTS = { 5000, 10000, 15000, 20000, 25000, 30000 };
+
+/**
+ * The matrix of `run_bulk.sh`: the closed-world series with the optimistic
+ * and the uniform distribution, and the random series with the uniform
+ * distribution, each on both implementations. Every workload is generated
+ * once and reused by all its runs.
+ */
+static int run_bulk(Options opt) {
+	struct Group {
+		const char *series[2];
+		lhf::WorkloadDistribution dist;
+		const std::vector<uint64_t> *counts;
+	};
+
+	const Group groups[] = {
+		{ { "closed_world", "closed_world_pointsto" }, lhf::WORKLOAD_OPTIMISTIC, &CLOSED_WORLD_COUNTS },
+		{ { "random", "random_pointsto" }, lhf::WORKLOAD_UNIFORM, &RANDOM_COUNTS },
+		{ { "closed_world", "closed_world_pointsto" }, lhf::WORKLOAD_UNIFORM, &CLOSED_WORLD_COUNTS },
+	};
+
+	opt.workload.results = opt.verify;
+	bool ok = true;
+	Workload w;
+
+	for (const Group &g : groups) {
+		for (const char *name : g.series) {
+			const Series &series = *find_series(name);
+			for (uint64_t count : opt.counts.empty() ? *g.counts : opt.counts) {
+				lhf::WorkloadConfig config = opt.workload;
+				config.dist = g.dist;
+				config.count = count;
+				generate(series, config, w);
+
+				for (const Implementation &impl : IMPLEMENTATIONS) {
+					ok = measure(impl, series, workload_label(config), w, opt) && ok;
+				}
+			}
+		}
+	}
+
+	return ok ? 0 : 1;
+}
+
+static void usage(const char *name) {
+	printf(
+		"Usage: %s list\n"
+		"       %s run <series> <implementation> <workload file | --generate spec> [options]\n"
+		"       %s bulk [options]\n"
+		"Options:\n"
+		"  --repetitions n   measured runs of every variant (default 1, 3 for bulk)\n"
+		"  --warmup n        discarded runs before the measured ones\n"
+		"  --verify          check every result against the workload\n"
+		"  --csv file        append the results to a CSV file\n"
+		"  --counts a,b,...  bulk: operation counts in place of those of the scripts\n"
+		"  --maxsize n, --maxval n, --corpussize n, --seed n, --threads n\n"
+		"                    bulk: workload parameters (see workload_gen)\n",
+		name, name, name);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::string command = argv[1];
+	if (command == "list") {
+		for (const Series &s : SERIES) {
+			for (const Implementation &i : IMPLEMENTATIONS) {
+				printf("%s %s\n", s.name, i.name);
+			}
+		}
+		return 0;
+	}
+
+	int first_option = 2;
+	if (command == "run") {
+		first_option = argc > 4 && std::string(argv[4]) == "--generate" ? 6 : 5;
+	}
+	if ((command != "run" && command != "bulk") || argc < first_option) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	Options opt;
+	opt.repetitions = command == "bulk" ? 3 : 1;
+
+	try {
+		for (int i = first_option; i < argc; i++) {
+			std::string o = argv[i];
+			bool has_value = i + 1 < argc;
+
+			if (o == "--verify") {
+				opt.verify = true;
+			} else if (o == "--repetitions" && has_value) {
+				opt.repetitions = std::stoi(argv[++i]);
+			} else if (o == "--warmup" && has_value) {
+				opt.warmup = std::stoi(argv[++i]);
+			} else if (o == "--csv" && has_value) {
+				opt.csv_path = argv[++i];
+			} else if (o == "--counts" && has_value) {
+				std::stringstream list(argv[++i]);
+				std::string item;
+				while (std::getline(list, item, ',')) {
+					opt.counts.push_back(std::stoull(item));
+				}
+			} else if (o.rfind("--", 0) == 0 && has_value && opt.workload.set(o.substr(2), argv[i + 1])) {
+				i++;
+			} else {
+				printf("Unknown option: %s\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		}
+
+		// Calibrate the clock once, before the children are forked.
+		lhf::probe_ticks_per_ns();
+
+		if (command == "bulk") {
+			return run_bulk(opt);
+		}
+
+		const Series *series = find_series(argv[2]);
+		const Implementation *impl = find_implementation(argv[3]);
+		if (!series || !impl) {
+			printf("Unknown variant: %s %s (see '%s list')\n", argv[2], argv[3], argv[0]);
+			return 1;
+		}
+
+		Workload w;
+		std::string label;
+		std::string source = argv[4];
+
+		if (source == "--generate") {
+			lhf::WorkloadConfig config = lhf::WorkloadConfig::parse(argv[5]);
+			config.results = opt.verify;
+			generate(*series, config, w);
+			label = workload_label(config);
+		} else {
+			read_workload(source, *series, opt.verify, w);
+			label = source;
+		}
+
+		return measure(*impl, *series, label, w, opt) ? 0 : 1;
+	} catch (const std::exception &e) {
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -25,6 +25,11 @@ export CXX=g++
 export PYTHON=python3
 export TIME_EXEC="$(which time)"
 
+# Path of the C++ workload generator (`workload_gen` in the examples of an LHF
+# build). If empty, the test data is generated by the Python scripts.
+export TEST_WORKLOAD_GENERATOR="${TEST_WORKLOAD_GENERATOR:-}"
+export TEST_WORKLOAD_SEED="1"
+
 # Below are likely the variables of interest.
 
 export TEST_MAX_INT="10000"
@@ -5,6 +5,28 @@ set -o nounset
 
 . $ENVIRONMENT_TO_USE
 
+# Generates the test data with the C++ workload generator if
+# TEST_WORKLOAD_GENERATOR is set, and with the Python script otherwise.
+generate_data() {
+	if [ -n "$TEST_WORKLOAD_GENERATOR" ]; then
+		"$TIME_EXEC" -f 'Generator Wallclock Time: %e, Max RSS (KB): %M' \
+		"$TEST_WORKLOAD_GENERATOR" random "$TEST_DATA_FILE_NAME" --pairs \
+			--count "$1" \
+			--maxsize "$TEST_MAX_SET_SIZE" \
+			--maxval "$TEST_MAX_INT" \
+			--dist "$TEST_DISTRIBUTION" \
+			--seed "$TEST_WORKLOAD_SEED"
+	else
+		"$TIME_EXEC" -f 'Python Wallclock Time: %e, Max RSS (KB): %M' \
+		"$PYTHON" "$TEST_BENCHMARK_SCRIPT_NAME"\
+			--count "$1" \
+			--maxsize "$TEST_MAX_SET_SIZE" \
+			--maxval "$TEST_MAX_INT" \
+			--dist "$TEST_DISTRIBUTION" \
+			"$TEST_DATA_FILE_NAME"
+	fi
+}
+
 if [ "$1" = "clean" ]; then
 	rm -f $TEST_EXEC_FILE_NAME;
 	rm -f $TEST_DATA_FILE_NAME;
@@ -29,13 +51,7 @@ if [ "$1" = "run" ]; then
 	set -o xtrace
 
 	if [ ! "$OPER_COUNT" = "nochange" ]; then
-		"$TIME_EXEC" -f 'Python Wallclock Time: %e, Max RSS (KB): %M' \
-		"$PYTHON" "$TEST_BENCHMARK_SCRIPT_NAME"\
-			--count "$2" \
-			--maxsize "$TEST_MAX_SET_SIZE" \
-			--maxval "$TEST_MAX_INT" \
-			--dist "$TEST_DISTRIBUTION" \
-			"$TEST_DATA_FILE_NAME"
+		generate_data "$2"
 	fi
 
 	"$CXX" "$TEST_SRC_FILE_NAME" -o "$TEST_EXEC_FILE_NAME" \
@@ -67,12 +83,7 @@ if [ "$1" = "run-verify" ]; then
 	set -o xtrace
 
 	if [ ! "$OPER_COUNT" = "nochange" ]; then
-		"$PYTHON" "$TEST_BENCHMARK_SCRIPT_NAME"\
-			--count "$2" \
-			--maxsize "$TEST_MAX_SET_SIZE" \
-			--maxval "$TEST_MAX_INT" \
-			--dist "$TEST_DISTRIBUTION" \
-			"$TEST_DATA_FILE_NAME"
+		generate_data "$2"
 	fi
 
 	"$CXX" "$TEST_SRC_FILE_NAME" -o "$TEST_EXEC_FILE_NAME" \
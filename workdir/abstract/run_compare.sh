@@ -0,0 +1,62 @@
+#!/bin/bash
+# set -o xtrace
+set -o errexit
+set -o nounset
+
+# Replays every test series on LHF and on the other set implementations with
+# `trace_compare` (built with the LHF examples), and collects the results in
+# one CSV. Each data point is generated once as a binary trace by
+# `workload_gen` and replayed by all implementations, instead of being rebuilt
+# and rerun per implementation.
+#
+# Usage: ENVIRONMENT_TO_USE=<environment setup> bash run_compare.sh <LHF build directory> <output CSV> [operation counts...]
+
+. $ENVIRONMENT_TO_USE
+
+if [ -z "${2+x}" ]; then
+	echo "Usage: $0 <LHF build directory> <output CSV> [operation counts...]";
+	exit 1;
+fi
+
+TEST_ROOT="$(pwd)"
+EXAMPLES="$(realpath "$1")/examples"
+OUTPUT="$(realpath "$2")"
+shift 2
+
+COUNTS="${*:-100000 200000 500000 1000000 2000000}"
+
+run_series() {
+	SERIES="$1"
+	KIND="$2"
+	EXTRA_FLAGS="$3"
+
+	echo "@@@@@@@@@ Test Series $SERIES @@@@@@@@"
+	cd "$TEST_ROOT/$SERIES"
+
+	CORPUS_FLAG=""
+	if [ "$KIND" = "closed_world" ]; then
+		CORPUS_FLAG="--corpussize $TEST_CORPUS_SIZE"
+	fi
+
+	for COUNT in $COUNTS; do
+		echo "@@@@ Running test $COUNT @@@@"
+		TRACE="${SERIES}_${COUNT}.lhft"
+
+		"$EXAMPLES/workload_gen" "$KIND" "$TRACE" --trace --no-results $EXTRA_FLAGS \
+			--count "$COUNT" \
+			--maxsize "$TEST_MAX_SET_SIZE" \
+			--maxval "$TEST_MAX_INT" \
+			--dist "$TEST_DISTRIBUTION" \
+			--seed "$TEST_WORKLOAD_SEED" \
+			$CORPUS_FLAG
+
+		"$EXAMPLES/trace_compare" "$TRACE" --csv "$OUTPUT"
+
+		rm -f "$TRACE"
+	done
+}
+
+run_series "closed_world" closed_world ""
+run_series "closed_world_pointsto" closed_world "--pairs"
+run_series "random" random ""
+run_series "random_pointsto" random "--pairs"
@@ -0,0 +1,31 @@
+#!/bin/bash
+# set -o xtrace
+set -o errexit
+set -o nounset
+
+# Builds the benchmark driver (`driver/driver.cpp`) once, then runs the
+# `run_bulk.sh` matrix for both implementations with it, writing one CSV. Any
+# arguments after the output CSV are passed to the driver, e.g.
+# `--repetitions 5 --warmup 1 --verify`.
+#
+# Usage: ENVIRONMENT_TO_USE=<environment setup> bash run_driver.sh <output CSV> [driver options...]
+
+. $ENVIRONMENT_TO_USE
+
+if [ -z "${1+x}" ]; then
+	echo "Usage: $0 <output CSV> [driver options...]";
+	exit 1;
+fi
+
+OUTPUT="$(realpath "$1")"
+shift
+
+cd driver
+$CXX -std=c++17 -O3 -DNDEBUG -I"$TEST_INCLUDE_DIR" -I"$TEST_LHF_INCLUDE_DIR" driver.cpp -o driver_out -pthread
+
+./driver_out bulk --csv "$OUTPUT" \
+	--maxsize "$TEST_MAX_SET_SIZE" \
+	--maxval "$TEST_MAX_INT" \
+	--corpussize "$TEST_CORPUS_SIZE" \
+	--seed "$TEST_WORKLOAD_SEED" \
+	"$@"
@@ -9,6 +9,7 @@ if __name__ == '__main__':
     parser.add_argument("--PRINTSTATS", help="Print statistics after analysis", action="store_true")
     parser.add_argument("--SIMPLE_PRINT", help="Prints required data", action="store_true")
     parser.add_argument("--SLIMIR", help="Prints SLIM instructions", action="store_true")
+    parser.add_argument("--SUMMARY_CACHE", help="Reuse function summaries from the directory in VASCO_SUMMARY_CACHE", action="store_true")
     res = parser.parse_args()
 
     Result = " "
@@ -31,4 +32,7 @@ if __name__ == '__main__':
     if res.SHOW_OUTPUT:
         Result += "SHOW_OUTPUT "
 
+    if res.SUMMARY_CACHE:
+        Result += "SUMMARY_CACHE "
+
     print(Result)
@@ -12,11 +12,13 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <list>
 #include <map>
 #include <ostream>
 #include <set>
@@ -25,11 +27,19 @@
 #include <unistd.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Context.h"
+#include "InstructionValues.h"
 #include "Worklist.h"
 // #include "TransformIR.h"
 #include "TransitionGraph.h"
+#ifdef SUMMARY_CACHE
+#include "SummaryCache.h"
+#include "llvm/Support/FileSystem.h"
+#include <cstdlib>
+#include <memory>
+#endif
 
 #include "IR.h"
 #include "sample.hpp"
@@ -93,6 +103,17 @@ inline void process_mem_usage(float &vm_usage, float &resident_set) {}
 
 #endif
 
+/*
+ * Functions of `functions` sorted by name. The callees of an indirect call are
+ * visited in this order, so that the labels of the contexts created for them
+ * do not depend on where the functions happen to be allocated.
+ */
+inline std::vector<Function *> inNameOrder(const std::set<Function *> &functions) {
+    std::vector<Function *> ordered(functions.begin(), functions.end());
+    std::sort(ordered.begin(), ordered.end(), [](Function *a, Function *b) { return a->getName() < b->getName(); });
+    return ordered;
+}
+
 inline void printMemory(float memory, std::ofstream &out) {
     out << fixed;
     out << setprecision(6);
@@ -156,6 +177,95 @@ reinterpret_cast<size_t>(P.first.second);
 
 typedef enum { FSFP, FSSP, FIFP, FISP } ExecMode;
 
+// True when std::hash accepts T. This holds for the LHF set types, whose values
+// are canonical indices, but not for the set types of NAIVE_MODE.
+template <typename T, typename = void>
+struct IsHashable : std::false_type {};
+
+template <typename T>
+struct IsHashable<T, std::void_t<decltype(std::hash<T>()(std::declval<const T &>()))>> : std::true_type {};
+
+// Number of flow function results the memo keeps for each direction before it
+// evicts the least recently used one.
+#ifndef FLOW_MEMO_LIMIT
+#define FLOW_MEMO_LIMIT (1 << 15)
+#endif
+
+// Values stored at a SLIM instruction that its flow functions may read. See
+// getForwardFlowFunctionReads.
+typedef enum {
+    READS_FORWARD_IN = 1,
+    READS_FORWARD_OUT = 2,
+    READS_BACKWARD_IN = 4,
+    READS_BACKWARD_OUT = 8,
+    READS_ALL = 15
+} FlowFunctionReads;
+
+// Inputs of a flow function applied to a SLIM instruction: the instruction and
+// the values it reads at its IN and OUT, the others being left empty. See
+// computeOutFromInMemoized.
+template <class F, class B>
+struct FlowFunctionKey {
+    long long instruction_id;
+    pair<F, B> in, out;
+
+    bool operator==(const FlowFunctionKey &other) const {
+        return instruction_id == other.instruction_id && in == other.in && out == other.out;
+    }
+};
+
+template <class F, class B>
+struct FlowFunctionKeyHash {
+    size_t operator()(const FlowFunctionKey<F, B> &key) const {
+        size_t hash = std::hash<long long>()(key.instruction_id);
+        hash = lhf::compose_hash(hash, std::hash<F>()(key.in.first));
+        hash = lhf::compose_hash(hash, std::hash<B>()(key.in.second));
+        hash = lhf::compose_hash(hash, std::hash<F>()(key.out.first));
+        return lhf::compose_hash(hash, std::hash<B>()(key.out.second));
+    }
+};
+
+// Flow function results of one direction, V being its value type. Holds at
+// most FLOW_MEMO_LIMIT entries and evicts the least recently used one past
+// that, so that it does not grow with contexts x instructions.
+template <class F, class B, class V>
+class FlowFunctionMemo {
+    typedef list<pair<FlowFunctionKey<F, B>, V>> EntryList;
+
+    EntryList entries; // Most recently used first.
+    unordered_map<FlowFunctionKey<F, B>, typename EntryList::iterator, FlowFunctionKeyHash<F, B>> index;
+
+public:
+    // Returns the result stored for key, or nullptr.
+    const V *find(const FlowFunctionKey<F, B> &key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return nullptr;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->second;
+    }
+
+    void insert(FlowFunctionKey<F, B> key, const V &value) {
+        if (index.count(key)) {
+            return;
+        }
+        if (entries.size() >= FLOW_MEMO_LIMIT) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+        entries.emplace_front(std::move(key), value);
+        index.emplace(entries.front().first, entries.begin());
+    }
+
+    void clear() {
+        index.clear();
+        entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+};
+
 template <class F, class B>
 class Analysis {
 private:
@@ -164,9 +274,12 @@ private:
     int current_analysis_direction{}; // 0:initial pass, 1:forward, 2:backward
     int processing_context_label{};
     std::unordered_map<int, unordered_map<llvm::Instruction *, pair<F, B>>> IN, OUT;
-    std::unordered_map<int, unordered_map<BaseInstruction *, pair<F, B>>> SLIM_IN, SLIM_OUT;
+    // Indexed by context label, then by SLIM instruction ID (see
+    // InstructionValues.h).
+    std::vector<InstructionValues<F, B>> SLIM_IN, SLIM_OUT;
     // mod:AR
-    std::unordered_map<Function *, unordered_map<BaseInstruction *, pair<F, B>>> SLIM_IN_ALL, SLIM_OUT_ALL;
+    std::unordered_map<Function *, InstructionValues<F, B>> SLIM_IN_ALL, SLIM_OUT_ALL;
+    InstructionIDRanges instruction_id_ranges;
 
     std::list<BasicBlock *> backwardsBBList, forwardsBBList;
     std::unordered_map<int, unordered_map<Function *, F>> DFVALUE;
@@ -195,6 +308,56 @@ private:
     std::unique_ptr<llvm::Module> moduleUniquePtr;
     std::chrono::milliseconds AnalysisTime, backward_time, forward_time;
 
+    // Results of the SLIM flow functions, for clients that opt in with
+    // isFlowFunctionMemoizable. Emptied whenever the client tables version
+    // moves on.
+    FlowFunctionMemo<F, B, F> forward_flow_memo;
+    FlowFunctionMemo<F, B, B> backward_flow_memo;
+    unsigned long long flow_memo_tables_version = 0;
+
+    // Whether SLIM_IN and SLIM_OUT keep only the values at block boundaries,
+    // for clients that opt in with useBlockGranularStorage. The values at the
+    // other instructions of one block of one context at a time are kept in
+    // replayed_block, either as written by the flow function of the block or
+    // as replayed from its boundary value for a direction on first read.
+    bool block_granular_storage = false;
+    struct ReplayedBlock {
+        int label = -1;
+        BasicBlock *block = nullptr;
+        bool forward = false, backward = false;
+        unordered_map<BaseInstruction *, pair<F, B>> in, out;
+    } replayed_block;
+
+#ifdef SUMMARY_CACHE
+    // Function summaries kept in the directory named by VASCO_SUMMARY_CACHE
+    // (see SummaryCache.h).
+    std::string summary_directory;
+    unordered_map<Function *, FunctionSummaries> summary_files;
+    // Contexts whose outflows were read from the cache, with the effects
+    // replayed for them. Their blocks are never analysed.
+    unordered_map<int, vector<std::string>> summary_contexts;
+    // The contexts each of them reached in the run that wrote it, read with
+    // its results.
+    struct SummaryReached {
+        Function *function;
+        pair<F, B> Inflow;
+        InstructionValues<F, B> in, out;
+    };
+    unordered_map<int, vector<SummaryReached>> summary_reached;
+    // Functions that changed the client tables while being analysed, and the
+    // effects logged while analysing each context.
+    unordered_set<Function *> summary_unsound;
+    unordered_map<int, vector<size_t>> summary_effects;
+    int summary_current_context = -1;
+    // Contexts whose outflow was read, and the contexts that are not recorded:
+    // those whose outflow changed after it was read, and those another context
+    // started from.
+    unordered_set<int> summary_outflow_read, summary_unsettled;
+    unsigned long long summary_tables_version = 0;
+    size_t summary_effects_seen = 0;
+    long summaryHitCount = 0, summaryMissCount = 0, summaryFilesWritten = 0;
+#endif
+
 #ifdef PRINTSTATS
 
     // std::chrono::milliseconds SLIMTime; // SplittingBBTime;
@@ -202,6 +365,8 @@ private:
     //++++++++++++++++++++++++++++++++++++++++++++++++++++
     long F_BBanalysedCount = 0, B_BBanalysedCount = 0;
     long contextReuseCount = 0;
+    long forwardMemoHitCount = 0, forwardMemoMissCount = 0;
+    long backwardMemoHitCount = 0, backwardMemoMissCount = 0;
     long forwardsRoundCount = 0, backwardsRoundCount = 0;
     unordered_map<pair<int, BaseInstruction *>, pair<F, B>, HashFunction> all_onflow_information;
     // #BBCOUNTPERROUND
@@ -211,7 +376,14 @@ private:
 protected:
     // List of contexts
     unordered_set<int> ProcedureContext;
-    Worklist<pair<pair<int, BasicBlock *>, bool>, HashFunction> backward_worklist, forward_worklist;
+    // Contexts bucketed by the hash of their function and inflow, oldest
+    // first, so that check_if_context_already_exists only compares the
+    // contexts of one bucket. Maintained by the inflow setters. Only used when
+    // F and B are hashable.
+    unordered_map<size_t, vector<int>> context_index;
+    unordered_map<int, size_t> context_index_key;
+    BlockWorklist<WorklistDirection::BACKWARD> backward_worklist;
+    BlockWorklist<WorklistDirection::FORWARD> forward_worklist;
 
     // mapping from (context label,call site) to target context label
     unordered_map<pair<int, llvm::Instruction *>, int, HashFunction> context_transition_graph;
@@ -229,6 +401,11 @@ protected:
 
     DumpPointsToInfo indirect_functions_obj;
 
+#ifdef SUMMARY_CACHE
+    // Stable names for the module, null unless VASCO_SUMMARY_CACHE is set.
+    std::unique_ptr<SummaryKeys> summary_keys;
+#endif
+
 public:
     Analysis(){};
 
@@ -275,6 +452,12 @@ public:
 
     int check_if_context_already_exists(llvm::Function *, const pair<F, B> &, const pair<F, B> &);
 
+    size_t getContextIndexKey(llvm::Function *, const pair<F, B> &);
+
+    void indexContext(int);
+
+    int findIndexedContext(llvm::Function *, const pair<F, B> &);
+
     void doAnalysisForward();
 
     void doAnalysisBackward();
@@ -410,6 +593,97 @@ public:
     virtual B computeInFromOut(llvm::Instruction &I);
     virtual B computeInFromOut(BaseInstruction *I);
 
+    // Memoization of computeOutFromIn and computeInFromOut on SLIM
+    // instructions, off unless the client overrides isFlowFunctionMemoizable.
+    // A client that opts in promises that its flow functions read nothing but
+    // the instruction, the values stored at its IN and OUT, and tables whose
+    // every change moves getFlowFunctionTablesVersion. Narrowing the
+    // FlowFunctionReads of a direction to what its flow function actually
+    // reads raises the hit rate.
+    virtual bool isFlowFunctionMemoizable() const {
+        return false;
+    }
+    virtual unsigned long long getFlowFunctionTablesVersion() const {
+        return 0;
+    }
+    virtual unsigned getForwardFlowFunctionReads() const {
+        return READS_ALL;
+    }
+    virtual unsigned getBackwardFlowFunctionReads() const {
+        return READS_ALL;
+    }
+    bool lookupFlowFunctionMemo(BaseInstruction *, unsigned, FlowFunctionKey<F, B> &);
+    F computeOutFromInMemoized(BaseInstruction *I);
+    B computeInFromOutMemoized(BaseInstruction *I);
+
+    // Block-granular storage of the SLIM values, off unless the client
+    // overrides useBlockGranularStorage and narrows the FlowFunctionReads of
+    // its forward flow function to READS_FORWARD_IN and of its backward one
+    // to READS_BACKWARD_OUT. Only the values at the first and last
+    // instructions of each block, and at every instruction of blocks with a
+    // call, are kept; the others are recomputed from the block boundary when
+    // read, which needs flow functions that depend on nothing else. The
+    // blocks are marked changed on their boundary values only, which the same
+    // promise makes exact.
+    virtual bool useBlockGranularStorage() const {
+        return false;
+    }
+    void claimReplayedBlock(int, BasicBlock *);
+    void replayBlockValues(int, BaseInstruction *, bool);
+    pair<F, B> &getSLIMValue(std::vector<InstructionValues<F, B>> &, int, BaseInstruction *, bool);
+    pair<F, B> *findSLIMValue(std::vector<InstructionValues<F, B>> &, int, BaseInstruction *);
+
+#ifdef SUMMARY_CACHE
+    // Persistent function summaries, off unless the client accepts functions
+    // in isFunctionSummaryCacheable. A context created for an accepted
+    // function whose inflow was seen by an earlier run takes its outflow and
+    // results from the cache, and its blocks are not analysed. The client
+    // converts its values to and from SummaryValue. Changes to its tables that a skipped
+    // function would have made must either move getSummaryTablesVersion, which
+    // keeps the function out of the cache, or be logged as effects, which are
+    // stored with the summaries and replayed when they are reused.
+    virtual bool isFunctionSummaryCacheable(llvm::Function *) {
+        return false;
+    }
+    virtual bool encodeSummaryValueForward(const F &, SummaryValue &) {
+        return false;
+    }
+    virtual bool decodeSummaryValueForward(const SummaryValue &, F &) {
+        return false;
+    }
+    virtual bool encodeSummaryValueBackward(const B &, SummaryValue &) {
+        return false;
+    }
+    virtual bool decodeSummaryValueBackward(const SummaryValue &, B &) {
+        return false;
+    }
+    virtual unsigned long long getSummaryTablesVersion() const {
+        return 0;
+    }
+    virtual size_t getSummaryEffectCount() const {
+        return 0;
+    }
+    virtual bool encodeSummaryEffect(size_t, std::string &) {
+        return false;
+    }
+    virtual bool replaySummaryEffect(const std::string &) {
+        return false;
+    }
+    void openSummaryCache(llvm::Module &M);
+    FunctionSummaries &getFunctionSummaries(llvm::Function *);
+    std::string getSummaryPath(llvm::Function *);
+    bool collectSummaryClosure(llvm::Function *, vector<Function *> &);
+    bool initSummaryContext(llvm::Function *, const std::pair<F, B> &);
+    bool encodeSummaryInstructions(llvm::Function *, InstructionValues<F, B> &, InstructionValues<F, B> &,
+                                   SummaryInstructionValues &);
+    bool decodeSummaryInstructions(llvm::Function *, const SummaryInstructionValues &, InstructionValues<F, B> &,
+                                   InstructionValues<F, B> &);
+    void trackSummaryBlock(int);
+    void saveSummaryCache();
+    void addSummaryResultContexts();
+    void printSummaryReuse();
+#endif
+
     virtual B getBoundaryInformationBackward();                               //{}
     virtual B getInitialisationValueBackward();                               //{}
     virtual B performMeetBackward(const B &d1, const B &d2) const;            //{}
@@ -511,6 +785,10 @@ public:
     // BaseInstruction * getBaseInstruction(long long id);
     // BaseInstruction * getBaseIns(long long id, SLIM);
     void setSLIMIRPointer(slim::IR *slimIRptr);
+    void bindSLIMValues(InstructionValues<F, B> &values, Function *function);
+    InstructionValues<F, B> &getSLIMValues(std::vector<InstructionValues<F, B>> &values, int label);
+    InstructionValues<F, B> &
+    getSLIMValues(std::unordered_map<Function *, InstructionValues<F, B>> &values, Function *function);
 
     // ----------------------------------------------
     // ----------------------------------------------
@@ -595,6 +873,143 @@ void Analysis<F, B>::setSLIMIRPointer(slim::IR *slimIRptr) {
     this->optIR = slimIRptr;
 }
 
+// Values of the context `label` in SLIM_IN or SLIM_OUT. The array of a context
+// is sized for its function on first use.
+template <class F, class B>
+InstructionValues<F, B> &Analysis<F, B>::getSLIMValues(std::vector<InstructionValues<F, B>> &values, int label) {
+    assert(label >= 0 && "Context labels are expected to be non-negative");
+    if (values.size() <= static_cast<size_t>(label)) {
+        values.resize(label + 1);
+    }
+    InstructionValues<F, B> &context_values = values[label];
+    if (!context_values.isBound()) {
+        auto context = context_label_to_context_object_map.find(label);
+        if (context != context_label_to_context_object_map.end()) {
+            bindSLIMValues(context_values, context->second->getFunction());
+        }
+    }
+    return context_values;
+}
+
+// Binds the values of a context of the function, to its block boundaries only
+// under block-granular storage.
+template <class F, class B>
+void Analysis<F, B>::bindSLIMValues(InstructionValues<F, B> &values, Function *function) {
+    values.bind(instruction_id_ranges.range(optIR, function),
+                block_granular_storage ? &instruction_id_ranges.boundarySlots(optIR, function) : nullptr);
+}
+
+template <class F, class B>
+InstructionValues<F, B> &
+Analysis<F, B>::getSLIMValues(std::unordered_map<Function *, InstructionValues<F, B>> &values, Function *function) {
+    InstructionValues<F, B> &function_values = values[function];
+    if (!function_values.isBound()) {
+        function_values.bind(instruction_id_ranges.range(optIR, function));
+    }
+    return function_values;
+}
+
+// Makes replayed_block hold the values of the block in the context, dropping
+// those of any other block.
+template <class F, class B>
+void Analysis<F, B>::claimReplayedBlock(int label, BasicBlock *block) {
+    if (replayed_block.label != label || replayed_block.block != block) {
+        replayed_block.label = label;
+        replayed_block.block = block;
+        replayed_block.forward = replayed_block.backward = false;
+        replayed_block.in.clear();
+        replayed_block.out.clear();
+    }
+}
+
+// Recomputes the values of one direction at the instructions of the block of
+// I that are not kept under block-granular storage, starting from those of the
+// kept instruction before them in that direction, as NormalFlowFunctionForward
+// and NormalFlowFunctionBackward do.
+template <class F, class B>
+void Analysis<F, B>::replayBlockValues(int label, BaseInstruction *I, bool forward) {
+    claimReplayedBlock(label, I->getBasicBlock());
+    bool &replayed = forward ? replayed_block.forward : replayed_block.backward;
+    if (replayed) {
+        return;
+    }
+    replayed = true;
+    if (forward ? std::is_same<F, NoAnalysisType>::value : std::is_same<B, NoAnalysisType>::value) {
+        return;
+    }
+
+    int processing_label = getProcessingContextLabel();
+    BaseInstruction *processing_instruction = getCurrentInstruction();
+    setProcessingContextLabel(label);
+    // Not kept across the flow functions, which may add contexts.
+    auto in = [&]() -> InstructionValues<F, B> & { return getSLIMValues(SLIM_IN, label); };
+    auto out = [&]() -> InstructionValues<F, B> & { return getSLIMValues(SLIM_OUT, label); };
+    auto &block = optIR->func_bb_to_inst_id[{context_label_to_context_object_map[label]->getFunction(),
+                                              I->getBasicBlock()}];
+    if (forward) {
+        F prev;
+        for (long long index : block) {
+            BaseInstruction *inst = optIR->inst_id_to_object[index];
+            if (in().holds(inst)) {
+                prev = out()[inst].first;
+                continue;
+            }
+            setCurrentInstruction(inst);
+            replayed_block.in[inst].first = prev;
+            if (!isIgnorableInstruction(inst)) {
+                prev = computeOutFromInMemoized(inst);
+            }
+            replayed_block.out[inst].first = prev;
+        }
+    } else {
+        B prev;
+        for (long long index : optIR->getReverseInstList(block)) {
+            BaseInstruction *inst = optIR->inst_id_to_object[index];
+            if (in().holds(inst)) {
+                prev = in()[inst].second;
+                continue;
+            }
+            setCurrentInstruction(inst);
+            replayed_block.out[inst].second = prev;
+            if (!isIgnorableInstruction(inst)) {
+                prev = computeInFromOutMemoized(inst);
+            }
+            replayed_block.in[inst].second = prev;
+        }
+    }
+    setProcessingContextLabel(processing_label);
+    setCurrentInstruction(processing_instruction);
+}
+
+// The values of the context at I in SLIM_IN or SLIM_OUT, replaying those of
+// the given direction in its block first if they are not kept.
+template <class F, class B>
+pair<F, B> &Analysis<F, B>::getSLIMValue(std::vector<InstructionValues<F, B>> &values, int label,
+                                         BaseInstruction *I, bool forward) {
+    InstructionValues<F, B> &context_values = getSLIMValues(values, label);
+    if (context_values.holds(I)) {
+        return context_values[I];
+    }
+    replayBlockValues(label, I, forward);
+    return &values == &SLIM_IN ? replayed_block.in[I] : replayed_block.out[I];
+}
+
+// Where to store the values of the context at I in SLIM_IN or SLIM_OUT, or
+// null if they are not kept and would be replayed anyway: outside the flow
+// function of its block, a value written there is derived from the boundary.
+template <class F, class B>
+pair<F, B> *Analysis<F, B>::findSLIMValue(std::vector<InstructionValues<F, B>> &values, int label,
+                                          BaseInstruction *I) {
+    InstructionValues<F, B> &context_values = getSLIMValues(values, label);
+    if (context_values.holds(I)) {
+        return &context_values[I];
+    }
+    if (replayed_block.label != label || replayed_block.block != I->getBasicBlock()) {
+        return nullptr;
+    }
+    return &values == &SLIM_IN ? &replayed_block.in[I] : &replayed_block.out[I];
+}
+
 /*
 template<class F, class B>
 BaseInstruction * Analysis<F,B>::getBaseInstruction(long long id){
@@ -606,7 +1021,7 @@ BaseInstruction * Analysis<F,B>::getBaseInstruction(long long id){
 template <class F, class B>
 F Analysis<F, B>::getForwardComponentAtInOfThisInstruction(BaseInstruction *I, int label) {
     // int label = getProcessingContextLabel();
-    return SLIM_IN[label][I].first;
+    return getSLIMValue(SLIM_IN, label, I, true).first;
 }
 
 // mod:AR
@@ -634,65 +1049,65 @@ void Analysis<F, B>::printBasicBlockLists() {
 
 template <class F, class B>
 F Analysis<F, B>::getAllForwardComponentAtInOfThisInstruction(Function *function, BaseInstruction *I) {
-    return SLIM_IN_ALL[function][I].first;
+    return getSLIMValues(SLIM_IN_ALL, function)[I].first;
 }
 
 template <class F, class B>
 F Analysis<F, B>::getAllForwardComponentAtOutOfThisInstruction(Function *function, BaseInstruction *I) {
-    return SLIM_OUT_ALL[function][I].first;
+    return getSLIMValues(SLIM_OUT_ALL, function)[I].first;
 }
 
 template <class F, class B>
 B Analysis<F, B>::getAllBackwardComponentAtInOfThisInstruction(Function *function, BaseInstruction *I) {
-    return SLIM_IN_ALL[function][I].second;
+    return getSLIMValues(SLIM_IN_ALL, function)[I].second;
 }
 
 template <class F, class B>
 B Analysis<F, B>::getAllBackwardComponentAtOutOfThisInstruction(Function *function, BaseInstruction *I) {
-    return SLIM_OUT_ALL[function][I].second;
+    return getSLIMValues(SLIM_OUT_ALL, function)[I].second;
 }
 
 template <class F, class B>
 void Analysis<F, B>::setAllForwardComponentAtInOfThisInstruction(
     Function *function, BaseInstruction *I, const F &in_value) {
-    SLIM_IN_ALL[function][I].first = in_value;
+    getSLIMValues(SLIM_IN_ALL, function)[I].first = in_value;
 }
 
 template <class F, class B>
 void Analysis<F, B>::setAllForwardComponentAtOutOfThisInstruction(
     Function *function, BaseInstruction *I, const F &out_value) {
-    SLIM_OUT_ALL[function][I].first = out_value;
+    getSLIMValues(SLIM_OUT_ALL, function)[I].first = out_value;
 }
 
 template <class F, class B>
 void Analysis<F, B>::setAllBackwardComponentAtInOfThisInstruction(
     Function *function, BaseInstruction *I, const B &in_value) {
-    SLIM_IN_ALL[function][I].second = in_value;
+    getSLIMValues(SLIM_IN_ALL, function)[I].second = in_value;
 }
 
 template <class F, class B>
 void Analysis<F, B>::setAllBackwardComponentAtOutOfThisInstruction(
     Function *function, BaseInstruction *I, const B &out_value) {
-    SLIM_OUT_ALL[function][I].second = out_value;
+    getSLIMValues(SLIM_OUT_ALL, function)[I].second = out_value;
 }
 
 //-----------
 template <class F, class B>
 F Analysis<F, B>::getForwardComponentAtOutOfThisInstruction(BaseInstruction *I, int label) {
     // int label = getProcessingContextLabel();
-    return SLIM_OUT[label][I].first;
+    return getSLIMValue(SLIM_OUT, label, I, true).first;
 }
 
 template <class F, class B>
 B Analysis<F, B>::getBackwardComponentAtInOfThisInstruction(BaseInstruction *I, int label) {
     // int label = getProcessingContextLabel();
-    return SLIM_IN[label][I].second;
+    return getSLIMValue(SLIM_IN, label, I, false).second;
 }
 
 template <class F, class B>
 B Analysis<F, B>::getBackwardComponentAtOutOfThisInstruction(BaseInstruction *I, int label) {
     // int label = getProcessingContextLabel();
-    return SLIM_OUT[label][I].second;
+    return getSLIMValue(SLIM_OUT, label, I, false).second;
 }
 
 template <class F, class B>
@@ -999,6 +1414,9 @@ void Analysis<F, B>::doAnalysis(std::unique_ptr<llvm::Module> &Mod, slim::IR *sl
     if (SLIM) {
         setSLIMIRPointer(slimIRObj);
     }
+    block_granular_storage = SLIM && useBlockGranularStorage() &&
+                             (getForwardFlowFunctionReads() & ~READS_FORWARD_IN) == 0 &&
+                             (getBackwardFlowFunctionReads() & ~READS_BACKWARD_OUT) == 0;
 
     // llvm::outs() << "Inside doAnalysis with SLIM parameter as " << SLIM <<
     // "\n";
@@ -2327,6 +2745,10 @@ void Analysis<F, B>::printStatistics() {
     llvm::outs() << " \nTotal number of BB analysed during Forward Analysis = " << F_BBanalysedCount;
     llvm::outs() << " \nTotal number of BB analysed during Backward Analysis = " << B_BBanalysedCount;
     llvm::outs() << " \nTotal number of times Context is Reused = " << contextReuseCount;
+    llvm::outs() << " \nFlow function memo (hits, misses) during Forward Analysis = (" << forwardMemoHitCount
+                 << ", " << forwardMemoMissCount << ")";
+    llvm::outs() << " \nFlow function memo (hits, misses) during Backward Analysis = (" << backwardMemoHitCount
+                 << ", " << backwardMemoMissCount << ")";
 
     llvm::outs() << " \n Total forward rounds: " << forwardsRoundCount;
     llvm::outs() << " \n Total backwards rounds " << backwardsRoundCount;
@@ -2369,21 +2791,24 @@ void Analysis<F, B>::printStatistics() {
     for (auto &entry : SLIM_IN_ALL) {
         llvm::Function *func_name = entry.first;
         llvm::outs() << "\n Displaying IN value for function: " << func_name->getName();
-        unordered_map<BaseInstruction *, pair<F, B>> mapInsInValue = entry.second;
-
-        for (auto it : mapInsInValue) {
-            llvm::outs() << "\n\n Instruction : ";
-            it.first->printInstruction();
-            llvm::outs() << " PIN : ";
-            printDataFlowValuesForward(getAllForwardComponentAtInOfThisInstruction(func_name, it.first));
-            llvm::outs() << "\n POUT : ";
-            printDataFlowValuesForward(getAllForwardComponentAtOutOfThisInstruction(func_name, it.first));
-
-            llvm::outs() << "\n LIN : ";
-            printDataFlowValuesBackward(getAllBackwardComponentAtInOfThisInstruction(func_name, it.first));
 
-            llvm::outs() << "\n LOUT : ";
-            printDataFlowValuesBackward(getAllBackwardComponentAtOutOfThisInstruction(func_name, it.first));
+        for (auto block = optIR->func_bb_to_inst_id.lower_bound({func_name, nullptr});
+             block != optIR->func_bb_to_inst_id.end() && block->first.first == func_name; ++block) {
+            for (long long index : block->second) {
+                BaseInstruction *instruction = optIR->inst_id_to_object[index];
+                llvm::outs() << "\n\n Instruction : ";
+                instruction->printInstruction();
+                llvm::outs() << " PIN : ";
+                printDataFlowValuesForward(getAllForwardComponentAtInOfThisInstruction(func_name, instruction));
+                llvm::outs() << "\n POUT : ";
+                printDataFlowValuesForward(getAllForwardComponentAtOutOfThisInstruction(func_name, instruction));
+
+                llvm::outs() << "\n LIN : ";
+                printDataFlowValuesBackward(getAllBackwardComponentAtInOfThisInstruction(func_name, instruction));
+
+                llvm::outs() << "\n LOUT : ";
+                printDataFlowValuesBackward(getAllBackwardComponentAtOutOfThisInstruction(func_name, instruction));
+            }
         }
         llvm::outs() << "\n\n";
     }
@@ -2393,6 +2818,13 @@ void Analysis<F, B>::printStatistics() {
     llvm::outs() << "\n\nTotal time taken in Analysis: " << this->AnalysisTime.count() << " milliseconds";
     llvm::outs() << "\n\nTotal time taken for Backwards Analysis: " << this->backward_time.count() << " milliseconds";
     llvm::outs() << "\n\nTotal time taken for Forwards Analysis: " << this->forward_time.count() << " milliseconds";
+#ifdef SUMMARY_CACHE
+    if (summary_keys) {
+        llvm::outs() << "\n\nSummary cache (contexts reused, contexts analysed after a miss, files written) = ("
+                     << summaryHitCount << ", " << summaryMissCount << ", " << summaryFilesWritten << ")";
+        printSummaryReuse();
+    }
+#endif
 }
 
 template <class F, class B>
@@ -2574,6 +3006,86 @@ F Analysis<F, B>::computeOutFromIn(BaseInstruction *I) {
     exit(-1);
 }
 
+// Builds the memo key of I from the values in reads currently stored at it,
+// after dropping the memo if the client tables have changed since it was
+// filled. Returns false when the client has not opted in.
+template <class F, class B>
+bool Analysis<F, B>::lookupFlowFunctionMemo(BaseInstruction *I, unsigned reads, FlowFunctionKey<F, B> &key) {
+    if (!isFlowFunctionMemoizable()) {
+        return false;
+    }
+    unsigned long long tables_version = getFlowFunctionTablesVersion();
+    if (tables_version != flow_memo_tables_version) {
+        forward_flow_memo.clear();
+        backward_flow_memo.clear();
+        flow_memo_tables_version = tables_version;
+    }
+    key.instruction_id = I->getInstructionId();
+    if (reads & READS_FORWARD_IN) {
+        key.in.first = getForwardComponentAtInOfThisInstruction(I);
+    }
+    if (reads & READS_BACKWARD_IN) {
+        key.in.second = getBackwardComponentAtInOfThisInstruction(I);
+    }
+    if (reads & READS_FORWARD_OUT) {
+        key.out.first = getForwardComponentAtOutOfThisInstruction(I);
+    }
+    if (reads & READS_BACKWARD_OUT) {
+        key.out.second = getBackwardComponentAtOutOfThisInstruction(I);
+    }
+    return true;
+}
+
+template <class F, class B>
+F Analysis<F, B>::computeOutFromInMemoized(BaseInstruction *I) {
+    if constexpr (IsHashable<F>::value && IsHashable<B>::value) {
+        FlowFunctionKey<F, B> key;
+        if (lookupFlowFunctionMemo(I, getForwardFlowFunctionReads(), key)) {
+            if (const F *cached = forward_flow_memo.find(key)) {
+#ifdef PRINTSTATS
+                forwardMemoHitCount++;
+#endif
+                return *cached;
+            }
+#ifdef PRINTSTATS
+            forwardMemoMissCount++;
+#endif
+            F result = computeOutFromIn(I);
+            // A result that changed the tables on the way may not be what a
+            // second call on the same values returns.
+            if (getFlowFunctionTablesVersion() == flow_memo_tables_version) {
+                forward_flow_memo.insert(std::move(key), result);
+            }
+            return result;
+        }
+    }
+    return computeOutFromIn(I);
+}
+
+template <class F, class B>
+B Analysis<F, B>::computeInFromOutMemoized(BaseInstruction *I) {
+    if constexpr (IsHashable<F>::value && IsHashable<B>::value) {
+        FlowFunctionKey<F, B> key;
+        if (lookupFlowFunctionMemo(I, getBackwardFlowFunctionReads(), key)) {
+            if (const B *cached = backward_flow_memo.find(key)) {
+#ifdef PRINTSTATS
+                backwardMemoHitCount++;
+#endif
+                return *cached;
+            }
+#ifdef PRINTSTATS
+            backwardMemoMissCount++;
+#endif
+            B result = computeInFromOut(I);
+            if (getFlowFunctionTablesVersion() == flow_memo_tables_version) {
+                backward_flow_memo.insert(std::move(key), result);
+            }
+            return result;
+        }
+    }
+    return computeInFromOut(I);
+}
+
 template <class F, class B>
 F Analysis<F, B>::getBoundaryInformationForward() {
     llvm::outs() << "\nThis function getBoundaryInformationForward() has not "
@@ -2828,7 +3340,7 @@ F Analysis<F, B>::getForwardComponentAtInOfThisInstruction(llvm::Instruction &I)
 template <class F, class B>
 F Analysis<F, B>::getForwardComponentAtInOfThisInstruction(BaseInstruction *I) {
     int label = getProcessingContextLabel();
-    return SLIM_IN[label][I].first;
+    return getSLIMValue(SLIM_IN, label, I, true).first;
 }
 
 template <class F, class B>
@@ -2840,7 +3352,7 @@ F Analysis<F, B>::getForwardComponentAtOutOfThisInstruction(llvm::Instruction &I
 template <class F, class B>
 F Analysis<F, B>::getForwardComponentAtOutOfThisInstruction(BaseInstruction *I) {
     int label = getProcessingContextLabel();
-    return SLIM_OUT[label][I].first;
+    return getSLIMValue(SLIM_OUT, label, I, true).first;
 }
 
 template <class F, class B>
@@ -2852,7 +3364,7 @@ B Analysis<F, B>::getBackwardComponentAtInOfThisInstruction(llvm::Instruction &I
 template <class F, class B>
 B Analysis<F, B>::getBackwardComponentAtInOfThisInstruction(BaseInstruction *I) {
     int label = getProcessingContextLabel();
-    return SLIM_IN[label][I].second;
+    return getSLIMValue(SLIM_IN, label, I, false).second;
 }
 
 template <class F, class B>
@@ -2865,7 +3377,7 @@ B Analysis<F, B>::getBackwardComponentAtOutOfThisInstruction(llvm::Instruction &
 template <class F, class B>
 B Analysis<F, B>::getBackwardComponentAtOutOfThisInstruction(BaseInstruction *I) {
     int label = getProcessingContextLabel();
-    return SLIM_OUT[label][I].second;
+    return getSLIMValue(SLIM_OUT, label, I, false).second;
 }
 
 template <class F, class B>
@@ -2877,7 +3389,9 @@ void Analysis<F, B>::setForwardComponentAtInOfThisInstruction(llvm::Instruction
 template <class F, class B>
 void Analysis<F, B>::setForwardComponentAtInOfThisInstruction(BaseInstruction *I, const F &in_value) {
     int label = getProcessingContextLabel();
-    SLIM_IN[label][I].first = in_value;
+    if (pair<F, B> *value = findSLIMValue(SLIM_IN, label, I)) {
+        value->first = in_value;
+    }
 }
 
 template <class F, class B>
@@ -2889,7 +3403,9 @@ void Analysis<F, B>::setForwardComponentAtOutOfThisInstruction(llvm::Instruction
 template <class F, class B>
 void Analysis<F, B>::setForwardComponentAtOutOfThisInstruction(BaseInstruction *I, const F &out_value) {
     int label = getProcessingContextLabel();
-    SLIM_OUT[label][I].first = out_value;
+    if (pair<F, B> *value = findSLIMValue(SLIM_OUT, label, I)) {
+        value->first = out_value;
+    }
 }
 
 template <class F, class B>
@@ -2901,7 +3417,9 @@ void Analysis<F, B>::setBackwardComponentAtInOfThisInstruction(llvm::Instruction
 template <class F, class B>
 void Analysis<F, B>::setBackwardComponentAtInOfThisInstruction(BaseInstruction *I, const B &in_value) {
     int label = getProcessingContextLabel();
-    SLIM_IN[label][I].second = in_value;
+    if (pair<F, B> *value = findSLIMValue(SLIM_IN, label, I)) {
+        value->second = in_value;
+    }
 }
 
 template <class F, class B>
@@ -2913,7 +3431,9 @@ void Analysis<F, B>::setBackwardComponentAtOutOfThisInstruction(llvm::Instructio
 template <class F, class B>
 void Analysis<F, B>::setBackwardComponentAtOutOfThisInstruction(BaseInstruction *I, const B &out_value) {
     int label = getProcessingContextLabel();
-    SLIM_OUT[label][I].second = out_value;
+    if (pair<F, B> *value = findSLIMValue(SLIM_OUT, label, I)) {
+        value->second = out_value;
+    }
 }
 
 //=====================setter and getters
@@ -2923,7 +3443,7 @@ template <class F, class B>
 pair<F, B> Analysis<F, B>::getIn(int label, llvm::BasicBlock *BB) {
     //    return IN[{label,&(*BB->begin())}];
     if (SLIM) {
-        return SLIM_IN[label][optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]];
+        return getSLIMValues(SLIM_IN, label)[optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]];
     }
     return IN[label][&(*(BB->begin()))];
 }
@@ -2931,7 +3451,7 @@ pair<F, B> Analysis<F, B>::getIn(int label, llvm::BasicBlock *BB) {
 template <class F, class B>
 pair<F, B> Analysis<F, B>::getOut(int label, llvm::BasicBlock *BB) {
     if (SLIM) {
-        return SLIM_OUT[label][optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]];
+        return getSLIMValues(SLIM_OUT, label)[optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]];
     }
     return OUT[label][&(BB->back())];
 }
@@ -2939,7 +3459,11 @@ pair<F, B> Analysis<F, B>::getOut(int label, llvm::BasicBlock *BB) {
 template <class F, class B>
 void Analysis<F, B>::setForwardIn(int label, llvm::BasicBlock *BB, const F &dataflowvalue) {
     if (SLIM) {
-        SLIM_IN[label][optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].first = dataflowvalue;
+        // The replayed values of the block start from this one.
+        if (replayed_block.label == label && replayed_block.block == BB) {
+            replayed_block.forward = false;
+        }
+        getSLIMValues(SLIM_IN, label)[optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].first = dataflowvalue;
         return;
     }
     IN[label][&(*(BB->begin()))].first = dataflowvalue;
@@ -2948,7 +3472,7 @@ void Analysis<F, B>::setForwardIn(int label, llvm::BasicBlock *BB, const F &data
 template <class F, class B>
 void Analysis<F, B>::setForwardOut(int label, llvm::BasicBlock *BB, const F &dataflowvalue) {
     if (SLIM) {
-        SLIM_OUT[label][optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].first = dataflowvalue;
+        getSLIMValues(SLIM_OUT, label)[optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].first = dataflowvalue;
         return;
     }
     OUT[label][&(BB->back())].first = dataflowvalue;
@@ -2957,7 +3481,7 @@ void Analysis<F, B>::setForwardOut(int label, llvm::BasicBlock *BB, const F &dat
 template <class F, class B>
 void Analysis<F, B>::setBackwardIn(int label, llvm::BasicBlock *BB, const B &dataflowvalue) {
     if (SLIM) {
-        SLIM_IN[label][optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].second = dataflowvalue;
+        getSLIMValues(SLIM_IN, label)[optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].second = dataflowvalue;
         return;
     }
     IN[label][&(*(BB->begin()))].second = dataflowvalue;
@@ -2966,7 +3490,10 @@ void Analysis<F, B>::setBackwardIn(int label, llvm::BasicBlock *BB, const B &dat
 template <class F, class B>
 void Analysis<F, B>::setBackwardOut(int label, llvm::BasicBlock *BB, const B &dataflowvalue) {
     if (SLIM) {
-        SLIM_OUT[label][optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].second = dataflowvalue;
+        if (replayed_block.label == label && replayed_block.block == BB) {
+            replayed_block.backward = false;
+        }
+        getSLIMValues(SLIM_OUT, label)[optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].second = dataflowvalue;
         return;
     }
     OUT[label][&(BB->back())].second = dataflowvalue;
@@ -2995,6 +3522,11 @@ template <class F, class B>
 F Analysis<F, B>::getForwardOutflowForThisContext(int context_label) {
     //    return
     //    context_label_to_context_object_map[context_label].second.second.first;
+#ifdef SUMMARY_CACHE
+    if (summary_keys) {
+        summary_outflow_read.insert(context_label);
+    }
+#endif
     return context_label_to_context_object_map[context_label]->getOutflowValue().first;
 }
 
@@ -3002,6 +3534,11 @@ template <class F, class B>
 B Analysis<F, B>::getBackwardOutflowForThisContext(int context_label) {
     //    return
     //    context_label_to_context_object_map[context_label].second.second.second;
+#ifdef SUMMARY_CACHE
+    if (summary_keys) {
+        summary_outflow_read.insert(context_label);
+    }
+#endif
     return context_label_to_context_object_map[context_label]->getOutflowValue().second;
 }
 
@@ -3009,23 +3546,39 @@ template <class F, class B>
 void Analysis<F, B>::setForwardInflowForThisContext(int context_label, const F &forward_inflow) {
     //    context_label_to_context_object_map[context_label].second.first.first=forward_inflow;
     context_label_to_context_object_map[context_label]->setForwardInflow(forward_inflow);
+    indexContext(context_label);
 }
 
 template <class F, class B>
 void Analysis<F, B>::setBackwardInflowForThisContext(int context_label, const B &backward_inflow) {
     //    context_label_to_context_object_map[context_label].second.first.second=backward_inflow;
     context_label_to_context_object_map[context_label]->setBackwardInflow(backward_inflow);
+    indexContext(context_label);
 }
 
 template <class F, class B>
 void Analysis<F, B>::setForwardOutflowForThisContext(int context_label, const F &forward_outflow) {
     //    context_label_to_context_object_map[context_label].second.second.first=forward_outflow;
+#ifdef SUMMARY_CACHE
+    if (summary_outflow_read.count(context_label) &&
+        !EqualDataFlowValuesForward(
+            context_label_to_context_object_map[context_label]->getOutflowValue().first, forward_outflow)) {
+        summary_unsettled.insert(context_label);
+    }
+#endif
     context_label_to_context_object_map[context_label]->setForwardOutflow(forward_outflow);
 }
 
 template <class F, class B>
 void Analysis<F, B>::setBackwardOutflowForThisContext(int context_label, const B &backward_outflow) {
     //    context_label_to_context_object_map[context_label].second.second.second=backward_outflow;
+#ifdef SUMMARY_CACHE
+    if (summary_outflow_read.count(context_label) &&
+        !EqualDataFlowValuesBackward(
+            context_label_to_context_object_map[context_label]->getOutflowValue().second, backward_outflow)) {
+        summary_unsettled.insert(context_label);
+    }
+#endif
     context_label_to_context_object_map[context_label]->setBackwardOutflow(backward_outflow);
 }
 
@@ -3058,6 +3611,9 @@ void Analysis<F, B>::doAnalysis(std::unique_ptr<llvm::Module> &Mod, slim::IR *sl
     if (SLIM) {
         setSLIMIRPointer(slimIRObj);
     }
+    block_granular_storage = SLIM && useBlockGranularStorage() &&
+                             (getForwardFlowFunctionReads() & ~READS_FORWARD_IN) == 0 &&
+                             (getBackwardFlowFunctionReads() & ~READS_BACKWARD_OUT) == 0;
 
     // llvm::outs() << "Inside doAnalysis with SLIM parameter as " << SLIM <<
     // "\n";
@@ -3067,6 +3623,9 @@ void Analysis<F, B>::doAnalysis(std::unique_ptr<llvm::Module> &Mod, slim::IR *sl
     int i = 0;
 
     if (modeOfExec == FSFP || modeOfExec == FSSP) {
+#ifdef SUMMARY_CACHE
+        openSummaryCache(M);
+#endif
         for (Function &function : M) {
             if (function.getName() == "main") {
                 // if (function.getName() == "matchpat_goal_anchor") {
@@ -3228,6 +3787,10 @@ void Analysis<F, B>::doAnalysis(std::unique_ptr<llvm::Module> &Mod, slim::IR *sl
             llvm::outs() << "\n Inside COMPUTE_CS_FIS_BLOCKS\n";
 #endif
         }
+#ifdef SUMMARY_CACHE
+        saveSummaryCache();
+        addSummaryResultContexts();
+#endif
     } else {
         for (Function &function : M) {
             if (function.getName() == "main") {
@@ -3334,11 +3897,422 @@ void Analysis<F, B>::doAnalysis(std::unique_ptr<llvm::Module> &Mod, slim::IR *sl
     }
 }
 
+#ifdef SUMMARY_CACHE
+template <class F, class B>
+void Analysis<F, B>::openSummaryCache(llvm::Module &M) {
+    const char *directory = std::getenv("VASCO_SUMMARY_CACHE");
+    if (directory == nullptr || *directory == '\0') {
+        return;
+    }
+    // Not std::filesystem: it calls stat(), which the global PerformanceStatistics
+    // of Profiling.cpp shadows.
+    std::error_code error = llvm::sys::fs::create_directories(directory);
+    if (error) {
+        llvm::errs() << "Summary cache disabled: cannot create " << directory << ": " << error.message() << "\n";
+        return;
+    }
+    summary_directory = directory;
+    summary_keys = std::make_unique<SummaryKeys>(M);
+}
+
+template <class F, class B>
+std::string Analysis<F, B>::getSummaryPath(llvm::Function *function) {
+    return summary_directory + "/" + llvm::utohexstr(summary_keys->hash(function)) + ".summary";
+}
+
+// The summaries of a function, read from its file on first use.
+template <class F, class B>
+FunctionSummaries &Analysis<F, B>::getFunctionSummaries(llvm::Function *function) {
+    auto inserted = summary_files.emplace(function, FunctionSummaries());
+    if (inserted.second) {
+        inserted.first->second.read(getSummaryPath(function), summary_keys->hash(function));
+    }
+    return inserted.first->second;
+}
+
+// Collects the function and everything it may call. Returns false, and the
+// summaries of the function are neither read nor written, if any of them is
+// refused by the client, makes indirect calls or changed the client tables.
+template <class F, class B>
+bool Analysis<F, B>::collectSummaryClosure(llvm::Function *function, vector<Function *> &closure) {
+    closure.assign(1, function);
+    unordered_set<Function *> seen{function};
+    for (size_t next = 0; next < closure.size(); next++) {
+        Function *member = closure[next];
+        if (summary_keys->hasIndirectCalls(member) || summary_unsound.count(member) ||
+            !isFunctionSummaryCacheable(member)) {
+            return false;
+        }
+        for (Function *callee : summary_keys->callees(member)) {
+            if (seen.insert(callee).second) {
+                closure.push_back(callee);
+            }
+        }
+    }
+    return true;
+}
+
+// Creates the context from the cache if an earlier run analysed the function
+// with this inflow. Like INIT_CONTEXT, the new context gets the next label,
+// but none of its blocks is put on the worklists: the caller, which is already
+// back on its worklist, reads the outflow through the transition graph. The
+// values at its instructions are read too, and those of the contexts it
+// reached are kept for addSummaryResultContexts.
+template <class F, class B>
+bool Analysis<F, B>::initSummaryContext(llvm::Function *function, const std::pair<F, B> &Inflow) {
+    // The context of main (label 0) is always analysed.
+    vector<Function *> closure;
+    if (!summary_keys || context_label_counter < 0 || !collectSummaryClosure(function, closure)) {
+        return false;
+    }
+
+    FunctionSummaries &summaries = getFunctionSummaries(function);
+    SummaryValue forward_inflow, backward_inflow, forward_outflow, backward_outflow;
+    vector<std::string> effects;
+    SummaryResults results;
+    std::pair<F, B> Outflow;
+    InstructionValues<F, B> in, out;
+    if (!encodeSummaryValueForward(Inflow.first, forward_inflow) ||
+        !encodeSummaryValueBackward(Inflow.second, backward_inflow) ||
+        !summaries.lookup(forward_inflow, backward_inflow, forward_outflow, backward_outflow, effects, results) ||
+        !decodeSummaryValueForward(forward_outflow, Outflow.first) ||
+        !decodeSummaryValueBackward(backward_outflow, Outflow.second) ||
+        !decodeSummaryInstructions(function, results.instructions, in, out)) {
+        summaryMissCount++;
+        return false;
+    }
+    vector<SummaryReached> reached;
+    for (auto &context : results.reached) {
+        SummaryReached &values = reached.emplace_back();
+        values.function = llvm::dyn_cast_or_null<Function>(summary_keys->decode(context.function));
+        if (values.function == nullptr || values.function->isDeclaration() ||
+            !decodeSummaryValueForward(context.forward_inflow, values.Inflow.first) ||
+            !decodeSummaryValueBackward(context.backward_inflow, values.Inflow.second) ||
+            !decodeSummaryInstructions(values.function, context.instructions, values.in, values.out)) {
+            summaryMissCount++;
+            return false;
+        }
+    }
+    // The effects of the context cover the contexts it reached in the run
+    // that wrote it, none of which is created here.
+    for (const std::string &effect : effects) {
+        if (!replaySummaryEffect(effect)) {
+            summary_unsound.insert(function);
+            summaryMissCount++;
+            return false;
+        }
+    }
+
+    context_label_counter++;
+    Context<F, B> *context_object = new Context<F, B>(context_label_counter, function, Inflow, Outflow);
+    int current_context_label = context_object->getLabel();
+    setProcessingContextLabel(current_context_label);
+    context_label_to_context_object_map[current_context_label] = context_object;
+    ProcedureContext.insert(current_context_label);
+    setForwardOutflowForThisContext(current_context_label, Outflow.first);
+    setBackwardOutflowForThisContext(current_context_label, Outflow.second);
+    setForwardInflowForThisContext(current_context_label, Inflow.first);
+    setBackwardInflowForThisContext(current_context_label, Inflow.second);
+    getSLIMValues(SLIM_IN, current_context_label) = std::move(in);
+    getSLIMValues(SLIM_OUT, current_context_label) = std::move(out);
+    summary_contexts[current_context_label] = std::move(effects);
+    summary_reached[current_context_label] = std::move(reached);
+    summaryHitCount++;
+    return true;
+}
+
+// The IN and OUT values kept at the instructions of the function, in the form
+// kept by the cache. Fails if the client cannot name one of them.
+template <class F, class B>
+bool Analysis<F, B>::encodeSummaryInstructions(llvm::Function *function, InstructionValues<F, B> &in,
+                                               InstructionValues<F, B> &out, SummaryInstructionValues &values) {
+    long long first = instruction_id_ranges.range(optIR, function).first;
+    for (auto block = optIR->func_bb_to_inst_id.lower_bound({function, nullptr});
+         block != optIR->func_bb_to_inst_id.end() && block->first.first == function; ++block) {
+        for (long long index : block->second) {
+            BaseInstruction *instruction = optIR->inst_id_to_object[index];
+            // Those not kept are replayed from the others.
+            if (!in.holds(instruction)) {
+                continue;
+            }
+            std::array<SummaryValue, 4> &value = values[index - first];
+            if (!encodeSummaryValueForward(in[instruction].first, value[0]) ||
+                !encodeSummaryValueForward(out[instruction].first, value[1]) ||
+                !encodeSummaryValueBackward(in[instruction].second, value[2]) ||
+                !encodeSummaryValueBackward(out[instruction].second, value[3])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Inverse of encodeSummaryInstructions, into `in` and `out`, which are bound
+// to the function here. Fails on a position outside the function, or one not
+// kept under block-granular storage.
+template <class F, class B>
+bool Analysis<F, B>::decodeSummaryInstructions(llvm::Function *function, const SummaryInstructionValues &values,
+                                               InstructionValues<F, B> &in, InstructionValues<F, B> &out) {
+    std::pair<long long, long long> range = instruction_id_ranges.range(optIR, function);
+    bindSLIMValues(in, function);
+    bindSLIMValues(out, function);
+    for (auto &value : values) {
+        auto instruction = optIR->inst_id_to_object.end();
+        if (value.first >= static_cast<size_t>(range.second - range.first) ||
+            (instruction = optIR->inst_id_to_object.find(range.first + value.first)) ==
+                optIR->inst_id_to_object.end() ||
+            !in.holds(instruction->second)) {
+            return false;
+        }
+        BaseInstruction *I = instruction->second;
+        if (!decodeSummaryValueForward(value.second[0], in[I].first) ||
+            !decodeSummaryValueForward(value.second[1], out[I].first) ||
+            !decodeSummaryValueBackward(value.second[2], in[I].second) ||
+            !decodeSummaryValueBackward(value.second[3], out[I].second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Once the analysis is over, gives each context reached from a reused one in
+// the run that wrote it a label of its own, unless this run has a context with
+// the same function and inflow, so that the result dumps list the same
+// contexts with and without the cache. They only carry their inflow and
+// values; saveSummaryCache has already run.
+template <class F, class B>
+void Analysis<F, B>::addSummaryResultContexts() {
+    vector<int> reused;
+    for (auto &entry : summary_reached) {
+        reused.push_back(entry.first);
+    }
+    std::sort(reused.begin(), reused.end());
+    for (int label : reused) {
+        for (SummaryReached &context : summary_reached[label]) {
+            if (check_if_context_already_exists(context.function, context.Inflow, {}) != 0) {
+                continue;
+            }
+            context_label_counter++;
+            context_label_to_context_object_map[context_label_counter] =
+                new Context<F, B>(context_label_counter, context.function, context.Inflow, {});
+            ProcedureContext.insert(context_label_counter);
+            setForwardInflowForThisContext(context_label_counter, context.Inflow.first);
+            setBackwardInflowForThisContext(context_label_counter, context.Inflow.second);
+            getSLIMValues(SLIM_IN, context_label_counter) = std::move(context.in);
+            getSLIMValues(SLIM_OUT, context_label_counter) = std::move(context.out);
+        }
+    }
+    summary_reached.clear();
+}
+
+// Lists the contexts that were reused from the cache.
+template <class F, class B>
+void Analysis<F, B>::printSummaryReuse() {
+    if (summary_contexts.empty()) {
+        return;
+    }
+    std::map<std::string, vector<int>> reused;
+    for (auto &entry : summary_contexts) {
+        reused[context_label_to_context_object_map[entry.first]->getFunction()->getName().str()].push_back(
+            entry.first);
+    }
+    llvm::outs() << "\n\nContexts reused from the summary cache:";
+    for (auto &function : reused) {
+        std::sort(function.second.begin(), function.second.end());
+        llvm::outs() << "\n  " << function.first << " : contexts";
+        for (int label : function.second) {
+            llvm::outs() << " " << label;
+        }
+    }
+}
+
+// Called as each block is taken off a worklist, and with -1 once the analysis
+// is over: whatever the client logged since the previous block is charged to
+// the context of that block.
+template <class F, class B>
+void Analysis<F, B>::trackSummaryBlock(int context_label) {
+    if (!summary_keys) {
+        return;
+    }
+    unsigned long long tables_version = getSummaryTablesVersion();
+    size_t effects = getSummaryEffectCount();
+    if (summary_current_context >= 0) {
+        if (tables_version != summary_tables_version) {
+            summary_unsound.insert(context_label_to_context_object_map[summary_current_context]->getFunction());
+        }
+        vector<size_t> &logged = summary_effects[summary_current_context];
+        for (size_t effect = summary_effects_seen; effect < effects; effect++) {
+            logged.push_back(effect);
+        }
+    }
+    summary_current_context = context_label;
+    summary_tables_version = tables_version;
+    summary_effects_seen = effects;
+}
+
+// Records the contexts analysed in this run and rewrites the files that
+// changed. The effects of a context are those logged while analysing it or
+// any context it reaches through the transition graph, and its results the
+// values at its instructions and at those of each context it reaches.
+//
+// Only settled contexts are recorded: those whose callers never saw an
+// outflow other than the final one, and that no other context started from.
+// Reusing one hands the callers what they saw in this run, so a later run
+// takes the same path through the program. The outflows of the others are
+// final too, but the callers of a context read from the cache would skip the
+// partial outflows they went through here, reach states this run never did,
+// and create contexts that miss.
+template <class F, class B>
+void Analysis<F, B>::saveSummaryCache() {
+    if (!summary_keys) {
+        return;
+    }
+    trackSummaryBlock(-1);
+
+    unordered_map<int, vector<int>> callee_contexts;
+    for (auto &edge : SLIM_transition_graph.get_graph()) {
+        for (auto &target : edge.second) {
+            callee_contexts[edge.first.first].push_back(target.second);
+        }
+    }
+    // A context with an effect the client cannot name is not recorded, nor is
+    // any context that reaches it.
+    unordered_map<int, vector<std::string>> effects(summary_contexts.begin(), summary_contexts.end());
+    unordered_set<int> unnamed;
+    for (auto &logged : summary_effects) {
+        vector<std::string> &texts = effects[logged.first];
+        for (size_t effect : logged.second) {
+            if (!encodeSummaryEffect(effect, texts.emplace_back())) {
+                unnamed.insert(logged.first);
+            }
+        }
+    }
+
+    // A context in the form kept by the cache, encoded once however many
+    // contexts reach it; null if the client cannot name its values.
+    auto encodeReached = [&](Function *function, const pair<F, B> &Inflow, InstructionValues<F, B> &in,
+                             InstructionValues<F, B> &out, SummaryReachedContext &context) {
+        return summary_keys->encode(function, context.function) &&
+               encodeSummaryValueForward(Inflow.first, context.forward_inflow) &&
+               encodeSummaryValueBackward(Inflow.second, context.backward_inflow) &&
+               encodeSummaryInstructions(function, in, out, context.instructions);
+    };
+    unordered_map<int, std::unique_ptr<SummaryReachedContext>> encoded;
+    auto encodeContext = [&](int label) {
+        auto cursor = encoded.find(label);
+        if (cursor == encoded.end()) {
+            Context<F, B> *context_object = context_label_to_context_object_map[label];
+            auto context = std::make_unique<SummaryReachedContext>();
+            if (!encodeReached(context_object->getFunction(), context_object->getInflowValue(),
+                               getSLIMValues(SLIM_IN, label), getSLIMValues(SLIM_OUT, label), *context)) {
+                context.reset();
+            }
+            cursor = encoded.emplace(label, std::move(context)).first;
+        }
+        return cursor->second.get();
+    };
+
+    unordered_map<Function *, bool> cacheable;
+    vector<Function *> closure;
+    for (int label = 1; label <= context_label_counter; label++) {
+        if (summary_contexts.count(label) || summary_unsettled.count(label)) {
+            continue;
+        }
+        Context<F, B> *context_object = context_label_to_context_object_map[label];
+        Function *function = context_object->getFunction();
+        auto accepted = cacheable.find(function);
+        if (accepted == cacheable.end()) {
+            accepted = cacheable.emplace(function, collectSummaryClosure(function, closure)).first;
+        }
+        if (!accepted->second) {
+            continue;
+        }
+
+        std::set<std::string> reached_effects;
+        unordered_set<int> reached{label};
+        vector<int> pending{label};
+        bool named = true;
+        while (named && !pending.empty()) {
+            int next = pending.back();
+            pending.pop_back();
+            named = !unnamed.count(next);
+            auto texts = effects.find(next);
+            if (texts != effects.end()) {
+                reached_effects.insert(texts->second.begin(), texts->second.end());
+            }
+            auto callees = callee_contexts.find(next);
+            if (callees != callee_contexts.end()) {
+                for (int callee : callees->second) {
+                    if (reached.insert(callee).second) {
+                        pending.push_back(callee);
+                    }
+                }
+            }
+        }
+
+        // The reached contexts are sorted by their values, as their labels
+        // depend on the run.
+        SummaryResults results;
+        SummaryReachedContext *own = encodeContext(label);
+        bool encodable = named && own != nullptr;
+        for (auto cursor = reached.begin(); encodable && cursor != reached.end(); ++cursor) {
+            if (*cursor == label) {
+                continue;
+            }
+            SummaryReachedContext *context = encodeContext(*cursor);
+            encodable = context != nullptr;
+            if (encodable) {
+                results.reached.push_back(*context);
+            }
+            // A reused context carries those it reached in its own run.
+            auto reused = summary_reached.find(*cursor);
+            if (reused != summary_reached.end()) {
+                for (SummaryReached &values : reused->second) {
+                    encodable = encodable && encodeReached(values.function, values.Inflow, values.in, values.out,
+                                                           results.reached.emplace_back());
+                }
+            }
+        }
+        if (!encodable) {
+            continue;
+        }
+        results.instructions = own->instructions;
+        std::sort(results.reached.begin(), results.reached.end());
+
+        SummaryValue forward_inflow, backward_inflow, forward_outflow, backward_outflow;
+        if (encodeSummaryValueForward(context_object->getInflowValue().first, forward_inflow) &&
+            encodeSummaryValueBackward(context_object->getInflowValue().second, backward_inflow) &&
+            encodeSummaryValueForward(getForwardOutflowForThisContext(label), forward_outflow) &&
+            encodeSummaryValueBackward(getBackwardOutflowForThisContext(label), backward_outflow)) {
+            getFunctionSummaries(function).record(forward_inflow, backward_inflow, forward_outflow, backward_outflow,
+                                                  reached_effects, results);
+        }
+    }
+
+    for (auto &entry : cacheable) {
+        Function *function = entry.first;
+        if (!entry.second || !getFunctionSummaries(function).isChanged()) {
+            continue;
+        }
+        if (getFunctionSummaries(function).write(getSummaryPath(function), summary_keys->hash(function))) {
+            summaryFilesWritten++;
+        } else {
+            llvm::errs() << "Summary cache: cannot write " << getSummaryPath(function) << "\n";
+        }
+    }
+}
+#endif
+
 template <class F, class B>
 void Analysis<F, B>::INIT_CONTEXT(
     llvm::Function *function, const std::pair<F, B> &Inflow, const std::pair<F, B> &Outflow) {
     /// llvm::outs() << "\n Inside INIT_CONTEXT 1..............";
 
+#ifdef SUMMARY_CACHE
+    if (initSummaryContext(function, Inflow)) {
+        return;
+    }
+#endif
     context_label_counter++;
     Context<F, B> *context_object = new Context<F, B>(context_label_counter, function, Inflow, Outflow);
     int current_context_label = context_object->getLabel();
@@ -3650,9 +4624,84 @@ void Analysis<F, B>::INIT_CONTEXT(
     // exit(0);
 }
 
+template <class F, class B>
+size_t Analysis<F, B>::getContextIndexKey(llvm::Function *function, const pair<F, B> &Inflow) {
+    size_t key = std::hash<llvm::Function *>()(function);
+    key = lhf::compose_hash(key, std::hash<F>()(Inflow.first));
+    return lhf::compose_hash(key, std::hash<B>()(Inflow.second));
+}
+
+// (Re-)files a context under its current function and inflow. Called whenever
+// the inflow of a context is set.
+template <class F, class B>
+void Analysis<F, B>::indexContext(int context_label) {
+    if constexpr (IsHashable<F>::value && IsHashable<B>::value) {
+        auto previous = context_index_key.find(context_label);
+        if (previous != context_index_key.end()) {
+            vector<int> &bucket = context_index[previous->second];
+            bucket.erase(std::find(bucket.begin(), bucket.end(), context_label));
+        }
+
+        Context<F, B> *context_object = context_label_to_context_object_map[context_label];
+        size_t key = getContextIndexKey(context_object->getFunction(), context_object->getInflowValue());
+        vector<int> &bucket = context_index[key];
+        bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), context_label), context_label);
+        context_index_key[context_label] = key;
+    }
+}
+
+// Indexed version of check_if_context_already_exists, with the same equality
+// tests. Returns the oldest matching context, or 0 if there is none. The
+// callers read 0 as "not found", so the context of main (label 0) is skipped
+// in favour of any later match.
+template <class F, class B>
+int Analysis<F, B>::findIndexedContext(llvm::Function *function, const pair<F, B> &Inflow) {
+    auto bucket = context_index.find(getContextIndexKey(function, Inflow));
+    if (bucket == context_index.end()) {
+        return 0;
+    }
+
+    for (int label : bucket->second) {
+        if (label == 0) {
+            continue;
+        }
+        Context<F, B> *current_object = context_label_to_context_object_map[label];
+        if (current_object->getFunction() != function) {
+            continue;
+        }
+        const pair<F, B> &current_inflow = current_object->getInflowValue();
+
+        bool found;
+        if (std::is_same<B, NoAnalysisType>::value) {
+            found = EqualDataFlowValuesForward(Inflow.first, current_inflow.first);
+        } else if (std::is_same<F, NoAnalysisType>::value) {
+            found = EqualDataFlowValuesBackward(Inflow.second, current_inflow.second);
+        } else {
+            found = EqualContextValuesForward(Inflow.first, current_inflow.first) &&
+                    EqualContextValuesBackward(Inflow.second, current_inflow.second);
+        }
+
+        if (found) {
+            if (debug) {
+                llvm::outs() << "\nContext found!!!!! LABEL: " << label << "\n";
+            }
+            return label;
+        }
+    }
+    return 0;
+}
+
 template <class F, class B>
 int Analysis<F, B>::check_if_context_already_exists(
     llvm::Function *function, const pair<F, B> &Inflow, const pair<F, B> &Outflow) {
+    if constexpr (IsHashable<F>::value && IsHashable<B>::value) {
+        // The flow-insensitive modes compare with EqualDataFlowValuesFIS and
+        // keep the linear search below.
+        if (!std::is_same<B, NoAnalysisType>::value || modeOfExec == FSFP || modeOfExec == FSSP) {
+            return findIndexedContext(function, Inflow);
+        }
+    }
+
     if (std::is_same<B, NoAnalysisType>::value) {
         // forward only
         if (modeOfExec == FSFP || modeOfExec == FSSP) {
@@ -3843,6 +4892,9 @@ void Analysis<F, B>::doAnalysisForward() {
         BasicBlock &b = *bb;
         Function *f = context_label_to_context_object_map[current_context_label]->getFunction();
         Function &function = *f;
+#ifdef SUMMARY_CACHE
+        trackSummaryBlock(current_context_label);
+#endif
 
         // MSCHANGE 1
         F previous_value_at_out_of_this_node = getOut(current_pair.first, current_pair.second).first;
@@ -4010,7 +5062,7 @@ void Analysis<F, B>::doAnalysisForward() {
 
 // #ifndef LFCPA
                             F forwardIN_at_callnode = a1;
-                            for (Function *target_function : indirect_functions) {
+                            for (Function *target_function : inNameOrder(indirect_functions)) {
                                 // get the return variable in callee to map it
                                 // with the variable in caller Example: z = call
                                 // Q() and defintion of Q(){ ... return x;} ,
@@ -4752,7 +5804,7 @@ void Analysis<F, B>::doAnalysisForward() {
                                 llvm::outs() << "\nIgnoring...\n";
                             new_prev = prev;
                         } else {
-                            new_prev = computeOutFromIn(inst);
+                            new_prev = computeOutFromInMemoized(inst);
                         }
                         if (debug)
                             llvm::outs() << "Called ComputeOutFromIn-1";
@@ -5166,14 +6218,23 @@ F Analysis<F, B>::NormalFlowFunctionForward(pair<int, BasicBlock *> current_pair
     bool changed = false;
     // traverse a basic block in forward direction
     if (SLIM) {
+        // Under block-granular storage, the values at the instructions that
+        // are not kept are written to replayed_block and not compared.
+        int label = current_pair_of_context_label_and_bb.first;
+        if (block_granular_storage) {
+            claimReplayedBlock(label, &b);
+            replayed_block.forward = true;
+        }
         for (auto &index : optIR->func_bb_to_inst_id[{context_object->getFunction(), &b}]) {
             auto &inst = optIR->inst_id_to_object[index];
 
-            F old_IN = getForwardComponentAtInOfThisInstruction(inst);
-            // if change in data flow value at IN of any instruction, add this
-            // basic block to backward worklist
-            if (!EqualDataFlowValuesForward(prev, old_IN))
-                changed = true;
+            if (getSLIMValues(SLIM_IN, label).holds(inst)) {
+                F old_IN = getForwardComponentAtInOfThisInstruction(inst);
+                // if change in data flow value at IN of any instruction, add
+                // this basic block to backward worklist
+                if (!EqualDataFlowValuesForward(prev, old_IN))
+                    changed = true;
+            }
 
             if (debug) {
                 printLine(current_pair_of_context_label_and_bb.first, 0);
@@ -5197,7 +6258,7 @@ F Analysis<F, B>::NormalFlowFunctionForward(pair<int, BasicBlock *> current_pair
                     llvm::outs() << "\nIgnoring...\n";
                 new_prev = prev;
             } else {
-                new_prev = computeOutFromIn(inst);
+                new_prev = computeOutFromInMemoized(inst);
             }
 
             if (debug)
@@ -5304,6 +6365,9 @@ void Analysis<F, B>::doAnalysisBackward() {
         BasicBlock &b = *bb;
         Function *f = context_label_to_context_object_map[current_context_label]->getFunction();
         Function &function = *f;
+#ifdef SUMMARY_CACHE
+        trackSummaryBlock(current_context_label);
+#endif
 
         // MSCHANGE 2
         B previous_value_at_in_of_this_node = getIn(
@@ -5450,7 +6514,7 @@ void Analysis<F, B>::doAnalysisBackward() {
                                               computeInFromOutForIndirectCalls(inst),
                                               getBackwardComponentAtInOfThisInstruction(inst)));
                             }
-                            for (Function *target_function : indirect_functions) {
+                            for (Function *target_function : inNameOrder(indirect_functions)) {
                                 // get the return variable in callee to map it
                                 // with the variable in caller Example: z = call
                                 // Q() and defintion of Q(){ ... return x;} ,
@@ -6027,7 +7091,7 @@ void Analysis<F, B>::doAnalysisBackward() {
                                 llvm::outs() << "\nIgnoring...\n";
                             new_prev = prev;
                         } else {
-                            new_prev = computeInFromOut(inst);
+                            new_prev = computeInFromOutMemoized(inst);
                         }
                         /*******************************************************
             mod:AR bool flagChanged = false; B old_IN =
@@ -6509,6 +7573,11 @@ B Analysis<F, B>::NormalFlowFunctionBackward(pair<int, BasicBlock *> current_pai
     bool changed = false;
     // traverse a basic block in backward direction
     if (SLIM) {
+        int label = current_pair_of_context_label_and_bb.first;
+        if (block_granular_storage) {
+            claimReplayedBlock(label, &b);
+            replayed_block.backward = true;
+        }
         for (auto &index : optIR->getReverseInstList(optIR->func_bb_to_inst_id[{
                  context_object->getFunction(), current_pair_of_context_label_and_bb.second}])) {
             auto inst = optIR->inst_id_to_object[index];
@@ -6527,15 +7596,17 @@ B Analysis<F, B>::NormalFlowFunctionBackward(pair<int, BasicBlock *> current_pai
                     llvm::outs() << "\nIgnoring...\n";
                 new_dfv = prev;
             } else {
-                new_dfv = computeInFromOut(inst);
+                new_dfv = computeInFromOutMemoized(inst);
             }
 
             ////if change in data flow value at IN of any instruction, add this
             /// basic
             /// block to forward worklist
-            B old_IN = getBackwardComponentAtInOfThisInstruction(inst);
-            if (!EqualDataFlowValuesBackward(new_dfv, old_IN))
-                changed = true;
+            if (getSLIMValues(SLIM_IN, label).holds(inst)) {
+                B old_IN = getBackwardComponentAtInOfThisInstruction(inst);
+                if (!EqualDataFlowValuesBackward(new_dfv, old_IN))
+                    changed = true;
+            }
 
             setBackwardComponentAtInOfThisInstruction(inst, new_dfv);
             /* if (debug) {
@@ -6650,7 +7721,7 @@ pair<F, B> Analysis<F, B>::CallOnflowFunctionForIndirect(
 template <class F, class B>
 B Analysis<F, B>::getBackwardIn(int label, llvm::BasicBlock *BB) {
     if (SLIM) {
-        return SLIM_IN[label][optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].second;
+        return getSLIMValues(SLIM_IN, label)[optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].second;
     }
     return IN[label][&(*(BB->begin()))].second;
 }
@@ -6658,7 +7729,7 @@ B Analysis<F, B>::getBackwardIn(int label, llvm::BasicBlock *BB) {
 template <class F, class B>
 B Analysis<F, B>::getBackwardOut(int label, llvm::BasicBlock *BB) {
     if (SLIM) {
-        return SLIM_OUT[label][optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].second;
+        return getSLIMValues(SLIM_OUT, label)[optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].second;
     }
     return OUT[label][&(BB->back())].second;
 }
@@ -6666,7 +7737,7 @@ B Analysis<F, B>::getBackwardOut(int label, llvm::BasicBlock *BB) {
 template <class F, class B>
 F Analysis<F, B>::getForwardIn(int label, llvm::BasicBlock *BB) {
     if (SLIM) {
-        return SLIM_IN[label][optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].first;
+        return getSLIMValues(SLIM_IN, label)[optIR->inst_id_to_object[optIR->getFirstIns(BB->getParent(), BB)]].first;
     }
     return IN[label][&(*(BB->begin()))].first;
 }
@@ -6674,7 +7745,7 @@ F Analysis<F, B>::getForwardIn(int label, llvm::BasicBlock *BB) {
 template <class F, class B>
 F Analysis<F, B>::getForwardOut(int label, llvm::BasicBlock *BB) {
     if (SLIM) {
-        return SLIM_OUT[label][optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].first;
+        return getSLIMValues(SLIM_OUT, label)[optIR->inst_id_to_object[optIR->getLastIns(BB->getParent(), BB)]].first;
     }
     return OUT[label][&(BB->back())].first;
 }
@@ -6715,6 +7786,17 @@ void Analysis<F, B>::INIT_CONTEXT(
     << "\n Inside INIT_CONTEXT with source context label.............."
     << source_context_label << "\n";*/
 
+#ifdef SUMMARY_CACHE
+    // A context read from the cache has no values to start from.
+    if (summary_contexts.count(source_context_label)) {
+        INIT_CONTEXT(function, Inflow, Outflow);
+        return;
+    }
+    if (initSummaryContext(function, Inflow)) {
+        return;
+    }
+    summary_unsettled.insert(source_context_label);
+#endif
     context_label_counter++;
     Context<F, B> *context_object =
         new Context<F, B>(context_label_counter, function, Inflow, Outflow, source_context_label);
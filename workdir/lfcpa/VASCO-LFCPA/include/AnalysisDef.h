@@ -320,7 +320,7 @@ public:
     BaseInstruction *getBaseInstruction(long long id);
     // BaseInstruction * getBaseIns(long long id, SLIM);
     void setSLIMIRPointer(slim::IR *slimIRptr);
-    bool compareIndices(std::vector<SLIMOperand *>, std::vector<SLIMOperand *>) const;
+    bool compareIndices(const std::vector<SLIMOperand *> &, const std::vector<SLIMOperand *> &) const;
 
     string _getFileName(llvm::Instruction *I);
     string _getFileName(BaseInstruction *I);
@@ -329,7 +329,7 @@ public:
 };
 
 template <class F, class B>
-bool AnalysisDef<F, B>::compareIndices(std::vector<SLIMOperand *> ipVec1, std::vector<SLIMOperand *> ipVec2) const {
+bool AnalysisDef<F, B>::compareIndices(const std::vector<SLIMOperand *> &ipVec1, const std::vector<SLIMOperand *> &ipVec2) const {
     if (ipVec1.size() != ipVec2.size())
         return false;
 
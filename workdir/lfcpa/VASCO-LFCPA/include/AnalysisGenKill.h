@@ -394,11 +394,11 @@ public:
     BaseInstruction *getBaseInstruction(long long id);
     // BaseInstruction * getBaseIns(long long id, SLIM);
     void setSLIMIRPointer(slim::IR *slimIRptr);
-    bool compareIndices(std::vector<SLIMOperand *>, std::vector<SLIMOperand *>) const;
+    bool compareIndices(const std::vector<SLIMOperand *> &, const std::vector<SLIMOperand *> &) const;
 };
 
 template <class F, class B>
-bool AnalysisGenKill<F, B>::compareIndices(std::vector<SLIMOperand *> ipVec1, std::vector<SLIMOperand *> ipVec2) const {
+bool AnalysisGenKill<F, B>::compareIndices(const std::vector<SLIMOperand *> &ipVec1, const std::vector<SLIMOperand *> &ipVec2) const {
     if (ipVec1.size() != ipVec2.size())
         return false;
 
@@ -9,20 +9,25 @@
 #include "lhf/lhf.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 #include <llvm-14/llvm/Support/raw_ostream.h>
 #include <sstream>
 
 #define ENABLE_INTEGRITY_CHECKING
 
-#define GET_KEY(__x) ((__x).get_key())
+#define GET_KEY(__x) (operandOf((__x).get_key()))
 #define GET_VALUE(__x) (std::get<0>((__x).get_value()))
 
-#define GET_PTSET_KEY(__x) ((__x).get_key())
+#define GET_PTSET_KEY(__x) (operandOf((__x).get_key()))
 #define GET_PTSET_VALUE(__x) (std::get<0>((__x).get_value()))
 
 static long long int DBG_total_insts = 0;
 
-inline bool compareIndices(std::vector<SLIMOperand *> ipVec1, std::vector<SLIMOperand *> ipVec2) {
+inline bool compareIndices(const std::vector<SLIMOperand *> &ipVec1, const std::vector<SLIMOperand *> &ipVec2) {
     if (ipVec1.size() != ipVec2.size())
         return false;
 
@@ -57,26 +62,123 @@ inline bool compareOperands(SLIMOperand *a1, SLIMOperand *a2) {
     return false;
 }
 
-struct SLIMOperandLess {
-    bool operator()(SLIMOperand *a, SLIMOperand *b) const {
-        if (!compareOperands(a, b)) {
-            return a < b;
+/*
+ * Canonical operand IDs.
+ *
+ * The LHFs store dense 32-bit IDs instead of SLIMOperand pointers, so that
+ * their merge loops compare and hash integers. Every SLIMOperand is mapped to
+ * the ID of its equivalence class under compareOperands:
+ *
+ *  - dynamic allocations and plain operands by (value, index values),
+ *  - array elements by the main operand of the array and the number of
+ *    indices, not their values.
+ *
+ * An operand is given its ID the first time it reaches a set, after SLIM (or
+ * the analysis) has finished building it. The first operand seen of a class
+ * is its representative, which GET_KEY returns for elements of a set.
+ */
+using OperandID = std::uint32_t;
+
+struct OperandKey {
+    llvm::Value *value = nullptr;
+    bool array = false;
+    std::size_t arity = 0; // Number of indices of an array element.
+    std::vector<llvm::Value *> indices;
+
+    bool operator==(const OperandKey &b) const {
+        return value == b.value && array == b.array && arity == b.arity && indices == b.indices;
+    }
+
+    bool operator<(const OperandKey &b) const {
+        return std::tie(value, array, arity, indices) < std::tie(b.value, b.array, b.arity, b.indices);
+    }
+};
+
+struct OperandKeyHash {
+    std::size_t operator()(const OperandKey &k) const {
+        std::size_t h = lhf::compose_hash(std::hash<llvm::Value *>()(k.value), k.array);
+        h = lhf::compose_hash(h, k.arity);
+        for (llvm::Value *i : k.indices) {
+            h = lhf::compose_hash(h, i);
+        }
+        return h;
+    }
+};
+
+class OperandTable {
+    lhf::Deduplicator<OperandKey, std::less<OperandKey>, OperandKeyHash> keys;
+    std::unordered_map<SLIMOperand *, OperandID> ids;
+    std::vector<SLIMOperand *> operands;
+
+  public:
+    static OperandKey keyOf(SLIMOperand *op) {
+        OperandKey k;
+        if (!op->isDynamicAllocationType() && op->isArrayElement()) {
+            k.value = op->getValueOfArray();
+            k.array = true;
+            k.arity = op->getIndexVector().size();
         } else {
+            k.value = op->getValue();
+            for (SLIMOperand *i : op->getIndexVector()) {
+                k.indices.push_back(i->getValue());
+            }
+        }
+        return k;
+    }
+
+    OperandID id(SLIMOperand *op) {
+        auto cursor = ids.find(op);
+        if (cursor != ids.end()) {
+            return cursor->second;
+        }
+
+        lhf::IndexValue index = keys.register_value(keyOf(op)).value;
+        if (index > std::numeric_limits<OperandID>::max()) {
+            throw std::overflow_error("Number of distinct operands exceeds the range of OperandID.");
+        }
+        if (index == operands.size()) {
+            operands.push_back(op);
+        }
+
+        ids.emplace(op, OperandID(index));
+        return OperandID(index);
+    }
+
+    SLIMOperand *operand(OperandID id) const {
+        return operands[id];
+    }
+
+    // ID of the class of a key, if an operand of it has been seen.
+    bool find(const OperandKey &k, OperandID &id) const {
+        auto index = keys.find(k);
+        if (!index.is_present()) {
             return false;
         }
+        id = OperandID(index.get().value);
+        return true;
     }
-};
 
-struct SLIMOperandEqual {
-    bool operator()(SLIMOperand *a, SLIMOperand *b) const {
-        return compareOperands(a, b);
+    std::size_t size() const {
+        return operands.size();
     }
 };
 
+// Shared by all translation units, unlike the LHFs below, so that an ID means
+// the same operand everywhere.
+inline OperandTable operandTable;
+
+inline OperandID operandID(SLIMOperand *op) {
+    return operandTable.id(op);
+}
+
+inline SLIMOperand *operandOf(OperandID id) {
+    return operandTable.operand(id);
+}
+
 struct SLIMOperandPrinter {
-    std::string operator()(SLIMOperand *a) const {
+    std::string operator()(OperandID a) const {
         std::stringstream s;
-        s << a;
+        s << operandOf(a);
         return s.str();
         // return a->hasName() ? a->getName().str() : "<UNNAMED>";
     }
@@ -86,7 +188,8 @@ static size_t STAT_operation_count = 0;
 
 struct LivenessLHF
     : public lhf::LatticeHashForest<
-          SLIMOperand *, SLIMOperandLess, std::hash<SLIMOperand *>, SLIMOperandEqual, SLIMOperandPrinter> {
+          OperandID, lhf::DefaultLess<OperandID>, lhf::DefaultHash<OperandID>, lhf::DefaultEqual<OperandID>,
+          SLIMOperandPrinter> {
 
     Index get_purely_global(Index a) {
         STAT_operation_count++;
@@ -97,7 +200,7 @@ struct LivenessLHF
         PropertySet new_set;
 
         for (const PropertyElement &i : get_value(a)) {
-            if (i.get_key()->isVariableGlobal()) {
+            if (operandOf(i.get_key())->isVariableGlobal()) {
                 LHF_PUSH_ONE(new_set, i);
             }
         }
@@ -114,7 +217,7 @@ struct LivenessLHF
         PropertySet new_set;
 
         for (const PropertyElement &i : get_value(a)) {
-            if (!i.get_key()->isVariableGlobal()) {
+            if (!operandOf(i.get_key())->isVariableGlobal()) {
                 LHF_PUSH_ONE(new_set, i);
             }
         }
@@ -124,8 +227,8 @@ struct LivenessLHF
 };
 
 struct PointsToLHF : public lhf::LatticeHashForest<
-                         SLIMOperand *, SLIMOperandLess, lhf::DefaultHash<SLIMOperand *>, SLIMOperandEqual,
-                         SLIMOperandPrinter, lhf::NestingBase<SLIMOperand *, LivenessLHF>> {
+                         OperandID, lhf::DefaultLess<OperandID>, lhf::DefaultHash<OperandID>,
+                         lhf::DefaultEqual<OperandID>, SLIMOperandPrinter, lhf::NestingBase<OperandID, LivenessLHF>> {
 
     PointsToLHF(LivenessLHF &l) : LatticeHashForest(RefList{l}) {}
 
@@ -169,14 +272,10 @@ struct PointsToLHF : public lhf::LatticeHashForest<
         return set_union(set_value, insertee);
     }
 
-    // This also needs to handle the empty set condition, apparently.
     LivenessLHF::Index get_pointees(Index set_value, SLIMOperand *pointer) {
-        const PropertySet &first = get_value(set_value);
-        for (auto &elem : first) {
-            // POTENTIAL PROBLEM?
-            if (GET_KEY(elem) == pointer) {
-                return GET_VALUE(elem);
-            }
+        auto elem = find_key(set_value, operandID(pointer));
+        if (elem.is_present()) {
+            return GET_VALUE(elem.get());
         }
         return lhf::EMPTY_SET_VALUE;
     }
@@ -206,7 +305,7 @@ struct LFLivenessSet {
         // std::cout << "liveness set_value: " << set_value << "\n";
         assert(set_value.value >= 0 && set_value < livenessLHF.property_set_count());
         // CHECK SET INTEGRITY
-        std::set<SLIMOperand *> k;
+        std::set<OperandID> k;
         for (const PropertyElement &i : livenessLHF.get_value(b)) {
             assert(k.count(i.get_key()) == 0);
             k.insert(i.get_key());
@@ -224,7 +323,7 @@ struct LFLivenessSet {
     }
 
     static LFLivenessSet create_from_single(SLIMOperand *p) {
-        return livenessLHF.register_set_single(p);
+        return livenessLHF.register_set_single(operandID(p));
     }
 
     bool operator<(const LFLivenessSet &b) const {
@@ -268,12 +367,38 @@ struct LFLivenessSet {
 
     LFLivenessSet insert_single(SLIMOperand *p) const {
         STAT_operation_count++;
-        return livenessLHF.set_insert_single(set_value, p);
+        return livenessLHF.set_insert_single(set_value, operandID(p));
     }
 
     LFLivenessSet remove_single(SLIMOperand *p) const {
         STAT_operation_count++;
-        return livenessLHF.set_remove_single(set_value, p);
+        return livenessLHF.set_remove_single(set_value, operandID(p));
+    }
+
+    // Batches inserts and removals into one set registration on commit, so a
+    // loop that builds a set does not register a set per step.
+    class Transient {
+        LivenessLHF::Transient t;
+
+      public:
+        Transient(const LFLivenessSet &s) : t(livenessLHF, s.set_value) {}
+
+        void insert(SLIMOperand *p) {
+            t.insert(operandID(p));
+        }
+
+        void remove(SLIMOperand *p) {
+            t.remove(operandID(p));
+        }
+
+        LFLivenessSet commit() {
+            STAT_operation_count++;
+            return t.commit();
+        }
+    };
+
+    Transient transient() const {
+        return Transient(*this);
     }
 
     const LivenessLHF::PropertySet &get_value() const {
@@ -282,7 +407,7 @@ struct LFLivenessSet {
 
     bool contains(SLIMOperand *p) const {
         STAT_operation_count++;
-        return livenessLHF.contains(set_value, p);
+        return livenessLHF.contains(set_value, operandID(p));
     }
 
     const_iterator begin() const {
@@ -328,12 +453,12 @@ struct LFPointsToSet {
 #ifdef ENABLE_INTEGRITY_CHECKING
         assert(set_value.value >= 0 && set_value < pointsToLHF.property_set_count());
         // CHECK SET INTEGRITY
-        std::set<SLIMOperand *> k;
+        std::set<OperandID> k;
         for (const PropertyElement &i : pointsToLHF.get_value(set_value)) {
             // std::cout << "checking: (" << i.key << ", " << i.value << ")" <<
             // std::endl;
-            assert(k.count(GET_KEY(i)) == 0);
-            k.insert(GET_KEY(i));
+            assert(k.count(i.get_key()) == 0);
+            k.insert(i.get_key());
         }
 #endif
     }
@@ -361,13 +486,13 @@ struct LFPointsToSet {
 
     LFPointsToSet insert_pointee(SLIMOperand *pointer, SLIMOperand *pointee) {
         STAT_operation_count++;
-        LivenessLHF::Index pointeeSet = livenessLHF.register_set_single(pointee);
-        return pointsToLHF.insert_pointee(set_value, {pointer, pointeeSet});
+        LivenessLHF::Index pointeeSet = livenessLHF.register_set_single(operandID(pointee));
+        return pointsToLHF.insert_pointee(set_value, {operandID(pointer), pointeeSet});
     }
 
     LFPointsToSet update_pointees(SLIMOperand *pointer, LFLivenessSet pointees) {
         STAT_operation_count++;
-        return pointsToLHF.update_pointees(set_value, {pointer, pointees.set_value});
+        return pointsToLHF.update_pointees(set_value, {operandID(pointer), pointees.set_value});
     }
 
     LFLivenessSet get_pointees(SLIMOperand *pointer) {
@@ -375,6 +500,38 @@ struct LFPointsToSet {
         return pointsToLHF.get_pointees(set_value, pointer);
     }
 
+    // Batches pointee updates into one set registration on commit. The pointees
+    // inserted for a pointer are registered as one liveness set.
+    class Transient {
+        PointsToLHF::Transient t;
+
+      public:
+        Transient(const LFPointsToSet &s) : t(pointsToLHF, s.set_value) {}
+
+        void insert_pointee(SLIMOperand *pointer, SLIMOperand *pointee) {
+            t.insert_child<0>(operandID(pointer), operandID(pointee));
+        }
+
+        void update_pointees(SLIMOperand *pointer, LFLivenessSet pointees) {
+            t.update({operandID(pointer), pointees.set_value});
+        }
+
+        LFPointsToSet commit() {
+            STAT_operation_count++;
+            return t.commit();
+        }
+    };
+
+    Transient transient() const {
+        return Transient(*this);
+    }
+
+    // The entries whose pointer is in `keys`, matched by operand ID.
+    LFPointsToSet restrict_keys(const LFLivenessSet &keys) const {
+        STAT_operation_count++;
+        return pointsToLHF.set_restrict_keys(set_value, livenessLHF, keys.set_value);
+    }
+
     const PointsToLHF::PropertySet &get_value() const {
         return pointsToLHF.get_value(set_value);
     }
@@ -392,4 +549,21 @@ struct LFPointsToSet {
     }
 };
 
+// Set values are canonical LHF indices, so equal sets hash equally.
+namespace std {
+template <>
+struct hash<LFLivenessSet> {
+    std::size_t operator()(const LFLivenessSet &s) const {
+        return std::hash<lhf::IndexValue>()(s.set_value.value);
+    }
+};
+
+template <>
+struct hash<LFPointsToSet> {
+    std::size_t operator()(const LFPointsToSet &s) const {
+        return std::hash<lhf::IndexValue>()(s.set_value.value);
+    }
+};
+} // namespace std
+
 #endif
@@ -60,6 +60,19 @@ inline bool compareOperands(SLIMOperand *a1, SLIMOperand *a2) {
     return false;
 }
 
+// Whether a and b fall in the same operand class of the LHF mode (see
+// OperandTable::keyOf in Common.h): array elements by their array and number
+// of indices, other operands as compareOperands has it.
+inline bool sameOperandClass(SLIMOperand *a, SLIMOperand *b) {
+    bool array_a = !a->isDynamicAllocationType() and a->isArrayElement();
+    bool array_b = !b->isDynamicAllocationType() and b->isArrayElement();
+    if (array_a or array_b) {
+        return array_a and array_b and a->getValueOfArray() == b->getValueOfArray() and
+               a->getIndexVector().size() == b->getIndexVector().size();
+    }
+    return compareOperands(a, b);
+}
+
 struct SLIMOperandLess {
     bool operator()(SLIMOperand *a, SLIMOperand *b) const {
         if (!compareOperands(a, b)) {
@@ -250,6 +263,30 @@ struct LFLivenessSet {
         return std::move(elems);
     }
 
+    class Transient {
+        container_type elems;
+
+      public:
+        Transient(const LFLivenessSet &s) : elems(s.elems) {}
+
+        void insert(key_type p) {
+            elems.insert(p);
+        }
+
+        void remove(key_type p) {
+            elems.erase(p);
+        }
+
+        LFLivenessSet commit() {
+            STAT_operation_count++;
+            return LFLivenessSet(elems);
+        }
+    };
+
+    Transient transient() const {
+        return Transient(*this);
+    }
+
     bool contains(SLIMOperand *p) const {
         STAT_operation_count++;
         return elems.count(p) > 0;
@@ -385,6 +422,44 @@ struct LFPointsToSet {
         return elems.at(pointer);
     }
 
+    class Transient {
+        container_type elems;
+
+      public:
+        Transient(const LFPointsToSet &s) : elems(s.elems) {}
+
+        void insert_pointee(SLIMOperand *pointer, SLIMOperand *pointee) {
+            elems[pointer].insert(pointee);
+        }
+
+        void update_pointees(SLIMOperand *pointer, LFLivenessSet pointees) {
+            elems.insert_or_assign(pointer, pointees.elems);
+        }
+
+        LFPointsToSet commit() {
+            STAT_operation_count++;
+            return LFPointsToSet(elems);
+        }
+    };
+
+    Transient transient() const {
+        return Transient(*this);
+    }
+
+    LFPointsToSet restrict_keys(const LFLivenessSet &keys) const {
+        STAT_operation_count++;
+        container_type new_set;
+        for (const auto &entry : elems) {
+            for (SLIMOperand *key : keys.elems) {
+                if (sameOperandClass(key, entry.first)) {
+                    new_set.insert(entry);
+                    break;
+                }
+            }
+        }
+        return new_set;
+    }
+
     std::size_t size() const {
         return elems.size();
     }
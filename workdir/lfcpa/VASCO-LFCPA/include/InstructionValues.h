@@ -0,0 +1,139 @@
+#ifndef VASCO_INSTRUCTIONVALUES_H
+#define VASCO_INSTRUCTIONVALUES_H
+
+#include "IR.h"
+#include "llvm/IR/Function.h"
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Range [first, last + 1) of the SLIM instruction IDs of each function. SLIM
+ * numbers instructions densely while it walks the module, so the IDs of a
+ * function form one block with at most a few holes. The ranges are computed on
+ * first use, from the instruction lists of the blocks of the function.
+ */
+class InstructionIDRanges {
+    std::unordered_map<llvm::Function *, std::pair<long long, long long>> ranges;
+    std::unordered_map<llvm::Function *, std::vector<int>> boundary_slots;
+
+  public:
+    std::pair<long long, long long> range(slim::IR *optIR, llvm::Function *function) {
+        auto cursor = ranges.find(function);
+        if (cursor != ranges.end()) {
+            return cursor->second;
+        }
+
+        long long first = 0, last = -1;
+        auto &blocks = optIR->func_bb_to_inst_id;
+        for (auto entry = blocks.lower_bound({function, nullptr});
+             entry != blocks.end() && entry->first.first == function; ++entry) {
+            for (long long id : entry->second) {
+                if (last < first) {
+                    first = last = id;
+                } else {
+                    first = std::min(first, id);
+                    last = std::max(last, id);
+                }
+            }
+        }
+        return ranges.emplace(function, std::make_pair(first, last + 1)).first->second;
+    }
+
+    // Slots of the instructions of the function, by ID minus the first ID of
+    // the function, when only the values at block boundaries are kept: the
+    // first and last instructions of each block have one, as has every
+    // instruction of a block with a call, whose call flow reads the values it
+    // stored there before. The others have -1.
+    const std::vector<int> &boundarySlots(slim::IR *optIR, llvm::Function *function) {
+        auto cursor = boundary_slots.find(function);
+        if (cursor != boundary_slots.end()) {
+            return cursor->second;
+        }
+
+        long long first = range(optIR, function).first;
+        std::vector<int> slots(range(optIR, function).second - first, -1);
+        int count = 0;
+        auto &blocks = optIR->func_bb_to_inst_id;
+        for (auto entry = blocks.lower_bound({function, nullptr});
+             entry != blocks.end() && entry->first.first == function; ++entry) {
+            bool has_call = std::any_of(entry->second.begin(), entry->second.end(),
+                                        [&](long long id) { return optIR->inst_id_to_object[id]->getCall(); });
+            for (long long id : entry->second) {
+                if (has_call || id == entry->second.front() || id == entry->second.back()) {
+                    slots[id - first] = count++;
+                }
+            }
+        }
+        return boundary_slots.emplace(function, std::move(slots)).first->second;
+    }
+};
+
+/*
+ * IN or OUT values of the SLIM instructions of one function, kept in a flat
+ * array indexed by instruction ID minus the first ID of the function. The
+ * values of instructions outside that range, including the null instruction
+ * that stands for an empty block, go to a side table that stays empty in
+ * practice. Values that were never set read as default-constructed, like the
+ * nested unordered_maps this replaces.
+ *
+ * Bound with the boundarySlots of the function, it keeps only the instructions
+ * that have a slot; the owner must not index it with the others (see holds).
+ */
+template <class F, class B>
+class InstructionValues {
+    bool bound = false;
+    long long offset = 0;
+    long long size = 0;
+    const std::vector<int> *slots = nullptr;
+    std::vector<std::pair<F, B>> values;
+    std::unordered_map<BaseInstruction *, std::pair<F, B>> others;
+
+    // Index into values of an instruction in the range, or -1.
+    long long indexOf(BaseInstruction *I) const {
+        if (I != nullptr) {
+            auto index = static_cast<unsigned long long>(I->getInstructionId() - offset);
+            if (index < static_cast<unsigned long long>(size)) {
+                return slots != nullptr ? (*slots)[index] : static_cast<long long>(index);
+            }
+        }
+        return -1;
+    }
+
+  public:
+    bool isBound() const {
+        return bound;
+    }
+
+    void bind(std::pair<long long, long long> range, const std::vector<int> *boundary_slots = nullptr) {
+        bound = true;
+        offset = range.first;
+        size = range.second - range.first;
+        slots = boundary_slots;
+        values.resize(slots != nullptr ? static_cast<size_t>(std::count_if(slots->begin(), slots->end(),
+                                                                           [](int slot) { return slot >= 0; }))
+                                       : size);
+    }
+
+    // Whether the values of the instruction are kept here.
+    bool holds(BaseInstruction *I) const {
+        if (slots == nullptr || I == nullptr) {
+            return true;
+        }
+        auto index = static_cast<unsigned long long>(I->getInstructionId() - offset);
+        return index >= slots->size() || (*slots)[index] >= 0;
+    }
+
+    std::pair<F, B> &operator[](BaseInstruction *I) {
+        long long index = indexOf(I);
+        if (index >= 0) {
+            return values[index];
+        }
+        assert(holds(I) && "Instruction has no slot under block-granular storage");
+        return others[I];
+    }
+};
+
+#endif // VASCO_INSTRUCTIONVALUES_H
@@ -0,0 +1,728 @@
+#ifndef VASCO_SUMMARYCACHE_H
+#define VASCO_SUMMARYCACHE_H
+
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/*
+ * Persistent function summaries, compiled in with SUMMARY_CACHE.
+ *
+ * A re-run of the analysis on a slightly changed build of the same program
+ * reuses the contexts of the functions that, together with everything they
+ * may call, did not change. Each function has one file in the cache directory,
+ * named after its hash, which holds the (inflow, outflow) pairs of its
+ * contexts, with the values at their instructions so that a run that reuses
+ * them reports the same results. LHF indices and pointers do not survive the
+ * run, so the values in the file are written in the SummaryValue form below,
+ * with program objects referred to by the stable names of SummaryKeys.
+ */
+
+// A data flow value in summary form: a set of entries, each the name of an
+// object (an operand, say) with the names of the objects it maps to. Plain
+// sets have no children.
+using SummaryValue = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+// The values at the instructions of a function in one context, by the position
+// of the instruction in the function: forward IN and OUT, then backward IN and
+// OUT.
+using SummaryInstructionValues = std::map<size_t, std::array<SummaryValue, 4>>;
+
+// A context reached from another one: the name of its function, its inflow and
+// the values at its instructions.
+struct SummaryReachedContext {
+    std::string function;
+    SummaryValue forward_inflow, backward_inflow;
+    SummaryInstructionValues instructions;
+
+    bool operator<(const SummaryReachedContext &other) const {
+        return std::tie(function, forward_inflow, backward_inflow, instructions) <
+               std::tie(other.function, other.forward_inflow, other.backward_inflow, other.instructions);
+    }
+};
+
+// The results of a context: the values at its instructions, and the contexts
+// it reached.
+struct SummaryResults {
+    SummaryInstructionValues instructions;
+    std::vector<SummaryReachedContext> reached;
+};
+
+/*
+ * Stable names for the functions and values of a module.
+ *
+ * The structural hash of a function covers its signature and instructions,
+ * with local values numbered by their position and globals by their name, so
+ * it does not depend on the rest of the module. hash() combines it with the
+ * hashes of the callees, bottom-up over the SCCs of the call graph: a function
+ * keeps its hash for as long as neither it nor anything it may call changes.
+ * The callees of an indirect call are not known here, so hasIndirectCalls
+ * reports the functions that make one.
+ *
+ * Locals are named after their function and its structural hash, so a name
+ * read back from an older run never denotes a value that has since changed.
+ */
+class SummaryKeys {
+    llvm::Module &module;
+    std::unordered_map<const llvm::Function *, uint64_t> own_hashes, hashes;
+    std::unordered_map<const llvm::Function *, std::vector<llvm::Function *>> callee_lists;
+    std::unordered_set<const llvm::Function *> indirect_callers;
+    // Arguments, then instructions, of each function in order, and back.
+    std::unordered_map<const llvm::Function *, std::vector<llvm::Value *>> locals;
+    std::unordered_map<const llvm::Value *, unsigned> positions;
+    const std::vector<llvm::Function *> no_callees;
+
+    static bool isPlainName(llvm::StringRef name) {
+        return !name.empty() && name.find_first_of(" \t\r\n") == llvm::StringRef::npos;
+    }
+
+    void printOperand(llvm::raw_ostream &os, const llvm::Value *operand,
+                      const std::unordered_map<const llvm::BasicBlock *, unsigned> &blocks) const {
+        if (auto *block = llvm::dyn_cast<llvm::BasicBlock>(operand)) {
+            os << 'b' << blocks.at(block);
+        } else if (llvm::isa<llvm::Argument>(operand) || llvm::isa<llvm::Instruction>(operand)) {
+            os << '%' << positions.at(operand);
+        } else if (auto *global = llvm::dyn_cast<llvm::GlobalValue>(operand)) {
+            os << '@' << global->getName();
+        } else if (llvm::isa<llvm::MetadataAsValue>(operand)) {
+            os << '!';
+        } else {
+            operand->printAsOperand(os, true, &module);
+        }
+    }
+
+    void hashFunction(llvm::Function &function) {
+        std::vector<llvm::Value *> &values = locals[&function];
+        for (llvm::Argument &argument : function.args()) {
+            positions[&argument] = values.size();
+            values.push_back(&argument);
+        }
+        std::unordered_map<const llvm::BasicBlock *, unsigned> blocks;
+        for (llvm::BasicBlock &block : function) {
+            blocks.emplace(&block, blocks.size());
+            for (llvm::Instruction &instruction : block) {
+                positions[&instruction] = values.size();
+                values.push_back(&instruction);
+            }
+        }
+
+        std::string text;
+        llvm::raw_string_ostream os(text);
+        os << function.getName() << ' ';
+        function.getFunctionType()->print(os);
+        for (llvm::BasicBlock &block : function) {
+            os << "\nb";
+            for (llvm::Instruction &instruction : block) {
+                os << '\n' << instruction.getOpcodeName() << ' ';
+                instruction.getType()->print(os);
+                if (auto *compare = llvm::dyn_cast<llvm::CmpInst>(&instruction)) {
+                    os << " p" << compare->getPredicate();
+                } else if (auto *alloca = llvm::dyn_cast<llvm::AllocaInst>(&instruction)) {
+                    os << ' ';
+                    alloca->getAllocatedType()->print(os);
+                } else if (auto *gep = llvm::dyn_cast<llvm::GetElementPtrInst>(&instruction)) {
+                    os << ' ';
+                    gep->getSourceElementType()->print(os);
+                } else if (auto *phi = llvm::dyn_cast<llvm::PHINode>(&instruction)) {
+                    for (llvm::BasicBlock *incoming : phi->blocks()) {
+                        os << " b" << blocks.at(incoming);
+                    }
+                } else if (auto *call = llvm::dyn_cast<llvm::CallBase>(&instruction)) {
+                    os << ' ';
+                    call->getFunctionType()->print(os);
+                    llvm::Function *callee = call->getCalledFunction();
+                    if (callee == nullptr) {
+                        if (!call->isInlineAsm()) {
+                            indirect_callers.insert(&function);
+                        }
+                    } else if (!callee->isDeclaration()) {
+                        std::vector<llvm::Function *> &callees = callee_lists[&function];
+                        if (std::find(callees.begin(), callees.end(), callee) == callees.end()) {
+                            callees.push_back(callee);
+                        }
+                    }
+                }
+                for (const llvm::Use &operand : instruction.operands()) {
+                    os << ' ';
+                    printOperand(os, operand.get(), blocks);
+                }
+            }
+        }
+        own_hashes[&function] = llvm::xxHash64(os.str());
+    }
+
+  public:
+    explicit SummaryKeys(llvm::Module &M) : module(M) {
+        for (llvm::Function &function : M) {
+            if (!function.isDeclaration()) {
+                hashFunction(function);
+            }
+        }
+
+        llvm::CallGraph CG(M);
+        for (llvm::Function &function : M) {
+            if (function.isDeclaration() || hashes.count(&function)) {
+                continue;
+            }
+            // SCCs reachable from the function, callees first.
+            for (auto SCCI = llvm::scc_begin(CG[&function]); !SCCI.isAtEnd(); ++SCCI) {
+                std::vector<llvm::Function *> members;
+                for (llvm::CallGraphNode *node : *SCCI) {
+                    llvm::Function *member = node->getFunction();
+                    if (member != nullptr && !member->isDeclaration() && !hashes.count(member)) {
+                        members.push_back(member);
+                    }
+                }
+                if (members.empty()) {
+                    continue;
+                }
+
+                std::vector<uint64_t> parts;
+                for (llvm::Function *member : members) {
+                    parts.push_back(own_hashes[member]);
+                    for (llvm::Function *callee : callees(member)) {
+                        if (std::find(members.begin(), members.end(), callee) == members.end()) {
+                            parts.push_back(hashes[callee]);
+                        }
+                    }
+                }
+                std::sort(parts.begin(), parts.end());
+                std::string text;
+                for (uint64_t part : parts) {
+                    text += llvm::utohexstr(part) + ' ';
+                }
+                uint64_t scc_hash = llvm::xxHash64(text);
+                for (llvm::Function *member : members) {
+                    hashes[member] = llvm::xxHash64(llvm::utohexstr(scc_hash) + ' ' + llvm::utohexstr(own_hashes[member]));
+                }
+            }
+        }
+    }
+
+    uint64_t hash(const llvm::Function *function) const {
+        return hashes.at(function);
+    }
+
+    // Functions with a body that the function calls directly.
+    const std::vector<llvm::Function *> &callees(const llvm::Function *function) const {
+        auto cursor = callee_lists.find(function);
+        return cursor == callee_lists.end() ? no_callees : cursor->second;
+    }
+
+    bool hasIndirectCalls(const llvm::Function *function) const {
+        return indirect_callers.count(function) != 0;
+    }
+
+    // Names a global, an argument or instruction of a function with a body, or
+    // an integer constant. Other values have no stable name.
+    bool encode(const llvm::Value *value, std::string &name) const {
+        if (auto *global = llvm::dyn_cast<llvm::GlobalValue>(value)) {
+            if (!isPlainName(global->getName())) {
+                return false;
+            }
+            name = "@" + global->getName().str();
+            return true;
+        }
+        if (auto *constant = llvm::dyn_cast<llvm::ConstantInt>(value)) {
+            if (constant->getBitWidth() > 64) {
+                return false;
+            }
+            name = "#" + std::to_string(constant->getBitWidth()) + "." + std::to_string(constant->getSExtValue());
+            return true;
+        }
+        const llvm::Function *function = nullptr;
+        if (auto *argument = llvm::dyn_cast<llvm::Argument>(value)) {
+            function = argument->getParent();
+        } else if (auto *instruction = llvm::dyn_cast<llvm::Instruction>(value)) {
+            function = instruction->getFunction();
+        }
+        if (function == nullptr || !isPlainName(function->getName()) || !positions.count(value)) {
+            return false;
+        }
+        name = "%" + function->getName().str() + "." + llvm::utohexstr(own_hashes.at(function)) + "." +
+               std::to_string(positions.at(value));
+        return true;
+    }
+
+    // Inverse of encode, or nullptr if the name does not denote a value of
+    // this module.
+    llvm::Value *decode(const std::string &name) const {
+        if (name.size() < 2) {
+            return nullptr;
+        }
+        llvm::StringRef rest = llvm::StringRef(name).drop_front();
+        if (name[0] == '@') {
+            return module.getNamedValue(rest);
+        }
+        if (name[0] == '#') {
+            auto [width, number] = rest.split('.');
+            unsigned bits;
+            long long constant;
+            if (width.getAsInteger(10, bits) || number.getAsInteger(10, constant) || bits == 0 || bits > 64) {
+                return nullptr;
+            }
+            return llvm::ConstantInt::get(llvm::IntegerType::get(module.getContext(), bits), constant, true);
+        }
+        if (name[0] == '%') {
+            auto [prefix, position] = rest.rsplit('.');
+            auto [function_name, hash] = prefix.rsplit('.');
+            llvm::Function *function = module.getFunction(function_name);
+            unsigned index;
+            if (function == nullptr || function->isDeclaration() || position.getAsInteger(10, index) ||
+                hash != llvm::utohexstr(own_hashes.at(function))) {
+                return nullptr;
+            }
+            const std::vector<llvm::Value *> &values = locals.at(function);
+            return index < values.size() ? values[index] : nullptr;
+        }
+        return nullptr;
+    }
+};
+
+/*
+ * The summaries of one function as kept in its file: its contexts as
+ * (inflow, outflow) pairs of value numbers, each with the effects on the
+ * tables of the client that reusing it must replay and its results, and a
+ * snapshot of the values they refer to. Like an LHF, the snapshot keeps every
+ * distinct name, set and value once: a set is a list of names and a value a
+ * list of (name, set) entries, all by number, sorted by name so that they do
+ * not depend on the order of the run that wrote them.
+ */
+class FunctionSummaries {
+    using Entries = std::vector<std::pair<size_t, size_t>>;
+    using Instructions = std::map<size_t, std::array<size_t, 4>>;
+
+    // A context reached from a recorded one, by the name number of its
+    // function and the value numbers of its inflow.
+    struct Reached {
+        size_t function, forward, backward;
+        Instructions instructions;
+
+        bool operator==(const Reached &other) const {
+            return std::tie(function, forward, backward, instructions) ==
+                   std::tie(other.function, other.forward, other.backward, other.instructions);
+        }
+    };
+
+    // The outflow of a context and its effects, as sorted name numbers, and
+    // its results: the values at its instructions and the contexts it
+    // reached.
+    struct Outcome {
+        size_t forward, backward;
+        std::vector<size_t> effects;
+        Instructions instructions;
+        std::vector<Reached> reached;
+
+        bool operator!=(const Outcome &other) const {
+            return forward != other.forward || backward != other.backward || effects != other.effects ||
+                   instructions != other.instructions || reached != other.reached;
+        }
+    };
+
+    std::vector<std::string> names;
+    std::map<std::string, size_t> name_numbers;
+    std::vector<std::vector<size_t>> sets;
+    std::map<std::vector<size_t>, size_t> set_numbers;
+    std::vector<Entries> values;
+    std::map<Entries, size_t> value_numbers;
+    std::map<std::pair<size_t, size_t>, Outcome> contexts;
+    bool changed = false;
+
+    static const char *header() {
+        return "vasco-summaries 3";
+    }
+
+    static void sortValue(SummaryValue &value) {
+        for (auto &entry : value) {
+            std::sort(entry.second.begin(), entry.second.end());
+            entry.second.erase(std::unique(entry.second.begin(), entry.second.end()), entry.second.end());
+        }
+        std::sort(value.begin(), value.end());
+        value.erase(std::unique(value.begin(), value.end()), value.end());
+    }
+
+    template <class Key>
+    static size_t intern(std::vector<Key> &table, std::map<Key, size_t> &numbers, const Key &key) {
+        auto cursor = numbers.find(key);
+        if (cursor != numbers.end()) {
+            return cursor->second;
+        }
+        numbers.emplace(key, table.size());
+        table.push_back(key);
+        return table.size() - 1;
+    }
+
+    template <class Key>
+    static bool find(const std::map<Key, size_t> &numbers, const Key &key, size_t &number) {
+        auto cursor = numbers.find(key);
+        if (cursor == numbers.end()) {
+            return false;
+        }
+        number = cursor->second;
+        return true;
+    }
+
+    // Number of a value, without adding it (or its parts) to the snapshot.
+    bool findValue(SummaryValue value, size_t &number) const {
+        sortValue(value);
+        Entries entries;
+        for (auto &entry : value) {
+            std::vector<size_t> set;
+            size_t key, child;
+            for (const std::string &name : entry.second) {
+                if (!find(name_numbers, name, child)) {
+                    return false;
+                }
+                set.push_back(child);
+            }
+            if (!find(name_numbers, entry.first, key) || !find(set_numbers, set, child)) {
+                return false;
+            }
+            entries.push_back({key, child});
+        }
+        return find(value_numbers, entries, number);
+    }
+
+    bool internValue(SummaryValue value, size_t &number) {
+        sortValue(value);
+        Entries entries;
+        for (auto &entry : value) {
+            std::vector<size_t> set;
+            size_t key, child;
+            for (const std::string &name : entry.second) {
+                if (!addName(name, child)) {
+                    return false;
+                }
+                set.push_back(child);
+            }
+            if (!addName(entry.first, key)) {
+                return false;
+            }
+            entries.push_back({key, intern(sets, set_numbers, set)});
+        }
+        number = intern(values, value_numbers, entries);
+        return true;
+    }
+
+    bool addName(const std::string &name, size_t &number) {
+        // Names are stored one per line.
+        if (name.empty() || name.find('\n') != std::string::npos) {
+            return false;
+        }
+        number = intern(names, name_numbers, name);
+        return true;
+    }
+
+    bool internInstructions(const SummaryInstructionValues &values, Instructions &numbers) {
+        for (auto &instruction : values) {
+            std::array<size_t, 4> &value_numbers = numbers[instruction.first];
+            for (size_t index = 0; index < 4; index++) {
+                if (!internValue(instruction.second[index], value_numbers[index])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    SummaryInstructionValues getInstructions(const Instructions &numbers) const {
+        SummaryInstructionValues values;
+        for (auto &instruction : numbers) {
+            std::array<SummaryValue, 4> &value = values[instruction.first];
+            for (size_t index = 0; index < 4; index++) {
+                value[index] = getValue(instruction.second[index]);
+            }
+        }
+        return values;
+    }
+
+    static void writeInstructions(std::ofstream &out, const std::pair<size_t, size_t> &inflow, size_t context,
+                                  const Instructions &numbers) {
+        for (auto &instruction : numbers) {
+            out << "I " << inflow.first << ' ' << inflow.second << ' ' << context << ' ' << instruction.first;
+            for (size_t value : instruction.second) {
+                out << ' ' << value;
+            }
+            out << '\n';
+        }
+    }
+
+    SummaryValue getValue(size_t number) const {
+        SummaryValue value;
+        for (auto &entry : values[number]) {
+            std::vector<std::string> children;
+            for (size_t child : sets[entry.second]) {
+                children.push_back(names[child]);
+            }
+            value.push_back({names[entry.first], children});
+        }
+        return value;
+    }
+
+  public:
+    bool lookup(const SummaryValue &forward_inflow, const SummaryValue &backward_inflow, SummaryValue &forward_outflow,
+                SummaryValue &backward_outflow, std::vector<std::string> &effects, SummaryResults &results) const {
+        size_t forward, backward;
+        if (!findValue(forward_inflow, forward) || !findValue(backward_inflow, backward)) {
+            return false;
+        }
+        auto cursor = contexts.find({forward, backward});
+        if (cursor == contexts.end()) {
+            return false;
+        }
+        forward_outflow = getValue(cursor->second.forward);
+        backward_outflow = getValue(cursor->second.backward);
+        effects.clear();
+        for (size_t effect : cursor->second.effects) {
+            effects.push_back(names[effect]);
+        }
+        results.instructions = getInstructions(cursor->second.instructions);
+        results.reached.clear();
+        for (auto &reached : cursor->second.reached) {
+            results.reached.push_back({names[reached.function], getValue(reached.forward), getValue(reached.backward),
+                                       getInstructions(reached.instructions)});
+        }
+        return true;
+    }
+
+    bool record(const SummaryValue &forward_inflow, const SummaryValue &backward_inflow,
+                const SummaryValue &forward_outflow, const SummaryValue &backward_outflow,
+                const std::set<std::string> &effects, const SummaryResults &results) {
+        std::pair<size_t, size_t> inflow;
+        Outcome outcome;
+        if (!internValue(forward_inflow, inflow.first) || !internValue(backward_inflow, inflow.second) ||
+            !internValue(forward_outflow, outcome.forward) || !internValue(backward_outflow, outcome.backward)) {
+            return false;
+        }
+        for (const std::string &effect : effects) {
+            if (!addName(effect, outcome.effects.emplace_back())) {
+                return false;
+            }
+        }
+        std::sort(outcome.effects.begin(), outcome.effects.end());
+        if (!internInstructions(results.instructions, outcome.instructions)) {
+            return false;
+        }
+        for (auto &reached : results.reached) {
+            Reached &numbers = outcome.reached.emplace_back();
+            if (!addName(reached.function, numbers.function) ||
+                !internValue(reached.forward_inflow, numbers.forward) ||
+                !internValue(reached.backward_inflow, numbers.backward) ||
+                !internInstructions(reached.instructions, numbers.instructions)) {
+                return false;
+            }
+        }
+        auto cursor = contexts.find(inflow);
+        if (cursor == contexts.end() || cursor->second != outcome) {
+            contexts[inflow] = outcome;
+            changed = true;
+        }
+        return true;
+    }
+
+    bool isChanged() const {
+        return changed;
+    }
+
+    size_t size() const {
+        return contexts.size();
+    }
+
+    /*
+     * The file is line based:
+     *
+     *   vasco-summaries 3 <function hash>
+     *   N <name>                      names, numbered from 0 in order
+     *   S <name>...                   sets
+     *   V <name>:<set>...             values
+     *   C <inflow> <outflow> <name>...
+     *                                 contexts, each flow a forward and a
+     *                                 backward value, and their effects
+     *   R <inflow> <name> <inflow>    the function and inflow of the next
+     *                                 context reached from the context,
+     *                                 numbered from 1
+     *   I <inflow> <context> <position> <IN> <OUT>
+     *                                 the values at an instruction, by its
+     *                                 position in its function, of the context
+     *                                 (0) or of a context reached from it
+     *
+     * A file that does not parse, or was written for another hash, is read as
+     * empty.
+     */
+    bool read(const std::string &path, uint64_t hash) {
+        std::ifstream in(path);
+        std::string line;
+        if (!in || !std::getline(in, line) || line != header() + (" " + llvm::utohexstr(hash))) {
+            return false;
+        }
+
+        FunctionSummaries file;
+        while (std::getline(in, line)) {
+            if (line.size() < 2 || line[1] != ' ') {
+                return false;
+            }
+            std::istringstream fields(line.substr(2));
+            size_t a, b, c, d, e;
+            char colon;
+            switch (line[0]) {
+            case 'N':
+                if (file.name_numbers.count(line.substr(2))) {
+                    return false;
+                }
+                intern(file.names, file.name_numbers, line.substr(2));
+                break;
+            case 'S': {
+                std::vector<size_t> set;
+                while (fields >> a) {
+                    if (a >= file.names.size()) {
+                        return false;
+                    }
+                    set.push_back(a);
+                }
+                if (file.set_numbers.count(set)) {
+                    return false;
+                }
+                intern(file.sets, file.set_numbers, set);
+                break;
+            }
+            case 'V': {
+                Entries entries;
+                while (fields >> a >> colon >> b) {
+                    if (colon != ':' || a >= file.names.size() || b >= file.sets.size()) {
+                        return false;
+                    }
+                    entries.push_back({a, b});
+                }
+                if (file.value_numbers.count(entries)) {
+                    return false;
+                }
+                intern(file.values, file.value_numbers, entries);
+                break;
+            }
+            case 'C': {
+                if (!(fields >> a >> b >> c >> d) || std::max({a, b, c, d}) >= file.values.size()) {
+                    return false;
+                }
+                std::pair<size_t, size_t> inflow{a, b};
+                Outcome outcome{c, d, {}};
+                while (fields >> a) {
+                    if (a >= file.names.size()) {
+                        return false;
+                    }
+                    outcome.effects.push_back(a);
+                }
+                file.contexts[inflow] = outcome;
+                break;
+            }
+            case 'R': {
+                auto context = file.contexts.end();
+                if (!(fields >> a >> b >> c >> d >> e) ||
+                    (context = file.contexts.find({a, b})) == file.contexts.end() || c >= file.names.size() ||
+                    std::max(d, e) >= file.values.size()) {
+                    return false;
+                }
+                context->second.reached.push_back({c, d, e, {}});
+                break;
+            }
+            case 'I': {
+                auto context = file.contexts.end();
+                size_t position;
+                std::array<size_t, 4> value_numbers;
+                if (!(fields >> a >> b >> c >> position) ||
+                    (context = file.contexts.find({a, b})) == file.contexts.end() ||
+                    c > context->second.reached.size()) {
+                    return false;
+                }
+                for (size_t &value : value_numbers) {
+                    if (!(fields >> value) || value >= file.values.size()) {
+                        return false;
+                    }
+                }
+                Instructions &instructions =
+                    c == 0 ? context->second.instructions : context->second.reached[c - 1].instructions;
+                instructions[position] = value_numbers;
+                break;
+            }
+            default:
+                return false;
+            }
+            if (!fields.eof() && line[0] != 'N') {
+                return false;
+            }
+        }
+        *this = std::move(file);
+        return true;
+    }
+
+    // Written to a temporary file first, so that an interrupted run does not
+    // leave a truncated file behind.
+    bool write(const std::string &path, uint64_t hash) const {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary);
+            out << header() << ' ' << llvm::utohexstr(hash) << '\n';
+            for (const std::string &name : names) {
+                out << "N " << name << '\n';
+            }
+            for (const std::vector<size_t> &set : sets) {
+                out << "S ";
+                for (size_t name : set) {
+                    out << name << ' ';
+                }
+                out << '\n';
+            }
+            for (const Entries &entries : values) {
+                out << "V ";
+                for (auto &entry : entries) {
+                    out << entry.first << ':' << entry.second << ' ';
+                }
+                out << '\n';
+            }
+            for (auto &context : contexts) {
+                out << "C " << context.first.first << ' ' << context.first.second << ' ' << context.second.forward
+                    << ' ' << context.second.backward;
+                for (size_t effect : context.second.effects) {
+                    out << ' ' << effect;
+                }
+                out << '\n';
+                for (const Reached &reached : context.second.reached) {
+                    out << "R " << context.first.first << ' ' << context.first.second << ' ' << reached.function
+                        << ' ' << reached.forward << ' ' << reached.backward << '\n';
+                }
+                writeInstructions(out, context.first, 0, context.second.instructions);
+                for (size_t index = 0; index < context.second.reached.size(); index++) {
+                    writeInstructions(out, context.first, index + 1, context.second.reached[index].instructions);
+                }
+            }
+            // Closing flushes the last of the file, which can fail too.
+            out.close();
+            if (out.fail()) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+};
+
+#endif // VASCO_SUMMARYCACHE_H
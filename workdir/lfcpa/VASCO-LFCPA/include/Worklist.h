@@ -2,6 +2,19 @@
 #ifndef COPYCONSTANTPROPAGATION_WORKLIST_H
 #define COPYCONSTANTPROPAGATION_WORKLIST_H
 
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include <algorithm>
+#include <cassert>
+#include <queue>
+#include <stack>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 template <typename Value, typename KeyHash = std::hash<Value>>
 class Worklist {
 private:
@@ -39,4 +52,150 @@ public:
     }
 };
 
+enum class WorklistDirection { FORWARD, BACKWARD };
+
+/*
+ * Rank of every basic block of a function in the order a forward analysis
+ * should visit them. The strongly connected components of the CFG come in
+ * topological order, so a loop settles before the blocks after it are
+ * visited. Blocks within a component come in reverse postorder. Blocks that are
+ * unreachable from the entry come last, in layout order. The ranks of a
+ * function are 0 .. size - 1, so they double as dense block IDs.
+ */
+class BlockOrder {
+    std::unordered_map<llvm::BasicBlock *, unsigned> ranks;
+
+  public:
+    explicit BlockOrder(llvm::Function *function) {
+        std::unordered_map<llvm::BasicBlock *, unsigned> rpo;
+        llvm::ReversePostOrderTraversal<llvm::Function *> traversal(function);
+        for (llvm::BasicBlock *bb : traversal) {
+            rpo.emplace(bb, rpo.size());
+        }
+
+        // scc_iterator yields components in reverse topological order.
+        std::vector<std::vector<llvm::BasicBlock *>> components;
+        for (auto scc = llvm::scc_begin(function); !scc.isAtEnd(); ++scc) {
+            components.push_back(*scc);
+        }
+
+        for (auto component = components.rbegin(); component != components.rend(); ++component) {
+            std::sort(component->begin(), component->end(),
+                      [&](llvm::BasicBlock *a, llvm::BasicBlock *b) { return rpo[a] < rpo[b]; });
+            for (llvm::BasicBlock *bb : *component) {
+                ranks.emplace(bb, ranks.size());
+            }
+        }
+
+        for (llvm::BasicBlock &bb : *function) {
+            ranks.emplace(&bb, ranks.size());
+        }
+    }
+
+    unsigned rank(llvm::BasicBlock *bb) const {
+        return ranks.at(bb);
+    }
+
+    unsigned size() const {
+        return ranks.size();
+    }
+};
+
+/*
+ * Worklist of ((context label, basic block), flag) items for the drivers of
+ * Analysis, with the same interface as Worklist. Items are taken from the most
+ * recently created context first, which keeps the callee-first order that the
+ * LIFO Worklist gave. Within a context they come in BlockOrder for forward
+ * analysis, and in its reverse (postorder) for backward analysis. Duplicates
+ * are dropped with a bitset per context, indexed by (block rank, flag), where
+ * Worklist keeps an unordered_set. AnalysisDef and AnalysisGenKill still use
+ * Worklist.
+ */
+template <WorklistDirection direction>
+class BlockWorklist {
+  public:
+    using Value = std::pair<std::pair<int, llvm::BasicBlock *>, bool>;
+
+  private:
+    // Ordered so that the top of the heap is the next item to process:
+    // highest context label, then lowest priority, then flag set first.
+    using Entry = std::tuple<int, unsigned, bool, llvm::BasicBlock *>;
+
+    struct EntryOrder {
+        bool operator()(const Entry &a, const Entry &b) const {
+            if (std::get<0>(a) != std::get<0>(b))
+                return std::get<0>(a) < std::get<0>(b);
+            if (std::get<1>(a) != std::get<1>(b))
+                return std::get<1>(a) > std::get<1>(b);
+            return std::get<2>(a) < std::get<2>(b);
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, EntryOrder> mHeap;
+    std::unordered_map<llvm::Function *, BlockOrder> mOrders;
+    std::vector<std::vector<bool>> mQueued;
+
+    const BlockOrder &orderOf(llvm::Function *function) {
+        auto cursor = mOrders.find(function);
+        if (cursor == mOrders.end()) {
+            cursor = mOrders.emplace(function, BlockOrder(function)).first;
+        }
+        return cursor->second;
+    }
+
+    std::vector<bool>::reference queuedBit(int label, unsigned rank, bool flag, unsigned blocks) {
+        if (mQueued.size() <= static_cast<size_t>(label)) {
+            mQueued.resize(label + 1);
+        }
+        std::vector<bool> &queued = mQueued[label];
+        if (queued.size() < 2 * blocks) {
+            queued.resize(2 * blocks, false);
+        }
+        return queued[2 * rank + flag];
+    }
+
+  public:
+    bool empty() const {
+        return mHeap.empty();
+    }
+
+    size_t size() const {
+        return mHeap.size();
+    }
+
+    bool workInsert(Value val) {
+        int label = val.first.first;
+        llvm::BasicBlock *bb = val.first.second;
+        bool flag = val.second;
+        assert(label >= 0 && "Context labels are expected to be non-negative");
+
+        const BlockOrder &order = orderOf(bb->getParent());
+        unsigned rank = order.rank(bb);
+        auto queued = queuedBit(label, rank, flag, order.size());
+        if (queued) {
+            return false;
+        }
+        queued = true;
+
+        unsigned priority = direction == WorklistDirection::FORWARD ? rank : order.size() - 1 - rank;
+        mHeap.emplace(label, priority, flag, bb);
+        return true;
+    }
+
+    /* NOTE: It is assumed that the user will not call this method when the
+     * worklist is empty */
+    Value workDelete() {
+        Entry top = mHeap.top();
+        mHeap.pop();
+
+        int label = std::get<0>(top);
+        bool flag = std::get<2>(top);
+        llvm::BasicBlock *bb = std::get<3>(top);
+
+        const BlockOrder &order = orderOf(bb->getParent());
+        queuedBit(label, order.rank(bb), flag, order.size()) = false;
+        return std::make_pair(std::make_pair(label, bb), flag);
+    }
+};
+
 #endif // COPYCONSTANTPROPAGATION_WORKLIST_H
@@ -77,6 +77,10 @@ class FISArray {
     bool flgChangeInUse;
 
 public:
+    // Number of changes made to any FISArray so far. The flow functions read
+    // these objects, so their memoized results are dropped when this moves.
+    static unsigned long long version;
+
     FISArray(){};
     FISArray(SLIMOperand *);
     SLIMOperand *fetchSLIMArrayOperand();
@@ -110,6 +114,18 @@ class IPLFCPA : public Analysis<F, B> {
     std::map<long long, std::pair<LFLivenessSet, LFPointsToSet>> mapUsePointAndPtpairs;
     std::map<std::tuple<Function *, int, B>, bool>
         mapPropagatePointstoInfoToFunction;
+    // Number of operands marked global by the flow functions (see
+    // getFlowFunctionTablesVersion).
+    mutable unsigned long long countOperandsMarkedGlobal = 0;
+#if defined(SUMMARY_CACHE) && !defined(NAIVE_MODE)
+    // Operands marked global, in order: the effects stored with the function
+    // summaries. The operand of a return instruction is logged with its
+    // function.
+    mutable std::vector<std::pair<SLIMOperand *, Function *>> operandsMarkedGlobal;
+    // Malloc operands by value, and whether each function may be summarised.
+    std::map<llvm::Value *, long long> mapMallocValueInsID;
+    std::map<Function *, bool> mapSummaryCacheable;
+#endif
 
 public:
     IPLFCPA() : Analysis(){};
@@ -133,6 +149,25 @@ public:
     //  B backwardMerge(B, B);
     B getFPandArgsBackward(long int, Instruction *);
     B computeInFromOut(BaseInstruction *I);
+    bool isFlowFunctionMemoizable() const;
+    unsigned long long getFlowFunctionTablesVersion() const;
+    void markOperandGlobal(SLIMOperand *, Function *returning = nullptr) const;
+#if defined(SUMMARY_CACHE) && !defined(NAIVE_MODE)
+    bool isFunctionSummaryCacheable(llvm::Function *);
+    bool encodeSummaryValueForward(const F &, SummaryValue &);
+    bool decodeSummaryValueForward(const SummaryValue &, F &);
+    bool encodeSummaryValueBackward(const B &, SummaryValue &);
+    bool decodeSummaryValueBackward(const SummaryValue &, B &);
+    unsigned long long getSummaryTablesVersion() const;
+    size_t getSummaryEffectCount() const;
+    bool encodeSummaryEffect(size_t, std::string &);
+    bool replaySummaryEffect(const std::string &);
+    bool encodeSummaryOperand(SLIMOperand *, std::string &);
+    SLIMOperand *decodeSummaryOperand(const std::string &);
+    bool encodeSummaryOperandValue(llvm::Value *, std::string &);
+    llvm::Value *decodeSummaryOperandValue(const std::string &);
+#endif
+    unsigned getBackwardFlowFunctionReads() const;
     B eraseFromLin(SLIMOperand *pointee, B INofInst);
     B insertRhsLin(
         B currentIN, std::vector<std::pair<SLIMOperand *, int>> rhslist, LFPointsToSet forwardIN, BaseInstruction *ins);
@@ -186,7 +221,7 @@ public:
 
     B getMainBoundaryInformationBackward(BaseInstruction *I);
     F getMainBoundaryInformationForward(BaseInstruction *I);
-    bool compareIndices(std::vector<SLIMOperand *>, std::vector<SLIMOperand *>) const;
+    bool compareIndices(const std::vector<SLIMOperand *> &, const std::vector<SLIMOperand *> &) const;
     bool compareOperands(SLIMOperand *, SLIMOperand *) const;
 
     F performCallReturnArgEffectForward(
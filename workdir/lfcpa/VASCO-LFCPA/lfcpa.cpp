@@ -626,6 +626,9 @@ SLIMOperand *IPLFCPA::fetchMallocInsOperand(long long insID, BasicBlock *B) {
         ////      OperandRepository::getOrCreateSLIMOperand(v1);
 
         mapMallocInsOperand[insID] = newMallocOperand;
+#if defined(SUMMARY_CACHE) && !defined(NAIVE_MODE)
+        mapMallocValueInsID[v1] = insID;
+#endif
         newMallocOperand->setDynamicAllocationType();
 
         if (debugFlag) {
@@ -1021,6 +1024,303 @@ B IPLFCPA::generateLivenessOfSource(
     return INofInst;
 }
 
+/* Besides the IN and OUT values at the instruction, the flow functions read
+ * the FISArray objects and the global flag of operands, both counted in
+ * getFlowFunctionTablesVersion. The def/block table of PREANALYSIS depends on
+ * the context being analysed and PRINTUSEPOINT records every visit, so
+ * memoization is off in those builds. */
+bool IPLFCPA::isFlowFunctionMemoizable() const {
+#if defined(PREANALYSIS) || defined(PRINTUSEPOINT)
+    return false;
+#else
+    return true;
+#endif
+}
+
+unsigned long long IPLFCPA::getFlowFunctionTablesVersion() const {
+    return FISArray::version + countOperandsMarkedGlobal;
+}
+
+void IPLFCPA::markOperandGlobal(SLIMOperand *operand, Function *returning) const {
+    operand->setVariableGlobal();
+    countOperandsMarkedGlobal++;
+#if defined(SUMMARY_CACHE) && !defined(NAIVE_MODE)
+    operandsMarkedGlobal.push_back({operand, returning});
+#else
+    (void)returning;
+#endif
+}
+
+#if defined(SUMMARY_CACHE) && !defined(NAIVE_MODE)
+/* Function summaries. A function is summarised unless it handles array
+ * elements, whose pointees live in the FISArray objects shared by all
+ * contexts: reusing a summary would skip their updates. Operands are named by
+ * their canonical key (see OperandTable), with the values in it named by
+ * SummaryKeys, except that malloc objects are named after their call. The
+ * effects are the operands marked global. In NAIVE_MODE, where sets hold the
+ * operands themselves rather than their IDs, no function is summarised. */
+bool IPLFCPA::isFunctionSummaryCacheable(llvm::Function *function) {
+#if defined(PREANALYSIS) || defined(PRINTUSEPOINT)
+    return false;
+#endif
+    auto pos = mapSummaryCacheable.find(function);
+    if (pos != mapSummaryCacheable.end()) {
+        return pos->second;
+    }
+
+    auto isArrayElement = [](SLIMOperand *operand) {
+        return operand != nullptr and operand->getValue() != nullptr and operand->isArrayElement();
+    };
+    bool cacheable = function->getName() != "main";
+    for (auto entry = optIR->func_bb_to_inst_id.lower_bound({function, nullptr});
+         cacheable && entry != optIR->func_bb_to_inst_id.end() && entry->first.first == function; ++entry) {
+        for (long long instruction_id : entry->second) {
+            BaseInstruction *I = optIR->inst_id_to_object[instruction_id];
+            SLIMOperand *lhsVal = I->getLHS().first;
+            if (isArrayElement(lhsVal)) {
+                cacheable = false;
+            }
+            for (auto &rhs : I->getRHS()) {
+                if (isArrayElement(rhs.first)) {
+                    cacheable = false;
+                }
+            }
+        }
+    }
+    mapSummaryCacheable[function] = cacheable;
+    return cacheable;
+}
+
+bool IPLFCPA::encodeSummaryOperandValue(llvm::Value *value, std::string &name) {
+    auto pos = mapMallocValueInsID.find(value);
+    if (pos == mapMallocValueInsID.end()) {
+        return summary_keys->encode(value, name);
+    }
+    if (!summary_keys->encode(optIR->inst_id_to_object[pos->second]->getLLVMInstruction(), name)) {
+        return false;
+    }
+    name = "heap:" + name;
+    return true;
+}
+
+llvm::Value *IPLFCPA::decodeSummaryOperandValue(const std::string &name) {
+    if (name.compare(0, 5, "heap:") != 0) {
+        return summary_keys->decode(name);
+    }
+    auto *call = llvm::dyn_cast_or_null<Instruction>(summary_keys->decode(name.substr(5)));
+    if (call == nullptr) {
+        return nullptr;
+    }
+    for (long long instruction_id : optIR->func_bb_to_inst_id[{call->getFunction(), call->getParent()}]) {
+        BaseInstruction *I = optIR->inst_id_to_object[instruction_id];
+        if (I->getLLVMInstruction() == call and I->getIsDynamicAllocation()) {
+            return fetchMallocInsOperand(instruction_id, I->getBasicBlock())->getValue();
+        }
+    }
+    return nullptr;
+}
+
+bool IPLFCPA::encodeSummaryOperand(SLIMOperand *operand, std::string &name) {
+    OperandKey key = OperandTable::keyOf(operand);
+    std::string part;
+    if (!encodeSummaryOperandValue(key.value, part)) {
+        return false;
+    }
+    name = (key.array ? "array " : "value ") + part;
+    if (key.array) {
+        name += " " + std::to_string(key.arity);
+    }
+    for (llvm::Value *index : key.indices) {
+        if (!encodeSummaryOperandValue(index, part)) {
+            return false;
+        }
+        name += " " + part;
+    }
+    return true;
+}
+
+// Returns the representative of the operand named, creating an operand of
+// its class if none has been seen in this run, or nullptr.
+SLIMOperand *IPLFCPA::decodeSummaryOperand(const std::string &name) {
+    std::istringstream parts(name);
+    std::string kind, part;
+    parts >> kind >> part;
+    OperandKey key;
+    key.array = kind == "array";
+    key.value = decodeSummaryOperandValue(part);
+    if ((kind != "array" and kind != "value") or key.value == nullptr) {
+        return nullptr;
+    }
+    if (key.array and !(parts >> key.arity)) {
+        return nullptr;
+    }
+    std::vector<SLIMOperand *> vecIndex;
+    while (parts >> part) {
+        llvm::Value *index = decodeSummaryOperandValue(part);
+        if (index == nullptr) {
+            return nullptr;
+        }
+        key.indices.push_back(index);
+        vecIndex.push_back(OperandRepository::getOrCreateSLIMOperand(index));
+    }
+
+    OperandID id;
+    if (operandTable.find(key, id)) {
+        return operandOf(id);
+    }
+    // Array elements are only ever met through the array, which is known by
+    // now if the operand is reachable in this run.
+    if (key.array) {
+        return nullptr;
+    }
+    SLIMOperand *operand;
+    auto pos = mapMallocValueInsID.find(key.value);
+    if (!vecIndex.empty()) {
+        operand = fetchNewOperand(key.value, vecIndex);
+    } else if (pos != mapMallocValueInsID.end()) {
+        operand = mapMallocInsOperand[pos->second];
+    } else {
+        operand = OperandRepository::getOrCreateSLIMOperand(key.value);
+    }
+    if (!(OperandTable::keyOf(operand) == key)) {
+        return nullptr;
+    }
+    operandID(operand);
+    return operand;
+}
+
+bool IPLFCPA::encodeSummaryValueForward(const F &dfv, SummaryValue &value) {
+    value.clear();
+    for (auto d : dfv) {
+        std::string name;
+        if (!encodeSummaryOperand(GET_PTSET_KEY(d), name)) {
+            return false;
+        }
+        std::vector<std::string> pointees;
+        LFLivenessSet pointeeSet = GET_PTSET_VALUE(d);
+        for (auto i : pointeeSet) {
+            if (!encodeSummaryOperand(GET_KEY(i), pointees.emplace_back())) {
+                return false;
+            }
+        }
+        value.push_back({name, pointees});
+    }
+    return true;
+}
+
+bool IPLFCPA::decodeSummaryValueForward(const SummaryValue &value, F &dfv) {
+    F::Transient pointsTo = F().transient();
+    for (auto &entry : value) {
+        SLIMOperand *pointer = decodeSummaryOperand(entry.first);
+        if (pointer == nullptr) {
+            return false;
+        }
+        LFLivenessSet::Transient pointees = LFLivenessSet().transient();
+        for (const std::string &name : entry.second) {
+            SLIMOperand *pointee = decodeSummaryOperand(name);
+            if (pointee == nullptr) {
+                return false;
+            }
+            pointees.insert(pointee);
+        }
+        pointsTo.update_pointees(pointer, pointees.commit());
+    }
+    dfv = pointsTo.commit();
+    return true;
+}
+
+bool IPLFCPA::encodeSummaryValueBackward(const B &dfv, SummaryValue &value) {
+    value.clear();
+    for (auto i : dfv) {
+        std::string name;
+        if (!encodeSummaryOperand(GET_KEY(i), name)) {
+            return false;
+        }
+        value.push_back({name, {}});
+    }
+    return true;
+}
+
+bool IPLFCPA::decodeSummaryValueBackward(const SummaryValue &value, B &dfv) {
+    B::Transient liveness = B().transient();
+    for (auto &entry : value) {
+        SLIMOperand *operand = decodeSummaryOperand(entry.first);
+        if (operand == nullptr or !entry.second.empty()) {
+            return false;
+        }
+        liveness.insert(operand);
+    }
+    dfv = liveness.commit();
+    return true;
+}
+
+unsigned long long IPLFCPA::getSummaryTablesVersion() const {
+    return FISArray::version + listFISArrayObjects.size();
+}
+
+size_t IPLFCPA::getSummaryEffectCount() const {
+    return operandsMarkedGlobal.size();
+}
+
+bool IPLFCPA::encodeSummaryEffect(size_t index, std::string &effect) {
+    auto &marked = operandsMarkedGlobal[index];
+    if (marked.second != nullptr) {
+        if (!summary_keys->encode(marked.second, effect)) {
+            return false;
+        }
+        effect = "return " + effect;
+        return true;
+    }
+    if (!encodeSummaryOperand(marked.first, effect)) {
+        return false;
+    }
+    effect = "global " + effect;
+    return true;
+}
+
+bool IPLFCPA::replaySummaryEffect(const std::string &effect) {
+    if (effect.compare(0, 7, "global ") == 0) {
+        SLIMOperand *operand = decodeSummaryOperand(effect.substr(7));
+        if (operand == nullptr) {
+            return false;
+        }
+        if (!operand->isVariableGlobal()) {
+            markOperandGlobal(operand);
+        }
+        return true;
+    }
+    if (effect.compare(0, 7, "return ") == 0) {
+        auto *function = llvm::dyn_cast_or_null<Function>(summary_keys->decode(effect.substr(7)));
+        if (function == nullptr or function->isDeclaration()) {
+            return false;
+        }
+        for (auto entry = optIR->func_bb_to_inst_id.lower_bound({function, nullptr});
+             entry != optIR->func_bb_to_inst_id.end() && entry->first.first == function; ++entry) {
+            for (long long instruction_id : entry->second) {
+                BaseInstruction *I = optIR->inst_id_to_object[instruction_id];
+                if (I->getInstructionType() != RETURN) {
+                    continue;
+                }
+                SLIMOperand *RHSval = ((ReturnInstruction *)I)->getReturnOperand();
+                if (RHSval->getValue() != nullptr and !RHSval->isVariableGlobal()) {
+                    markOperandGlobal(RHSval, function);
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
+#endif
+
+// computeInFromOut reads LOUT and PIN only. computeOutFromIn reads all four
+// values: it merges into the previous POUT and restricts by LIN and LOUT. Both
+// read beyond their own direction, so IPLFCPA cannot use block-granular
+// storage (see useBlockGranularStorage).
+unsigned IPLFCPA::getBackwardFlowFunctionReads() const {
+    return READS_BACKWARD_OUT | READS_FORWARD_IN;
+}
+
 B IPLFCPA::computeInFromOut(BaseInstruction *I) {
     if (debugFlag) {
         llvm::outs() << "\n Inside computeINfromOUT.........";
@@ -1083,8 +1383,10 @@ B IPLFCPA::computeInFromOut(BaseInstruction *I) {
             if (debugFlag)
                 llvm::outs() << "\n Return operand is NULL\n";
         } else {
-            RHSval->setVariableGlobal(); /// marked global for return value
-                                         /// mapping
+            if (!RHSval->isVariableGlobal()) {
+                markOperandGlobal(RHSval, I->getFunction()); /// marked global for return value
+                                                             /// mapping
+            }
             if (RHSval->getOperandType() != CONSTANT_INT and RHSval->getOperandType() != CONSTANT_FP and
                 RHSval->isPointerInLLVM()) {
                 if (RHSval->isArrayElement()) {
@@ -2278,7 +2580,7 @@ bool IPLFCPA::EqualContextValuesForward(const F &d1, const F &d2) const {
     return d1 == d2; // modAR::LHF
 }
 
-bool IPLFCPA::compareIndices(std::vector<SLIMOperand *> ipVec1, std::vector<SLIMOperand *> ipVec2) const {
+bool IPLFCPA::compareIndices(const std::vector<SLIMOperand *> &ipVec1, const std::vector<SLIMOperand *> &ipVec2) const {
     /* return ipVec1 == ipVec2;
      if (ipVec1.size() != ipVec2.size())
         return false;
@@ -2310,37 +2612,10 @@ F IPLFCPA::restrictByLivness(F valPointsTo, B valLiveness) {
 #ifdef PRINTSTATS
     stat.timerStart(__func__);
 #endif
-    F resPointsTo;
-
-    for (auto lv : valLiveness) {
-        for (auto pt : valPointsTo) {
-            SLIMOperand *key = GET_PTSET_KEY(pt);
-            LFLivenessSet value = GET_VALUE(pt);
-
-            if (key->isArrayElement()) {
-
-                if (debugFlag)
-                    llvm::outs() << "\n Key is an array = " << key->getOnlyName();
-                if (lv == key and (GET_KEY(lv)->getIndexVector().size() == key->getIndexVector().size())) {
-                    LFLivenessSet prevValue =
-                        resPointsTo.get_pointees(GET_KEY(lv)); // multiple instances of array in lout
-                    resPointsTo = resPointsTo.update_pointees(
-                        GET_KEY(lv), backwardMerge(
-                                         prevValue,
-                                         value)); // merge all array pointees modAR::LHF
-                    // std::set<SLIMOperand *> prevValue = resPointsTo[lv]; //
-                    // multiple instances of array in lout resPointsTo[lv] =
-                    // backwardMerge(prevValue, value); // merge all array
-                    // pointees
-                }
-            } else {
-                if (compareOperands(GET_KEY(lv), key)) {
-                    resPointsTo = resPointsTo.update_pointees(key, value); // modAR::LHF
-                    // resPointsTo[key] = value;
-                }
-            } // end else
-        } // end inner for
-    } // end outer for
+    // Keep the entries of live pointers. Array elements have the operand ID of
+    // their array and number of indices, so a live element keeps the entry of
+    // the elements of its array with as many indices.
+    F resPointsTo = valPointsTo.restrict_keys(valLiveness);
 #ifdef PRINTSTATS
     stat.timerEnd(__func__);
 #endif
@@ -2473,18 +2748,18 @@ F IPLFCPA::performMeetForward(const F &d1, const F &d2, const string pos) {
 
 F IPLFCPA::getPurelyGlobalComponentForward(const F &dfv) const {
     //  llvm::outs() << "\n Inside getPurelyGlobalComponentForward...........";
-    F globalComponent;
+    F::Transient globalComponent = F().transient();
     for (auto d : dfv) {
         SLIMOperand *key = GET_PTSET_KEY(d);
         LFLivenessSet value = GET_VALUE(d);
         if (key->isVariableGlobal()) {
             for (auto i : value) {
                 if (GET_KEY(i)->isVariableGlobal())
-                    globalComponent = globalComponent.insert_pointee(key, GET_KEY(i)); // modAR::LHF
+                    globalComponent.insert_pointee(key, GET_KEY(i)); // modAR::LHF
                 // globalComponent[key].insert(i);
                 else {
-                    GET_KEY(i)->setVariableGlobal();
-                    globalComponent = globalComponent.insert_pointee(key, GET_KEY(i)); // modAR::LHF
+                    markOperandGlobal(GET_KEY(i));
+                    globalComponent.insert_pointee(key, GET_KEY(i)); // modAR::LHF
                     // globalComponent[key].insert(i);
                 }
                 // TODO check alternative for dangling
@@ -2493,7 +2768,7 @@ F IPLFCPA::getPurelyGlobalComponentForward(const F &dfv) const {
             }
         }
     }
-    return globalComponent;
+    return globalComponent.commit();
 }
 
 void IPLFCPA::printDataFlowValuesForward(const F &dfv) const {
@@ -3101,8 +3376,7 @@ F IPLFCPA::computeOutFromIn(BaseInstruction *I) {
                                 if ((compareOperands(list->fetchSLIMArrayOperand(), rhsVal.first))) {
                                     flgArrFound = true;
                                     LFLivenessSet aPointee = list->getArrayPointees();
-                                    for (auto point : aPointee)
-                                        rhsSet = rhsSet.insert_single(GET_KEY(point));
+                                    rhsSet = rhsSet.set_union(aPointee);
                                     // rhsSet.insert(point); modAR::LHF
                                 } // end if
                             } // end for
@@ -3301,8 +3575,7 @@ F IPLFCPA::computeOutFromIn(BaseInstruction *I) {
                                 for (auto list : listFISArrayObjects) {
                                     if (compareOperands(list->fetchSLIMArrayOperand(), rhsValue)) {
                                         LFLivenessSet rhsPointees = list->getArrayPointees();
-                                        for (auto rp : rhsPointees)
-                                            rhsSet = rhsSet.insert_single(GET_KEY(rp));
+                                        rhsSet = rhsSet.set_union(rhsPointees);
                                         // rhsSet.insert(rp); modAR::LHF
                                         notPINEmpty = true;
                                         foundPointee = true;
@@ -3324,10 +3597,8 @@ F IPLFCPA::computeOutFromIn(BaseInstruction *I) {
                                         setPointsToPairForUsePoint(I->getInstructionId(), rhsValue, tempPT);
 #endif
 
-                                        for (auto s : Pointee) {
-                                            rhsSet = rhsSet.insert_single(GET_KEY(s));
-                                            // rhsSet.insert((s)); modAR::LHF
-                                        } // for
+                                        rhsSet = rhsSet.set_union(Pointee);
+                                        // rhsSet.insert((s)); modAR::LHF
                                     } // end if
                                 } // end outer for
                             } // else not arr
@@ -4658,7 +4929,7 @@ std::pair<std::pair<LFLivenessSet, int>, bool> IPLFCPA::performMergeDefBlock(
 F IPLFCPA::getPurelyLocalComponentForward(const F &dfv) const {
     if (debugFlag)
         llvm::outs() << "\n Inside getPurelyLocalComponentForward.............";
-    F fwdLocalVal;
+    F::Transient localComponent = F().transient();
     for (auto d : dfv) {
         SLIMOperand *pointer = GET_PTSET_KEY(d);
         LFLivenessSet pointee = GET_VALUE(d);
@@ -4666,11 +4937,12 @@ F IPLFCPA::getPurelyLocalComponentForward(const F &dfv) const {
         if (!pointer->isVariableGlobal()) {
             for (auto p : pointee) {
                 /// if (!p->isVariableGlobal())  local->global or local->local
-                fwdLocalVal = fwdLocalVal.insert_pointee(pointer, GET_KEY(p)); // modAR::LHF
-                                                                               // fwdLocalVal[pointer].insert(p);
+                localComponent.insert_pointee(pointer, GET_KEY(p)); // modAR::LHF
+                                                                    // fwdLocalVal[pointer].insert(p);
             }
         } // end if
     } // end for
+    F fwdLocalVal = localComponent.commit();
 
     if (debugFlag) {
         llvm::outs() << "\n Printing the forward local componenets";
@@ -4697,15 +4969,16 @@ pair<F, B> IPLFCPA::CallInflowFunction(
     }
 
     // set the backward value
+    B::Transient calleeLiveness = calleeLOUT.transient();
     for (auto d : d1) {
         if (GET_KEY(d)->isVariableGlobal())
-            calleeLOUT = calleeLOUT.insert_single(GET_KEY(d)); // modAR::LHF
+            calleeLiveness.insert(GET_KEY(d)); // modAR::LHF
         // calleeLOUT.insert(d);
         if (return_operand_map.second != nullptr && compareOperands(GET_KEY(d), return_operand_map.first))
-            calleeLOUT =
-                calleeLOUT.insert_single(return_operand_map.second); // modAR::LHF
-                                                                     // calleeLOUT.insert(return_operand_map.second);
+            calleeLiveness.insert(return_operand_map.second); // modAR::LHF
+                                                              // calleeLOUT.insert(return_operand_map.second);
     } // for
+    calleeLOUT = calleeLiveness.commit();
 
     if (debugFlag) {
         llvm::outs() << "\n Printing calleee inflow: LOUT ";
@@ -4799,6 +5072,7 @@ pair<F, B> IPLFCPA::CallOutflowFunction(
 
     // Merge the backward outflow with the local components
     SLIMOperand *CallerRetArg = return_operand_map.first;
+    B::Transient mergedLin = callnodeLin.transient();
     for (auto i : LocalComponent) {
         if (CallerRetArg != nullptr) {
             if (!compareOperands(GET_KEY(i), CallerRetArg)) // x = Q(a,b); If x is local and is live
@@ -4806,9 +5080,10 @@ pair<F, B> IPLFCPA::CallOutflowFunction(
                                                             // killed. return_operand_map contains the
                                                             // mapping x===retVal_in_Q
                 // callnodeLin.insert(i); modAR::LHF
-                callnodeLin = callnodeLin.insert_single(GET_KEY(i));
+                mergedLin.insert(GET_KEY(i));
         } // outer if
     } // for
+    callnodeLin = mergedLin.commit();
 
     retOUTflow.second = callnodeLin; // imp step
     if (debugFlag) {
@@ -4831,17 +5106,19 @@ pair<F, B> IPLFCPA::CallOutflowFunction(
         F retForwardOutflow;
         // a3:forward_outflow d1: LOUT_callnode
         if (argCallee != nullptr) { // do this only for functions with return argument
+            F::Transient mappedOutflow = retForwardOutflow.transient();
             for (auto pin : a3) {
                 if (compareOperands(GET_PTSET_KEY(pin), argCallee)) { // x=call fun() and return x' in
                                                                 // callee then x'->a ==> x->a
                     // retForwardOutflow[argCaller] = GET_VALUE(pin);
-                    retForwardOutflow = retForwardOutflow.update_pointees(argCaller, GET_VALUE(pin));
+                    mappedOutflow.update_pointees(argCaller, GET_VALUE(pin));
                 } else {
                     // retForwardOutflow.insert(pin); // if y->b  in a3 ==>
                     // retForwardOutflow contain y->b
-                    retForwardOutflow = retForwardOutflow.update_pointees(GET_PTSET_KEY(pin), GET_VALUE(pin)); // modAR::LHF
+                    mappedOutflow.update_pointees(GET_PTSET_KEY(pin), GET_VALUE(pin)); // modAR::LHF
                 }
             }
+            retForwardOutflow = mappedOutflow.commit();
             if (debugFlag) {
                 llvm::outs() << "\nForward Outflow after updating callee "
                                 "return arg with "
@@ -5121,13 +5398,15 @@ pair<F, B> IPLFCPA::CallInflowFunction(
     }
 
     // set the backward value
+    B::Transient calleeLiveness = calleeLOUT.transient();
     for (auto d : d1) {
         if (GET_KEY(d)->isVariableGlobal())
-            calleeLOUT = calleeLOUT.insert_single(GET_KEY(d)); // modAR::LHF
+            calleeLiveness.insert(GET_KEY(d)); // modAR::LHF
         // calleeLOUT.insert(d);
         if (return_operand_map.second != nullptr && compareOperands(GET_KEY(d), return_operand_map.first))
-            calleeLOUT = calleeLOUT.insert_single(return_operand_map.second); // modAR::LHF
+            calleeLiveness.insert(return_operand_map.second); // modAR::LHF
     } // for
+    calleeLOUT = calleeLiveness.commit();
 
     if (debugFlag) {
         llvm::outs() << "\n Printing calleee inflow: LOUT ";
@@ -5262,6 +5541,7 @@ pair<F, B> IPLFCPA::computeSetDifference(
             llvm::outs() << "\n Calleee Arg is NOT nullptr";
     }
     // if (!flgDoNothing) {
+    B::Transient liveOut = result.second.transient();
     for (auto o : setOUT) {
         bool flgMatch = false;
         if (calleeArg == nullptr || !compareOperands(callerArg, GET_KEY(o))) {
@@ -5274,11 +5554,12 @@ pair<F, B> IPLFCPA::computeSetDifference(
                 }
             }
             if (!flgMatch) {
-                result.second = result.second.insert_single(GET_KEY(o));
+                liveOut.insert(GET_KEY(o));
             }
             // result.second.insert(o); modAR::LHF
         }
     }
+    result.second = liveOut.commit();
     //}
 
     if (debugFlag) {
@@ -5424,10 +5705,12 @@ B IPLFCPA::performCallReturnArgEffectBackward(
     if (calleeArg == nullptr || callerArg == nullptr)
         return dfv;
 
+    B::Transient live = result.transient();
     for (auto o : dfv) {
         if (!compareOperands(callerArg, GET_KEY(o)))
-            result = result.insert_single(GET_KEY(o));
+            live.insert(GET_KEY(o));
     } // for
+    result = live.commit();
 
     /*  if (debugFlag) {
         llvm::outs() << "\n Printing the result of callreturnArg effect: ";
@@ -5451,12 +5734,14 @@ B IPLFCPA::getGlobalandFunctionArgComponentBackward(const B &dfv) const {
     // local to the callee.
     B global_component;
     if (!dfv.empty()) {
+        B::Transient global_live = global_component.transient();
         for (auto v : dfv) {
             if (GET_KEY(v)->isVariableGlobal() || GET_KEY(v)->isFormalArgument() ||
                 GET_KEY(v)->isDynamicAllocationType()) {
-                global_component = global_component.insert_single(GET_KEY(v)); // modAR::LHF
+                global_live.insert(GET_KEY(v)); // modAR::LHF
             }
         } // end for
+        global_component = global_live.commit();
     }
     return global_component;
 }
@@ -5494,8 +5779,11 @@ set<BasicBlock *> IPLFCPA::getMixedFISBasicBlocksForward() {
 }
 
 // Flow insensitive array computation
+unsigned long long FISArray::version = 0;
+
 FISArray::FISArray(SLIMOperand *op) {
     this->opdArray = op;
+    version++;
 }
 
 SLIMOperand *FISArray::fetchSLIMArrayOperand() {
@@ -5504,6 +5792,7 @@ SLIMOperand *FISArray::fetchSLIMArrayOperand() {
 
 void FISArray::setOnlyArrayName(llvm::StringRef aName) {
     this->nmArray = aName;
+    version++;
 }
 
 llvm::StringRef FISArray::getOnlyArrayName() {
@@ -5511,7 +5800,8 @@ llvm::StringRef FISArray::getOnlyArrayName() {
 }
 
 void FISArray::setPtUse(BasicBlock *bb) {
-    this->ptUse.insert(bb);
+    if (this->ptUse.insert(bb).second)
+        version++;
 }
 
 std::set<BasicBlock *> FISArray::getPtUse() {
@@ -5519,7 +5809,8 @@ std::set<BasicBlock *> FISArray::getPtUse() {
 }
 
 void FISArray::setPtDef(BasicBlock *bb) {
-    this->ptDef.insert(bb);
+    if (this->ptDef.insert(bb).second)
+        version++;
 }
 
 std::set<BasicBlock *> FISArray::getPtDef() {
@@ -5527,6 +5818,8 @@ std::set<BasicBlock *> FISArray::getPtDef() {
 }
 
 void FISArray::setFlgChangeInPointees(bool v) {
+    if (this->flgChangeInPointees != v)
+        version++;
     this->flgChangeInPointees = v;
 }
 
@@ -5535,6 +5828,8 @@ bool FISArray::getFlgChangeInPointees() {
 }
 
 void FISArray::setFlgChangeInUse(bool v) {
+    if (this->flgChangeInUse != v)
+        version++;
     this->flgChangeInUse = v;
 }
 
@@ -5565,10 +5860,11 @@ void FISArray::setArrayPointees(LFLivenessSet currPointee) {
         for (auto p : currPointee)
             llvm::outs() << "\t: " << GET_KEY(p)->getOnlyName() << " :";
     }
-    for (auto val : currPointee)                               // prevOUT merge succIN
-        prevPointee = prevPointee.insert_single(GET_KEY(val)); // modAR::LHF
+    prevPointee = prevPointee.set_union(currPointee); // prevOUT merge succIN modAR::LHF
     // prevPointee.insert(val);
 
+    if (!(this->arrPointees == prevPointee))
+        version++;
     this->arrPointees = prevPointee;
 
     if (debugFlag) {
@@ -0,0 +1,140 @@
+#ifndef LHF_BENCHMARKS_COMMON_HPP
+#define LHF_BENCHMARKS_COMMON_HPP
+
+#include "lhf/lhf.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace lhf_bench {
+
+/**
+ * @brief      How the elements of generated sets are drawn from the universe.
+ *             Passed as the `dist` argument of swept benchmarks.
+ */
+enum Distribution {
+	/// Every element of the universe is equally likely.
+	UNIFORM = 0,
+
+	/// Elements are drawn from a window of four times the set size at a
+	/// random offset, giving dense, overlapping runs.
+	CLUSTERED = 1,
+
+	/// Small elements are much more likely than large ones.
+	SKEWED = 2
+};
+
+/**
+ * @brief      Generates sorted, duplicate-free sets of `int`.
+ */
+class SetGenerator {
+	std::mt19937_64 gen;
+	int universe;
+	Distribution dist;
+
+	int draw(int window_begin, int window_size) {
+		std::uniform_real_distribution<double> u(0, 1);
+		switch (dist) {
+		case CLUSTERED:
+			return window_begin + int(u(gen) * window_size);
+		case SKEWED:
+			return int(universe * std::pow(u(gen), 3));
+		default:
+			return int(u(gen) * universe);
+		}
+	}
+
+public:
+	SetGenerator(int universe, int dist, uint64_t seed = 1):
+		gen(seed), universe(std::max(universe, 1)), dist(Distribution(dist)) {}
+
+	/**
+	 * @brief      Generates a set of `n` elements (fewer if the universe is
+	 *             smaller), containing every element of `shared`.
+	 */
+	std::vector<int> make(int n, const std::vector<int> &shared = {}) {
+		n = std::min(n, universe);
+		std::set<int> s(shared.begin(), shared.end());
+
+		int window = std::min(universe, 4 * n);
+		int begin = std::uniform_int_distribution<int>(0, universe - window)(gen);
+
+		std::size_t attempts = 0;
+		while (int(s.size()) < n && attempts++ < std::size_t(64) * n) {
+			s.insert(std::min(draw(begin, window), universe - 1));
+		}
+
+		return std::vector<int>(s.begin(), s.end());
+	}
+
+	/**
+	 * @brief      Generates a pair of sets of `n` elements each, where about
+	 *             half of the elements of the second are from the first. This
+	 *             keeps intersections and differences non-trivial.
+	 */
+	std::pair<std::vector<int>, std::vector<int>> make_pair(int n) {
+		std::vector<int> a = make(n);
+		std::vector<int> shared;
+		for (std::size_t i = 0; i < a.size(); i += 2) {
+			shared.push_back(a[i]);
+		}
+		return { a, make(n, shared) };
+	}
+};
+
+/**
+ * @brief      Draws indices in `[0, n)` with probability proportional to
+ *             `1 / (i + 1)^s`, so that a few operands are much hotter than the
+ *             rest, as in analysis workloads.
+ */
+class ZipfSampler {
+	std::mt19937_64 gen;
+	std::vector<double> cdf;
+
+public:
+	ZipfSampler(std::size_t n, double s, uint64_t seed = 1): gen(seed), cdf(std::max<std::size_t>(n, 1)) {
+		double sum = 0;
+		for (std::size_t i = 0; i < cdf.size(); i++) {
+			sum += 1.0 / std::pow(double(i + 1), s);
+			cdf[i] = sum;
+		}
+		for (double &c : cdf) {
+			c /= sum;
+		}
+	}
+
+	std::size_t operator()() {
+		double u = std::uniform_real_distribution<double>(0, 1)(gen);
+		std::size_t i = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+		return std::min(i, cdf.size() - 1);
+	}
+};
+
+/// Set sizes swept by the operation benchmarks.
+inline const std::vector<int64_t> SET_SIZES = { 4, 16, 64, 256 };
+
+/// Universe sizes swept by the operation benchmarks.
+inline const std::vector<int64_t> UNIVERSE_SIZES = { 1 << 10, 1 << 16 };
+
+/// Distributions swept by the operation benchmarks.
+inline const std::vector<int64_t> DISTRIBUTIONS = { UNIFORM, CLUSTERED, SKEWED };
+
+/**
+ * @brief      Applies the full (set size, universe size, distribution) sweep
+ *             to a benchmark.
+ */
+inline void sweep(benchmark::internal::Benchmark *b) {
+	b->ArgNames({ "n", "universe", "dist" });
+	b->ArgsProduct({ SET_SIZES, UNIVERSE_SIZES, DISTRIBUTIONS });
+}
+
+/// Number of operand pairs cycled through by a benchmark before the LHF
+/// instance is rebuilt.
+constexpr std::size_t POOL_SIZE = 2048;
+
+}
+
+#endif
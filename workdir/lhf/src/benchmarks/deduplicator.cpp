@@ -0,0 +1,90 @@
+#include "common.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace lhf_bench;
+
+/**
+ * @brief      Builds `n` distinct strings of identifier-like length.
+ */
+static std::vector<std::string> make_names(std::size_t n) {
+	std::vector<std::string> names;
+	for (std::size_t i = 0; i < n; i++) {
+		names.push_back("function_" + std::to_string(i * 2654435761u) + "::local");
+	}
+	return names;
+}
+
+/**
+ * @brief      Registers values that are all already interned. Nothing may be
+ *             allocated per call.
+ */
+static void BM_intern_hit(benchmark::State &state) {
+	const std::size_t n = state.range(0);
+	std::vector<std::string> names = make_names(n);
+	lhf::Deduplicator<std::string> d;
+	for (auto &s : names) {
+		d.register_value(s);
+	}
+
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(d.register_value(std::string_view(names[i++ % n])));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief      Interns `n` distinct values into a fresh deduplicator.
+ */
+static void BM_intern_miss(benchmark::State &state) {
+	const std::size_t n = state.range(0);
+	std::vector<std::string> names = make_names(n);
+
+	for (auto _ : state) {
+		lhf::Deduplicator<std::string> d;
+		for (auto &s : names) {
+			benchmark::DoNotOptimize(d.register_value(s));
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_intern_hit)->ArgName("n")->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_intern_miss)->ArgName("n")->Range(1 << 10, 1 << 20);
+
+#if defined(LHF_ENABLE_PARALLEL) && !defined(LHF_ENABLE_TBB)
+
+/**
+ * @brief      Interns from all threads into one concurrent deduplicator, with
+ *             Zipfian picks so that most calls are hits on a few hot values.
+ */
+static void BM_intern_concurrent(benchmark::State &state) {
+	constexpr std::size_t n = POOL_SIZE * 64;
+	static std::vector<std::string> names;
+	static std::unique_ptr<lhf::ConcurrentDeduplicator<std::string>> d;
+
+	if (state.thread_index() == 0) {
+		names = make_names(n);
+		d = std::make_unique<lhf::ConcurrentDeduplicator<std::string>>();
+	}
+
+	ZipfSampler zipf(n, 0.99, state.thread_index() + 1);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(d->register_value(std::string_view(names[zipf()])));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (state.thread_index() == 0) {
+		d.reset();
+	}
+}
+
+BENCHMARK(BM_intern_concurrent)->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()))->UseRealTime();
+
+#endif
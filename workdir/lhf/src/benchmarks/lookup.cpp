@@ -0,0 +1,74 @@
+#include "common.hpp"
+
+using namespace lhf_bench;
+
+using LHF = lhf::LatticeHashForest<int>;
+using Index = typename LHF::Index;
+
+/**
+ * @brief      Set sizes around `LHF_SORTED_VECTOR_BINARY_SEARCH_THRESHOLD`,
+ *             where lookups switch from a linear scan to a binary search.
+ */
+static void lookup_sizes(benchmark::internal::Benchmark *b) {
+	const int t = LHF_SORTED_VECTOR_BINARY_SEARCH_THRESHOLD;
+	b->ArgName("n");
+	for (int n : { 2, t / 2, t - 1, t, t + 1, 2 * t, 8 * t, 64 * t }) {
+		b->Arg(n);
+	}
+}
+
+/**
+ * @brief      Registers sets of `n` even numbers, and generates keys of which
+ *             half are present.
+ */
+static std::pair<std::vector<Index>, std::vector<int>> make_lookups(LHF &l, int n) {
+	std::mt19937 gen(1);
+	std::vector<Index> sets;
+	std::vector<int> keys;
+
+	for (int s = 0; s < 64; s++) {
+		std::vector<int> e;
+		for (int i = 0; i < n; i++) {
+			e.push_back(2 * (s + i));
+		}
+		sets.push_back(l.register_set(e.begin(), e.end()));
+	}
+
+	std::uniform_int_distribution<int> key(0, 2 * (64 + n));
+	for (int i = 0; i < 1024; i++) {
+		keys.push_back(key(gen));
+	}
+
+	return { sets, keys };
+}
+
+static void BM_find_key(benchmark::State &state) {
+	LHF l;
+	auto [sets, keys] = make_lookups(l, state.range(0));
+
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(
+			l.find_key(sets[i % sets.size()], keys[i % keys.size()]).is_present());
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_contains(benchmark::State &state) {
+	LHF l;
+	auto [sets, keys] = make_lookups(l, state.range(0));
+
+	std::size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(
+			l.contains(sets[i % sets.size()], keys[i % keys.size()]));
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_find_key)->Apply(lookup_sizes);
+BENCHMARK(BM_contains)->Apply(lookup_sizes);
@@ -0,0 +1,38 @@
+#include "lhf/lhf.hpp"
+#include <benchmark/benchmark.h>
+
+/**
+ * Records the LHF build configuration alongside the results, so that runs of
+ * different backends and flags can be told apart.
+ */
+int main(int argc, char **argv) {
+#if defined(LHF_ENABLE_TBB)
+	benchmark::AddCustomContext("lhf_backend", "tbb");
+#elif defined(LHF_ENABLE_PARALLEL)
+	benchmark::AddCustomContext("lhf_backend", "parallel");
+#else
+	benchmark::AddCustomContext("lhf_backend", "serial");
+#endif
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	benchmark::AddCustomContext("lhf_performance_metrics", "on");
+#else
+	benchmark::AddCustomContext("lhf_performance_metrics", "off");
+#endif
+
+#ifdef LHF_ENABLE_DEBUG
+	benchmark::AddCustomContext("lhf_debug", "on");
+#else
+	benchmark::AddCustomContext("lhf_debug", "off");
+#endif
+
+	benchmark::AddCustomContext("lhf_index_bits", std::to_string(8 * sizeof(lhf::IndexValue)));
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
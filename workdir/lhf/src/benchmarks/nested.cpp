@@ -0,0 +1,100 @@
+#include "common.hpp"
+#include <memory>
+
+using namespace lhf_bench;
+
+using ChildLHF = lhf::LatticeHashForest<int>;
+using ChildIndex = typename ChildLHF::Index;
+
+template<template<typename, typename...> typename Nesting>
+using NestedLHF =
+	lhf::LatticeHashForest<
+		int,
+		lhf::DefaultLess<int>,
+		lhf::DefaultHash<int>,
+		lhf::DefaultEqual<int>,
+		lhf::DefaultPrinter<int>,
+		Nesting<int, ChildLHF>>;
+
+/**
+ * @brief      Times nested unions, where every key shared by both operands
+ *             causes a union in the child LHF. With `hit` set, the pool of
+ *             operand pairs is unioned once before timing.
+ */
+template<template<typename, typename...> typename Nesting, bool hit>
+static void BM_nested_union(benchmark::State &state) {
+	using LHF = NestedLHF<Nesting>;
+	using Index = typename LHF::Index;
+
+	SetGenerator gen(state.range(1), state.range(2));
+	SetGenerator child_gen(1 << 10, UNIFORM, 2);
+
+	std::vector<std::vector<int>> child_sets(64);
+	for (auto &c : child_sets) {
+		c = child_gen.make(4);
+	}
+
+	std::vector<std::pair<std::vector<int>, std::vector<int>>> pairs(POOL_SIZE / 4);
+	for (auto &p : pairs) {
+		p = gen.make_pair(state.range(0));
+	}
+
+	std::unique_ptr<ChildLHF> child;
+	std::unique_ptr<LHF> l;
+	std::vector<std::pair<Index, Index>> operands;
+
+	auto prepare = [&]() {
+		operands.clear();
+		l.reset();
+		child = std::make_unique<ChildLHF>();
+		l = std::make_unique<LHF>(std::tie(*child));
+
+		std::vector<ChildIndex> children;
+		for (auto &c : child_sets) {
+			children.push_back(child->register_set(c.begin(), c.end()));
+		}
+
+		auto make = [&](const std::vector<int> &keys, std::size_t salt) {
+			typename LHF::PropertySet s;
+			for (int k : keys) {
+				s.push_back({ k, { children[(k + salt) % children.size()] } });
+			}
+			return l->register_set(std::move(s));
+		};
+
+		for (std::size_t i = 0; i < pairs.size(); i++) {
+			Index a = make(pairs[i].first, i);
+			Index b = make(pairs[i].second, i + 1);
+			if constexpr (hit) {
+				l->set_union(a, b);
+			}
+			operands.push_back({ a, b });
+		}
+	};
+
+	prepare();
+	std::size_t i = 0;
+
+	for (auto _ : state) {
+		if (i == operands.size()) {
+			if constexpr (hit) {
+				i = 0;
+			} else {
+				state.PauseTiming();
+				prepare();
+				i = 0;
+				state.ResumeTiming();
+			}
+		}
+
+		benchmark::DoNotOptimize(l->set_union(operands[i].first, operands[i].second));
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_nested_union, lhf::NestingBase, true)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_nested_union, lhf::NestingBase, false)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_nested_union, lhf::NestingSoA, true)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_nested_union, lhf::NestingSoA, false)->Apply(sweep);
@@ -0,0 +1,191 @@
+#include "common.hpp"
+#include <memory>
+
+using namespace lhf_bench;
+
+using LHF = lhf::LatticeHashForest<int>;
+using Index = typename LHF::Index;
+using Elements = std::vector<int>;
+
+/**
+ * @brief      Which path through an operation a benchmark exercises.
+ */
+enum Scenario {
+	/// The operand pair is in the operation map.
+	HIT,
+
+	/// The operands are in a known subset relation.
+	SUBSET_HIT,
+
+	/// The operand pair is new, but the result set is already registered.
+	EDGE_MISS,
+
+	/// Neither the operand pair nor the result set is known.
+	COLD_MISS
+};
+
+struct Union {
+	static Index apply(LHF &l, const Index &a, const Index &b) {
+		return l.set_union(a, b);
+	}
+
+	static Elements reference(const Elements &a, const Elements &b) {
+		Elements ret;
+		std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(ret));
+		return ret;
+	}
+};
+
+struct Intersection {
+	static Index apply(LHF &l, const Index &a, const Index &b) {
+		return l.set_intersection(a, b);
+	}
+
+	static Elements reference(const Elements &a, const Elements &b) {
+		Elements ret;
+		std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(ret));
+		return ret;
+	}
+};
+
+struct Difference {
+	static Index apply(LHF &l, const Index &a, const Index &b) {
+		return l.set_difference(a, b);
+	}
+
+	static Elements reference(const Elements &a, const Elements &b) {
+		Elements ret;
+		std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(ret));
+		return ret;
+	}
+};
+
+static std::vector<std::pair<Elements, Elements>> make_pairs(benchmark::State &state) {
+	SetGenerator gen(state.range(1), state.range(2));
+	std::vector<std::pair<Elements, Elements>> ret(POOL_SIZE);
+	for (auto &p : ret) {
+		p = gen.make_pair(state.range(0));
+	}
+	return ret;
+}
+
+/**
+ * @brief      Times one operation on a pool of operand pairs that are set up
+ *             (outside of the timed region) so that every call takes the path
+ *             given by `S`. Miss scenarios rebuild the LHF once the pool is
+ *             exhausted.
+ */
+template<typename Op, Scenario S>
+static void BM_set_operation(benchmark::State &state) {
+	auto pairs = make_pairs(state);
+
+	std::unique_ptr<LHF> l;
+	std::vector<std::pair<Index, Index>> operands;
+
+	auto prepare = [&]() {
+		l = std::make_unique<LHF>();
+		operands.clear();
+
+		for (auto &p : pairs) {
+			Index a = l->register_set(p.first.begin(), p.first.end());
+			Index b = l->register_set(p.second.begin(), p.second.end());
+
+			if constexpr (S == HIT) {
+				Op::apply(*l, a, b);
+			} else if constexpr (S == SUBSET_HIT) {
+				// Records a as a subset of a ∪ b.
+				b = l->set_union(a, b);
+			} else if constexpr (S == EDGE_MISS) {
+				Elements r = Op::reference(p.first, p.second);
+				l->register_set(r.begin(), r.end());
+			}
+
+			operands.push_back({ a, b });
+		}
+	};
+
+	prepare();
+	std::size_t i = 0;
+
+	for (auto _ : state) {
+		if (i == operands.size()) {
+			if constexpr (S == HIT || S == SUBSET_HIT) {
+				i = 0;
+			} else {
+				state.PauseTiming();
+				prepare();
+				i = 0;
+				state.ResumeTiming();
+			}
+		}
+
+		benchmark::DoNotOptimize(Op::apply(*l, operands[i].first, operands[i].second));
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_set_operation, Union, HIT)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Union, SUBSET_HIT)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Union, EDGE_MISS)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Union, COLD_MISS)->Apply(sweep);
+
+BENCHMARK_TEMPLATE(BM_set_operation, Intersection, HIT)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Intersection, SUBSET_HIT)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Intersection, EDGE_MISS)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Intersection, COLD_MISS)->Apply(sweep);
+
+// Differences have no subset shortcut.
+BENCHMARK_TEMPLATE(BM_set_operation, Difference, HIT)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Difference, EDGE_MISS)->Apply(sweep);
+BENCHMARK_TEMPLATE(BM_set_operation, Difference, COLD_MISS)->Apply(sweep);
+
+/**
+ * @brief      Times registration of sets that are already registered.
+ */
+static void BM_register_set_hit(benchmark::State &state) {
+	auto pairs = make_pairs(state);
+
+	LHF l;
+	for (auto &p : pairs) {
+		l.register_set(p.first.begin(), p.first.end());
+	}
+
+	std::size_t i = 0;
+	for (auto _ : state) {
+		const Elements &e = pairs[i].first;
+		benchmark::DoNotOptimize(l.register_set(e.begin(), e.end()));
+		i = (i + 1) % pairs.size();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief      Times registration of new sets.
+ */
+static void BM_register_set_miss(benchmark::State &state) {
+	auto pairs = make_pairs(state);
+
+	auto l = std::make_unique<LHF>();
+	std::size_t i = 0;
+
+	for (auto _ : state) {
+		if (i == pairs.size()) {
+			state.PauseTiming();
+			l = std::make_unique<LHF>();
+			i = 0;
+			state.ResumeTiming();
+		}
+
+		const Elements &e = pairs[i].first;
+		benchmark::DoNotOptimize(l->register_set(e.begin(), e.end()));
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_register_set_hit)->Apply(sweep);
+BENCHMARK(BM_register_set_miss)->Apply(sweep);
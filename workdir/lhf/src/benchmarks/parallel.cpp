@@ -0,0 +1,93 @@
+#include "common.hpp"
+#include <memory>
+#include <thread>
+
+using namespace lhf_bench;
+
+using LHF = lhf::LatticeHashForest<int>;
+using Index = typename LHF::Index;
+
+#if defined(LHF_ENABLE_TBB) || defined(LHF_ENABLE_PARALLEL)
+
+/// Instance shared by the threads of a benchmark run. Set up and torn down by
+/// thread 0; the start and end of the timed loop are barriers.
+static std::unique_ptr<LHF> shared_lhf;
+static std::vector<Index> shared_sets;
+
+static void prepare_shared(benchmark::State &state, bool precompute) {
+	SetGenerator gen(state.range(1), state.range(2));
+	shared_lhf = std::make_unique<LHF>();
+	shared_sets.clear();
+
+	for (std::size_t i = 0; i < POOL_SIZE; i++) {
+		std::vector<int> e = gen.make(state.range(0));
+		shared_sets.push_back(shared_lhf->register_set(e.begin(), e.end()));
+	}
+
+	if (precompute) {
+		for (std::size_t i = 0; i < POOL_SIZE; i++) {
+			shared_lhf->set_union(shared_sets[i], shared_sets[(i + 1) % POOL_SIZE]);
+		}
+	}
+}
+
+/**
+ * @brief      Concurrent unions of a fixed pool of pairs that are all in the
+ *             operation map.
+ */
+static void BM_parallel_union_hit(benchmark::State &state) {
+	if (state.thread_index() == 0) {
+		prepare_shared(state, true);
+	}
+
+	std::size_t i = state.thread_index() * 97;
+	for (auto _ : state) {
+		std::size_t j = i % POOL_SIZE;
+		benchmark::DoNotOptimize(
+			shared_lhf->set_union(shared_sets[j], shared_sets[(j + 1) % POOL_SIZE]));
+		i++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (state.thread_index() == 0) {
+		shared_lhf.reset();
+	}
+}
+
+/**
+ * @brief      Concurrent unions of pseudo-random pairs from the pool. Nearly
+ *             every pair is new, so most calls compute and register a set.
+ */
+static void BM_parallel_union_miss(benchmark::State &state) {
+	if (state.thread_index() == 0) {
+		prepare_shared(state, false);
+	}
+
+	std::mt19937_64 gen(state.thread_index() + 1);
+	for (auto _ : state) {
+		std::size_t r = gen();
+		benchmark::DoNotOptimize(
+			shared_lhf->set_union(
+				shared_sets[r % POOL_SIZE],
+				shared_sets[(r >> 32) % POOL_SIZE]));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (state.thread_index() == 0) {
+		shared_lhf.reset();
+	}
+}
+
+static void parallel_sweep(benchmark::internal::Benchmark *b) {
+	b->ArgNames({ "n", "universe", "dist" });
+	b->ArgsProduct({ { 16, 64 }, { 1 << 16 }, { UNIFORM, SKEWED } });
+	b->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()));
+	b->UseRealTime();
+}
+
+BENCHMARK(BM_parallel_union_hit)->Apply(parallel_sweep);
+BENCHMARK(BM_parallel_union_miss)->Apply(parallel_sweep);
+
+#endif
@@ -0,0 +1,235 @@
+#include "common.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace lhf_bench;
+
+#if defined(LHF_ENABLE_TBB) || defined(LHF_ENABLE_PARALLEL)
+
+using FlatLHF = lhf::LatticeHashForest<int>;
+
+using NestedLHF =
+	lhf::LatticeHashForest<
+		int,
+		lhf::DefaultLess<int>,
+		lhf::DefaultHash<int>,
+		lhf::DefaultEqual<int>,
+		lhf::DefaultPrinter<int>,
+		lhf::NestingBase<int, FlatLHF>>;
+
+/**
+ * @brief      Workload shapes of the scaling benchmarks.
+ */
+enum Shape {
+	/// Nine in ten operations are unions that are already in the operation
+	/// map, the rest are `contains` lookups. Nothing is inserted while timing.
+	READ_MOSTLY,
+
+	/// One in four operations registers a set, the rest are unions of
+	/// operand pairs that may or may not have been seen before.
+	MIXED,
+
+	/// Alternating unions and intersections of nested sets, which also
+	/// operate on the child instance.
+	NESTED
+};
+
+/**
+ * @brief      Whether the threads of a run draw operands from one corpus of
+ *             sets or each from their own. Passed as the `shared` argument.
+ */
+enum Corpus {
+	PRIVATE = 0,
+	SHARED = 1
+};
+
+constexpr int SCALING_SET_SIZE = 32;
+constexpr int SCALING_UNIVERSE = 1 << 16;
+constexpr double SCALING_ZIPF_EXPONENT = 0.99;
+
+/// Number of not yet registered sets per corpus used by the `MIXED` shape.
+constexpr std::size_t SCALING_FRESH_SETS = 1024;
+
+/**
+ * @brief      Instance and corpora shared by the threads of a run. Set up and
+ *             torn down by thread 0; the start and end of the timed loop are
+ *             barriers.
+ */
+template<typename LHF>
+struct ScalingInstance {
+	static inline std::unique_ptr<FlatLHF> child;
+	static inline std::unique_ptr<LHF> lhf;
+	static inline std::vector<std::vector<typename LHF::Index>> pools;
+	static inline std::vector<std::vector<std::vector<int>>> fresh;
+
+	static void prepare(Shape shape, std::size_t corpora) {
+		lhf.reset();
+		child = std::make_unique<FlatLHF>();
+		pools.assign(corpora, {});
+		fresh.assign(corpora, {});
+
+		std::vector<typename FlatLHF::Index> children;
+		if constexpr (std::is_same_v<LHF, NestedLHF>) {
+			lhf = std::make_unique<LHF>(std::tie(*child));
+			SetGenerator child_gen(1 << 10, UNIFORM, 2);
+			for (int i = 0; i < 64; i++) {
+				std::vector<int> c = child_gen.make(4);
+				children.push_back(child->register_set(c.begin(), c.end()));
+			}
+		} else {
+			lhf = std::make_unique<LHF>();
+		}
+
+		auto make = [&](const std::vector<int> &e) {
+			if constexpr (std::is_same_v<LHF, NestedLHF>) {
+				typename LHF::PropertySet s;
+				for (int k : e) {
+					s.push_back({ k, { children[k % children.size()] } });
+				}
+				return lhf->register_set(std::move(s));
+			} else {
+				return lhf->register_set(e.begin(), e.end());
+			}
+		};
+
+		for (std::size_t c = 0; c < corpora; c++) {
+			SetGenerator gen(SCALING_UNIVERSE, UNIFORM, c + 1);
+			for (std::size_t i = 0; i < POOL_SIZE; i++) {
+				pools[c].push_back(make(gen.make(SCALING_SET_SIZE)));
+			}
+
+			if (shape == READ_MOSTLY) {
+				for (std::size_t i = 0; i < POOL_SIZE; i++) {
+					lhf->set_union(pools[c][i], pools[c][(i + 1) % POOL_SIZE]);
+				}
+			} else if (shape == MIXED) {
+				for (std::size_t i = 0; i < SCALING_FRESH_SETS; i++) {
+					fresh[c].push_back(gen.make(SCALING_SET_SIZE));
+				}
+			}
+		}
+	}
+
+	static void reset() {
+		pools.clear();
+		fresh.clear();
+		lhf.reset();
+		child.reset();
+	}
+};
+
+/// Throughput of the single-threaded run of every (shape, corpus)
+/// configuration, which the speedup of the multithreaded runs is relative to.
+static std::map<std::pair<int, int>, double> scaling_baselines;
+
+/**
+ * @brief      Runs a workload shape on one instance from all threads, picking
+ *             operands from the corpus with a Zipfian distribution.
+ *
+ *             Thread 0 reports, besides the usual `items_per_second`:
+ *
+ *             * `speedup`: throughput relative to the one-thread run of the
+ *               same configuration (which runs first).
+ *             * `read_waits_per_op` and `write_waits_per_op`: lock
+ *               acquisitions that had to wait, per operation (see
+ *               `lhf::lock_contention`). These are only available with
+ *               `LHF_ENABLE_PARALLEL`; the TBB containers do not expose
+ *               theirs.
+ */
+template<Shape shape>
+static void BM_scaling(benchmark::State &state) {
+	using LHF = std::conditional_t<shape == NESTED, NestedLHF, FlatLHF>;
+	using Instance = ScalingInstance<LHF>;
+	using namespace std::chrono;
+
+	const Corpus corpus = Corpus(state.range(0));
+	const std::size_t t = state.thread_index();
+
+	if (t == 0) {
+		Instance::prepare(shape, corpus == SHARED ? 1 : state.threads());
+#if defined(LHF_ENABLE_PARALLEL) && !defined(LHF_ENABLE_TBB)
+		lhf::reset_lock_contention();
+#endif
+	}
+
+	ZipfSampler zipf(POOL_SIZE, SCALING_ZIPF_EXPONENT, t + 1);
+	const std::size_t c = corpus == SHARED ? 0 : t;
+
+	std::size_t ops = 0;
+	steady_clock::time_point start;
+
+	for (auto _ : state) {
+		if (ops == 0) {
+			start = steady_clock::now();
+		}
+
+		LHF &l = *Instance::lhf;
+		const auto &pool = Instance::pools[c];
+		std::size_t i = zipf();
+
+		if constexpr (shape == READ_MOSTLY) {
+			if (ops % 10 == 9) {
+				benchmark::DoNotOptimize(l.contains(pool[i], int(ops % SCALING_UNIVERSE)));
+			} else {
+				benchmark::DoNotOptimize(l.set_union(pool[i], pool[(i + 1) % POOL_SIZE]));
+			}
+		} else if constexpr (shape == MIXED) {
+			if (ops % 4 == 0) {
+				const auto &e = Instance::fresh[c][(ops / 4) % SCALING_FRESH_SETS];
+				benchmark::DoNotOptimize(l.register_set(e.begin(), e.end()));
+			} else {
+				benchmark::DoNotOptimize(l.set_union(pool[i], pool[zipf()]));
+			}
+		} else {
+			if (ops % 2 == 0) {
+				benchmark::DoNotOptimize(l.set_union(pool[i], pool[zipf()]));
+			} else {
+				benchmark::DoNotOptimize(l.set_intersection(pool[i], pool[zipf()]));
+			}
+		}
+
+		ops++;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+
+	if (t == 0) {
+		// Every thread runs the same number of iterations, and the end of the
+		// loop waits for all of them.
+		double seconds = duration<double>(steady_clock::now() - start).count();
+		double total = double(ops) * state.threads();
+		double rate = seconds > 0 ? total / seconds : 0;
+
+		auto key = std::make_pair(int(shape), int(corpus));
+		if (state.threads() == 1) {
+			scaling_baselines[key] = rate;
+		}
+		if (scaling_baselines.count(key) && scaling_baselines[key] > 0) {
+			state.counters["speedup"] = rate / scaling_baselines[key];
+		}
+
+#if defined(LHF_ENABLE_PARALLEL) && !defined(LHF_ENABLE_TBB)
+		lhf::LockContention waits = lhf::lock_contention();
+		state.counters["read_waits_per_op"] = total > 0 ? waits.shared_waits / total : 0;
+		state.counters["write_waits_per_op"] = total > 0 ? waits.exclusive_waits / total : 0;
+#endif
+
+		Instance::reset();
+	}
+}
+
+static void scaling_sweep(benchmark::internal::Benchmark *b) {
+	b->ArgNames({ "shared" });
+	b->Arg(PRIVATE)->Arg(SHARED);
+	b->ThreadRange(1, std::max(1u, std::thread::hardware_concurrency()));
+	b->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_scaling, READ_MOSTLY)->Apply(scaling_sweep);
+BENCHMARK_TEMPLATE(BM_scaling, MIXED)->Apply(scaling_sweep);
+BENCHMARK_TEMPLATE(BM_scaling, NESTED)->Apply(scaling_sweep);
+
+#endif
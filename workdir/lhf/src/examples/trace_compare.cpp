@@ -0,0 +1,638 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lhf/lhf.hpp"
+#include "lhf/trace.hpp"
+
+#if __has_include(<boost/container/flat_set.hpp>)
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+#define TRACE_COMPARE_ENABLE_FLAT_SET
+#endif
+
+#ifdef TRACE_COMPARE_ENABLE_ROARING
+#include <roaring/roaring64map.hh>
+#endif
+
+/**
+ * Replays one operation trace (see `lhf/trace.hpp`) against several set
+ * implementations, and writes one CSV line per implementation:
+ *
+ * * `lhf`, `lhf-soa`: LHF with `NestingBase` and with `NestingSoA` (the two
+ *   only differ for traces of pairs).
+ * * `std-set`: `std::set`, with `std::map` of sets for pairs, as in the
+ *   naive implementation of the `abstract` tests.
+ * * `sorted-vector`: sorted `std::vector`s.
+ * * `flat-set`: `boost::container::flat_set` (if Boost is available).
+ * * `roaring`: `Roaring64Map` (if CRoaring was found at configure time).
+ *
+ * Every implementation runs in a forked child process, so its peak RSS is
+ * measured on its own. Only the operations are timed; building the corpus
+ * and inline operands is not. LHF keeps every result, while the other
+ * implementations drop the results of corpus traces once they are counted.
+ * The checksum (the total number of elements, or pairs, over all results)
+ * must agree between implementations.
+ *
+ * Corpus traces of arity 1 and 2 are supported, as well as live traces of a
+ * single plain LHF.
+ */
+
+/// Result of one run, passed from the child to the parent through a pipe.
+struct RunResult {
+	uint64_t operations = 0;
+	uint64_t registrations = 0;
+	uint64_t checksum = 0;
+	double op_time_ns = 0;
+	double p50_ns = 0;
+	double p99_ns = 0;
+	char error[160] = "";
+};
+
+/// Latency samples of the timed operations.
+struct Samples {
+	std::vector<uint32_t> ticks;
+	uint64_t total = 0;
+
+	void add(uint64_t t) {
+		total += t;
+		ticks.push_back(static_cast<uint32_t>(std::min<uint64_t>(t, UINT32_MAX)));
+	}
+
+	double percentile(double p, double ticks_per_ns) {
+		if (ticks.empty()) {
+			return 0;
+		}
+		std::size_t k = std::min(ticks.size() - 1, std::size_t(p * ticks.size()));
+		std::nth_element(ticks.begin(), ticks.begin() + k, ticks.end());
+		return ticks[k] / ticks_per_ns;
+	}
+};
+
+//
+// Backends. Every backend has a `Set` type that stands for one set, builds
+// sets from trace elements with `make()`, applies `op()`, and counts the
+// elements (or pairs) of a set with `count()`.
+//
+
+template<typename Nesting>
+struct LHFBackendBase {
+	using ChildLHF = lhf::LatticeHashForest<long>;
+	using NestedLHF =
+		lhf::LatticeHashForest<
+			long,
+			lhf::DefaultLess<long>,
+			lhf::DefaultHash<long>,
+			lhf::DefaultEqual<long>,
+			lhf::DefaultPrinter<long>,
+			Nesting>;
+
+	ChildLHF child;
+	NestedLHF nested { std::tie(child) };
+	ChildLHF::PropertySet child_buffer;
+	typename NestedLHF::PropertySet buffer;
+	uint32_t arity;
+
+	/// An index into `child` for plain traces, and into `nested` for pairs.
+	using Set = lhf::IndexValue;
+
+	explicit LHFBackendBase(uint32_t arity): arity(arity) {}
+
+	Set make_child(const int64_t *begin, const int64_t *end, std::size_t stride) {
+		child_buffer.clear();
+		for (const int64_t *e = begin; e < end; e += stride) {
+			child_buffer.push_back(*e);
+		}
+		return child.register_set<true>(child_buffer).value;
+	}
+
+	Set make(const std::vector<int64_t> &elements) {
+		if (arity == 1) {
+			return make_child(elements.data(), elements.data() + elements.size(), 1);
+		}
+
+		buffer.clear();
+		for (std::size_t i = 0; i < elements.size();) {
+			std::size_t j = i;
+			while (j < elements.size() && elements[j] == elements[i]) {
+				j += 2;
+			}
+			ChildLHF::Index c(make_child(elements.data() + i + 1, elements.data() + j + 1, 2));
+			buffer.push_back({ elements[i], { c } });
+			i = j;
+		}
+		return nested.template register_set<true>(buffer).value;
+	}
+
+	template<typename LHF>
+	static Set apply(LHF &l, uint8_t op, Set a, Set b) {
+		using Index = typename LHF::Index;
+		switch (op) {
+		case lhf::TRACE_UNION: return l.set_union(Index(a), Index(b)).value;
+		case lhf::TRACE_INTERSECTION: return l.set_intersection(Index(a), Index(b)).value;
+		default: return l.set_difference(Index(a), Index(b)).value;
+		}
+	}
+
+	Set op(uint8_t op, const Set &a, const Set &b) {
+		return arity == 1 ? apply(child, op, a, b) : apply(nested, op, a, b);
+	}
+
+	uint64_t count(const Set &s) {
+		if (arity == 1) {
+			return child.size_of(ChildLHF::Index(s));
+		}
+
+		uint64_t n = 0;
+		for (const auto &e : nested.get_value(typename NestedLHF::Index(s))) {
+			n += child.size_of(std::get<0>(e.get_value()));
+		}
+		return n;
+	}
+};
+
+using LHFBackend = LHFBackendBase<lhf::NestingBase<long, lhf::LatticeHashForest<long>>>;
+using LHFSoABackend = LHFBackendBase<lhf::NestingSoA<long, lhf::LatticeHashForest<long>>>;
+
+/// Operations on plain sets that provide ordered iteration.
+template<typename SetT>
+struct OrderedOps {
+	using T = SetT;
+
+	static T make(const int64_t *begin, const int64_t *end, std::size_t stride) {
+		T out;
+		for (const int64_t *e = begin; e < end; e += stride) {
+			out.insert(out.end(), *e);
+		}
+		return out;
+	}
+
+	static T op(uint8_t op, const T &a, const T &b) {
+		T out;
+		auto ins = std::inserter(out, out.end());
+		switch (op) {
+		case lhf::TRACE_UNION: std::set_union(a.begin(), a.end(), b.begin(), b.end(), ins); break;
+		case lhf::TRACE_INTERSECTION: std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), ins); break;
+		default: std::set_difference(a.begin(), a.end(), b.begin(), b.end(), ins); break;
+		}
+		return out;
+	}
+
+	static uint64_t count(const T &s) {
+		return s.size();
+	}
+};
+
+#ifdef TRACE_COMPARE_ENABLE_ROARING
+struct RoaringOps {
+	using T = roaring::Roaring64Map;
+
+	static T make(const int64_t *begin, const int64_t *end, std::size_t stride) {
+		T out;
+		for (const int64_t *e = begin; e < end; e += stride) {
+			out.add(static_cast<uint64_t>(*e));
+		}
+		return out;
+	}
+
+	static T op(uint8_t op, const T &a, const T &b) {
+		switch (op) {
+		case lhf::TRACE_UNION: return a | b;
+		case lhf::TRACE_INTERSECTION: return a & b;
+		default: return a - b;
+		}
+	}
+
+	static uint64_t count(const T &s) {
+		return s.cardinality();
+	}
+};
+#endif
+
+/**
+ * Sets of pairs as an ordered map from keys to plain sets, combined key by
+ * key like nested LHF sets. `Map` is an ordered associative container or a
+ * sorted vector of pairs.
+ */
+template<typename Map, typename Inner>
+struct KeyedOps {
+	using T = Map;
+
+	static T make(const int64_t *begin, const int64_t *end, std::size_t) {
+		T out;
+		for (const int64_t *i = begin; i < end;) {
+			const int64_t *j = i;
+			while (j < end && *j == *i) {
+				j += 2;
+			}
+			out.insert(out.end(), typename T::value_type(*i, Inner::make(i + 1, j + 1, 2)));
+			i = j;
+		}
+		return out;
+	}
+
+	static T op(uint8_t op, const T &a, const T &b) {
+		T out;
+		auto i = a.begin();
+		auto j = b.begin();
+
+		while (i != a.end() || j != b.end()) {
+			if (j == b.end() || (i != a.end() && i->first < j->first)) {
+				if (op != lhf::TRACE_INTERSECTION) {
+					out.insert(out.end(), *i);
+				}
+				i++;
+			} else if (i == a.end() || j->first < i->first) {
+				if (op == lhf::TRACE_UNION) {
+					out.insert(out.end(), *j);
+				}
+				j++;
+			} else {
+				out.insert(out.end(), typename T::value_type(i->first, Inner::op(op, i->second, j->second)));
+				i++;
+				j++;
+			}
+		}
+		return out;
+	}
+
+	static uint64_t count(const T &s) {
+		uint64_t n = 0;
+		for (const auto &e : s) {
+			n += Inner::count(e.second);
+		}
+		return n;
+	}
+};
+
+/// Adapts a pair of plain and keyed operation types to a backend.
+template<typename Flat, typename Keyed>
+struct ValueBackend {
+	struct Set {
+		typename Flat::T flat;
+		typename Keyed::T keyed;
+	};
+
+	uint32_t arity;
+
+	explicit ValueBackend(uint32_t arity): arity(arity) {}
+
+	Set make(const std::vector<int64_t> &elements) {
+		Set s;
+		if (arity == 1) {
+			s.flat = Flat::make(elements.data(), elements.data() + elements.size(), 1);
+		} else {
+			s.keyed = Keyed::make(elements.data(), elements.data() + elements.size(), 2);
+		}
+		return s;
+	}
+
+	Set op(uint8_t op, const Set &a, const Set &b) {
+		Set s;
+		if (arity == 1) {
+			s.flat = Flat::op(op, a.flat, b.flat);
+		} else {
+			s.keyed = Keyed::op(op, a.keyed, b.keyed);
+		}
+		return s;
+	}
+
+	uint64_t count(const Set &s) {
+		return arity == 1 ? Flat::count(s.flat) : Keyed::count(s.keyed);
+	}
+};
+
+using StdSetOps = OrderedOps<std::set<int64_t>>;
+using SortedVectorOps = OrderedOps<std::vector<int64_t>>;
+
+using StdSetBackend = ValueBackend<
+	StdSetOps,
+	KeyedOps<std::map<int64_t, std::set<int64_t>>, StdSetOps>>;
+using SortedVectorBackend = ValueBackend<
+	SortedVectorOps,
+	KeyedOps<std::vector<std::pair<int64_t, std::vector<int64_t>>>, SortedVectorOps>>;
+
+#ifdef TRACE_COMPARE_ENABLE_FLAT_SET
+using FlatSetOps = OrderedOps<boost::container::flat_set<int64_t>>;
+using FlatSetBackend = ValueBackend<
+	FlatSetOps,
+	KeyedOps<boost::container::flat_map<int64_t, boost::container::flat_set<int64_t>>, FlatSetOps>>;
+#endif
+
+#ifdef TRACE_COMPARE_ENABLE_ROARING
+using RoaringBackend = ValueBackend<
+	RoaringOps,
+	KeyedOps<std::map<int64_t, roaring::Roaring64Map>, RoaringOps>>;
+#endif
+
+//
+// Replay
+//
+
+template<typename Backend>
+static void replay(const char *path, RunResult &result) {
+	using Set = typename Backend::Set;
+
+	lhf::TraceFile file(path);
+	lhf::TraceReader reader(file.data(), file.size());
+	uint32_t arity = reader.is_live() ? 1 : reader.header().arity;
+
+	Backend backend(arity);
+	Samples samples;
+	samples.ticks.reserve(reader.header().op_count);
+
+	std::vector<Set> sets;
+	std::vector<bool> known;
+	sets.reserve(reader.is_live() ? reader.header().op_count : reader.header().corpus_count);
+
+	auto store = [&](uint64_t i, Set &&s) {
+		if (i >= sets.size()) {
+			sets.resize(i + 1);
+			known.resize(i + 1, false);
+		}
+		sets[i] = std::move(s);
+		known[i] = true;
+	};
+
+	auto get = [&](uint64_t i) -> const Set & {
+		if (i >= sets.size() || !known[i]) {
+			throw lhf::TraceFormatError("Reference to unknown set " + std::to_string(i));
+		}
+		return sets[i];
+	};
+
+	if (reader.is_live()) {
+		store(0, backend.make({}));
+	}
+
+	lhf::TraceReader::Record r;
+	Set inline_a, inline_b;
+
+	while (reader.next(r)) {
+		switch (r.opcode) {
+		case lhf::TRACE_CORPUS_SET:
+			store(sets.size(), backend.make(*r.a.elements));
+			result.registrations++;
+			continue;
+
+		case lhf::TRACE_CORPUS_DUPLICATE:
+			for (uint64_t i = r.start; i <= r.stop; i++) {
+				store(sets.size(), Set(get(i)));
+			}
+			continue;
+
+		case lhf::TRACE_LIVE_INSTANCE:
+			if (!r.children->empty() || r.instance != 0) {
+				throw lhf::TraceFormatError("Only live traces of a single plain LHF are supported");
+			}
+			continue;
+
+		case lhf::TRACE_LIVE_REGISTER:
+			if (r.has_result) {
+				store(r.index, backend.make(*r.a.elements));
+			}
+			result.registrations++;
+			continue;
+
+		case lhf::TRACE_UNION:
+		case lhf::TRACE_INTERSECTION:
+		case lhf::TRACE_DIFFERENCE: {
+			const Set *a = r.a.is_corpus ? &get(r.a.corpus_index) : nullptr;
+			const Set *b = r.b.is_corpus ? &get(r.b.corpus_index) : nullptr;
+			if (!a) {
+				inline_a = backend.make(*r.a.elements);
+				a = &inline_a;
+			}
+			if (!b) {
+				inline_b = backend.make(*r.b.elements);
+				b = &inline_b;
+			}
+
+			uint64_t t0 = lhf::probe_ticks();
+			Set s = backend.op(r.opcode, *a, *b);
+			samples.add(lhf::probe_ticks() - t0);
+
+			result.checksum += backend.count(s);
+			result.operations++;
+			continue;
+		}
+
+		default: {
+			uint8_t op = r.opcode - lhf::TRACE_LIVE_UNION + lhf::TRACE_UNION;
+			const Set &a = get(r.left);
+			const Set &b = get(r.right);
+
+			uint64_t t0 = lhf::probe_ticks();
+			Set s = backend.op(op, a, b);
+			samples.add(lhf::probe_ticks() - t0);
+
+			result.checksum += backend.count(s);
+			result.operations++;
+			store(r.index, std::move(s));
+		}
+		}
+	}
+
+	double ticks_per_ns = lhf::probe_ticks_per_ns();
+	result.op_time_ns = samples.total / ticks_per_ns;
+	result.p50_ns = samples.percentile(0.5, ticks_per_ns);
+	result.p99_ns = samples.percentile(0.99, ticks_per_ns);
+}
+
+struct BackendEntry {
+	const char *name;
+	std::function<void(const char *, RunResult &)> run;
+};
+
+static std::vector<BackendEntry> backends() {
+	return {
+		{ "lhf", replay<LHFBackend> },
+		{ "lhf-soa", replay<LHFSoABackend> },
+		{ "std-set", replay<StdSetBackend> },
+		{ "sorted-vector", replay<SortedVectorBackend> },
+#ifdef TRACE_COMPARE_ENABLE_FLAT_SET
+		{ "flat-set", replay<FlatSetBackend> },
+#endif
+#ifdef TRACE_COMPARE_ENABLE_ROARING
+		{ "roaring", replay<RoaringBackend> },
+#endif
+	};
+}
+
+/// The LHF build flags, which tell apart LHF configurations across builds.
+static std::string lhf_config() {
+	std::string s;
+#if defined(LHF_ENABLE_TBB)
+	s += "tbb";
+#elif defined(LHF_ENABLE_PARALLEL)
+	s += "parallel";
+#else
+	s += "serial";
+#endif
+#ifdef LHF_ENABLE_32BIT_INDEX
+	s += "+idx32";
+#endif
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	s += "+metrics";
+#endif
+#ifdef LHF_ENABLE_DEBUG
+	s += "+debug";
+#endif
+	return s;
+}
+
+/**
+ * Runs one backend in a child process, and collects its result and peak
+ * RSS (in KiB).
+ */
+static bool run_isolated(const BackendEntry &backend, const char *path, RunResult &result, long &peak_rss_kb) {
+	int fds[2];
+	if (pipe(fds) < 0) {
+		perror("pipe");
+		return false;
+	}
+
+	std::cout.flush();
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return false;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+		RunResult r;
+		try {
+			backend.run(path, r);
+		} catch (const std::exception &e) {
+			std::snprintf(r.error, sizeof(r.error), "%s", e.what());
+		}
+		ssize_t written = write(fds[1], &r, sizeof(r));
+		_exit(written == sizeof(r) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	ssize_t got = read(fds[0], &result, sizeof(result));
+	close(fds[0]);
+
+	int status;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	peak_rss_kb = usage.ru_maxrss;
+
+	if (got != sizeof(result)) {
+		std::snprintf(result.error, sizeof(result.error), "child exited abnormally (status %d)", status);
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		printf("Usage: %s [trace file] [--backends a,b,...] [--csv output file] [--list]\n", argv[0]);
+		return 1;
+	}
+
+	std::string path;
+	std::string csv_path;
+	std::vector<std::string> selected;
+
+	for (int i = 1; i < argc; i++) {
+		std::string opt = argv[i];
+		if (opt == "--list") {
+			for (const BackendEntry &b : backends()) {
+				printf("%s\n", b.name);
+			}
+			return 0;
+		} else if (opt == "--backends" && i + 1 < argc) {
+			std::string list = argv[++i];
+			for (std::size_t start = 0; start <= list.size();) {
+				std::size_t end = std::min(list.find(',', start), list.size());
+				selected.push_back(list.substr(start, end - start));
+				start = end + 1;
+			}
+		} else if (opt == "--csv" && i + 1 < argc) {
+			csv_path = argv[++i];
+		} else if (path.empty()) {
+			path = opt;
+		} else {
+			printf("Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<BackendEntry> runs;
+	for (const BackendEntry &b : backends()) {
+		if (selected.empty() || std::find(selected.begin(), selected.end(), b.name) != selected.end()) {
+			runs.push_back(b);
+		}
+	}
+	if (runs.size() < std::max<std::size_t>(selected.size(), 1)) {
+		printf("Unknown backend selected, see --list\n");
+		return 1;
+	}
+
+	// Calibrate the clock once, before the children are forked.
+	lhf::probe_ticks_per_ns();
+
+	std::ofstream csv_file;
+	bool write_header = true;
+	if (!csv_path.empty()) {
+		write_header = !std::ifstream(csv_path).good();
+		csv_file.open(csv_path, std::ios::app);
+	}
+	std::ostream &csv = csv_path.empty() ? std::cout : csv_file;
+
+	if (write_header) {
+		csv << "trace,backend,lhf_config,operations,registrations,op_time_ms,"
+		       "ops_per_s,p50_ns,p99_ns,peak_rss_kb,checksum,status\n";
+	}
+
+	uint64_t reference = 0;
+	bool have_reference = false;
+	int ret = 0;
+
+	for (const BackendEntry &b : runs) {
+		RunResult r;
+		long rss = 0;
+		if (!run_isolated(b, path.c_str(), r, rss)) {
+			return 1;
+		}
+
+		std::string status = "ok";
+		if (r.error[0]) {
+			status = r.error;
+			ret = 1;
+		} else if (have_reference && r.checksum != reference) {
+			status = "checksum mismatch";
+			ret = 1;
+		} else {
+			reference = r.checksum;
+			have_reference = true;
+		}
+
+		std::replace(status.begin(), status.end(), ',', ';');
+
+		char line[512];
+		std::snprintf(line, sizeof(line), "%s,%s,%s,%lu,%lu,%.3f,%.0f,%.1f,%.1f,%ld,%lu,%s\n",
+			path.c_str(), b.name, lhf_config().c_str(),
+			r.operations, r.registrations,
+			r.op_time_ns / 1e6,
+			r.op_time_ns > 0 ? r.operations / (r.op_time_ns / 1e9) : 0.0,
+			r.p50_ns, r.p99_ns, rss, r.checksum, status.c_str());
+		csv << line;
+		csv.flush();
+	}
+
+	return ret;
+}
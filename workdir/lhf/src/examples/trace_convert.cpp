@@ -0,0 +1,155 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lhf/trace.hpp"
+
+/**
+ * Converts the text operation streams used by `benchmark.cpp` and the
+ * `abstract` test programs into the binary trace format (see
+ * `lhf/trace.hpp`).
+ *
+ * Input formats:
+ *
+ * * `explicit`: the operation count, then for every operation its type
+ *   (`U`, `I` or `D`) and three sets: both operands and the result.
+ * * `corpus`: the corpus size and the corpus sets, the operation count, then
+ *   for every operation its type, two corpus indices and the result. `S a b`
+ *   lines duplicate corpus entries `a` to `b`.
+ *
+ * A set is its length followed by its elements. With `--pairs`, every element
+ * is a pair of integers (as in the `*_pointsto` tests).
+ */
+
+static bool read_set(std::istream &in, std::vector<int64_t> &out, int arity) {
+	long long len;
+	if (!(in >> len)) {
+		return false;
+	}
+
+	out.clear();
+	for (long long i = 0; i < len * arity; i++) {
+		long long v;
+		if (!(in >> v)) {
+			return false;
+		}
+		out.push_back(v);
+	}
+	return true;
+}
+
+static lhf::TraceOpcode to_opcode(char c) {
+	switch (c) {
+	case 'U': return lhf::TRACE_UNION;
+	case 'I': return lhf::TRACE_INTERSECTION;
+	case 'D': return lhf::TRACE_DIFFERENCE;
+	default:
+		throw lhf::TraceFormatError(std::string("Illegal operator: ") + c);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 4) {
+		printf("Usage: %s <explicit | corpus> [input file] [output file] [--pairs] [--no-results]\n", argv[0]);
+		return 1;
+	}
+
+	std::string format = argv[1];
+	int arity = 1;
+	bool keep_results = true;
+
+	for (int i = 4; i < argc; i++) {
+		std::string opt = argv[i];
+		if (opt == "--pairs") {
+			arity = 2;
+		} else if (opt == "--no-results") {
+			keep_results = false;
+		} else {
+			printf("Unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (format != "explicit" && format != "corpus") {
+		printf("Unknown format: %s\n", format.c_str());
+		return 1;
+	}
+
+	std::ifstream in(argv[2]);
+	if (!in) {
+		printf("File not found: %s\n", argv[2]);
+		return 1;
+	}
+
+	std::ofstream out(argv[3], std::ios::binary | std::ios::trunc);
+	if (!out) {
+		printf("Could not open output file: %s\n", argv[3]);
+		return 1;
+	}
+
+	try {
+		lhf::TraceWriter writer(out, arity);
+		std::vector<int64_t> a, b, result;
+
+		if (format == "corpus") {
+			long long corpus_count;
+			in >> corpus_count;
+			for (long long i = 0; i < corpus_count; i++) {
+				if (!read_set(in, a, arity)) {
+					throw lhf::TraceFormatError("Malformed corpus set " + std::to_string(i));
+				}
+				writer.corpus_set(a);
+			}
+		}
+
+		long long num_ops;
+		if (!(in >> num_ops)) {
+			throw lhf::TraceFormatError("Expected the number of operations");
+		}
+
+		long long count = 0;
+		std::string op;
+
+		while (count < num_ops && in >> op) {
+			if (op == "S") {
+				uint64_t start, stop;
+				in >> start >> stop;
+				writer.corpus_duplicate(start, stop);
+				continue;
+			}
+
+			lhf::TraceOpcode opcode = to_opcode(op[0]);
+			lhf::TraceWriter::Operand oa, ob;
+
+			if (format == "corpus") {
+				uint64_t ia, ib;
+				in >> ia >> ib;
+				oa = lhf::TraceWriter::Operand::corpus(ia);
+				ob = lhf::TraceWriter::Operand::corpus(ib);
+			} else {
+				if (!read_set(in, a, arity) || !read_set(in, b, arity)) {
+					throw lhf::TraceFormatError("Malformed operands of operation " + std::to_string(count));
+				}
+				oa = lhf::TraceWriter::Operand::inline_set(a, arity);
+				ob = lhf::TraceWriter::Operand::inline_set(b, arity);
+			}
+
+			if (!read_set(in, result, arity)) {
+				throw lhf::TraceFormatError("Malformed result of operation " + std::to_string(count));
+			}
+
+			writer.operation(opcode, oa, ob, keep_results ? &result : nullptr);
+			count++;
+		}
+
+		writer.finish();
+		std::cout << "Wrote " << count << " operations to " << argv[3]
+		          << " (" << out.tellp() << " bytes)" << std::endl;
+	} catch (const lhf::TraceFormatError &e) {
+		std::cout << argv[2] << ": " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,494 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <type_traits>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lhf/lhf.hpp"
+#include "lhf/trace.hpp"
+#include "lhf/workload.hpp"
+
+/**
+ * Replays a binary operation trace (see `lhf/trace.hpp`) against LHF. The
+ * trace is memory-mapped and decoded into reused buffers, so the replay loop
+ * does no parsing and no allocation besides the LHF's own. Only the LHF calls
+ * are timed, separately for set registration and for every operation type.
+ *
+ * Traces with an element arity of 2 are replayed on a nested LHF, in which
+ * the pairs `(k, v)` with the same `k` become one key with a child set.
+ *
+ * Traces recorded from a running LHF (`TraceRecorder`) are replayed on the
+ * same structure: one plain LHF, or one LHF with a single plain child. Set
+ * indices of the recording are mapped to the indices of the replay as they
+ * appear. Operations on sets that are not known yet (which can happen when
+ * several threads were recorded) are skipped and counted. With `--verify`,
+ * the replay fails if a recorded index maps to two different sets.
+ *
+ * With `--generate <spec>` in place of the trace file, a workload is generated
+ * in memory (see `lhf/workload.hpp`) and replayed without going through a
+ * file. The spec is a comma separated list of `key=value` parameters, such as
+ * `kind=closed_world,dist=normal,count=1000000,seed=7`.
+ */
+
+/// Plain sets of integers.
+struct FlatBackend {
+	using LHF = lhf::LatticeHashForest<long>;
+	using Index = LHF::Index;
+
+	LHF l;
+	LHF::PropertySet buffer;
+
+	LHF &lhf() {
+		return l;
+	}
+
+	/// Trace sets are sorted and unique, so integrity checks are skipped.
+	Index make(const std::vector<int64_t> &elements) {
+		buffer.clear();
+		for (int64_t e : elements) {
+			buffer.push_back(e);
+		}
+		return l.register_set<true>(buffer);
+	}
+
+	void flatten(const Index &i, std::vector<int64_t> &out) {
+		out.clear();
+		for (auto &e : l.get_value(i)) {
+			out.push_back(e.get_key());
+		}
+	}
+};
+
+/// Marks recorded indices that have no counterpart in the replay.
+constexpr uint64_t UNMAPPED = UINT64_MAX;
+
+/// Sets of (key, value) pairs, stored as keys with a nested set of values.
+struct NestedBackend {
+	using ChildLHF = lhf::LatticeHashForest<long>;
+	using LHF =
+		lhf::LatticeHashForest<
+			long,
+			lhf::DefaultLess<long>,
+			lhf::DefaultHash<long>,
+			lhf::DefaultEqual<long>,
+			lhf::DefaultPrinter<long>,
+			lhf::NestingBase<long, ChildLHF>>;
+	using Index = LHF::Index;
+
+	ChildLHF child;
+	LHF l{std::tie(child)};
+	LHF::PropertySet buffer;
+	ChildLHF::PropertySet child_buffer;
+
+	LHF &lhf() {
+		return l;
+	}
+
+	Index make(const std::vector<int64_t> &elements) {
+		buffer.clear();
+		for (std::size_t i = 0; i < elements.size();) {
+			long key = elements[i];
+			child_buffer.clear();
+			for (; i < elements.size() && elements[i] == key; i += 2) {
+				child_buffer.push_back(elements[i + 1]);
+			}
+			buffer.push_back({ key, { child.register_set<true>(child_buffer) } });
+		}
+		return l.register_set<true>(buffer);
+	}
+
+	/**
+	 * Builds a set of a live trace, whose elements are keys with a recorded
+	 * child index, mapped through `children`. Returns `false` if a child is
+	 * unknown.
+	 */
+	bool make_live(const std::vector<int64_t> &elements, const std::vector<uint64_t> &children, Index &out) {
+		buffer.clear();
+		for (std::size_t i = 0; i < elements.size(); i += 2) {
+			uint64_t c = static_cast<uint64_t>(elements[i + 1]);
+			if (c >= children.size() || children[c] == UNMAPPED) {
+				return false;
+			}
+			buffer.push_back({ elements[i], { ChildLHF::Index(children[c]) } });
+		}
+		out = l.register_set<true>(buffer);
+		return true;
+	}
+
+	ChildLHF::Index make_child(const std::vector<int64_t> &elements) {
+		child_buffer.clear();
+		for (int64_t e : elements) {
+			child_buffer.push_back(e);
+		}
+		return child.register_set<true>(child_buffer);
+	}
+
+	/// Keys with an empty child set carry no pairs, and are skipped.
+	void flatten(const Index &i, std::vector<int64_t> &out) {
+		out.clear();
+		for (auto &e : l.get_value(i)) {
+			for (auto &v : child.get_value(std::get<0>(e.get_value()))) {
+				out.push_back(e.get_key());
+				out.push_back(v.get_key());
+			}
+		}
+	}
+};
+
+struct OpTimes {
+	const char *name;
+	uint64_t total = 0;
+	std::vector<uint32_t> samples;
+
+	OpTimes(const char *name): name(name) {}
+
+	void add(uint64_t ticks) {
+		total += ticks;
+		samples.push_back(static_cast<uint32_t>(std::min<uint64_t>(ticks, UINT32_MAX)));
+	}
+
+	void print(double ticks_per_ns) {
+		if (samples.empty()) {
+			return;
+		}
+
+		auto percentile = [&](double p) {
+			std::size_t k = std::min(samples.size() - 1, std::size_t(p * samples.size()));
+			std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+			return samples[k] / ticks_per_ns;
+		};
+
+		printf("%-14s %12zu %12.3f %10.1f %10.1f %10.1f\n",
+			name,
+			samples.size(),
+			total / ticks_per_ns / 1e6,
+			total / ticks_per_ns / samples.size(),
+			percentile(0.5),
+			percentile(0.99));
+	}
+};
+
+template<typename Backend>
+static int replay(lhf::TraceReader &reader, bool verify) {
+	using Index = typename Backend::Index;
+
+	Backend backend;
+	auto &l = backend.lhf();
+
+	OpTimes times[4] = { { "register" }, { "union" }, { "intersection" }, { "difference" } };
+	const lhf::TraceHeader &h = reader.header();
+	times[0].samples.reserve(h.corpus_count + 2 * h.op_count);
+	for (int i = 1; i < 4; i++) {
+		times[i].samples.reserve(h.op_count);
+	}
+
+	std::vector<Index> corpus;
+	corpus.reserve(h.corpus_count);
+
+	std::vector<int64_t> got;
+	lhf::TraceReader::Record r;
+	uint64_t count = 0;
+
+	auto make = [&](const std::vector<int64_t> &elements) {
+		uint64_t t0 = lhf::probe_ticks();
+		Index ret = backend.make(elements);
+		times[0].add(lhf::probe_ticks() - t0);
+		return ret;
+	};
+
+	auto operand = [&](const lhf::TraceReader::Record::Operand &o) {
+		if (o.is_corpus) {
+			if (o.corpus_index >= corpus.size()) {
+				throw lhf::TraceFormatError("Corpus reference out of range");
+			}
+			return corpus[o.corpus_index];
+		}
+		return make(*o.elements);
+	};
+
+	while (reader.next(r)) {
+		switch (r.opcode) {
+		case lhf::TRACE_CORPUS_SET:
+			corpus.push_back(make(*r.a.elements));
+			continue;
+
+		case lhf::TRACE_CORPUS_DUPLICATE:
+			for (uint64_t i = r.start; i <= r.stop; i++) {
+				corpus.push_back(corpus.at(i));
+			}
+			continue;
+
+		default:
+			break;
+		}
+
+		Index a = operand(r.a);
+		Index b = operand(r.b);
+		Index result;
+
+		uint64_t t0 = lhf::probe_ticks();
+		switch (r.opcode) {
+		case lhf::TRACE_UNION: result = l.set_union(a, b); break;
+		case lhf::TRACE_INTERSECTION: result = l.set_intersection(a, b); break;
+		case lhf::TRACE_DIFFERENCE: result = l.set_difference(a, b); break;
+		}
+		uint64_t ticks = lhf::probe_ticks() - t0;
+		times[1 + r.opcode - lhf::TRACE_UNION].add(ticks);
+
+		if (verify && r.has_result) {
+			backend.flatten(result, got);
+			if (got != *r.result) {
+				std::cout << "Result mismatch at operation " << count << ": "
+				          << l.property_set_to_string(result) << std::endl;
+				return 1;
+			}
+		}
+
+		count++;
+	}
+
+	double ticks_per_ns = lhf::probe_ticks_per_ns();
+	uint64_t op_ticks = times[1].total + times[2].total + times[3].total;
+
+	printf("Replayed %lu operations, %zu sets\n", count, l.property_set_count());
+	printf("%-14s %12s %12s %10s %10s %10s\n", "Operation", "Count", "Total (ms)", "Mean (ns)", "p50 (ns)", "p99 (ns)");
+	for (OpTimes &t : times) {
+		t.print(ticks_per_ns);
+	}
+	printf("Operation time: %.3f ms\n", op_ticks / ticks_per_ns / 1e6);
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	std::cout << l.dump_perf();
+#endif
+
+	return 0;
+}
+
+/// The instances of a live trace that are replayed.
+struct LiveLayout {
+	int64_t root = -1;
+	int64_t child = -1;
+};
+
+/**
+ * Finds the instance to replay: an instance with a single child that has no
+ * children itself, or else the only instance.
+ */
+static LiveLayout scan_instances(const lhf::TraceFile &file) {
+	lhf::TraceReader reader(file.data(), file.size());
+	lhf::TraceReader::Record r;
+	std::vector<std::vector<uint64_t>> children;
+
+	while (reader.next(r)) {
+		if (r.opcode == lhf::TRACE_LIVE_INSTANCE) {
+			children.resize(std::max<std::size_t>(children.size(), r.instance + 1));
+			children[r.instance] = *r.children;
+		}
+	}
+
+	LiveLayout layout;
+	for (std::size_t i = 0; i < children.size(); i++) {
+		if (children[i].empty()) {
+			continue;
+		}
+		if (layout.root >= 0 || children[i].size() != 1 || !children.at(children[i][0]).empty()) {
+			throw lhf::TraceFormatError("Unsupported nesting structure in live trace");
+		}
+		layout.root = i;
+		layout.child = children[i][0];
+	}
+
+	if (layout.root < 0) {
+		if (children.size() != 1) {
+			throw lhf::TraceFormatError("Live trace with several unrelated instances");
+		}
+		layout.root = 0;
+	}
+
+	return layout;
+}
+
+template<typename Backend>
+static int replay_live(lhf::TraceReader &reader, LiveLayout layout, bool verify) {
+	Backend backend;
+
+	OpTimes times[4] = { { "register" }, { "union" }, { "intersection" }, { "difference" } };
+	for (OpTimes &t : times) {
+		t.samples.reserve(reader.header().op_count / 2);
+	}
+
+	// Recorded index -> replayed index, for the root and the child.
+	std::vector<uint64_t> maps[2] = { { 0 }, { 0 } };
+	uint64_t count = 0;
+	uint64_t unresolved = 0;
+	uint64_t mismatches = 0;
+
+	auto lookup = [](const std::vector<uint64_t> &map, uint64_t recorded) {
+		return recorded < map.size() ? map[recorded] : UNMAPPED;
+	};
+
+	auto assign = [&](std::vector<uint64_t> &map, uint64_t recorded, uint64_t value) {
+		if (recorded >= map.size()) {
+			map.resize(recorded + 1, UNMAPPED);
+		}
+		if (map[recorded] != UNMAPPED && map[recorded] != value) {
+			mismatches++;
+		}
+		map[recorded] = value;
+	};
+
+	// Replays a record on one LHF. `make` registers new sets, and returns
+	// `false` if the set refers to unknown children.
+	auto run = [&](auto &l, std::vector<uint64_t> &map, const lhf::TraceReader::Record &r, auto make) {
+		using Index = typename std::decay_t<decltype(l)>::Index;
+
+		if (r.opcode == lhf::TRACE_LIVE_REGISTER) {
+			Index result;
+			uint64_t known = lookup(map, r.index);
+			if (!r.has_result && known == UNMAPPED) {
+				unresolved++;
+				return;
+			}
+
+			uint64_t t0 = lhf::probe_ticks();
+			if (!r.has_result) {
+				result = l.template register_set<true>(l.get_value(Index(known)));
+			} else if (!make(*r.a.elements, result)) {
+				unresolved++;
+				return;
+			}
+			times[0].add(lhf::probe_ticks() - t0);
+			assign(map, r.index, result.value);
+			count++;
+			return;
+		}
+
+		uint64_t a = lookup(map, r.left);
+		uint64_t b = lookup(map, r.right);
+		if (a == UNMAPPED || b == UNMAPPED) {
+			unresolved++;
+			return;
+		}
+
+		Index result;
+		uint64_t t0 = lhf::probe_ticks();
+		switch (r.opcode) {
+		case lhf::TRACE_LIVE_UNION: result = l.set_union(Index(a), Index(b)); break;
+		case lhf::TRACE_LIVE_INTERSECTION: result = l.set_intersection(Index(a), Index(b)); break;
+		case lhf::TRACE_LIVE_DIFFERENCE: result = l.set_difference(Index(a), Index(b)); break;
+		}
+		times[1 + r.opcode - lhf::TRACE_LIVE_UNION].add(lhf::probe_ticks() - t0);
+		assign(map, r.index, result.value);
+		count++;
+	};
+
+	lhf::TraceReader::Record r;
+	while (reader.next(r)) {
+		if (r.opcode == lhf::TRACE_LIVE_INSTANCE) {
+			continue;
+		}
+
+		if (static_cast<int64_t>(r.instance) == layout.root) {
+			run(backend.lhf(), maps[0], r, [&](const std::vector<int64_t> &e, auto &out) {
+				if constexpr (std::is_same_v<Backend, NestedBackend>) {
+					return backend.make_live(e, maps[1], out);
+				} else {
+					out = backend.make(e);
+					return true;
+				}
+			});
+		} else if (static_cast<int64_t>(r.instance) == layout.child) {
+			if constexpr (std::is_same_v<Backend, NestedBackend>) {
+				run(backend.child, maps[1], r, [&](const std::vector<int64_t> &e, auto &out) {
+					out = backend.make_child(e);
+					return true;
+				});
+			}
+		} else {
+			throw lhf::TraceFormatError("Record of an instance that is not replayed");
+		}
+	}
+
+	double ticks_per_ns = lhf::probe_ticks_per_ns();
+	uint64_t op_ticks = times[1].total + times[2].total + times[3].total;
+
+	printf("Replayed %lu operations, %zu sets\n", count, backend.lhf().property_set_count());
+	if (unresolved) {
+		printf("Skipped %lu operations on unknown sets\n", unresolved);
+	}
+	printf("%-14s %12s %12s %10s %10s %10s\n", "Operation", "Count", "Total (ms)", "Mean (ns)", "p50 (ns)", "p99 (ns)");
+	for (OpTimes &t : times) {
+		t.print(ticks_per_ns);
+	}
+	printf("Operation time: %.3f ms\n", op_ticks / ticks_per_ns / 1e6);
+
+	if (verify && mismatches) {
+		printf("%lu recorded indices map to different sets\n", mismatches);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2 || (std::string(argv[1]) == "--generate" && argc < 3)) {
+		printf("Usage: %s <trace file | --generate spec> [--verify]\n", argv[0]);
+		return 1;
+	}
+
+	bool generated = std::string(argv[1]) == "--generate";
+	int verify_arg = generated ? 3 : 2;
+	bool verify = argc > verify_arg && std::string(argv[verify_arg]) == "--verify";
+	std::string source = generated ? argv[2] : argv[1];
+
+	try {
+		std::unique_ptr<lhf::TraceFile> file;
+		std::string buffer;
+		const void *data;
+		std::size_t size;
+
+		if (generated) {
+			auto start = std::chrono::steady_clock::now();
+			lhf::WorkloadConfig config = lhf::WorkloadConfig::parse(source);
+			std::stringstream out;
+			lhf::TraceWriter writer(out, config.arity);
+			lhf::WorkloadGenerator(config).generate(writer);
+			writer.finish();
+
+			buffer = out.str();
+			data = buffer.data();
+			size = buffer.size();
+			printf("Generated %zu bytes in %.3f ms\n", size,
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		} else {
+			file = std::make_unique<lhf::TraceFile>(source);
+			data = file->data();
+			size = file->size();
+		}
+
+		lhf::TraceReader reader(data, size);
+
+		// Calibrate the clock before timing anything.
+		lhf::probe_ticks_per_ns();
+
+		if (reader.is_live()) {
+			LiveLayout layout = scan_instances(*file);
+			if (layout.child >= 0) {
+				return replay_live<NestedBackend>(reader, layout, verify);
+			} else {
+				return replay_live<FlatBackend>(reader, layout, verify);
+			}
+		} else if (reader.header().arity == 1) {
+			return replay<FlatBackend>(reader, verify);
+		} else {
+			return replay<NestedBackend>(reader, verify);
+		}
+	} catch (const std::runtime_error &e) {
+		std::cout << source << ": " << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "lhf/workload.hpp"
+
+/**
+ * Generates the workloads of the `abstract` test series (see
+ * `lhf/workload.hpp`), as a drop-in replacement for their `benchmark.py`
+ * scripts: the options have the same names, and the default output is the
+ * same text format. With `--trace`, a binary trace is written instead, which
+ * can be replayed by `trace_replay` and `trace_compare` without conversion.
+ *
+ * Generation uses all hardware threads unless `--threads` says otherwise. The
+ * output only depends on the options and `--seed`.
+ */
+
+static void usage(const char *name) {
+	printf(
+		"Usage: %s <random | closed_world> <output file | -> [--trace] [--pairs]\n"
+		"       [--count n] [--maxsize n] [--maxval n] [--corpussize n]\n"
+		"       [--dist uniform | normal | optimistic] [--seed n] [--threads n]\n"
+		"       [--no-results]\n",
+		name);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::string path = argv[2];
+	bool trace = false;
+
+	try {
+		lhf::WorkloadConfig config;
+		config.set("kind", argv[1]);
+
+		for (int i = 3; i < argc; i++) {
+			std::string opt = argv[i];
+			if (opt == "--trace") {
+				trace = true;
+			} else if (opt == "--pairs") {
+				config.arity = 2;
+			} else if (opt == "--no-results") {
+				config.results = false;
+			} else if (opt.rfind("--", 0) == 0 && i + 1 < argc && config.set(opt.substr(2), argv[i + 1])) {
+				i++;
+			} else {
+				printf("Unknown option: %s\n", argv[i]);
+				usage(argv[0]);
+				return 1;
+			}
+		}
+
+		if (trace && path == "-") {
+			printf("Binary traces must be written to a file\n");
+			return 1;
+		}
+
+		std::ofstream file;
+		if (path != "-") {
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				printf("Could not open output file: %s\n", path.c_str());
+				return 1;
+			}
+		}
+		std::ostream &out = path == "-" ? std::cout : file;
+
+		lhf::WorkloadGenerator generator(config);
+		auto start = std::chrono::steady_clock::now();
+
+		if (trace) {
+			lhf::TraceWriter writer(out, config.arity);
+			generator.generate(writer);
+			writer.finish();
+		} else {
+			lhf::WorkloadTextWriter writer(out, config);
+			generator.generate(writer);
+			writer.finish();
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cerr << "@@@@ Generation Time: " << ms << " ms" << std::endl;
+	} catch (const std::runtime_error &e) {
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
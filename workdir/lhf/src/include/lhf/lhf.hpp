@@ -7,6 +7,8 @@
 #define LHF_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -19,11 +21,16 @@
 #include <set>
 #include <unordered_set>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
 #include <algorithm>
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <type_traits>
 
 #ifdef LHF_ENABLE_PARALLEL
-#include <atomic>
 #include <mutex>
 #include <shared_mutex>
 #endif
@@ -37,6 +44,10 @@
 #include "lhf_config.hpp"
 #include "profiling.hpp"
 
+#ifdef LHF_ENABLE_TRACE_RECORDING
+#include "trace.hpp"
+#endif
+
 namespace lhf {
 
 #ifdef LHF_ENABLE_DEBUG
@@ -53,13 +64,94 @@ using String = std::string;
 
 using RWMutex = std::shared_mutex;
 
-using ReadLock = std::shared_lock<RWMutex>;
+/**
+ * @brief      Number of lock acquisitions that found the lock held and had to
+ *             wait, across all instances. Only the slow path is counted, so
+ *             uncontended locking costs the same as a plain lock.
+ */
+struct LockContention {
+	/// Shared (reader) acquisitions that waited.
+	Size shared_waits = 0;
+
+	/// Exclusive (writer) acquisitions that waited.
+	Size exclusive_waits = 0;
+};
+
+/// Backing counters of `lock_contention`.
+inline std::atomic<Size> lock_shared_waits = 0;
+inline std::atomic<Size> lock_exclusive_waits = 0;
+
+/**
+ * @brief      Returns the lock contention counters accumulated since the
+ *             start of the program or the last call to
+ *             `reset_lock_contention`.
+ */
+inline LockContention lock_contention() {
+	return {
+		lock_shared_waits.load(std::memory_order_relaxed),
+		lock_exclusive_waits.load(std::memory_order_relaxed)
+	};
+}
+
+/**
+ * @brief      Resets the lock contention counters.
+ */
+inline void reset_lock_contention() {
+	lock_shared_waits.store(0, std::memory_order_relaxed);
+	lock_exclusive_waits.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief      Scoped shared lock that counts contended acquisitions.
+ */
+class ReadLock {
+	RWMutex &mutex;
+
+public:
+	explicit ReadLock(RWMutex &mutex): mutex(mutex) {
+		if (!mutex.try_lock_shared()) {
+			lock_shared_waits.fetch_add(1, std::memory_order_relaxed);
+			mutex.lock_shared();
+		}
+	}
+
+	ReadLock(const ReadLock &) = delete;
+	ReadLock &operator=(const ReadLock &) = delete;
+
+	~ReadLock() {
+		mutex.unlock_shared();
+	}
+};
+
+/**
+ * @brief      Scoped exclusive lock that counts contended acquisitions.
+ */
+class WriteLock {
+	RWMutex &mutex;
+
+public:
+	explicit WriteLock(RWMutex &mutex): mutex(mutex) {
+		if (!mutex.try_lock()) {
+			lock_exclusive_waits.fetch_add(1, std::memory_order_relaxed);
+			mutex.lock();
+		}
+	}
+
+	WriteLock(const WriteLock &) = delete;
+	WriteLock &operator=(const WriteLock &) = delete;
 
-using WriteLock = std::lock_guard<RWMutex>;
+	~WriteLock() {
+		mutex.unlock();
+	}
+};
 
 #endif
 
-using IndexValue = Size;
+using IndexValue = LHF_INDEX_VALUE_TYPE;
+
+static_assert(
+	std::is_unsigned_v<IndexValue>,
+	"LHF_INDEX_VALUE_TYPE must be an unsigned integer type.");
 
 template<typename T>
 using UniquePointer = std::unique_ptr<T>;
@@ -105,6 +197,15 @@ struct AbsentValueAccessError : public std::invalid_argument {
 		std::invalid_argument(message.c_str()) {}
 };
 
+/**
+ * @brief      Thrown if more property sets are registered than `IndexValue`
+ *             can address.
+ */
+struct IndexOverflowError : public std::overflow_error {
+	IndexOverflowError(const std::string &message):
+		std::overflow_error(message.c_str()) {}
+};
+
 /**
  * @brief      Describes an optional reference of some type T. The value may
  *             either be present or absent.
@@ -191,7 +292,26 @@ enum SubsetRelation {
 
 // The index of the empty set. The first set that will ever be inserted
 // in the property set value storage is the empty set.
-static const constexpr Size EMPTY_SET_VALUE = 0;
+static const constexpr IndexValue EMPTY_SET_VALUE = 0;
+
+/**
+ * @brief      Converts a storage position to an index value. Throws if the
+ *             position is not representable, which can only happen if
+ *             `IndexValue` is narrower than `Size`.
+ *
+ * @param[in]  pos   The position
+ *
+ * @return     The index value.
+ */
+inline IndexValue to_index_value(Size pos) {
+	if constexpr (sizeof(IndexValue) < sizeof(Size)) {
+		if (pos > std::numeric_limits<IndexValue>::max()) {
+			throw IndexOverflowError(
+				"Number of registered sets exceeds the range of IndexValue.");
+		}
+	}
+	return static_cast<IndexValue>(pos);
+}
 
 /**
  * @brief      Composes a preexisting hash with another variable. Useful for
@@ -210,6 +330,115 @@ inline Size compose_hash(const Size prev, T next) {
 	return prev ^ (Hash()(next) + 0x9e3779b9 + (prev << 6) + (prev >> 2));
 }
 
+/**
+ * @brief      Multiplies two 64-bit values and folds the 128-bit product into
+ *             64 bits.
+ */
+inline std::uint64_t __hash_mix(std::uint64_t a, std::uint64_t b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t r = static_cast<__uint128_t>(a) * b;
+	return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+	std::uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffff, lb = b & 0xffffffff;
+	std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+	std::uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t __hash_read64(const unsigned char *p) {
+	std::uint64_t v;
+	std::memcpy(&v, p, 8);
+	return v;
+}
+
+inline std::uint64_t __hash_read32(const unsigned char *p) {
+	std::uint32_t v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+/**
+ * @brief      Hashes a block of raw bytes. Adapted from wyhash (public
+ *             domain). Inputs longer than 48 bytes are consumed in three
+ *             independent lanes so that the multiplies can overlap.
+ *
+ * @param[in]  data  Pointer to the bytes
+ * @param[in]  len   Number of bytes
+ * @param[in]  seed  Seed value
+ *
+ * @return     The hash
+ */
+inline Size hash_bytes(const void *data, Size len, std::uint64_t seed = 0) {
+	constexpr std::uint64_t s0 = 0xa0761d6478bd642full;
+	constexpr std::uint64_t s1 = 0xe7037ed1a0b428dbull;
+	constexpr std::uint64_t s2 = 0x8ebc6af09c88c6e3ull;
+	constexpr std::uint64_t s3 = 0x589965cc75374cc3ull;
+
+	const unsigned char *p = static_cast<const unsigned char *>(data);
+	std::uint64_t a = 0, b = 0;
+	seed ^= __hash_mix(seed ^ s0, s1);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			Size off = (len >> 3) << 2;
+			a = (__hash_read32(p) << 32) | __hash_read32(p + off);
+			b = (__hash_read32(p + len - 4) << 32) | __hash_read32(p + len - 4 - off);
+		} else if (len > 0) {
+			a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[len >> 1]) << 8) | p[len - 1];
+		}
+	} else {
+		Size i = len;
+		if (i > 48) {
+			std::uint64_t seed1 = seed, seed2 = seed;
+			do {
+				seed = __hash_mix(__hash_read64(p) ^ s1, __hash_read64(p + 8) ^ seed);
+				seed1 = __hash_mix(__hash_read64(p + 16) ^ s2, __hash_read64(p + 24) ^ seed1);
+				seed2 = __hash_mix(__hash_read64(p + 32) ^ s3, __hash_read64(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+
+		while (i > 16) {
+			seed = __hash_mix(__hash_read64(p) ^ s1, __hash_read64(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+
+		a = __hash_read64(p + i - 16);
+		b = __hash_read64(p + i - 8);
+	}
+
+	return static_cast<Size>(__hash_mix(s1 ^ len, __hash_mix(a ^ s1, b ^ seed)));
+}
+
+/**
+ * @brief      Tells whether an element type can be hashed and compared by its
+ *             raw bytes. Element types opt in by defining a `static constexpr
+ *             bool is_bytewise` member.
+ */
+template<typename ElementT, typename = void>
+struct is_bytewise_element : std::false_type {};
+
+template<typename ElementT>
+struct is_bytewise_element<ElementT, std::void_t<decltype(ElementT::is_bytewise)>> :
+	std::bool_constant<ElementT::is_bytewise && std::is_trivially_copyable_v<ElementT>> {};
+
+/**
+ * @brief      Whether `SetT` is a contiguous container of bytewise elements,
+ *             in which case whole sets may be hashed, compared and copied as
+ *             memory blocks.
+ */
+template<typename SetT, typename ElementT>
+constexpr bool is_bytewise_set_v =
+	is_bytewise_element<ElementT>::value &&
+	std::is_same_v<SetT, std::vector<ElementT>>;
+
 /**
  * @brief      This struct contains the information about the operands of an
  *             operation (union, intersection, etc.)
@@ -237,16 +466,132 @@ inline std::ostream &operator<<(std::ostream &os, const OperationNode &op) {
 	return os << op.to_string();
 }
 
+/**
+ * @brief      The operands of an operation that involves another LHF
+ *             instance (such as a transform into a target LHF). The other
+ *             instance is part of the key, so results computed against one
+ *             instance are never returned for another.
+ */
+struct ForeignOperationNode {
+	/// `instance_id()` of the other LHF.
+	IndexValue instance;
+	IndexValue left;
+	IndexValue right;
+	/// Additional operation-specific key (such as the state of a transform).
+	std::uint64_t tag;
+
+	std::string to_string() const {
+		std::stringstream s;
+		s << "(#" << instance << ":" << left << "," << right << "," << tag << ")";
+		return s.str();
+	}
+
+	bool operator==(const ForeignOperationNode &op) const {
+		return (instance == op.instance) && (left == op.left) &&
+		       (right == op.right) && (tag == op.tag);
+	}
+};
+
+inline std::ostream &operator<<(std::ostream &os, const ForeignOperationNode &op) {
+	return os << op.to_string();
+}
+
+/**
+ * @brief      Generates the next unique LHF instance identifier.
+ *
+ * @return     A process-wide unique value.
+ */
+inline IndexValue __next_instance_id() {
+	static std::atomic<IndexValue> counter{0};
+	return counter++;
+}
+
+/**
+ * @brief      Generates the next unique transform identifier. Do not call this
+ *             directly, use `transform_id` instead.
+ *
+ * @return     A process-wide unique value.
+ */
+inline IndexValue __next_transform_id() {
+	static std::atomic<IndexValue> counter{0};
+	return counter++;
+}
+
+/**
+ * @brief      Returns a process-wide unique identifier for the transform
+ *             functor type `Transform`. This is used to key the results of
+ *             `set_transform` in the operation cache.
+ *
+ * @tparam     Transform  The transform functor type.
+ *
+ * @return     The identifier.
+ */
+template<typename Transform>
+inline IndexValue transform_id() {
+	static const IndexValue id = __next_transform_id();
+	return id;
+}
+
+/**
+ * @brief      Tells whether the transform functor type `Transform` provides
+ *             `state_key()`, which identifies the state of an instance.
+ */
+template<typename Transform, typename = void>
+struct has_transform_state_key : std::false_type {};
+
+template<typename Transform>
+struct has_transform_state_key<
+	Transform,
+	std::void_t<decltype(std::uint64_t(std::declval<const Transform &>().state_key()))>> :
+	std::true_type {};
+
+/**
+ * @brief      Returns the part of the `set_transform` cache key that
+ *             identifies the state of `fn`: zero for stateless functors, or
+ *             `fn.state_key()`.
+ */
+template<typename Transform>
+inline std::uint64_t transform_state_key(const Transform &fn) {
+	static_assert(std::is_empty_v<Transform> || has_transform_state_key<Transform>::value,
+		"A transform with state must provide `std::uint64_t state_key() const`, "
+		"which must differ between instances that map elements differently");
+
+	if constexpr (has_transform_state_key<Transform>::value) {
+		return fn.state_key();
+	} else {
+		(void) fn;
+		return 0;
+	}
+}
+
 };
 
 /************************** START GLOBAL NAMESPACE ****************************/
 
+/**
+ * Operand indices are small, dense integers, so a plain combination like
+ * `left ^ (right << 1)` maps most pairs of nearby sets onto a few buckets.
+ * Both halves are mixed with a full-width multiply instead.
+ */
 template <>
 struct std::hash<lhf::OperationNode> {
 	lhf::Size operator()(const lhf::OperationNode& k) const {
-		return
-			std::hash<lhf::IndexValue>()(k.left) ^
-			(std::hash<lhf::IndexValue>()(k.right) << 1);
+		return static_cast<lhf::Size>(lhf::__hash_mix(
+			static_cast<std::uint64_t>(k.left) ^ 0xa0761d6478bd642full,
+			static_cast<std::uint64_t>(k.right) ^ 0xe7037ed1a0b428dbull));
+	}
+};
+
+template <>
+struct std::hash<lhf::ForeignOperationNode> {
+	lhf::Size operator()(const lhf::ForeignOperationNode& k) const {
+		return static_cast<lhf::Size>(lhf::__hash_mix(
+			lhf::__hash_mix(
+				static_cast<std::uint64_t>(k.instance) ^ 0xa0761d6478bd642full,
+				k.tag ^ 0x8ebc6af09c88c6e3ull),
+			lhf::__hash_mix(
+				static_cast<std::uint64_t>(k.left) ^ 0xe7037ed1a0b428dbull,
+				static_cast<std::uint64_t>(k.right) ^ 0x589965cc75374cc3ull)));
 	}
 };
 
@@ -254,6 +599,14 @@ struct std::hash<lhf::OperationNode> {
 
 namespace lhf {
 
+/**
+ * @brief      Tells whether a set type uses the structure-of-arrays layout
+ *             (see `SoAPropertySet`). Such sets provide their own hashing and
+ *             equality over whole columns.
+ */
+template<typename SetT>
+struct is_soa_property_set : std::false_type {};
+
 /**
  * @brief      Generic Less-than comparator for set types.
  *
@@ -303,6 +656,12 @@ template<
 	typename ElementHash = DefaultHash<ElementT>>
 struct SetHash {
 	Size operator()(const SetT *k) const {
+		if constexpr (is_bytewise_set_v<SetT, ElementT>) {
+			return hash_bytes(k->data(), k->size() * sizeof(ElementT));
+		} else if constexpr (is_soa_property_set<SetT>::value) {
+			return k->hash();
+		}
+
 		// Adapted from boost::hash_combine
 		size_t hash_value = 0;
 		for (const auto &value : *k) {
@@ -336,6 +695,12 @@ struct SetEqual {
 			return true;
 		}
 
+		if constexpr (is_bytewise_set_v<SetT, ElementT>) {
+			return std::memcmp(a->data(), b->data(), a->size() * sizeof(ElementT)) == 0;
+		} else if constexpr (is_soa_property_set<SetT>::value) {
+			return a->full_equal(*b);
+		}
+
 		auto cursor_1 = a->begin();
 		const auto &cursor_end_1 = a->end();
 		auto cursor_2 = b->begin();
@@ -413,10 +778,12 @@ static inline void verify_property_set_integrity(const PropertySetT &cont) {
 	std::unordered_set<
 		PropertyElementT,
 		typename PropertyElementT::Hash> k;
-	const PropertyElementT *prev_val = nullptr;
+	auto prev = cont.begin();
 
-	for (const PropertyElementT &val : cont) {
-		if (prev_val && !(*prev_val < val)) {
+	for (auto cursor = cont.begin(); cursor != cont.end(); cursor++) {
+		const PropertyElementT &val = *cursor;
+
+		if (cursor != cont.begin() && !(*prev < val)) {
 			throw AssertError("Supplied property set is not sorted.");
 		}
 
@@ -426,7 +793,7 @@ static inline void verify_property_set_integrity(const PropertySetT &cont) {
 			k.insert(val);
 		}
 
-		prev_val = &val;
+		prev = cursor;
 	}
 }
 
@@ -525,7 +892,33 @@ static inline void verify_property_set_integrity(const PropertySetT &cont) {
  * @param      __end   The end of the range (e.g. input.end())
  *
  */
-#define LHF_PUSH_RANGE(__cont, __start, __end) (__cont).insert((__cont).end(), (__start), (__end))
+#define LHF_PUSH_RANGE(__cont, __start, __end) push_range((__cont), (__start), (__end))
+
+/**
+ * @brief      Appends the range [start, end) to a PropertySet. Ranges of
+ *             bytewise elements taken from another PropertySet are copied as a
+ *             single memory block.
+ *
+ * @param      cont   The container object
+ * @param[in]  start  The start of the range
+ * @param[in]  end    The end of the range
+ */
+template<typename SetT, typename Iterator>
+inline void push_range(SetT &cont, Iterator start, Iterator end) {
+	using ElementT = typename SetT::value_type;
+	if constexpr (
+		is_bytewise_set_v<SetT, ElementT> &&
+		(std::is_same_v<Iterator, typename SetT::iterator> ||
+		 std::is_same_v<Iterator, typename SetT::const_iterator>)) {
+		if (start == end) {
+			return;
+		}
+		const ElementT *first = &*start;
+		cont.insert(cont.end(), first, first + (end - start));
+	} else {
+		cont.insert(cont.end(), start, end);
+	}
+}
 
 
 /**
@@ -537,6 +930,58 @@ static inline void verify_property_set_integrity(const PropertySetT &cont) {
  */
 #define LHF_REGISTER_SET_INTERNAL(__set, __cold) register_set<LHF_DISABLE_INTERNAL_INTEGRITY_CHECK>((__set), (__cold))
 
+/**
+ * @def LHF_TRACE_REGISTER(__cold, __call)
+ * @brief      Records a set registration if a trace recorder is attached and
+ *             this is not a call nested in another LHF call. `__call` is the
+ *             overload of the registration that reports cold misses in
+ *             `__cold`; it is re-entered with the nesting guard set.
+ *             `__trace_cold` can be passed as `__cold` by overloads that do
+ *             not report cold misses.
+ *
+ * @note       Conditionally enabled if `LHF_ENABLE_TRACE_RECORDING` is set.
+ *
+ * @param      __cold  The cold miss flag
+ * @param      __call  The registration call
+ */
+
+/**
+ * @def LHF_TRACE_OPERATION(__opcode, __op_name, __a, __b)
+ * @brief      Records a binary operation if a trace recorder is attached and
+ *             this is not a call nested in another LHF call. The operation is
+ *             re-entered with the nesting guard set.
+ *
+ * @note       Conditionally enabled if `LHF_ENABLE_TRACE_RECORDING` is set.
+ *
+ * @param      __opcode   The trace opcode (e.g. `TRACE_LIVE_UNION`)
+ * @param      __op_name  The operation (e.g. `set_union`)
+ * @param      __a        LHS argument of the operation
+ * @param      __b        RHS argument of the operation
+ */
+
+#ifdef LHF_ENABLE_TRACE_RECORDING
+#define LHF_TRACE_REGISTER(__cold, __call) \
+	if (trace_recorder && TraceCallGuard::is_outermost()) { \
+		TraceCallGuard __trace_guard; \
+		[[maybe_unused]] bool __trace_cold = false; \
+		Index __trace_ret = __call; \
+		trace_register(__trace_ret, (__cold)); \
+		return __trace_ret; \
+	}
+
+#define LHF_TRACE_OPERATION(__opcode, __op_name, __a, __b) \
+	if (trace_recorder && TraceCallGuard::is_outermost()) { \
+		TraceCallGuard __trace_guard; \
+		Index __trace_ret = __op_name((__a), (__b)); \
+		trace_recorder->record_operation( \
+			(__opcode), trace_instance, (__a).value, (__b).value, __trace_ret.value); \
+		return __trace_ret; \
+	}
+#else
+#define LHF_TRACE_REGISTER(__cold, __call)
+#define LHF_TRACE_OPERATION(__opcode, __op_name, __a, __b)
+#endif
+
 /**
  * @brief      The nesting type for non-nested data structures. Act as "leaf"
  *             nodes in a tree of nested LHFs.
@@ -551,6 +996,10 @@ struct NestingNone {
 	/// Compile-time value that says there are no nested children.
 	static constexpr Size num_children = 0;
 
+	/// Compile-time value that says property sets are stored as arrays of
+	/// elements.
+	static constexpr bool soa_layout = false;
+
 	/// Placeholder value to mark the reference lists and value lists as empty.
 	struct Empty {
 		Empty() {}
@@ -584,6 +1033,14 @@ struct NestingNone {
 		/// Value type is made available here if required by user.
 		using InterfaceValueType = PropertyT;
 
+		/// Compile-time value that says whether sets of this element may be
+		/// hashed and compared by their raw bytes. This holds for types like
+		/// integers and pointers with the default hasher and comparator.
+		static constexpr bool is_bytewise =
+			std::has_unique_object_representations_v<PropertyT> &&
+			std::is_same_v<PropertyHash, DefaultHash<PropertyT>> &&
+			std::is_same_v<PropertyEqual, DefaultEqual<PropertyT>>;
+
 	protected:
 		PropertyT value;
 
@@ -660,6 +1117,97 @@ struct NestingNone {
 
 };
 
+/**
+ * @brief      Memory held by an LHF instance, broken down by structure. Sizes
+ *             are computed from container capacities and node layouts, so
+ *             they exclude allocator bookkeeping and any heap memory owned
+ *             by the property elements themselves.
+ */
+struct MemoryUsage {
+	/**
+	 * @brief      Memory held by a hash map.
+	 */
+	struct MapUsage {
+		Size entries = 0;
+
+		/// Bytes of the bucket array.
+		Size bucket_bytes = 0;
+
+		/// Bytes of the nodes holding the entries.
+		Size node_bytes = 0;
+
+		Size bytes() const {
+			return bucket_bytes + node_bytes;
+		}
+	};
+
+	/// Number of property sets in the storage array, including evicted ones.
+	Size property_sets = 0;
+
+	/// Bytes of the resident property sets and their element buffers.
+	Size payload_bytes = 0;
+
+	/// Bytes of the storage array of property set holders.
+	Size holder_bytes = 0;
+
+	/// The property set -> index map.
+	MapUsage property_set_map;
+
+	/// Operation caches and the subset relation map, by name.
+	OrderedMap<String, MapUsage> operation_maps;
+
+	/// Usage of the nested child LHFs, in template argument order. A child
+	/// shared by several parents is reported under each of them.
+	Vector<MemoryUsage> children;
+
+	/// Bytes held by this instance, excluding children.
+	Size own_bytes() const {
+		Size ret = payload_bytes + holder_bytes + property_set_map.bytes();
+		for (auto &m : operation_maps) {
+			ret += m.second.bytes();
+		}
+		return ret;
+	}
+
+	/// Bytes held by this instance and all of its descendants.
+	Size total_bytes() const {
+		Size ret = own_bytes();
+		for (auto &c : children) {
+			ret += c.total_bytes();
+		}
+		return ret;
+	}
+
+	String to_string(Size indent = 0) const {
+		std::stringstream s;
+		String pad(indent, ' ');
+
+		auto map_line = [&](const String &name, const MapUsage &m) {
+			s << pad << "    " << name << ": " << m.bytes() << " bytes"
+			  << " (entries: " << m.entries
+			  << ", buckets: " << m.bucket_bytes
+			  << ", nodes: " << m.node_bytes << ")\n";
+		};
+
+		s << pad << "Memory usage: " << total_bytes() << " bytes"
+		  << " (own: " << own_bytes() << ")\n";
+		s << pad << "    Property sets: " << payload_bytes << " bytes"
+		  << " (count: " << property_sets << ")\n";
+		s << pad << "    Holders: " << holder_bytes << " bytes\n";
+		map_line("Property set map", property_set_map);
+		for (auto &m : operation_maps) {
+			map_line(m.first, m.second);
+		}
+
+		for (Size i = 0; i < children.size(); i++) {
+			s << pad << "    Child " << i << ":\n";
+			s << children[i].to_string(indent + 8);
+		}
+
+		return s.str();
+	}
+};
+
 /**
  * @def        MapAdapter
  * @brief      Enables the interface used by LHF for using a map data structure
@@ -702,6 +1250,28 @@ public:
 		return data.size();
 	}
 
+	Size bucket_count() const {
+		return data.bucket_count();
+	}
+
+	/**
+	 * @brief      Memory held by the map. A bucket holds a lock and a list
+	 *             head, and a node additionally holds a lock and a link.
+	 */
+	MemoryUsage::MapUsage memory_usage() const {
+		struct Node {
+			void *next;
+			void *mutex;
+			KeyValuePair value;
+		};
+
+		MemoryUsage::MapUsage ret;
+		ret.entries = data.size();
+		ret.bucket_bytes = data.bucket_count() * 2 * sizeof(void *);
+		ret.node_bytes = ret.entries * sizeof(Node);
+		return ret;
+	}
+
 	typename Map::const_iterator begin() const {
 		return data.begin();
 	}
@@ -757,6 +1327,31 @@ public:
 		return data.size();
 	}
 
+	Size bucket_count() const {
+		LHF_PARALLEL(ReadLock m(mutex);)
+		return data.bucket_count();
+	}
+
+	/**
+	 * @brief      Memory held by the map. Nodes are assumed to hold a link,
+	 *             the cached hash and the entry, as the common standard
+	 *             library implementations do for non-trivial hashers.
+	 */
+	MemoryUsage::MapUsage memory_usage() const {
+		LHF_PARALLEL(ReadLock m(mutex);)
+		struct Node {
+			void *next;
+			Size hash;
+			KeyValuePair value;
+		};
+
+		MemoryUsage::MapUsage ret;
+		ret.entries = data.size();
+		ret.bucket_bytes = data.bucket_count() * sizeof(void *);
+		ret.node_bytes = ret.entries * sizeof(Node);
+		return ret;
+	}
+
 	typename Map::const_iterator begin() const {
 		return data.begin();
 	}
@@ -854,6 +1449,10 @@ struct NestingBase {
 	/// are equal to the number of parameters in the template parameter pack.
 	static constexpr Size num_children = sizeof...(ChildT);
 
+	/// Compile-time value that says property sets are stored as arrays of
+	/// elements.
+	static constexpr bool soa_layout = false;
+
 	/// Reference list. References to all the nested LHFs are presented here.
 	using LHFReferenceList = std::tuple<ChildT&...>;
 
@@ -888,6 +1487,8 @@ struct NestingBase {
 		ChildValueList value;
 
 	public:
+		PropertyElement(): key(), value() {}
+
 		PropertyElement(
 			const PropertyT &key,
 			const ChildValueList &value):
@@ -1015,69 +1616,441 @@ struct NestingBase {
 };
 
 /**
- * @brief      Operation performance Statistics.
+ * @brief      Nesting behaviour identical to `NestingBase`, except that
+ *             property sets are stored in the structure-of-arrays layout
+ *             provided by `SoAPropertySet`.
+ *
+ * @tparam     PropertyT  The key property that the LHF acts upon.
+ * @tparam     ChildT     the children of the property that are nested.
  */
-struct OperationPerf {
-	/// Number of direct hits (operation pair in map)
-	size_t hits = 0;
-
-	/// Number of equal hits (both arguments consist of the same set)
-	size_t equal_hits = 0;
-
-	/// Number of subset hits (operation pair not in but resolvable using
-	/// subset relation)
-	size_t subset_hits = 0;
-
-	/// Number of empty hits (operation is optimised because at least one of
-	/// the sets is empty)
-	size_t empty_hits = 0;
-
-	/// Number of cold misses (operation pair not in map, and neither
-	/// resultant set in map. Neither node in lattice exists, nor the edges)
-	size_t cold_misses = 0;
+template<typename PropertyT, typename ...ChildT>
+struct NestingSoA : public NestingBase<PropertyT, ChildT...> {
+	/// Compile-time value that says property sets are stored as one key array
+	/// and one index array per child.
+	static constexpr bool soa_layout = true;
+};
 
-	/// Number of edge misses (operation pair not in map, but resultant set
-	/// in map. Node in lattice exists, but not the edges)
-	size_t edge_misses = 0;
+/**
+ * @brief      Buffers of child elements, one per nested child LHF, that a
+ *             `Transient` collects for an element before registering them.
+ *             Empty for LHFs that are not nested.
+ *
+ * @tparam     RefList  The reference list of the nesting behaviour.
+ */
+template<typename RefList>
+struct TransientChildBuffers {
+	using type = std::tuple<>;
+};
 
-	String to_string() const {
-		std::stringstream s;
-		s << "      " << "Hits       : " << hits << "\n"
-		  << "      " << "Equal Hits : " << equal_hits << "\n"
-		  << "      " << "Subset Hits: " << subset_hits << "\n"
-		  << "      " << "Empty Hits : " << empty_hits << "\n"
-		  << "      " << "Cold Misses: " << cold_misses << "\n"
-		  << "      " << "Edge Misses: " << edge_misses << "\n";
-		return s.str();
-	}
+template<typename ...ChildT>
+struct TransientChildBuffers<std::tuple<ChildT &...>> {
+	using type = std::tuple<Vector<typename ChildT::PropertyElement>...>;
 };
 
 /**
- * @def        LHF_PERF_INC(__oper, __category)
- * @brief      Increments the invocation count of the given category and operator.
+ * @brief      Structure-of-arrays storage for nested property sets. Keys are
+ *             kept in one contiguous array and each child index in an array of
+ *             its own, so merges that only compare keys do not pull the child
+ *             indices through the cache. Hashing and equality work on whole
+ *             arrays at a time.
  *
- * @note       Conditionally enabled if `LHF_ENABLE_PERFORMANCE_METRICS` is set.
+ *             Only the part of the `std::vector` interface used by LHF is
+ *             provided. Elements are reconstructed on access, so iterators and
+ *             `operator[]` return `PropertyElement` by value, and insertion is
+ *             only supported at the end.
  *
- * @param      __oper      The operator (e.g. `unions`)
- * @param      __category  The category (e.g. `hits`)
+ * @tparam     ElementT        The property element type.
+ * @tparam     KeyT            The key type.
+ * @tparam     ChildValueList  Tuple of child index types.
+ * @tparam     KeyHash         Hasher for keys.
+ * @tparam     KeyEqual        Equality comparator for keys.
  */
+template<
+	typename ElementT,
+	typename KeyT,
+	typename ChildValueList,
+	typename KeyHash,
+	typename KeyEqual>
+class SoAPropertySet;
 
-#ifdef LHF_ENABLE_PERFORMANCE_METRICS
-#define LHF_PERF_INC(__oper, __category) (perf[__LHF_STR(__oper)] . __category ++)
-#else
-#define LHF_PERF_INC(__oper, __category)
-#endif
+template<
+	typename ElementT,
+	typename KeyT,
+	typename... ChildIndexT,
+	typename KeyHash,
+	typename KeyEqual>
+class SoAPropertySet<ElementT, KeyT, std::tuple<ChildIndexT...>, KeyHash, KeyEqual> {
+public:
+	using value_type = ElementT;
+	using size_type = Size;
+	using ChildValueList = std::tuple<ChildIndexT...>;
 
+	/// Whether the key array can be hashed and compared as raw bytes.
+	static constexpr bool is_key_bytewise =
+		std::has_unique_object_representations_v<KeyT> &&
+		std::is_same_v<KeyHash, DefaultHash<KeyT>> &&
+		std::is_same_v<KeyEqual, DefaultEqual<KeyT>>;
 
-/**
- * @brief      The main LatticeHashForest structure.
- *             This class can be used as-is with a type or derived for
- *             additional functionality as needed
- *
- *
- * @tparam     PropertyT      The type of the property.
- *                            The property type must satisfy the following:
- *                            * It must be hashable with std::hash
+	static_assert(
+		(std::has_unique_object_representations_v<ChildIndexT> && ...),
+		"Child indices must be comparable as raw bytes.");
+
+protected:
+	using Sequence = std::index_sequence_for<ChildIndexT...>;
+
+	Vector<KeyT> keys;
+	std::tuple<Vector<ChildIndexT>...> children;
+
+	template<Size... I>
+	ChildValueList gather(Size pos, std::index_sequence<I...>) const {
+		return ChildValueList(std::get<I>(children)[pos]...);
+	}
+
+	template<Size... I>
+	void push_children(const ChildValueList &value, std::index_sequence<I...>) {
+		(std::get<I>(children).push_back(std::get<I>(value)), ...);
+	}
+
+	template<Size... I>
+	void append_children(
+		const SoAPropertySet &src,
+		Size begin,
+		Size end,
+		std::index_sequence<I...>) {
+		(std::get<I>(children).insert(
+			std::get<I>(children).end(),
+			std::get<I>(src.children).begin() + begin,
+			std::get<I>(src.children).begin() + end), ...);
+	}
+
+public:
+	/**
+	 * @brief      Random access iterator that reconstructs elements on
+	 *             dereference. `key()` reads only the key array.
+	 */
+	class const_iterator {
+		const SoAPropertySet *set = nullptr;
+		Size pos = 0;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = ElementT;
+		using difference_type = std::ptrdiff_t;
+		using reference = ElementT;
+
+		/// Holds a reconstructed element so that `->` can be used on it.
+		struct pointer {
+			ElementT element;
+
+			const ElementT *operator->() const {
+				return &element;
+			}
+		};
+
+		const_iterator() {}
+
+		const_iterator(const SoAPropertySet *set, Size pos): set(set), pos(pos) {}
+
+		ElementT operator*() const {
+			return (*set)[pos];
+		}
+
+		pointer operator->() const {
+			return pointer{(*set)[pos]};
+		}
+
+		ElementT operator[](difference_type n) const {
+			return (*set)[pos + n];
+		}
+
+		/// Gets the key of the current element without reading the children.
+		const KeyT &key() const {
+			return set->keys[pos];
+		}
+
+		const SoAPropertySet &owner() const {
+			return *set;
+		}
+
+		Size position() const {
+			return pos;
+		}
+
+		const_iterator &operator++() {
+			pos++;
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			const_iterator ret = *this;
+			pos++;
+			return ret;
+		}
+
+		const_iterator &operator--() {
+			pos--;
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			const_iterator ret = *this;
+			pos--;
+			return ret;
+		}
+
+		const_iterator &operator+=(difference_type n) {
+			pos += n;
+			return *this;
+		}
+
+		const_iterator &operator-=(difference_type n) {
+			pos -= n;
+			return *this;
+		}
+
+		const_iterator operator+(difference_type n) const {
+			return const_iterator(set, pos + n);
+		}
+
+		const_iterator operator-(difference_type n) const {
+			return const_iterator(set, pos - n);
+		}
+
+		difference_type operator-(const const_iterator &b) const {
+			return difference_type(pos) - difference_type(b.pos);
+		}
+
+		bool operator==(const const_iterator &b) const {
+			return pos == b.pos && set == b.set;
+		}
+
+		bool operator!=(const const_iterator &b) const {
+			return !(*this == b);
+		}
+
+		bool operator<(const const_iterator &b) const {
+			return pos < b.pos;
+		}
+
+		bool operator>(const const_iterator &b) const {
+			return pos > b.pos;
+		}
+
+		bool operator<=(const const_iterator &b) const {
+			return pos <= b.pos;
+		}
+
+		bool operator>=(const const_iterator &b) const {
+			return pos >= b.pos;
+		}
+	};
+
+	using iterator = const_iterator;
+
+	SoAPropertySet() {}
+
+	SoAPropertySet(std::initializer_list<ElementT> list) {
+		reserve(list.size());
+		for (const ElementT &e : list) {
+			push_back(e);
+		}
+	}
+
+	template<typename Iterator>
+	SoAPropertySet(Iterator begin, Iterator end) {
+		insert(this->end(), begin, end);
+	}
+
+	Size size() const {
+		return keys.size();
+	}
+
+	bool empty() const {
+		return keys.empty();
+	}
+
+	void reserve(Size n) {
+		keys.reserve(n);
+		std::apply([n](auto &... c) { (c.reserve(n), ...); }, children);
+	}
+
+	void clear() {
+		keys.clear();
+		std::apply([](auto &... c) { (c.clear(), ...); }, children);
+	}
+
+	void swap(SoAPropertySet &b) {
+		keys.swap(b.keys);
+		children.swap(b.children);
+	}
+
+	void push_back(const ElementT &e) {
+		keys.push_back(e.get_key());
+		push_children(e.get_value(), Sequence{});
+	}
+
+	ElementT operator[](Size pos) const {
+		return ElementT(keys[pos], gather(pos, Sequence{}));
+	}
+
+	/// Gets the key at `pos` without reading the children.
+	const KeyT &key_at(Size pos) const {
+		return keys[pos];
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, keys.size());
+	}
+
+	/**
+	 * @brief      Appends the range [begin, end). Ranges taken from another
+	 *             `SoAPropertySet` are copied column by column.
+	 *
+	 * @param[in]  pos    Insertion position. Must be `end()`.
+	 * @param[in]  begin  The start of the range
+	 * @param[in]  end    The end of the range
+	 */
+	template<typename Iterator>
+	void insert(const const_iterator &pos, Iterator begin, Iterator end) {
+		if (pos.position() != size()) {
+			throw AssertError("SoAPropertySet only supports insertion at the end.");
+		}
+
+		if constexpr (std::is_same_v<Iterator, const_iterator>) {
+			if (begin == end) {
+				return;
+			}
+
+			const SoAPropertySet &src = begin.owner();
+			keys.insert(
+				keys.end(),
+				src.keys.begin() + begin.position(),
+				src.keys.begin() + end.position());
+			append_children(src, begin.position(), end.position(), Sequence{});
+		} else {
+			for (; begin != end; ++begin) {
+				push_back(*begin);
+			}
+		}
+	}
+
+	template<typename Iterator>
+	void assign(Iterator begin, Iterator end) {
+		clear();
+		insert(this->end(), begin, end);
+	}
+
+	/**
+	 * @brief      Bytes allocated for the key array and the child arrays.
+	 */
+	Size capacity_bytes() const {
+		Size ret = keys.capacity() * sizeof(KeyT);
+		std::apply([&ret](const auto &... c) {
+			((ret += c.capacity() * sizeof(*c.data())), ...);
+		}, children);
+		return ret;
+	}
+
+	/**
+	 * @brief      Hashes the key array and every child array as blocks.
+	 */
+	Size hash() const {
+		Size ret = 0;
+
+		if constexpr (is_key_bytewise) {
+			ret = hash_bytes(keys.data(), keys.size() * sizeof(KeyT));
+		} else {
+			for (const KeyT &k : keys) {
+				ret = compose_hash<KeyT, KeyHash>(ret, k);
+			}
+		}
+
+		std::apply([&ret](const auto &... c) {
+			((ret = hash_bytes(c.data(), c.size() * sizeof(*c.data()), ret)), ...);
+		}, children);
+
+		return ret;
+	}
+
+	/**
+	 * @brief      Compares both the keys and the child indices of two sets.
+	 */
+	bool full_equal(const SoAPropertySet &b) const {
+		if (size() != b.size()) {
+			return false;
+		}
+
+		if constexpr (is_key_bytewise) {
+			if (std::memcmp(keys.data(), b.keys.data(), keys.size() * sizeof(KeyT)) != 0) {
+				return false;
+			}
+		} else {
+			if (!std::equal(keys.begin(), keys.end(), b.keys.begin(), KeyEqual())) {
+				return false;
+			}
+		}
+
+		return equal_children(b, Sequence{});
+	}
+
+protected:
+	template<Size... I>
+	bool equal_children(const SoAPropertySet &b, std::index_sequence<I...>) const {
+		return ((std::memcmp(
+			std::get<I>(children).data(),
+			std::get<I>(b.children).data(),
+			size() * sizeof(ChildIndexT)) == 0) && ...);
+	}
+};
+
+template<
+	typename ElementT,
+	typename KeyT,
+	typename ChildValueList,
+	typename KeyHash,
+	typename KeyEqual>
+struct is_soa_property_set<SoAPropertySet<ElementT, KeyT, ChildValueList, KeyHash, KeyEqual>> :
+	std::true_type {};
+
+/**
+ * @def        LHF_PERF_INC(__oper, __category)
+ * @brief      Increments the invocation count of the given category and operator.
+ *             The operator name is resolved to an ID once per call site, and
+ *             the count goes to the calling thread's shard of `stat`.
+ *
+ * @note       Conditionally enabled if `LHF_ENABLE_PERFORMANCE_METRICS` is set.
+ *
+ * @param      __oper      The operator (e.g. `unions`)
+ * @param      __category  The category (e.g. `hits`)
+ */
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+static_assert(LHF_PROBE_MAX_OPERATIONS >= 7,
+	"LHF_PROBE_MAX_OPERATIONS must cover the 7 operations counted by LatticeHashForest");
+#define LHF_PERF_INC(__oper, __category) \
+	([this]() { \
+		static const Size __LHF_OPERATION_ID__ = \
+			ProbeNameTable::operations().id(__LHF_STR(__oper)); \
+		stat.count_operation(__LHF_OPERATION_ID__, OperationPerfField::__category); \
+	}())
+#else
+#define LHF_PERF_INC(__oper, __category)
+#endif
+
+
+/**
+ * @brief      The main LatticeHashForest structure.
+ *             This class can be used as-is with a type or derived for
+ *             additional functionality as needed
+ *
+ *
+ * @tparam     PropertyT      The type of the property.
+ *                            The property type must satisfy the following:
+ *                            * It must be hashable with std::hash
  *                            * It must be less-than comparable
  *                            * It can be checked for equality
  *
@@ -1154,11 +2127,39 @@ public:
 			PropertyEqual,
 			PropertyPrinter>;
 
+	/// The less-than comparator of property keys.
+	using KeyLess = PropertyLess;
+
+	/// Compile-time value that says whether property sets use the
+	/// structure-of-arrays layout.
+	static constexpr bool soa_layout = Nesting::soa_layout;
+
+	/**
+	 * The storage structure for property elements. Implemented as sorted
+	 * vectors, or as a sorted `SoAPropertySet` if the nesting behaviour
+	 * asks for it.
+	 */
+	using PropertySet =
+		std::conditional_t<
+			soa_layout,
+			SoAPropertySet<
+				PropertyElement,
+				PropertyT,
+				typename Nesting::ChildValueList,
+				PropertyHash,
+				PropertyEqual>,
+			std::vector<PropertyElement>>;
+
 	/**
-	 * The storage structure for property elements. Currently implemented as
-	 * sorted vectors.
+	 * Result of looking up a single element. Elements of sets in the
+	 * structure-of-arrays layout do not exist in memory, so they are returned
+	 * by value.
 	 */
-	using PropertySet = std::vector<PropertyElement>;
+	using ElementRef =
+		std::conditional_t<
+			soa_layout,
+			Optional<PropertyElement>,
+			OptionalRef<PropertyElement>>;
 
 	using PropertySetHash =
 		SetHash<
@@ -1213,14 +2214,28 @@ public:
 
 	using UnaryOperationMap = OperationMap<IndexValue>;
 	using BinaryOperationMap = OperationMap<OperationNode>;
+	using ForeignOperationMap = OperationMap<ForeignOperationNode>;
 	using RefList = typename Nesting::LHFReferenceList;
 
 protected:
+	// Operations that write into another LHF (`set_transform`) restore sets
+	// that the other LHF has evicted.
+	template<typename, typename, typename, typename, typename, typename, Size, Size>
+	friend class LatticeHashForest;
+
 	RefList reflist;
 
+	// Process-wide identifier of this instance, used to key the results of
+	// operations that involve other LHF instances.
+	IndexValue lhf_instance_id = __next_instance_id();
+
 #ifdef LHF_ENABLE_PERFORMANCE_METRICS
 	PerformanceStatistics stat;
-	HashMap<String, OperationPerf> perf;
+#endif
+
+#ifdef LHF_ENABLE_TRACE_RECORDING
+	TraceRecorder *trace_recorder = nullptr;
+	uint32_t trace_instance = 0;
 #endif
 
 	struct PropertySetHolder {
@@ -1306,12 +2321,16 @@ protected:
 
 		Index push_back(PropertySetHolder &&p) {
 			auto it = data.push_back(std::move(p));
-			return it - data.begin();
+			return to_index_value(it - data.begin());
 		}
 
 		Size size() const {
 			return data.size();
 		}
+
+		Size capacity_bytes() const {
+			return data.capacity() * sizeof(PropertySetHolder);
+		}
 	};
 
 #elif defined(LHF_ENABLE_PARALLEL)
@@ -1374,12 +2393,21 @@ protected:
 			}
 			data.back().push_back(std::move(p));
 			total_elems++;
-			return Index(total_elems - 1);
+			return Index(to_index_value(total_elems - 1));
 		}
 
 		Size size() const {
 			return total_elems;
 		}
+
+		Size capacity_bytes() const {
+			ReadLock m(realloc_mutex);
+			Size ret = data.capacity() * sizeof(Vector<PropertySetHolder>);
+			for (auto &block : data) {
+				ret += block.capacity() * sizeof(PropertySetHolder);
+			}
+			return ret;
+		}
 	};
 
 #else
@@ -1411,12 +2439,16 @@ protected:
 
 		Index push_back(PropertySetHolder &&p) {
 			data.push_back(std::move(p));
-			return data.size() - 1;
+			return to_index_value(data.size() - 1);
 		}
 
 		Size size() const {
 			return data.size();
 		}
+
+		Size capacity_bytes() const {
+			return data.capacity() * sizeof(PropertySetHolder);
+		}
 	};
 
 #endif
@@ -1431,6 +2463,13 @@ protected:
 	BinaryOperationMap intersections = {};
 	BinaryOperationMap differences = {};
 
+	// (target instance, transform_id, index, transform state) -> index in the
+	// target LHF.
+	ForeignOperationMap transforms = {};
+
+	// (key LHF instance, index, key set index) -> index of the restriction.
+	ForeignOperationMap restrictions = {};
+
 	InternalMap<OperationNode, SubsetRelation> subsets = {};
 
 	/**
@@ -1453,6 +2492,48 @@ protected:
 		}
 	}
 
+#ifdef LHF_ENABLE_TRACE_RECORDING
+	/// Converts a key to the integer stored in a trace.
+	static int64_t trace_key(const PropertyT &p) {
+		if constexpr (std::is_pointer_v<PropertyT>) {
+			return static_cast<int64_t>(reinterpret_cast<std::intptr_t>(p));
+		} else if constexpr (std::is_integral_v<PropertyT> || std::is_enum_v<PropertyT>) {
+			return static_cast<int64_t>(p);
+		} else {
+			return 0;
+		}
+	}
+
+	/**
+	 * @brief      Records the registration of a set. The contents are only
+	 *             recorded for new sets.
+	 *
+	 * @param[in]  index  The index of the set
+	 * @param[in]  cold   Whether the set is new
+	 */
+	void trace_register(const Index &index, bool cold) {
+		if (!cold) {
+			trace_recorder->record_register(trace_instance, index.value, nullptr, 0);
+			return;
+		}
+
+		static thread_local std::vector<int64_t> elements;
+		elements.clear();
+
+		for (const auto &e : get_value(index)) {
+			elements.push_back(trace_key(e.get_key()));
+			if constexpr (Nesting::is_nested) {
+				std::apply([](const auto &... child) {
+					(elements.push_back(child.value), ...);
+				}, e.get_value());
+			}
+		}
+
+		trace_recorder->record_register(
+			trace_instance, index.value, &elements, 1 + Nesting::num_children);
+	}
+#endif
+
 public:
 	explicit LatticeHashForest(RefList reflist = {}): reflist(reflist) {
 		// INSERT EMPTY SET AT INDEX 0
@@ -1463,6 +2544,13 @@ public:
 		return i.is_empty();
 	}
 
+	/**
+	 * @brief      Returns the process-wide identifier of this LHF instance.
+	 */
+	inline IndexValue instance_id() const {
+		return lhf_instance_id;
+	}
+
 	/**
 	 * @brief      Returns whether we currently know whether a is a subset or a
 	 *             superset of b.
@@ -1495,6 +2583,8 @@ public:
 	 * @todo          Check whether the cache hit check can be removed.
 	 */
 	Index register_set_single(const PropertyElement &c) {
+		LHF_TRACE_REGISTER(__trace_cold, register_set_single(c, __trace_cold));
+
 		__lhf_calc_functime(stat);
 
 		PropertySetHolder new_set = PropertySetHolder(new PropertySet{c});
@@ -1530,6 +2620,8 @@ public:
 	 * @return     Index of the newly created set.
 	 */
 	Index register_set_single(const PropertyElement &c, bool &cold) {
+		LHF_TRACE_REGISTER(cold, register_set_single(c, cold));
+
 		__lhf_calc_functime(stat);
 
 		PropertySetHolder new_set = PropertySetHolder(new PropertySet{c});
@@ -1574,12 +2666,38 @@ public:
 			deduplicator.insert(i);
 		}
 
-		c.assign(deduplicator.begin(), deduplicator.end());
-		std::sort(c.begin(), c.end());
+		if constexpr (soa_layout) {
+			Vector<PropertyElement> sorted(deduplicator.begin(), deduplicator.end());
+			std::sort(sorted.begin(), sorted.end());
+			c.assign(sorted.begin(), sorted.end());
+		} else {
+			c.assign(deduplicator.begin(), deduplicator.end());
+			std::sort(c.begin(), c.end());
+		}
+	}
+
+	/**
+	 * @brief      Returns a cleared, reusable property set buffer. There is
+	 *             one buffer per LHF type per thread. Operations that build a
+	 *             set only to register it can write into this buffer instead
+	 *             of a fresh vector, so that no allocation happens when the
+	 *             result is already present.
+	 *
+	 * @note       The buffer is only valid until the next call to this
+	 *             function on the same thread.
+	 *
+	 * @return     The buffer.
+	 */
+	static PropertySet &scratch_buffer() {
+		static thread_local PropertySet buffer;
+		buffer.clear();
+		return buffer;
 	}
 
 	template <bool disable_integrity_check = false>
 	Index register_set(const PropertySet &c) {
+		LHF_TRACE_REGISTER(__trace_cold, register_set<disable_integrity_check>(c, __trace_cold));
+
 		__lhf_calc_functime(stat);
 
 		if (!disable_integrity_check) {
@@ -1608,6 +2726,8 @@ public:
 
 	template <bool disable_integrity_check = false>
 	Index register_set(const PropertySet &c, bool &cold) {
+		LHF_TRACE_REGISTER(cold, register_set<disable_integrity_check>(c, cold));
+
 		__lhf_calc_functime(stat);
 
 		if (!disable_integrity_check) {
@@ -1640,6 +2760,8 @@ public:
 
 	template <bool disable_integrity_check = false>
 	Index register_set(PropertySet &&c) {
+		LHF_TRACE_REGISTER(__trace_cold, register_set<disable_integrity_check>(std::move(c), __trace_cold));
+
 		__lhf_calc_functime(stat);
 
 		if (!disable_integrity_check) {
@@ -1651,13 +2773,13 @@ public:
 		if (!result.is_present()) {
 			LHF_PERF_INC(property_sets, cold_misses);
 
-			PropertySetHolder new_set(new PropertySet(c));
+			PropertySetHolder new_set(new PropertySet(std::move(c)));
 			Index ret = property_sets.push_back(std::move(new_set));
 			property_set_map.insert(std::make_pair(property_sets.at(ret).get(), ret.value));
 			return ret;
 		}
 		LHF_EVICTION(else if (is_evicted(result.get())) {
-			property_sets.at_mutable(result.get()).reassign(new PropertySet(c));
+			property_sets.at_mutable(result.get()).reassign(new PropertySet(std::move(c)));
 			return Index(result.get());
 		})
 		else {
@@ -1668,6 +2790,8 @@ public:
 
 	template <bool disable_integrity_check = false>
 	Index register_set(PropertySet &&c, bool &cold) {
+		LHF_TRACE_REGISTER(cold, register_set<disable_integrity_check>(std::move(c), cold));
+
 		__lhf_calc_functime(stat);
 
 		if (!disable_integrity_check) {
@@ -1679,7 +2803,7 @@ public:
 		if (!result.is_present()) {
 			LHF_PERF_INC(property_sets, cold_misses);
 
-			PropertySetHolder new_set(new PropertySet(c));
+			PropertySetHolder new_set(new PropertySet(std::move(c)));
 			Index ret = property_sets.push_back(std::move(new_set));
 			property_set_map.insert(std::make_pair(property_sets.at(ret).get(), ret.value));
 
@@ -1687,7 +2811,7 @@ public:
 			return ret;
 		}
 		LHF_EVICTION(else if (is_evicted(result.get())) {
-			property_sets.at_mutable(result.get()).reassign(new PropertySet(c));
+			property_sets.at_mutable(result.get()).reassign(new PropertySet(std::move(c)));
 			cold = false;
 			return Index(result.get());
 		})
@@ -1700,6 +2824,8 @@ public:
 
 	template<typename Iterator, bool disable_integrity_check = false>
 	Index register_set(Iterator begin, Iterator end) {
+		LHF_TRACE_REGISTER(__trace_cold, (register_set<Iterator, disable_integrity_check>(begin, end, __trace_cold)));
+
 		__lhf_calc_functime(stat);
 
 		PropertySetHolder new_set(new PropertySet(begin, end));
@@ -1718,7 +2844,7 @@ public:
 			return ret;
 		}
 		LHF_EVICTION(else if (is_evicted(result.get())) {
-			property_sets.at_mutable(result.get()).reassign(std::move(new_set));
+			property_sets.at_mutable(result.get()).swap(new_set);
 			return Index(result.get());
 		})
 		else {
@@ -1729,6 +2855,8 @@ public:
 
 	template<typename Iterator, bool disable_integrity_check = false>
 	Index register_set(Iterator begin, Iterator end, bool &cold) {
+		LHF_TRACE_REGISTER(cold, (register_set<Iterator, disable_integrity_check>(begin, end, cold)));
+
 		__lhf_calc_functime(stat);
 
 		PropertySetHolder new_set(new PropertySet(begin, end));
@@ -1748,7 +2876,7 @@ public:
 			return ret;
 		}
 		LHF_EVICTION(else if (is_evicted(result.get())) {
-			property_sets.at_mutable(result.get()).reassign(std::move(new_set));
+			property_sets.at_mutable(result.get()).swap(new_set);
 			cold = false;
 			return Index(result.get());
 		})
@@ -1839,6 +2967,46 @@ public:
 		return PropertyLess()(a.get_key(), b.get_key());
 	}
 
+	/**
+	 * @brief      Gets the key of the element at an iterator position of a
+	 *             property set. In the structure-of-arrays layout only the key
+	 *             array is read.
+	 *
+	 * @param[in]  cursor  The iterator
+	 *
+	 * @return     The key.
+	 */
+	template<typename Iterator>
+	static inline const PropertyT &key_at(const Iterator &cursor) {
+		if constexpr (soa_layout) {
+			return cursor.key();
+		} else {
+			return cursor->get_key();
+		}
+	}
+
+	/**
+	 * @brief      Gets the key of the element at position `pos` of a
+	 *             property set.
+	 */
+	static inline const PropertyT &key_at(const PropertySet &s, Size pos) {
+		if constexpr (soa_layout) {
+			return s.key_at(pos);
+		} else {
+			return s[pos].get_key();
+		}
+	}
+
+	/**
+	 * @brief      Less than comparator over the keys at two iterator
+	 *             positions. Merge loops use this so that children are only
+	 *             read when an element is actually needed.
+	 */
+	template<typename Iterator>
+	static inline bool less_at(const Iterator &a, const Iterator &b) {
+		return PropertyLess()(key_at(a), key_at(b));
+	}
+
 	/**
 	 * @brief      Equality comparator for operations. You MUST use this
 	 *             instead of directly using anything else like "<"
@@ -1870,17 +3038,17 @@ public:
 	 * @return     An optional that contains a property element if the key was
 	 *             found.
 	 */
-	inline OptionalRef<PropertyElement> find_key(const Index &index, const PropertyT &p) const {
+	inline ElementRef find_key(const Index &index, const PropertyT &p) const {
 		if (is_empty(index)) {
-			return OptionalRef<PropertyElement>::absent();
+			return ElementRef::absent();
 		}
 
 		const PropertySet &s = get_value(index);
 
 		if (s.size() <= LHF_SORTED_VECTOR_BINARY_SEARCH_THRESHOLD) {
-			for (const PropertyElement &i : s) {
-				if (equal_key(i, p)) {
-					return OptionalRef<PropertyElement>(i);
+			for (Size i = 0; i < s.size(); i++) {
+				if (PropertyEqual()(key_at(s, i), p)) {
+					return ElementRef(s[i]);
 				}
 			}
 		} else {
@@ -1891,9 +3059,9 @@ public:
 			while (low <= high) {
 				long int mid = low + (high - low) / 2;
 
-				if (equal_key(s[mid], p)) {
-					return OptionalRef<PropertyElement>(s[mid]);
-				} else if (less_key(s[mid], p)) {
+				if (PropertyEqual()(key_at(s, mid), p)) {
+					return ElementRef(s[mid]);
+				} else if (PropertyLess()(key_at(s, mid), p)) {
 					low = mid + 1;
 				} else {
 					high = mid - 1;
@@ -1901,7 +3069,7 @@ public:
 			}
 		}
 
-		return OptionalRef<PropertyElement>::absent();
+		return ElementRef::absent();
 	}
 
 	/**
@@ -1921,8 +3089,8 @@ public:
 		const PropertySet &s = get_value(index);
 
 		if (s.size() <= LHF_SORTED_VECTOR_BINARY_SEARCH_THRESHOLD) {
-			for (PropertyElement i : s) {
-				if (equal_key(i, prop)) {
+			for (Size i = 0; i < s.size(); i++) {
+				if (PropertyEqual()(key_at(s, i), prop.get_key())) {
 					return true;
 				}
 			}
@@ -1933,9 +3101,9 @@ public:
 
 			while (low <= high) {
 				long int mid = low + (high - low) / 2;
-				if (equal_key(s[mid], prop)) {
+				if (PropertyEqual()(key_at(s, mid), prop.get_key())) {
 					return true;
-				} else if (less_key(s[mid], prop)) {
+				} else if (PropertyLess()(key_at(s, mid), prop.get_key())) {
 					low = mid + 1;
 				} else {
 					high = mid - 1;
@@ -1957,6 +3125,8 @@ public:
 	 */
 	LHF_BINARY_NESTED_OPERATION(set_union)
 	Index set_union(const Index &_a, const Index &_b) {
+		LHF_TRACE_OPERATION(TRACE_LIVE_UNION, set_union, _a, _b);
+
 		LHF_PROPERTY_SET_PAIR_VALID(_a, _b);
 		__lhf_calc_functime(stat);
 
@@ -2007,11 +3177,11 @@ public:
 					break;
 				}
 
-				if (less(*cursor_2, *cursor_1)) {
+				if (less_at(cursor_2, cursor_1)) {
 					LHF_PUSH_ONE(new_set, *cursor_2);
 					cursor_2++;
 				} else {
-					if (!(less(*cursor_1, *cursor_2))) {
+					if (!(less_at(cursor_1, cursor_2))) {
 						if constexpr (Nesting::is_nested) {
 							PropertyElement new_elem =
 								LHF_PERFORM_BINARY_NESTED_OPERATION(
@@ -2089,6 +3259,8 @@ public:
 	 */
 	LHF_BINARY_NESTED_OPERATION(set_difference)
 	Index set_difference(const Index &a, const Index &b) {
+		LHF_TRACE_OPERATION(TRACE_LIVE_DIFFERENCE, set_difference, a, b);
+
 		LHF_PROPERTY_SET_PAIR_VALID(a, b);
 		__lhf_calc_functime(stat);
 
@@ -2126,11 +3298,11 @@ public:
 					break;
 				}
 
-				if (less(*cursor_1, *cursor_2)) {
+				if (less_at(cursor_1, cursor_2)) {
 					LHF_PUSH_ONE(new_set, *cursor_1);
 					cursor_1++;
 				} else {
-					if (!(less(*cursor_2, *cursor_1))) {
+					if (!(less_at(cursor_2, cursor_1))) {
 						if constexpr (Nesting::is_nested) {
 							PropertyElement new_elem =
 								LHF_PERFORM_BINARY_NESTED_OPERATION(
@@ -2208,7 +3380,7 @@ public:
 		const auto &cursor_end_1 = first.end();
 
 		for (;cursor_1 != cursor_end_1; cursor_1++) {
-			if (!PropertyEqual()(cursor_1->get_key(), p)) {
+			if (!PropertyEqual()(key_at(cursor_1), p)) {
 				LHF_PUSH_ONE(new_set, *cursor_1);
 			}
 		}
@@ -2226,6 +3398,8 @@ public:
 	 */
 	LHF_BINARY_NESTED_OPERATION(set_intersection)
 	Index set_intersection(const Index &_a, const Index &_b) {
+		LHF_TRACE_OPERATION(TRACE_LIVE_INTERSECTION, set_intersection, _a, _b);
+
 		LHF_PROPERTY_SET_PAIR_VALID(_a, _b);
 		__lhf_calc_functime(stat);
 
@@ -2269,10 +3443,10 @@ public:
 
 			while (cursor_1 != cursor_end_1 && cursor_2 != cursor_end_2)
 			{
-				if (less(*cursor_1,*cursor_2)) {
+				if (less_at(cursor_1, cursor_2)) {
 					cursor_1++;
 				} else {
-					if (!(less(*cursor_2, *cursor_1))) {
+					if (!(less_at(cursor_2, cursor_1))) {
 						if constexpr (Nesting::is_nested) {
 							PropertyElement new_elem =
 								LHF_PERFORM_BINARY_NESTED_OPERATION(set_intersection, reflist, *cursor_1, *cursor_2);
@@ -2384,6 +3558,490 @@ public:
 		}
 	}
 
+	/**
+	 * @brief      Applies `fn` to every element of the set `s`, and registers
+	 *             the resulting set in `target`. The result is cached per
+	 *             (target, transform, transform state, index), so the
+	 *             transform is computed only once for each set.
+	 *
+	 *             The transform type must satisfy the following:
+	 *             * `TargetLHF::PropertyElement operator()(const PropertyElement &) const`
+	 *             * `static constexpr bool is_order_preserving`: `true` if
+	 *               the transform is strictly monotone with respect to the
+	 *               less-than comparators of both LHFs. The result is then
+	 *               already sorted and free of duplicates, and the sorting
+	 *               step is skipped.
+	 *             * If the transform has state, `std::uint64_t state_key() const`,
+	 *               which must differ between instances that map elements
+	 *               differently. Stateful transforms without it are rejected
+	 *               at compile time.
+	 *
+	 * @note       The transform must be a pure function of the element and
+	 *             its state key, since results are reused for every functor
+	 *             of the same type and state key.
+	 *
+	 * @param[in]  s          The set to transform
+	 * @param      target     The LHF to register the result in (can be this
+	 *                        LHF)
+	 * @param[in]  fn         The transform functor
+	 *
+	 * @tparam     Transform  The transform functor type
+	 * @tparam     TargetLHF  The type of the target LHF
+	 *
+	 * @return     Index of the transformed set in `target`.
+	 */
+	template<typename Transform, typename TargetLHF>
+	typename TargetLHF::Index set_transform(
+		const Index &s,
+		TargetLHF &target,
+		const Transform &fn = Transform()) {
+		using TargetIndex = typename TargetLHF::Index;
+		using TargetPropertySet = typename TargetLHF::PropertySet;
+
+		LHF_PROPERTY_SET_INDEX_VALID(s);
+		__lhf_calc_functime(stat);
+
+		if (is_empty(s)) {
+			LHF_PERF_INC(transforms, empty_hits);
+			return TargetIndex(EMPTY_SET_VALUE);
+		}
+
+		const ForeignOperationNode key = {
+			target.instance_id(), transform_id<Transform>(), s.value, transform_state_key(fn)};
+		auto result = transforms.find(key);
+
+		if (!result.is_present() LHF_EVICTION(|| target.is_evicted(result.get()))) {
+			TargetPropertySet &new_set = TargetLHF::scratch_buffer();
+			const PropertySet &first = get_value(s);
+			new_set.reserve(first.size());
+
+			for (const PropertyElement &value : first) {
+				LHF_PUSH_ONE(new_set, fn(value));
+			}
+
+			if constexpr (!Transform::is_order_preserving) {
+				target.prepare_vector_set(new_set);
+			}
+
+			bool cold = false;
+			TargetIndex ret;
+
+			LHF_EVICTION(if (result.is_present() && target.is_evicted(result.get())) {
+				ret = result.get();
+				target.property_sets.at_mutable(ret.value).reassign(new TargetPropertySet(new_set));
+			} else) {
+				ret = target.template register_set<
+					LHF_DISABLE_INTERNAL_INTEGRITY_CHECK>(new_set, cold);
+				transforms.insert({key, ret.value});
+			}
+
+			if (cold) {
+				LHF_PERF_INC(transforms, cold_misses);
+			} else {
+				LHF_PERF_INC(transforms, edge_misses);
+			}
+
+			return ret;
+		} else {
+			LHF_PERF_INC(transforms, hits);
+			return TargetIndex(result.get());
+		}
+	}
+
+	/**
+	 * @brief      Calculates, or returns a cached result of the restriction
+	 *             of `s` to the keys in the set `k` of another LHF: the
+	 *             elements of `s` whose key is equal to the key of some
+	 *             element of `k`. This is a single merge-join over the keys
+	 *             of both sets, with the child sets of nested elements kept
+	 *             as-is. The result is cached per (s, keys, k).
+	 *
+	 *             Keys are matched with the key comparator of this LHF, so
+	 *             any equivalence of keys (for instance, treating several
+	 *             objects as one) must already be reflected in the key values
+	 *             of both LHFs.
+	 *
+	 * @param[in]  s       The set to restrict
+	 * @param[in]  keys    The LHF that holds `k`
+	 * @param[in]  k       The set of keys to restrict to
+	 *
+	 * @tparam     KeyLHF  The type of the LHF that holds `k`. Its property
+	 *                     type and key comparator must be those of this LHF,
+	 *                     since both sets are walked in the same order.
+	 *
+	 * @return     Index of the restricted set.
+	 */
+	template<typename KeyLHF>
+	Index set_restrict_keys(const Index &s, const KeyLHF &keys, const typename KeyLHF::Index &k) {
+		static_assert(std::is_same_v<typename KeyLHF::PropertyElement::InterfaceKeyType, PropertyT>,
+			"The key LHF must have the same property type");
+		static_assert(std::is_same_v<typename KeyLHF::KeyLess, PropertyLess>,
+			"The key LHF must order keys with the same comparator");
+
+		LHF_PROPERTY_SET_INDEX_VALID(s);
+		__lhf_calc_functime(stat);
+
+		if (is_empty(s) || k.is_empty()) {
+			LHF_PERF_INC(restrictions, empty_hits);
+			return Index(EMPTY_SET_VALUE);
+		}
+
+		const ForeignOperationNode key = {keys.instance_id(), s.value, k.value, 0};
+		auto result = restrictions.find(key);
+
+		if (!result.is_present() LHF_EVICTION(|| is_evicted(result.get()))) {
+			PropertySet new_set;
+			const PropertySet &first = get_value(s);
+			const typename KeyLHF::PropertySet &second = keys.get_value(k);
+
+			auto cursor_1 = first.begin();
+			const auto &cursor_end_1 = first.end();
+			auto cursor_2 = second.begin();
+			const auto &cursor_end_2 = second.end();
+
+			while (cursor_1 != cursor_end_1 && cursor_2 != cursor_end_2) {
+				if (PropertyLess()(key_at(cursor_1), KeyLHF::key_at(cursor_2))) {
+					cursor_1++;
+				} else {
+					if (!PropertyLess()(KeyLHF::key_at(cursor_2), key_at(cursor_1))) {
+						LHF_PUSH_ONE(new_set, *cursor_1);
+						cursor_1++;
+					}
+					cursor_2++;
+				}
+			}
+
+			bool cold = false;
+			Index ret;
+
+			LHF_EVICTION(if (result.is_present() && is_evicted(result.get())) {
+				ret = result.get();
+				property_sets.at_mutable(ret).reassign(new PropertySet(std::move(new_set)));
+			} else) {
+				ret = LHF_REGISTER_SET_INTERNAL(std::move(new_set), cold);
+				restrictions.insert({key, ret.value});
+
+				if (ret != s) {
+					store_subset(ret, s);
+				}
+			}
+
+			if (cold) {
+				LHF_PERF_INC(restrictions, cold_misses);
+			} else {
+				LHF_PERF_INC(restrictions, edge_misses);
+			}
+
+			return Index(ret);
+		}
+
+		LHF_PERF_INC(restrictions, hits);
+		return Index(result.get());
+	}
+
+	/**
+	 * @brief      A mutable copy of a property set, for applying a batch of
+	 *             updates to one value. Updates are appended to a staging
+	 *             buffer in the order they are made, and sorted and merged
+	 *             into the sorted elements only on `commit()` or on the next
+	 *             query (`contains`, `size`, `empty`). A batch of n updates
+	 *             thus costs O(n log n) instead of a mid-buffer insertion per
+	 *             update, and only `commit()` registers the result.
+	 *
+	 *             For nested LHFs, `insert_child` collects elements of the
+	 *             children of an element, and each changed child is
+	 *             registered once on commit, through a transient of the
+	 *             child LHF.
+	 *
+	 * @note       The transient holds a reference to its LHF, and must not
+	 *             outlive it.
+	 */
+	class Transient {
+		using ChildBuffers = typename TransientChildBuffers<RefList>::type;
+
+		enum StagedKind { STAGED_INSERT, STAGED_UPDATE, STAGED_REMOVE, STAGED_CHILD };
+
+		/// An update not merged into `elements` yet. `children` holds the
+		/// child element of a `STAGED_CHILD` update.
+		struct StagedUpdate {
+			StagedKind kind;
+			PropertyElement element;
+			ChildBuffers children;
+		};
+
+		LatticeHashForest &lhf;
+
+		// Sorted contents as of the last merge, and the updates made since.
+		// Queries merge first, hence `mutable`.
+		mutable Vector<PropertyElement> elements;
+		mutable Vector<StagedUpdate> staged;
+
+		// Pending child elements, at the same positions as `elements`. Only
+		// used by nested LHFs.
+		mutable Vector<ChildBuffers> pending;
+
+		static PropertyElement key_element(const PropertyT &key) {
+			if constexpr (Nesting::is_nested) {
+				return PropertyElement(key, typename Nesting::ChildValueList());
+			} else {
+				return PropertyElement(key);
+			}
+		}
+
+		template<Size I, typename ChildIndex, typename Buffer>
+		bool flush_child(ChildIndex &child, Buffer &buffer) {
+			if (buffer.empty()) {
+				return false;
+			}
+
+			auto &child_lhf = std::get<I>(lhf.reflist);
+			typename std::remove_reference_t<decltype(child_lhf)>::Transient t(child_lhf, child);
+			for (const auto &e : buffer) {
+				t.insert(e);
+			}
+			buffer.clear();
+			child = t.commit();
+			return true;
+		}
+
+		template<Size I, typename ChildIndex, typename Buffer>
+		void append_child(const ChildIndex &child, Buffer &buffer) const {
+			if (child.is_empty()) {
+				return;
+			}
+
+			for (const auto &e : std::get<I>(lhf.reflist).get_value(child)) {
+				buffer.push_back(e);
+			}
+		}
+
+		template<Size ...I>
+		void append_children(ChildBuffers &buffers, const PropertyElement &e, std::index_sequence<I...>) const {
+			const typename Nesting::ChildValueList value = e.get_value();
+			(append_child<I>(std::get<I>(value), std::get<I>(buffers)), ...);
+		}
+
+		template<Size ...I>
+		static void move_children(ChildBuffers &to, ChildBuffers &from, std::index_sequence<I...>) {
+			((std::get<I>(to).insert(
+				std::get<I>(to).end(), std::get<I>(from).begin(), std::get<I>(from).end())), ...);
+		}
+
+		template<Size ...I>
+		void flush_children(Size pos, std::index_sequence<I...>) {
+			typename Nesting::ChildValueList value = elements[pos].get_value();
+			bool changed = false;
+			((changed |= flush_child<I>(std::get<I>(value), std::get<I>(pending[pos]))), ...);
+			if (changed) {
+				elements[pos] = PropertyElement(elements[pos].get_key(), value);
+			}
+		}
+
+		/// Applies the staged updates of one key, in the order they were
+		/// made, to the state of that key in `present`, `e` and `buffers`.
+		void apply(StagedUpdate &u, bool &present, PropertyElement &e, ChildBuffers &buffers) const {
+			switch (u.kind) {
+			case STAGED_INSERT:
+				if (!present) {
+					present = true;
+					e = u.element;
+				} else if constexpr (Nesting::is_nested) {
+					append_children(buffers, u.element, std::make_index_sequence<Nesting::num_children>{});
+				}
+				break;
+			case STAGED_UPDATE:
+				present = true;
+				e = u.element;
+				buffers = ChildBuffers();
+				break;
+			case STAGED_REMOVE:
+				present = false;
+				buffers = ChildBuffers();
+				break;
+			case STAGED_CHILD:
+				if (!present) {
+					present = true;
+					e = u.element;
+				}
+				if constexpr (Nesting::is_nested) {
+					move_children(buffers, u.children, std::make_index_sequence<Nesting::num_children>{});
+				}
+				break;
+			}
+		}
+
+		/// Sorts the staged updates by key, keeping their order within a
+		/// key, and merges them into `elements` and `pending`.
+		void merge() const {
+			if (staged.empty()) {
+				return;
+			}
+
+			std::stable_sort(staged.begin(), staged.end(),
+				[](const StagedUpdate &a, const StagedUpdate &b) {
+					return PropertyLess()(a.element.get_key(), b.element.get_key());
+				});
+
+			Vector<PropertyElement> merged;
+			Vector<ChildBuffers> merged_pending;
+			merged.reserve(elements.size() + staged.size());
+			if constexpr (Nesting::is_nested) {
+				merged_pending.reserve(elements.size() + staged.size());
+			}
+
+			Size i = 0;
+			Size j = 0;
+			while (j < staged.size()) {
+				const PropertyT &key = staged[j].element.get_key();
+				while (i < elements.size() && PropertyLess()(elements[i].get_key(), key)) {
+					merged.push_back(elements[i]);
+					if constexpr (Nesting::is_nested) {
+						merged_pending.push_back(std::move(pending[i]));
+					}
+					i++;
+				}
+
+				bool present = i < elements.size() && PropertyEqual()(elements[i].get_key(), key);
+				PropertyElement e = present ? elements[i] : staged[j].element;
+				ChildBuffers buffers;
+				if (present) {
+					if constexpr (Nesting::is_nested) {
+						buffers = std::move(pending[i]);
+					}
+					i++;
+				}
+
+				for (; j < staged.size() && PropertyEqual()(staged[j].element.get_key(), key); j++) {
+					apply(staged[j], present, e, buffers);
+				}
+
+				if (present) {
+					merged.push_back(e);
+					if constexpr (Nesting::is_nested) {
+						merged_pending.push_back(std::move(buffers));
+					}
+				}
+			}
+
+			for (; i < elements.size(); i++) {
+				merged.push_back(elements[i]);
+				if constexpr (Nesting::is_nested) {
+					merged_pending.push_back(std::move(pending[i]));
+				}
+			}
+
+			elements = std::move(merged);
+			pending = std::move(merged_pending);
+			staged.clear();
+		}
+
+	public:
+		Transient(LatticeHashForest &lhf, const Index &from = Index(EMPTY_SET_VALUE)): lhf(lhf) {
+			const PropertySet &s = lhf.get_value(from);
+			elements.reserve(s.size());
+			for (const PropertyElement &e : s) {
+				elements.push_back(e);
+			}
+			if constexpr (Nesting::is_nested) {
+				pending.resize(elements.size());
+			}
+		}
+
+		Size size() const {
+			merge();
+			return elements.size();
+		}
+
+		bool empty() const {
+			merge();
+			return elements.empty();
+		}
+
+		bool contains(const PropertyT &key) const {
+			merge();
+			auto it = std::lower_bound(elements.begin(), elements.end(), key,
+				[](const PropertyElement &a, const PropertyT &k) { return PropertyLess()(a.get_key(), k); });
+			return it != elements.end() && PropertyEqual()(it->get_key(), key);
+		}
+
+		/**
+		 * @brief      Inserts an element. If an element with the same key is
+		 *             present, the children of a nested element are merged
+		 *             into it as in `set_union` (collected like `insert_child`
+		 *             and registered on commit), and a non-nested one is left
+		 *             as it is.
+		 */
+		void insert(const PropertyElement &e) {
+			staged.push_back({ STAGED_INSERT, e, ChildBuffers() });
+		}
+
+		/**
+		 * @brief      Inserts an element, replacing the element with the same
+		 *             key (and any child elements pending for it) if present.
+		 */
+		void update(const PropertyElement &e) {
+			staged.push_back({ STAGED_UPDATE, e, ChildBuffers() });
+		}
+
+		/**
+		 * @brief      Removes the element with the key `key`, if present.
+		 */
+		void remove(const PropertyT &key) {
+			staged.push_back({ STAGED_REMOVE, key_element(key), ChildBuffers() });
+		}
+
+		/**
+		 * @brief      Adds `child` to the `I`th child set of the element with
+		 *             the key `key`, creating the element with empty children
+		 *             if it is not present. The child set is registered on
+		 *             commit.
+		 */
+		template<Size I, typename ChildElement>
+		void insert_child(const PropertyT &key, const ChildElement &child) {
+			static_assert(Nesting::is_nested, "insert_child requires a nested LHF");
+
+			ChildBuffers children;
+			std::get<I>(children).push_back(child);
+			staged.push_back({ STAGED_CHILD, key_element(key), std::move(children) });
+		}
+
+		/**
+		 * @brief      Registers the current contents in the LHF. The
+		 *             transient stays valid, and can be updated and committed
+		 *             again.
+		 *
+		 * @return     Index of the set.
+		 */
+		Index commit() {
+			merge();
+
+			if constexpr (Nesting::is_nested) {
+				for (Size pos = 0; pos < elements.size(); pos++) {
+					flush_children(pos, std::make_index_sequence<Nesting::num_children>{});
+				}
+			}
+
+			if constexpr (soa_layout) {
+				PropertySet &s = scratch_buffer();
+				s.assign(elements.begin(), elements.end());
+				return lhf.template register_set<LHF_DISABLE_INTERNAL_INTEGRITY_CHECK>(s);
+			} else {
+				return lhf.template register_set<LHF_DISABLE_INTERNAL_INTEGRITY_CHECK>(elements);
+			}
+		}
+	};
+
+	/**
+	 * @brief      Starts a batch of updates to the set `s`.
+	 *
+	 * @param[in]  s     The set to start from
+	 *
+	 * @return     A transient holding a copy of `s`.
+	 */
+	Transient transient(const Index &s = Index(EMPTY_SET_VALUE)) {
+		return Transient(*this, s);
+	}
+
 	/**
 	 * @brief      Converts the property set to a string.
 	 *
@@ -2426,6 +4084,14 @@ public:
 		s << intersections.to_string();
 		s << "\n";
 
+		s << "    " << "Transforms: " << "(Count: " << transforms.size() << ")\n";
+		s << transforms.to_string();
+		s << "\n";
+
+		s << "    " << "Restrictions: " << "(Count: " << restrictions.size() << ")\n";
+		s << restrictions.to_string();
+		s << "\n";
+
 		s << "    " << "Subsets: " << "(Count: " << subsets.size() << ")\n";
 		for (auto i : subsets) {
 			s << "      " << i.first << " -> " << (i.second == SUBSET ? "sub" : "sup") << "\n";
@@ -2447,7 +4113,217 @@ public:
 		return os;
 	}
 
+#ifdef LHF_ENABLE_TRACE_RECORDING
+	/// Whether the operations of this LHF can be recorded: keys must be
+	/// integers, enums or pointers.
+	static constexpr bool is_trace_recordable =
+		std::is_integral_v<PropertyT> ||
+		std::is_enum_v<PropertyT> ||
+		std::is_pointer_v<PropertyT>;
+
+	/**
+	 * @brief      Attaches a trace recorder to this LHF and its nested
+	 *             children, or detaches it if `recorder` is `nullptr`. From
+	 *             then on, set registrations and binary operations called on
+	 *             the LHF are recorded; the calls they make internally are
+	 *             not. Sets that already exist are recorded first, so the
+	 *             trace can be replayed on its own.
+	 *
+	 *             Other operations are recorded as what they do to the LHF:
+	 *             `set_insert_single` as a registration and a union,
+	 *             `set_remove_single_key` as the registration of its result,
+	 *             and `set_filter` and `set_transform` as the registrations of
+	 *             their results on a cache miss.
+	 *
+	 * @note       Conditionally enabled if `LHF_ENABLE_TRACE_RECORDING` is
+	 *             set. Attaching and detaching is not thread-safe, and must
+	 *             be done while the LHF is not in use.
+	 *
+	 * @param      recorder  The recorder
+	 */
+	void set_trace_recorder(TraceRecorder *recorder) {
+		if (recorder == trace_recorder) {
+			return;
+		}
+
+		if constexpr (!is_trace_recordable) {
+			if (recorder) {
+				throw __LHF_EXCEPT("Trace recording requires integral, enum or pointer keys");
+			}
+		}
+
+		std::vector<uint32_t> children;
+		if constexpr (Nesting::is_nested) {
+			std::apply([&](auto &... child) {
+				(child.set_trace_recorder(recorder), ...);
+				(children.push_back(child.trace_instance_id()), ...);
+			}, reflist);
+		}
+
+		trace_recorder = recorder;
+		if (!recorder) {
+			return;
+		}
+
+		trace_instance = recorder->declare_instance(children);
+		for (Size i = 1; i < property_sets.size(); i++) {
+			if (!property_sets.at(i).is_evicted()) {
+				trace_register(Index(i), true);
+			}
+		}
+		recorder->flush_thread();
+	}
+
+	/// The instance number of this LHF in the attached trace recorder.
+	uint32_t trace_instance_id() const {
+		return trace_instance;
+	}
+#endif
+
+	/**
+	 * @brief      Collects structured statistics: operation counters and
+	 *             function timings (if `LHF_ENABLE_PERFORMANCE_METRICS` is
+	 *             set), the number of sets, the distribution of set sizes and
+	 *             the occupancy of the internal maps. This walks over all
+	 *             stored sets, so it is meant to be called periodically
+	 *             rather than per operation.
+	 *
+	 * @return     The report.
+	 */
+	MetricsReport metrics() const {
+		MetricsReport r;
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+		PerformanceStatistics::Snapshot snap = stat.snapshot();
+		r.operations = snap.operations;
+		r.timers = snap.timers;
+		r.dropped_probes = snap.dropped_operations;
+		r.dropped_probes.insert(
+			r.dropped_probes.end(), snap.dropped_timers.begin(), snap.dropped_timers.end());
+#endif
+
+		r.property_set_count = property_sets.size();
+
+		Vector<Size> sizes;
+		sizes.reserve(property_sets.size());
+		for (Size i = 0; i < property_sets.size(); i++) {
+			if (!property_sets.at(i).is_evicted()) {
+				sizes.push_back(property_sets.at(i).get()->size());
+			}
+		}
+
+		if (sizes.size() > 0) {
+			std::sort(sizes.begin(), sizes.end());
+			Size total = 0;
+			for (Size s : sizes) {
+				total += s;
+			}
+			r.set_size.mean = double(total) / sizes.size();
+			r.set_size.p50 = sizes[(sizes.size() - 1) * 50 / 100];
+			r.set_size.p90 = sizes[(sizes.size() - 1) * 90 / 100];
+			r.set_size.p99 = sizes[(sizes.size() - 1) * 99 / 100];
+			r.set_size.max = sizes.back();
+		}
+
+		auto map_metrics = [](const auto &m) {
+			MetricsReport::MapMetrics ret;
+			ret.entries = m.size();
+			ret.buckets = m.bucket_count();
+			return ret;
+		};
+
+		r.maps["property_sets"] = map_metrics(property_set_map);
+		r.maps["unions"] = map_metrics(unions);
+		r.maps["intersections"] = map_metrics(intersections);
+		r.maps["differences"] = map_metrics(differences);
+		r.maps["transforms"] = map_metrics(transforms);
+		r.maps["restrictions"] = map_metrics(restrictions);
+		r.maps["subsets"] = map_metrics(subsets);
+
+		return r;
+	}
+
+	/**
+	 * @brief      Computes the memory held by this instance, broken down into
+	 *             property set payloads, the holder array, the property set
+	 *             map and each operation map, and recursively that of the
+	 *             nested child LHFs. This walks over all stored sets, so it
+	 *             is meant to be called periodically rather than per
+	 *             operation.
+	 *
+	 * @return     The memory usage breakdown.
+	 */
+	MemoryUsage memory_usage() const {
+		MemoryUsage r;
+
+		r.property_sets = property_sets.size();
+		r.holder_bytes = property_sets.capacity_bytes();
+
+		for (Size i = 0; i < property_sets.size(); i++) {
+			const PropertySetHolder &h = property_sets.at(i);
+			if (h.is_evicted()) {
+				continue;
+			}
+
+			r.payload_bytes += sizeof(PropertySet);
+			if constexpr (soa_layout) {
+				r.payload_bytes += h.get()->capacity_bytes();
+			} else {
+				r.payload_bytes += h.get()->capacity() * sizeof(PropertyElement);
+			}
+		}
+
+		r.property_set_map = property_set_map.memory_usage();
+		r.operation_maps["unions"] = unions.memory_usage();
+		r.operation_maps["intersections"] = intersections.memory_usage();
+		r.operation_maps["differences"] = differences.memory_usage();
+		r.operation_maps["transforms"] = transforms.memory_usage();
+		r.operation_maps["restrictions"] = restrictions.memory_usage();
+		r.operation_maps["subsets"] = subsets.memory_usage();
+
+		if constexpr (Nesting::is_nested) {
+			std::apply([&r](const auto &... child) {
+				(r.children.push_back(child.memory_usage()), ...);
+			}, reflist);
+		}
+
+		return r;
+	}
+
 #ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	/**
+	 * @brief      Counts the property sets whose full hash value is shared
+	 *             with a previously registered set. Every such set costs an
+	 *             extra equality comparison when it is probed in the property
+	 *             set map.
+	 * @note       Conditionally enabled if `LHF_ENABLE_PERFORMANCE_METRICS` is
+	 *             set.
+	 * @return     The number of colliding sets.
+	 */
+	Size hash_collisions() const {
+		HashSet<Size> seen;
+		Size collisions = 0;
+		for (Size i = 0; i < property_sets.size(); i++) {
+			if (property_sets.at(i).is_evicted()) {
+				continue;
+			}
+			if (!seen.insert(PropertySetHash()(property_sets.at(i).get())).second) {
+				collisions++;
+			}
+		}
+		return collisions;
+	}
+
+	/**
+	 * @brief      Returns the operation counters and function timings of this
+	 *             LHF, merged over all threads.
+	 * @note       Conditionally enabled if `LHF_ENABLE_PERFORMANCE_METRICS` is
+	 *             set.
+	 */
+	PerformanceStatistics::Snapshot perf_snapshot() const {
+		return stat.snapshot();
+	}
+
 	/**
 	 * @brief      Dumps performance information as a string.
 	 * @note       Conditionally enabled if `LHF_ENABLE_PERFORMANCE_METRICS` is
@@ -2458,10 +4334,11 @@ public:
 	String dump_perf() const {
 		std::stringstream s;
 		s << "Performance Profile: \n";
-		for (auto &p : perf) {
+		for (auto &p : perf_snapshot().operations) {
 			s << p.first << "\n"
 			  << p.second.to_string() << "\n";
 		}
+		s << "hash_collisions: " << hash_collisions() << "\n";
 		s << stat.dump();
 		return s.str();
 	}
@@ -2469,25 +4346,318 @@ public:
 
 }; // END LatticeHashForest
 
+/**
+ * @brief      Hash for strings that also accepts `std::string_view` and C
+ *             strings, so that string keys can be looked up without
+ *             constructing a `String`. Agrees with `std::hash<String>`.
+ */
+struct StringViewHash {
+	using is_transparent = void;
+
+	Size operator()(std::string_view s) const {
+		return std::hash<std::string_view>()(s);
+	}
+};
+
+/**
+ * @brief      Equality for strings that also accepts `std::string_view` and C
+ *             strings. See `StringViewHash`.
+ */
+struct StringViewEqual {
+	using is_transparent = void;
+
+	bool operator()(std::string_view a, std::string_view b) const {
+		return a == b;
+	}
+};
+
+/**
+ * @brief      Whether a hash or equality functor accepts other key types than
+ *             the one it is for, i.e. defines `is_transparent`.
+ */
+template<typename T, typename = void>
+struct IsTransparent: std::false_type {};
+
+template<typename T>
+struct IsTransparent<T, std::void_t<typename T::is_transparent>>: std::true_type {};
+
+/**
+ * @brief      Default hash and equality of a `Deduplicator`. They are
+ *             `DefaultHash` and `DefaultEqual`, except for strings, which use
+ *             the transparent `StringViewHash` and `StringViewEqual`.
+ *
+ * @tparam     T     The property type.
+ */
+template<typename T>
+struct InternDefaults {
+	using Hash = DefaultHash<T>;
+	using Equal = DefaultEqual<T>;
+};
+
+template<>
+struct InternDefaults<String> {
+	using Hash = StringViewHash;
+	using Equal = StringViewEqual;
+};
+
+/**
+ * @brief      Append-only storage of interned values. Values live in chunks
+ *             that double in size and are never moved, so references to them
+ *             stay valid and an index maps to its chunk with a few bit
+ *             operations.
+ *
+ *             `emplace` is for a single writer. `emplace_concurrent` may be
+ *             called from several threads at once, and concurrently with `at`
+ *             on indices that have already been handed out.
+ *
+ * @tparam     T     The value type.
+ */
+template<typename T>
+class InternArena {
+	/// Size of the first chunk is `1 << FIRST_CHUNK_BITS`.
+	static constexpr Size FIRST_CHUNK_BITS = 6;
+	static constexpr Size CHUNK_COUNT = sizeof(Size) * 8 - FIRST_CHUNK_BITS;
+
+	std::atomic<T *> chunks[CHUNK_COUNT] = {};
+	std::atomic<Size> count = 0;
+
+	static Size chunk_of(Size pos) {
+		Size j = (pos >> FIRST_CHUNK_BITS) + 1;
+		return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(j);
+	}
+
+	static Size chunk_base(Size chunk) {
+		return ((Size(1) << chunk) - 1) << FIRST_CHUNK_BITS;
+	}
+
+	static Size chunk_size(Size chunk) {
+		return Size(1) << (chunk + FIRST_CHUNK_BITS);
+	}
+
+	T *slot(Size pos) {
+		Size c = chunk_of(pos);
+		T *chunk = chunks[c].load(std::memory_order_acquire);
+		if (chunk == nullptr) {
+			T *fresh = std::allocator<T>().allocate(chunk_size(c));
+			if (chunks[c].compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+				chunk = fresh;
+			} else {
+				std::allocator<T>().deallocate(fresh, chunk_size(c));
+			}
+		}
+		return chunk + (pos - chunk_base(c));
+	}
+
+public:
+	InternArena() = default;
+	InternArena(const InternArena &) = delete;
+	InternArena &operator=(const InternArena &) = delete;
+
+	~InternArena() {
+		Size n = count.load(std::memory_order_relaxed);
+		for (Size c = 0; c < CHUNK_COUNT; c++) {
+			T *chunk = chunks[c].load(std::memory_order_relaxed);
+			if (chunk == nullptr) {
+				continue;
+			}
+			Size base = chunk_base(c);
+			for (Size i = base; i < std::min(n, base + chunk_size(c)); i++) {
+				chunk[i - base].~T();
+			}
+			std::allocator<T>().deallocate(chunk, chunk_size(c));
+		}
+	}
+
+	/**
+	 * @brief      Constructs a value at the end. Single writer only. If the
+	 *             constructor throws, nothing is added.
+	 *
+	 * @return     Position of the value.
+	 */
+	template<typename... Args>
+	Size emplace(Args &&...args) {
+		Size pos = count.load(std::memory_order_relaxed);
+		new (slot(pos)) T(std::forward<Args>(args)...);
+		count.store(pos + 1, std::memory_order_release);
+		return pos;
+	}
+
+	/**
+	 * @brief      Moves a value to the end. Safe to call from several threads.
+	 *             The position is reserved before the value is in place, so
+	 *             the move must not throw.
+	 *
+	 * @return     Position of the value.
+	 */
+	Size emplace_concurrent(T &&value) {
+		static_assert(
+			std::is_nothrow_move_constructible_v<T>,
+			"Concurrent interning requires a nothrow move constructor.");
+		Size pos = count.fetch_add(1, std::memory_order_relaxed);
+		new (slot(pos)) T(std::move(value));
+		return pos;
+	}
+
+	const T &at(Size pos) const {
+		Size c = chunk_of(pos);
+		return chunks[c].load(std::memory_order_acquire)[pos - chunk_base(c)];
+	}
+
+	/// Number of values. Under concurrent appends this may count values
+	/// that are still being moved into place.
+	Size size() const {
+		return count.load(std::memory_order_acquire);
+	}
+
+	Size capacity_bytes() const {
+		Size ret = 0;
+		for (Size c = 0; c < CHUNK_COUNT; c++) {
+			if (chunks[c].load(std::memory_order_relaxed)) {
+				ret += chunk_size(c) * sizeof(T);
+			}
+		}
+		return ret;
+	}
+};
+
+/**
+ * @brief      Open-addressing hash index of an `InternArena`. Slots hold the
+ *             (mixed) hash and the position of a value, so probing compares
+ *             hashes first and growing never rehashes values. Not thread-safe.
+ */
+class InternTable {
+	struct Slot {
+		Size hash;
+		IndexValue index;
+	};
+
+	static constexpr IndexValue EMPTY_SLOT = std::numeric_limits<IndexValue>::max();
+	static constexpr Size INITIAL_CAPACITY = 16;
+
+	Vector<Slot> slots;
+	Size used = 0;
+
+	void grow() {
+		Vector<Slot> old(std::max(INITIAL_CAPACITY, slots.size() * 2), Slot{ 0, EMPTY_SLOT });
+		old.swap(slots);
+		Size mask = slots.size() - 1;
+		for (const Slot &s : old) {
+			if (s.index != EMPTY_SLOT) {
+				Size pos = s.hash & mask;
+				while (slots[pos].index != EMPTY_SLOT) {
+					pos = (pos + 1) & mask;
+				}
+				slots[pos] = s;
+			}
+		}
+	}
+
+public:
+	/**
+	 * @brief      Scrambles a user-provided hash, which may be the identity
+	 *             (as `std::hash` is for integers), before it picks a slot.
+	 */
+	static Size mix(Size hash) {
+		return __hash_mix(hash ^ 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull);
+	}
+
+	/**
+	 * @brief      Finds the position of a value.
+	 *
+	 * @param[in]  hash   Mixed hash of the value.
+	 * @param[in]  equal  Called with candidate positions of equal hash.
+	 *
+	 * @return     The position, or `EMPTY_SLOT`.
+	 */
+	template<typename Equal>
+	IndexValue find(Size hash, const Equal &equal) const {
+		if (slots.empty()) {
+			return EMPTY_SLOT;
+		}
+		Size mask = slots.size() - 1;
+		for (Size pos = hash & mask; slots[pos].index != EMPTY_SLOT; pos = (pos + 1) & mask) {
+			if (slots[pos].hash == hash && equal(slots[pos].index)) {
+				return slots[pos].index;
+			}
+		}
+		return EMPTY_SLOT;
+	}
+
+	/**
+	 * @brief      Makes room for `index`, so that inserting it does not throw.
+	 *             Throws if it cannot be represented, or memory runs out.
+	 */
+	void prepare(IndexValue index) {
+		if (index == EMPTY_SLOT) {
+			throw IndexOverflowError(
+				"Number of interned values exceeds the range of IndexValue.");
+		}
+		// Keep the load factor at or below 3/4.
+		if ((used + 1) * 4 > slots.size() * 3) {
+			grow();
+		}
+	}
+
+	/**
+	 * @brief      Adds the position of a value that is not in the table yet.
+	 */
+	void insert(Size hash, IndexValue index) {
+		prepare(index);
+		Size mask = slots.size() - 1;
+		Size pos = hash & mask;
+		while (slots[pos].index != EMPTY_SLOT) {
+			pos = (pos + 1) & mask;
+		}
+		slots[pos] = { hash, index };
+		used++;
+	}
+
+	static bool absent(IndexValue index) {
+		return index == EMPTY_SLOT;
+	}
+
+	Size size() const {
+		return used;
+	}
+
+	Size capacity_bytes() const {
+		return slots.capacity() * sizeof(Slot);
+	}
+};
+
 /**
  * @brief      An LHF-like structure for scalar values. It does not implement
- *             any special operations besides deduplication.
+ *             any special operations besides deduplication: every distinct
+ *             value gets a dense index, in order of first registration.
+ *             Interning heavy keys this way before they reach an LHF makes the
+ *             LHF's property type cheap to hash and compare.
+ *
+ *             Values are stored once, in an `InternArena`, and indexed by an
+ *             `InternTable`. A hit allocates nothing. If `PropertyHash` and
+ *             `PropertyEqual` are transparent (define `is_transparent`), any
+ *             key type they accept can be looked up, and a `PropertyT` is
+ *             only constructed from it on a miss. Strings are transparent by
+ *             default (see `InternDefaults`), so they can be interned from a
+ *             `std::string_view`.
+ *
+ *             Not thread-safe. See `ConcurrentDeduplicator`.
  *
  * @tparam     PropertyT      The type of the property.
  *                            The property type must satisfy the following:
- *                            * It must be hashable with std::hash
+ *                            * It must be hashable with PropertyHash
  *                            * It must be less-than comparable
  *                            * It can be checked for equality
  *
  * @tparam     PropertyLess     Custom less-than comparator (if required)
+ * @tparam     PropertyHash     Custom hash (if required)
  * @tparam     PropertyEqual    Custom equality comaparator (if required)
  * @tparam     PropertyPrinter  PropertyT string representation generator
  */
 template <
 	typename PropertyT,
 	typename PropertyLess = DefaultLess<PropertyT>,
-	typename PropertyHash = DefaultHash<PropertyT>,
-	typename PropertyEqual = DefaultEqual<PropertyT>,
+	typename PropertyHash = typename InternDefaults<PropertyT>::Hash,
+	typename PropertyEqual = typename InternDefaults<PropertyT>::Equal,
 	typename PropertyPrinter = DefaultPrinter<PropertyT>>
 struct Deduplicator {
 	/**
@@ -2520,50 +4690,240 @@ struct Deduplicator {
 		}
 	};
 
-
-	using PropertyMap =
-		std::unordered_map<
-			PropertyT *, IndexValue,
-			PropertyHash,
-			PropertyEqual>;
+protected:
+	template<typename K>
+	using EnableLookup = std::enable_if_t<
+		std::is_same_v<K, PropertyT> ||
+		(IsTransparent<PropertyHash>::value && IsTransparent<PropertyEqual>::value)>;
 
 	// The property storage array.
-	Vector<UniquePointer<PropertyT>> property_list = {};
+	InternArena<PropertyT> property_list;
 
-	// The property -> Index in storage array mapping.
-	PropertyMap property_map = {};
+	// Hash index of the property storage.
+	InternTable property_map;
+
+	template<typename K>
+	IndexValue lookup(Size hash, const K &key) const {
+		return property_map.find(hash, [&](IndexValue i) {
+			return PropertyEqual()(property_list.at(i), key);
+		});
+	}
+
+public:
+	Deduplicator() = default;
+	Deduplicator(const Deduplicator &) = delete;
+	Deduplicator &operator=(const Deduplicator &) = delete;
 
 	/**
 	 * @brief         Inserts a (or gets an existing) element into property
-	                  storage.
+	 *                storage.
 	 *
-	 * @param[in]  c  The single-element property set.
+	 * @param[in]  c  The value, or with transparent `PropertyHash` and
+	 *                `PropertyEqual` any key they accept. `PropertyT` must be
+	 *                constructible from it.
 	 *
-	 * @return        Index of the newly created/existing set.
+	 * @return        Index of the newly created/existing value.
+	 */
+	template<typename K = PropertyT, typename = EnableLookup<K>>
+	Index register_value(const K &c) {
+		Size hash = InternTable::mix(PropertyHash()(c));
+		IndexValue found = lookup(hash, c);
+
+		if (InternTable::absent(found)) {
+			// Everything that can throw happens before the value is indexed.
+			IndexValue ret = to_index_value(property_list.size());
+			property_map.prepare(ret);
+			property_list.emplace(c);
+			property_map.insert(hash, ret);
+			return Index(ret);
+		}
+
+		return Index(found);
+	}
+
+	/**
+	 * @brief      Looks up a value without registering it.
 	 *
-	 * @todo          Check whether the cache hit check can be removed.
+	 * @param[in]  c     The value or key (see `register_value`).
+	 *
+	 * @return     Its index, or absent if it was never registered.
+	 */
+	template<typename K = PropertyT, typename = EnableLookup<K>>
+	Optional<Index> find(const K &c) const {
+		IndexValue found = lookup(InternTable::mix(PropertyHash()(c)), c);
+		if (InternTable::absent(found)) {
+			return Optional<Index>::absent();
+		}
+		return Optional<Index>(Index(found));
+	}
+
+	/**
+	 * @brief      Gets the value at an index.
+	 */
+	const PropertyT &get_value(const Index &index) const {
+		return property_list.at(index.value);
+	}
+
+	/**
+	 * @brief      Number of distinct values registered.
 	 */
-	Index register_value(const PropertyT &c) {
+	Size size() const {
+		return property_list.size();
+	}
 
-		UniquePointer<PropertyT> new_value =
-			UniquePointer<PropertyT>(new PropertyT{c});
+	/**
+	 * @brief      Bytes allocated for values and the hash index.
+	 */
+	Size capacity_bytes() const {
+		return property_list.capacity_bytes() + property_map.capacity_bytes();
+	}
 
-		auto cursor = property_map.find(new_value.get());
+};
 
-		if (cursor == property_map.end()) {
-			// LHF_PERF_INC(property_sets, cold_misses);
-			property_list.push_back(std::move(new_value));
-			IndexValue ret = property_list.size() - 1;
-			property_map.insert(std::make_pair(property_list[ret].get(), ret));
-			return Index(ret);
+#ifdef LHF_ENABLE_PARALLEL
+
+/**
+ * @brief      Thread-safe `Deduplicator`. The hash index is split into
+ *             `1 << SHARD_BITS` shards by the top bits of the hash, each
+ *             behind its own reader-writer lock, so registrations of
+ *             different values rarely contend, and hits only take a shared
+ *             lock. Indices stay dense: all shards append to one
+ *             `InternArena`.
+ *
+ *             `get_value` does not lock. It is safe for any index returned by
+ *             `register_value` or `find`, including ones registered by other
+ *             threads.
+ *
+ * @tparam     SHARD_BITS  Log2 of the shard count.
+ *
+ * @see        Deduplicator for the other parameters. `PropertyT` must be
+ *             nothrow move constructible.
+ */
+template <
+	typename PropertyT,
+	typename PropertyLess = DefaultLess<PropertyT>,
+	typename PropertyHash = typename InternDefaults<PropertyT>::Hash,
+	typename PropertyEqual = typename InternDefaults<PropertyT>::Equal,
+	typename PropertyPrinter = DefaultPrinter<PropertyT>,
+	Size SHARD_BITS = 6>
+struct ConcurrentDeduplicator {
+	using Index = typename Deduplicator<
+		PropertyT, PropertyLess, PropertyHash, PropertyEqual, PropertyPrinter>::Index;
+
+protected:
+	template<typename K>
+	using EnableLookup = std::enable_if_t<
+		std::is_same_v<K, PropertyT> ||
+		(IsTransparent<PropertyHash>::value && IsTransparent<PropertyEqual>::value)>;
+
+	struct alignas(64) Shard {
+		mutable RWMutex mutex;
+		InternTable table;
+	};
+
+	InternArena<PropertyT> property_list;
+	Shard shards[Size(1) << SHARD_BITS];
+
+	Shard &shard_of(Size hash) {
+		return shards[hash >> (sizeof(Size) * 8 - SHARD_BITS)];
+	}
+
+	const Shard &shard_of(Size hash) const {
+		return shards[hash >> (sizeof(Size) * 8 - SHARD_BITS)];
+	}
+
+	template<typename K>
+	IndexValue lookup(const Shard &shard, Size hash, const K &key) const {
+		return shard.table.find(hash, [&](IndexValue i) {
+			return PropertyEqual()(property_list.at(i), key);
+		});
+	}
+
+public:
+	ConcurrentDeduplicator() = default;
+	ConcurrentDeduplicator(const ConcurrentDeduplicator &) = delete;
+	ConcurrentDeduplicator &operator=(const ConcurrentDeduplicator &) = delete;
+
+	/**
+	 * @brief      Inserts a (or gets an existing) element into property
+	 *             storage. See `Deduplicator::register_value`.
+	 */
+	template<typename K = PropertyT, typename = EnableLookup<K>>
+	Index register_value(const K &c) {
+		Size hash = InternTable::mix(PropertyHash()(c));
+		Shard &shard = shard_of(hash);
+
+		{
+			ReadLock m(shard.mutex);
+			IndexValue found = lookup(shard, hash, c);
+			if (!InternTable::absent(found)) {
+				return Index(found);
+			}
+		}
+
+		// Constructed before locking, so that a throwing constructor leaves
+		// nothing behind and does not hold up the shard.
+		PropertyT value(c);
+
+		WriteLock m(shard.mutex);
+		IndexValue found = lookup(shard, hash, c);
+		if (!InternTable::absent(found)) {
+			return Index(found);
+		}
+
+		shard.table.prepare(to_index_value(property_list.size()));
+		IndexValue ret = to_index_value(property_list.emplace_concurrent(std::move(value)));
+		shard.table.insert(hash, ret);
+		return Index(ret);
+	}
+
+	/**
+	 * @brief      Looks up a value without registering it. See
+	 *             `Deduplicator::find`.
+	 */
+	template<typename K = PropertyT, typename = EnableLookup<K>>
+	Optional<Index> find(const K &c) const {
+		Size hash = InternTable::mix(PropertyHash()(c));
+		const Shard &shard = shard_of(hash);
+		ReadLock m(shard.mutex);
+		IndexValue found = lookup(shard, hash, c);
+		if (InternTable::absent(found)) {
+			return Optional<Index>::absent();
 		}
+		return Optional<Index>(Index(found));
+	}
 
-		// LHF_PERF_INC(property_sets, hits);
-		return Index(cursor->second);
+	/**
+	 * @brief      Gets the value at an index.
+	 */
+	const PropertyT &get_value(const Index &index) const {
+		return property_list.at(index.value);
 	}
 
+	/**
+	 * @brief      Number of distinct values registered. While registrations
+	 *             are running, this may include values that are not yet
+	 *             visible.
+	 */
+	Size size() const {
+		return property_list.size();
+	}
+
+	/**
+	 * @brief      Bytes allocated for values and the hash index.
+	 */
+	Size capacity_bytes() const {
+		Size ret = property_list.capacity_bytes();
+		for (const Shard &s : shards) {
+			ReadLock m(s.mutex);
+			ret += s.table.capacity_bytes();
+		}
+		return ret;
+	}
 };
 
+#endif
+
 }; // END NAMESPACE
 
 #endif
@@ -11,4 +11,35 @@
 #define LHF_DEFAULT_BLOCK_MASK (LHF_DEFAULT_BLOCK_SIZE - 1)
 #define LHF_DISABLE_INTERNAL_INTEGRITY_CHECK true
 
+// Probe instrumentation (see profiling.hpp). Maximum number of distinct timed
+// functions and counted operations, number of log2 latency buckets, fraction of
+// calls that get timed (one in LHF_PROBE_SAMPLE_INTERVAL, a power of two) and
+// number of per-thread shard cache slots.
+#ifndef LHF_PROBE_MAX_TIMERS
+#define LHF_PROBE_MAX_TIMERS 32
+#endif
+#ifndef LHF_PROBE_MAX_OPERATIONS
+#define LHF_PROBE_MAX_OPERATIONS 16
+#endif
+#ifndef LHF_PROBE_HISTOGRAM_BUCKETS
+#define LHF_PROBE_HISTOGRAM_BUCKETS 40
+#endif
+#ifndef LHF_PROBE_SAMPLE_INTERVAL
+#define LHF_PROBE_SAMPLE_INTERVAL 64
+#endif
+#ifndef LHF_PROBE_SHARD_CACHE_SIZE
+#define LHF_PROBE_SHARD_CACHE_SIZE 8
+#endif
+
+// Integer type of set indices. Defining LHF_ENABLE_32BIT_INDEX halves the size
+// of indices, operation cache keys and nested child references, and limits an
+// LHF instance to 2^32 - 1 property sets.
+#ifndef LHF_INDEX_VALUE_TYPE
+#ifdef LHF_ENABLE_32BIT_INDEX
+#define LHF_INDEX_VALUE_TYPE std::uint32_t
+#else
+#define LHF_INDEX_VALUE_TYPE std::size_t
+#endif
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,529 @@
+/**
+ * @file metrics.hpp
+ * @brief Machine-readable export of LHF statistics (JSON lines and the
+ *        Prometheus text exposition format), and a periodic writer.
+ */
+
+#ifndef LHF_METRICS_HPP
+#define LHF_METRICS_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define LHF_METRICS_ENABLE_SOCKET
+#ifdef MSG_NOSIGNAL
+#define LHF_METRICS_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define LHF_METRICS_SEND_FLAGS 0
+#endif
+#endif
+
+#include "profiling.hpp"
+
+namespace lhf {
+
+/**
+ * @brief      Escapes a string for use inside JSON or Prometheus label values.
+ */
+inline std::string metrics_escape(const std::string &s) {
+	std::string ret;
+	ret.reserve(s.size());
+	for (char c : s) {
+		if (c == '"' || c == '\\') {
+			ret += '\\';
+			ret += c;
+		} else if (c == '\n') {
+			ret += "\\n";
+		} else {
+			ret += c;
+		}
+	}
+	return ret;
+}
+
+/**
+ * @brief      Additional values that are derived from consecutive reports.
+ */
+struct MetricsDelta {
+	/// Seconds since the epoch at which the report was taken.
+	double timestamp = 0;
+
+	/// Rate of change of the number of property sets since the previous
+	/// report, in sets per second.
+	double set_growth_per_s = 0;
+};
+
+/**
+ * @brief      Serializes a report as a single line of JSON.
+ *
+ * @param[in]  r      The report
+ * @param[in]  name   Name of the LHF instance
+ * @param[in]  delta  Values derived from the previous report
+ *
+ * @return     The JSON object, without a trailing newline.
+ */
+inline std::string metrics_to_json(
+	const MetricsReport &r,
+	const std::string &name,
+	const MetricsDelta &delta = {}) {
+	std::stringstream s;
+	s << std::setprecision(10);
+
+	s << "{\"timestamp\":" << delta.timestamp
+	  << ",\"lhf\":\"" << metrics_escape(name) << "\""
+	  << ",\"property_sets\":" << r.property_set_count
+	  << ",\"set_growth_per_s\":" << delta.set_growth_per_s;
+
+	s << ",\"set_size\":{"
+	  << "\"mean\":" << r.set_size.mean
+	  << ",\"p50\":" << r.set_size.p50
+	  << ",\"p90\":" << r.set_size.p90
+	  << ",\"p99\":" << r.set_size.p99
+	  << ",\"max\":" << r.set_size.max << "}";
+
+	s << ",\"maps\":{";
+	bool first = true;
+	for (auto &m : r.maps) {
+		s << (first ? "" : ",") << "\"" << metrics_escape(m.first) << "\":{"
+		  << "\"entries\":" << m.second.entries
+		  << ",\"buckets\":" << m.second.buckets
+		  << ",\"load_factor\":" << m.second.load_factor() << "}";
+		first = false;
+	}
+	s << "}";
+
+	s << ",\"operations\":{";
+	first = true;
+	for (auto &o : r.operations) {
+		const OperationPerf &p = o.second;
+		s << (first ? "" : ",") << "\"" << metrics_escape(o.first) << "\":{"
+		  << "\"hits\":" << p.hits
+		  << ",\"equal_hits\":" << p.equal_hits
+		  << ",\"subset_hits\":" << p.subset_hits
+		  << ",\"empty_hits\":" << p.empty_hits
+		  << ",\"cold_misses\":" << p.cold_misses
+		  << ",\"edge_misses\":" << p.edge_misses
+		  << ",\"hit_ratio\":" << p.hit_ratio() << "}";
+		first = false;
+	}
+	s << "}";
+
+	s << ",\"timers\":{";
+	first = true;
+	for (auto &t : r.timers) {
+		s << (first ? "" : ",") << "\"" << metrics_escape(t.name) << "\":{"
+		  << "\"calls\":" << t.calls
+		  << ",\"sampled\":" << t.sampled
+		  << ",\"mean_ns\":" << t.mean_ns()
+		  << ",\"p50_ns\":" << t.percentile_ns(0.5)
+		  << ",\"p99_ns\":" << t.percentile_ns(0.99)
+		  << ",\"estimated_total_ms\":" << t.estimated_total_ms() << "}";
+		first = false;
+	}
+	s << "}";
+
+	s << ",\"dropped_probes\":[";
+	first = true;
+	for (auto &name : r.dropped_probes) {
+		s << (first ? "" : ",") << "\"" << metrics_escape(name) << "\"";
+		first = false;
+	}
+	s << "]}";
+
+	return s.str();
+}
+
+/**
+ * @brief      Serializes reports of several LHF instances in the Prometheus
+ *             text exposition format. Each metric family is emitted once, with
+ *             the instance name as the `lhf` label.
+ *
+ * @param[in]  reports  Pairs of instance name and report
+ * @param[in]  deltas   Values derived from the previous reports, in the same
+ *                      order as `reports`
+ *
+ * @return     The exposition text.
+ */
+inline std::string metrics_to_prometheus(
+	const std::vector<std::pair<std::string, MetricsReport>> &reports,
+	const std::vector<MetricsDelta> &deltas = {}) {
+	std::stringstream s;
+	s << std::setprecision(10);
+
+	auto family = [&s](const char *name, const char *type, const char *help) {
+		s << "# HELP " << name << " " << help << "\n"
+		  << "# TYPE " << name << " " << type << "\n";
+	};
+
+	auto label = [](const std::string &lhf) {
+		return "lhf=\"" + metrics_escape(lhf) + "\"";
+	};
+
+	family("lhf_property_sets", "gauge", "Number of stored property sets.");
+	for (auto &r : reports) {
+		s << "lhf_property_sets{" << label(r.first) << "} "
+		  << r.second.property_set_count << "\n";
+	}
+
+	family("lhf_property_sets_growth_per_second", "gauge",
+		"Growth rate of the number of property sets since the previous snapshot.");
+	for (size_t i = 0; i < reports.size(); i++) {
+		s << "lhf_property_sets_growth_per_second{" << label(reports[i].first) << "} "
+		  << (i < deltas.size() ? deltas[i].set_growth_per_s : 0) << "\n";
+	}
+
+	family("lhf_set_size", "gauge", "Distribution of property set cardinalities.");
+	for (auto &r : reports) {
+		const MetricsReport::SizeDistribution &d = r.second.set_size;
+		std::string l = label(r.first);
+		s << "lhf_set_size{" << l << ",stat=\"mean\"} " << d.mean << "\n"
+		  << "lhf_set_size{" << l << ",stat=\"p50\"} " << d.p50 << "\n"
+		  << "lhf_set_size{" << l << ",stat=\"p90\"} " << d.p90 << "\n"
+		  << "lhf_set_size{" << l << ",stat=\"p99\"} " << d.p99 << "\n"
+		  << "lhf_set_size{" << l << ",stat=\"max\"} " << d.max << "\n";
+	}
+
+	family("lhf_map_entries", "gauge", "Number of entries in an internal map.");
+	for (auto &r : reports) {
+		for (auto &m : r.second.maps) {
+			s << "lhf_map_entries{" << label(r.first) << ",map=\""
+			  << metrics_escape(m.first) << "\"} " << m.second.entries << "\n";
+		}
+	}
+
+	family("lhf_map_load_factor", "gauge", "Load factor of an internal map.");
+	for (auto &r : reports) {
+		for (auto &m : r.second.maps) {
+			s << "lhf_map_load_factor{" << label(r.first) << ",map=\""
+			  << metrics_escape(m.first) << "\"} " << m.second.load_factor() << "\n";
+		}
+	}
+
+	family("lhf_operations_total", "counter", "Invocations of an operation by outcome.");
+	for (auto &r : reports) {
+		for (auto &o : r.second.operations) {
+			std::string l = label(r.first) + ",operation=\"" + metrics_escape(o.first) + "\"";
+			const OperationPerf &p = o.second;
+			s << "lhf_operations_total{" << l << ",result=\"hits\"} " << p.hits << "\n"
+			  << "lhf_operations_total{" << l << ",result=\"equal_hits\"} " << p.equal_hits << "\n"
+			  << "lhf_operations_total{" << l << ",result=\"subset_hits\"} " << p.subset_hits << "\n"
+			  << "lhf_operations_total{" << l << ",result=\"empty_hits\"} " << p.empty_hits << "\n"
+			  << "lhf_operations_total{" << l << ",result=\"cold_misses\"} " << p.cold_misses << "\n"
+			  << "lhf_operations_total{" << l << ",result=\"edge_misses\"} " << p.edge_misses << "\n";
+		}
+	}
+
+	family("lhf_operation_hit_ratio", "gauge",
+		"Fraction of invocations of an operation that did not compute a new set.");
+	for (auto &r : reports) {
+		for (auto &o : r.second.operations) {
+			s << "lhf_operation_hit_ratio{" << label(r.first) << ",operation=\""
+			  << metrics_escape(o.first) << "\"} " << o.second.hit_ratio() << "\n";
+		}
+	}
+
+	family("lhf_function_calls_total", "counter", "Calls of an instrumented function.");
+	for (auto &r : reports) {
+		for (auto &t : r.second.timers) {
+			s << "lhf_function_calls_total{" << label(r.first) << ",function=\""
+			  << metrics_escape(t.name) << "\"} " << t.calls << "\n";
+		}
+	}
+
+	family("lhf_function_latency_ns", "gauge",
+		"Sampled latency of an instrumented function.");
+	for (auto &r : reports) {
+		for (auto &t : r.second.timers) {
+			std::string l = label(r.first) + ",function=\"" + metrics_escape(t.name) + "\"";
+			s << "lhf_function_latency_ns{" << l << ",stat=\"mean\"} " << t.mean_ns() << "\n"
+			  << "lhf_function_latency_ns{" << l << ",stat=\"p50\"} " << t.percentile_ns(0.5) << "\n"
+			  << "lhf_function_latency_ns{" << l << ",stat=\"p99\"} " << t.percentile_ns(0.99) << "\n";
+		}
+	}
+
+	family("lhf_dropped_probes", "gauge",
+		"Number of probes not recorded because the probe name tables are full.");
+	for (auto &r : reports) {
+		s << "lhf_dropped_probes{" << label(r.first) << "} " << r.second.dropped_probes.size() << "\n";
+	}
+
+	return s.str();
+}
+
+/**
+ * @brief      Periodically writes reports of one or more LHF instances.
+ *
+ *             The writer has no thread of its own: the analysis calls
+ *             `poll()` from its main loop, and a report is written whenever
+ *             the interval has elapsed. This keeps collection on the thread
+ *             that owns the LHFs, so it is safe with every storage variant.
+ *
+ *             Destinations:
+ *
+ *             * `JSON_LINES`: one JSON object per instance and snapshot,
+ *               appended to a file.
+ *             * `PROMETHEUS`: the latest exposition, atomically replacing a
+ *               file (suitable for a textfile collector).
+ *             * `PROMETHEUS` over a Unix domain socket (`listen_unix()`):
+ *               every client that connects receives the latest exposition.
+ *               Clients are written to without blocking; a client that
+ *               cannot take the whole exposition at once, or has already
+ *               disconnected, is dropped.
+ */
+class MetricsWriter {
+public:
+	enum Format {
+		JSON_LINES,
+		PROMETHEUS
+	};
+
+	using Source = std::function<MetricsReport()>;
+
+protected:
+	struct SourceEntry {
+		std::string name;
+		Source source;
+		bool has_previous = false;
+		uint64_t previous_count = 0;
+		double previous_time = 0;
+	};
+
+	Format format;
+	std::string path;
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point last_write;
+	bool written_once = false;
+	std::vector<SourceEntry> sources;
+	std::string latest;
+	bool active = false;
+	int listen_fd = -1;
+	std::string socket_path;
+
+	static double now_seconds() {
+		using namespace std::chrono;
+		return duration_cast<duration<double>>(system_clock::now().time_since_epoch()).count();
+	}
+
+	void serve_clients() {
+#ifdef LHF_METRICS_ENABLE_SOCKET
+		if (listen_fd < 0) {
+			return;
+		}
+
+		int client;
+		while ((client = accept(listen_fd, nullptr, nullptr)) >= 0) {
+			// Accepted sockets do not inherit O_NONBLOCK. A client that
+			// stops reading must not block the analysis, and one that has
+			// gone away must not raise SIGPIPE, so such clients are dropped.
+			fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+			int one = 1;
+			setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+			const char *data = latest.data();
+			size_t left = latest.size();
+			while (left > 0) {
+				ssize_t n = send(client, data, left, LHF_METRICS_SEND_FLAGS);
+				if (n < 0 && errno == EINTR) {
+					continue;
+				}
+				if (n <= 0) {
+					// EAGAIN, EPIPE, ECONNRESET etc.
+					break;
+				}
+				data += n;
+				left -= n;
+			}
+			close(client);
+		}
+#endif
+	}
+
+public:
+	/**
+	 * @param[in]  format      Output format
+	 * @param[in]  path        Output file. May be empty if only a socket is
+	 *                         used.
+	 * @param[in]  interval_s  Minimum number of seconds between two reports
+	 */
+	MetricsWriter(Format format, const std::string &path, double interval_s = 60):
+		format(format),
+		path(path),
+		interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(interval_s))) {}
+
+	MetricsWriter(const MetricsWriter &) = delete;
+	MetricsWriter &operator=(const MetricsWriter &) = delete;
+
+	~MetricsWriter() {
+#ifdef LHF_METRICS_ENABLE_SOCKET
+		if (listen_fd >= 0) {
+			close(listen_fd);
+			unlink(socket_path.c_str());
+		}
+#endif
+	}
+
+	/**
+	 * @brief      Adds a report source under the given name.
+	 */
+	void add_source(const std::string &name, Source source) {
+		sources.push_back({name, std::move(source)});
+	}
+
+	/**
+	 * @brief      Adds an LHF instance (or anything with a `metrics()` member)
+	 *             under the given name. The instance must outlive the writer.
+	 */
+	template<typename LHF>
+	void add(const std::string &name, const LHF &lhf) {
+		add_source(name, [&lhf]() { return lhf.metrics(); });
+	}
+
+	/**
+	 * @brief      Serves the Prometheus exposition on a Unix domain socket at
+	 *             `socket_path`. Clients are served during `poll()`.
+	 *
+	 * @return     Whether the socket could be created.
+	 */
+	bool listen_unix(const std::string &socket_path) {
+#ifdef LHF_METRICS_ENABLE_SOCKET
+		sockaddr_un addr = {};
+		if (socket_path.size() >= sizeof(addr.sun_path)) {
+			return false;
+		}
+
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return false;
+		}
+
+		addr.sun_family = AF_UNIX;
+		std::copy(socket_path.begin(), socket_path.end(), addr.sun_path);
+		unlink(socket_path.c_str());
+
+		if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+		    listen(fd, 8) < 0) {
+			close(fd);
+			return false;
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		listen_fd = fd;
+		this->socket_path = socket_path;
+		return true;
+#else
+		(void) socket_path;
+		return false;
+#endif
+	}
+
+	/// Enables writing. Writing is disabled on construction.
+	void enable() {
+		active = true;
+	}
+
+	/// Disables writing. Already connected clients are still served.
+	void disable() {
+		active = false;
+	}
+
+	bool is_enabled() const {
+		return active;
+	}
+
+	/**
+	 * @brief      Writes a report if enabled and the interval has elapsed,
+	 *             and serves pending socket clients. Cheap enough to call
+	 *             from an analysis main loop.
+	 *
+	 * @return     Whether a report was written.
+	 */
+	bool poll() {
+		bool written = false;
+		if (active) {
+			auto now = std::chrono::steady_clock::now();
+			if (!written_once || now - last_write >= interval) {
+				write();
+				written = true;
+			}
+		}
+		serve_clients();
+		return written;
+	}
+
+	/**
+	 * @brief      Collects and writes a report of every source immediately.
+	 */
+	void write() {
+		last_write = std::chrono::steady_clock::now();
+		written_once = true;
+		double timestamp = now_seconds();
+
+		std::vector<std::pair<std::string, MetricsReport>> reports;
+		std::vector<MetricsDelta> deltas;
+
+		for (SourceEntry &e : sources) {
+			MetricsReport r = e.source();
+			MetricsDelta d;
+			d.timestamp = timestamp;
+			if (e.has_previous && timestamp > e.previous_time) {
+				d.set_growth_per_s =
+					(double(r.property_set_count) - double(e.previous_count)) /
+					(timestamp - e.previous_time);
+			}
+			e.has_previous = true;
+			e.previous_count = r.property_set_count;
+			e.previous_time = timestamp;
+
+			reports.push_back({e.name, std::move(r)});
+			deltas.push_back(d);
+		}
+
+		if (format == JSON_LINES) {
+			std::stringstream s;
+			for (size_t i = 0; i < reports.size(); i++) {
+				s << metrics_to_json(reports[i].second, reports[i].first, deltas[i]) << "\n";
+			}
+			latest = s.str();
+
+			if (!path.empty()) {
+				std::ofstream out(path, std::ios::app);
+				out << latest;
+			}
+		} else {
+			latest = metrics_to_prometheus(reports, deltas);
+
+			if (!path.empty()) {
+				std::string tmp = path + ".tmp";
+				{
+					std::ofstream out(tmp, std::ios::trunc);
+					out << latest;
+				}
+				std::rename(tmp.c_str(), path.c_str());
+			}
+		}
+	}
+
+	/// The most recently written output.
+	const std::string &latest_output() const {
+		return latest;
+	}
+};
+
+}
+
+#endif
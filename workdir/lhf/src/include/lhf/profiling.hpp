@@ -6,22 +6,252 @@
 #ifndef LHF_PROFILING_H
 #define LHF_PROFILING_H
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define LHF_PROBE_USE_TSC
+#endif
 
 #include "lhf_config.hpp"
 
 namespace lhf {
 
+/**
+ * @brief      Reads the probe clock. This is the TSC on x86, and nanoseconds
+ *             of `std::chrono::steady_clock` elsewhere.
+ */
+inline uint64_t probe_ticks() {
+#ifdef LHF_PROBE_USE_TSC
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief      Returns the number of probe clock ticks per nanosecond. The
+ *             first call records a reference point, and later calls measure
+ *             against it.
+ */
+inline double probe_ticks_per_ns() {
+#ifdef LHF_PROBE_USE_TSC
+	using namespace std::chrono;
+	static const steady_clock::time_point t0 = steady_clock::now();
+	static const uint64_t c0 = probe_ticks();
+
+	steady_clock::time_point t1 = steady_clock::now();
+	while (duration_cast<nanoseconds>(t1 - t0).count() < 1000000) {
+		t1 = steady_clock::now();
+	}
+
+	uint64_t c1 = probe_ticks();
+	return double(c1 - c0) / double(duration_cast<nanoseconds>(t1 - t0).count());
+#else
+	return 1.0;
+#endif
+}
+
+/**
+ * @brief      Gets the latency histogram bucket of a tick count. Bucket `b`
+ *             holds durations in [2^(b-1), 2^b) ticks.
+ */
+inline std::size_t probe_bucket(uint64_t ticks) {
+	std::size_t b = 0;
+#if defined(__GNUC__) || defined(__clang__)
+	b = ticks == 0 ? 0 : 64 - __builtin_clzll(ticks);
+#else
+	while (ticks) {
+		ticks >>= 1;
+		b++;
+	}
+#endif
+	return b < LHF_PROBE_HISTOGRAM_BUCKETS ? b : LHF_PROBE_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * @brief      Counter with a single writer (the owning thread) and any number
+ *             of readers. Increments do not need a locked instruction.
+ */
+struct ProbeCounter {
+	std::atomic<uint64_t> value{0};
+
+	void add(uint64_t n = 1) {
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	uint64_t get() const {
+		return value.load(std::memory_order_relaxed);
+	}
+};
+
+/**
+ * @brief      Process-wide table that assigns small integer IDs to probe
+ *             names. Each instrumented call site looks its name up once and
+ *             keeps the ID in a function-local static.
+ */
+class ProbeNameTable {
+	mutable std::mutex mutex;
+	std::vector<std::string> names;
+	std::vector<std::string> overflow;
+	std::size_t capacity;
+
+public:
+	explicit ProbeNameTable(std::size_t capacity): capacity(capacity) {}
+
+	/// Gets the ID of `name`, creating it if needed. Returns `capacity()` if
+	/// the table is full, in which case the probe is not recorded and its
+	/// name is listed in `overflowed()`. Debug builds throw instead.
+	std::size_t id(const std::string &name) {
+		std::lock_guard<std::mutex> m(mutex);
+		for (std::size_t i = 0; i < names.size(); i++) {
+			if (names[i] == name) {
+				return i;
+			}
+		}
+
+		if (names.size() >= capacity) {
+			if (std::find(overflow.begin(), overflow.end(), name) == overflow.end()) {
+				overflow.push_back(name);
+			}
+#ifdef LHF_ENABLE_DEBUG
+			throw std::length_error(
+				"Probe '" + name + "' exceeds the probe name table capacity of " +
+				std::to_string(capacity) + " (raise LHF_PROBE_MAX_TIMERS or "
+				"LHF_PROBE_MAX_OPERATIONS)");
+#endif
+			return capacity;
+		}
+
+		names.push_back(name);
+		return names.size() - 1;
+	}
+
+	std::string name(std::size_t id) const {
+		std::lock_guard<std::mutex> m(mutex);
+		return names.at(id);
+	}
+
+	std::size_t size() const {
+		std::lock_guard<std::mutex> m(mutex);
+		return names.size();
+	}
+
+	std::size_t max_size() const {
+		return capacity;
+	}
+
+	/// Names of the probes that did not fit in the table, and are therefore
+	/// not recorded.
+	std::vector<std::string> overflowed() const {
+		std::lock_guard<std::mutex> m(mutex);
+		return overflow;
+	}
+
+	/// Names of timed functions.
+	static ProbeNameTable &timers() {
+		static ProbeNameTable table(LHF_PROBE_MAX_TIMERS);
+		return table;
+	}
+
+	/// Names of operations counted with `LHF_PERF_INC`.
+	static ProbeNameTable &operations() {
+		static ProbeNameTable table(LHF_PROBE_MAX_OPERATIONS);
+		return table;
+	}
+};
+
+/**
+ * @brief      Indices of the fields of `OperationPerf`, used to address the
+ *             thread-local counters behind `LHF_PERF_INC`.
+ */
+struct OperationPerfField {
+	enum {
+		hits,
+		equal_hits,
+		subset_hits,
+		empty_hits,
+		cold_misses,
+		edge_misses,
+		count
+	};
+};
+
+/**
+ * @brief      Operation performance Statistics.
+ */
+struct OperationPerf {
+	/// Number of direct hits (operation pair in map)
+	size_t hits = 0;
+
+	/// Number of equal hits (both arguments consist of the same set)
+	size_t equal_hits = 0;
+
+	/// Number of subset hits (operation pair not in but resolvable using
+	/// subset relation)
+	size_t subset_hits = 0;
+
+	/// Number of empty hits (operation is optimised because at least one of
+	/// the sets is empty)
+	size_t empty_hits = 0;
+
+	/// Number of cold misses (operation pair not in map, and neither
+	/// resultant set in map. Neither node in lattice exists, nor the edges)
+	size_t cold_misses = 0;
+
+	/// Number of edge misses (operation pair not in map, but resultant set
+	/// in map. Node in lattice exists, but not the edges)
+	size_t edge_misses = 0;
+
+	/// Total number of invocations.
+	size_t total() const {
+		return hits + equal_hits + subset_hits + empty_hits + cold_misses + edge_misses;
+	}
+
+	/// Fraction of invocations that did not have to compute a new set.
+	double hit_ratio() const {
+		size_t t = total();
+		return t ? double(hits + equal_hits + subset_hits + empty_hits) / t : 0;
+	}
+
+	std::string to_string() const {
+		std::stringstream s;
+		s << "      " << "Hits       : " << hits << "\n"
+		  << "      " << "Equal Hits : " << equal_hits << "\n"
+		  << "      " << "Subset Hits: " << subset_hits << "\n"
+		  << "      " << "Empty Hits : " << empty_hits << "\n"
+		  << "      " << "Cold Misses: " << cold_misses << "\n"
+		  << "      " << "Edge Misses: " << edge_misses << "\n";
+		return s.str();
+	}
+};
+
 /**
  * @brief      Utility class for enabling code-based profiling.
+ *
+ *             Function timers and operation counters live in per-thread
+ *             shards that only their own thread writes to, so the hot path
+ *             takes no locks and does no string lookups. Only one in every
+ *             `LHF_PROBE_SAMPLE_INTERVAL` calls of a timed function reads the
+ *             clock. Shards are merged when a snapshot is taken.
+ *
+ *             The string-keyed `timer_start`/`timer_end`/`inc_counter`
+ *             functions remain for coarse, user-level measurements.
  */
 struct PerformanceStatistics {
 	using Count = uint64_t;
@@ -33,7 +263,7 @@ struct PerformanceStatistics {
 	using WriteLock = std::lock_guard<std::mutex>;
 	using ThreadID = std::thread::id;
 
-	std::mutex mutex;
+	mutable std::mutex mutex;
 
 	struct Duration {
 		bool started = false;
@@ -51,9 +281,205 @@ struct PerformanceStatistics {
 		long double get_cumul_duration_ms() { return duration; }
 	};
 
+	/**
+	 * @brief      Statistics of one timed function in one thread.
+	 */
+	struct ProbeTimer {
+		ProbeCounter calls;
+		ProbeCounter sampled;
+		ProbeCounter ticks;
+		ProbeCounter histogram[LHF_PROBE_HISTOGRAM_BUCKETS];
+	};
+
+	/**
+	 * @brief      Counters written by a single thread.
+	 */
+	struct ThreadShard {
+		ProbeTimer timers[LHF_PROBE_MAX_TIMERS];
+		ProbeCounter operations[LHF_PROBE_MAX_OPERATIONS][OperationPerfField::count];
+	};
+
+	/**
+	 * @brief      Merged statistics of one timed function.
+	 */
+	struct TimerSnapshot {
+		String name;
+
+		/// Number of calls.
+		Count calls = 0;
+
+		/// Number of calls that were timed.
+		Count sampled = 0;
+
+		/// Total time of the timed calls.
+		double sampled_ns = 0;
+
+		/// Latency histogram of the timed calls. Bucket `b` holds durations
+		/// below `bucket_upper_ns[b]`.
+		Count histogram[LHF_PROBE_HISTOGRAM_BUCKETS] = {};
+		double bucket_upper_ns[LHF_PROBE_HISTOGRAM_BUCKETS] = {};
+
+		/// Mean latency of a call.
+		double mean_ns() const {
+			return sampled ? sampled_ns / sampled : 0;
+		}
+
+		/// Estimated total time spent in all calls.
+		double estimated_total_ms() const {
+			return mean_ns() * calls / 1e6;
+		}
+
+		/// Upper bound of the latency below which a fraction `p` of the
+		/// timed calls fall.
+		double percentile_ns(double p) const {
+			Count target = Count(p * sampled);
+			Count seen = 0;
+			for (std::size_t b = 0; b < LHF_PROBE_HISTOGRAM_BUCKETS; b++) {
+				seen += histogram[b];
+				if (seen > target) {
+					return bucket_upper_ns[b];
+				}
+			}
+			return bucket_upper_ns[LHF_PROBE_HISTOGRAM_BUCKETS - 1];
+		}
+	};
+
+	/**
+	 * @brief      Merged statistics of all threads.
+	 */
+	struct Snapshot {
+		Map<String, OperationPerf> operations;
+		std::vector<TimerSnapshot> timers;
+
+		/// Names of operations and timers that were not recorded because
+		/// the process-wide name tables were full.
+		std::vector<String> dropped_operations;
+		std::vector<String> dropped_timers;
+	};
+
 	Map<String, Count> counters;
 	Map<ThreadID, Map<String, Duration>> timers;
 
+protected:
+	// Serial numbers are never reused, so stale thread-local cache entries of
+	// destroyed instances can never match a live instance.
+	static uint64_t next_serial() {
+		static std::atomic<uint64_t> serial{1};
+		return serial++;
+	}
+
+	struct ShardCacheEntry {
+		uint64_t serial = 0;
+		ThreadShard *shard = nullptr;
+	};
+
+	const uint64_t serial = next_serial();
+	Map<ThreadID, std::unique_ptr<ThreadShard>> shards;
+
+	ThreadShard &shard_slow(ShardCacheEntry &entry) {
+		WriteLock m(mutex);
+		std::unique_ptr<ThreadShard> &s = shards[std::this_thread::get_id()];
+		if (!s) {
+			s.reset(new ThreadShard());
+		}
+		entry.serial = serial;
+		entry.shard = s.get();
+		return *s;
+	}
+
+public:
+	PerformanceStatistics() {
+		probe_ticks_per_ns();
+	}
+
+	PerformanceStatistics(const PerformanceStatistics &) = delete;
+	PerformanceStatistics &operator=(const PerformanceStatistics &) = delete;
+
+	/**
+	 * @brief      Gets the calling thread's shard. A small thread-local cache
+	 *             makes this a single comparison in the common case.
+	 */
+	ThreadShard &shard() {
+		static thread_local ShardCacheEntry cache[LHF_PROBE_SHARD_CACHE_SIZE];
+		ShardCacheEntry &entry = cache[serial % LHF_PROBE_SHARD_CACHE_SIZE];
+		if (entry.serial == serial) {
+			return *entry.shard;
+		}
+		return shard_slow(entry);
+	}
+
+	/**
+	 * @brief      Increments an operation counter.
+	 *
+	 * @param[in]  operation  Operation ID from `ProbeNameTable::operations()`
+	 * @param[in]  field      Field from `OperationPerfField`
+	 */
+	void count_operation(std::size_t operation, std::size_t field) {
+		if (operation < LHF_PROBE_MAX_OPERATIONS) {
+			shard().operations[operation][field].add();
+		}
+	}
+
+	/**
+	 * @brief      Merges the shards of all threads. Counters that are being
+	 *             written concurrently may be off by in-flight increments.
+	 */
+	Snapshot snapshot() const {
+		Snapshot ret;
+		ProbeNameTable &timer_names = ProbeNameTable::timers();
+		ProbeNameTable &operation_names = ProbeNameTable::operations();
+		std::size_t num_timers = timer_names.size();
+		std::size_t num_operations = operation_names.size();
+		double ticks_per_ns = probe_ticks_per_ns();
+		ret.dropped_operations = operation_names.overflowed();
+		ret.dropped_timers = timer_names.overflowed();
+
+		WriteLock m(mutex);
+
+		for (std::size_t o = 0; o < num_operations; o++) {
+			OperationPerf p;
+			for (auto &s : shards) {
+				const ProbeCounter *c = s.second->operations[o];
+				p.hits += c[OperationPerfField::hits].get();
+				p.equal_hits += c[OperationPerfField::equal_hits].get();
+				p.subset_hits += c[OperationPerfField::subset_hits].get();
+				p.empty_hits += c[OperationPerfField::empty_hits].get();
+				p.cold_misses += c[OperationPerfField::cold_misses].get();
+				p.edge_misses += c[OperationPerfField::edge_misses].get();
+			}
+			if (p.total() > 0) {
+				ret.operations[operation_names.name(o)] = p;
+			}
+		}
+
+		for (std::size_t t = 0; t < num_timers; t++) {
+			TimerSnapshot ts;
+			Count ticks = 0;
+			for (auto &s : shards) {
+				const ProbeTimer &pt = s.second->timers[t];
+				ts.calls += pt.calls.get();
+				ts.sampled += pt.sampled.get();
+				ticks += pt.ticks.get();
+				for (std::size_t b = 0; b < LHF_PROBE_HISTOGRAM_BUCKETS; b++) {
+					ts.histogram[b] += pt.histogram[b].get();
+				}
+			}
+
+			if (ts.calls == 0) {
+				continue;
+			}
+
+			ts.name = timer_names.name(t);
+			ts.sampled_ns = ticks / ticks_per_ns;
+			for (std::size_t b = 0; b < LHF_PROBE_HISTOGRAM_BUCKETS; b++) {
+				ts.bucket_upper_ns[b] = double(uint64_t(1) << b) / ticks_per_ns;
+			}
+			ret.timers.push_back(ts);
+		}
+
+		return ret;
+	}
+
 	// Timer Functions
 
 	static inline const ThreadID currthread() {
@@ -109,8 +535,12 @@ struct PerformanceStatistics {
 	String dump() const {
 		using namespace std;
 		stringstream s;
+		Snapshot snap = snapshot();
+
+		WriteLock m(mutex);
 
-		if (counters.size() < 1 && timers.size() < 1) {
+		if (counters.size() < 1 && timers.size() < 1 && snap.timers.size() < 1 &&
+		    snap.dropped_timers.empty() && snap.dropped_operations.empty()) {
 			s << endl << "Profiler: No statistics generated" << endl;
 			return s.str();
 		}
@@ -131,24 +561,105 @@ struct PerformanceStatistics {
 				 << ": " << k.second.get_cumul_duration_ms() << " ms" << endl;
 			}
 		}
+		for (const TimerSnapshot &t : snap.timers) {
+			s << "    "
+			  << "'" << t.name << "'"
+			  << ": " << t.estimated_total_ms() << " ms"
+			  << " (calls: " << t.calls
+			  << ", mean: " << t.mean_ns() << " ns"
+			  << ", p50: " << t.percentile_ns(0.5) << " ns"
+			  << ", p99: " << t.percentile_ns(0.99) << " ns)" << endl;
+		}
+		for (const String &name : snap.dropped_timers) {
+			s << "    '" << name << "': not recorded (raise LHF_PROBE_MAX_TIMERS)" << endl;
+		}
+		for (const String &name : snap.dropped_operations) {
+			s << "    '" << name << "': not recorded (raise LHF_PROBE_MAX_OPERATIONS)" << endl;
+		}
 
 		return s.str();
 	}
 };
 
+/**
+ * @brief      Structured statistics of one LHF instance, meant for export
+ *             (see metrics.hpp).
+ */
+struct MetricsReport {
+	/**
+	 * @brief      Occupancy of one of the internal hash maps.
+	 */
+	struct MapMetrics {
+		uint64_t entries = 0;
+		uint64_t buckets = 0;
+
+		double load_factor() const {
+			return buckets ? double(entries) / buckets : 0;
+		}
+	};
+
+	/**
+	 * @brief      Distribution of the cardinalities of the stored sets.
+	 */
+	struct SizeDistribution {
+		double mean = 0;
+		uint64_t p50 = 0;
+		uint64_t p90 = 0;
+		uint64_t p99 = 0;
+		uint64_t max = 0;
+	};
+
+	/// Per-operation counters. Empty if performance metrics are disabled.
+	std::map<std::string, OperationPerf> operations;
+
+	/// Per-function timings. Empty if performance metrics are disabled.
+	std::vector<PerformanceStatistics::TimerSnapshot> timers;
+
+	/// Names of probes that were not recorded because the process-wide
+	/// probe name tables were full.
+	std::vector<std::string> dropped_probes;
+
+	/// Number of property sets stored, including the empty set.
+	uint64_t property_set_count = 0;
+
+	/// Cardinalities of the stored (non-evicted) property sets.
+	SizeDistribution set_size;
+
+	/// Occupancy of the property set map and the operation caches.
+	std::map<std::string, MapMetrics> maps;
+};
+
 /**
  * @brief      The object used to enable the duration capturing mechanism.
+ *             Counts every call, and times one in every
+ *             `LHF_PROBE_SAMPLE_INTERVAL` calls.
  */
-struct __CalcTime {
-	std::string key;
-	PerformanceStatistics &stat;
+struct __ProbeTimer {
+	PerformanceStatistics::ProbeTimer *timer = nullptr;
+	uint64_t start = 0;
+
+	__ProbeTimer(PerformanceStatistics &stat, std::size_t id) {
+		if (id >= LHF_PROBE_MAX_TIMERS) {
+			return;
+		}
 
-	__CalcTime(PerformanceStatistics &stat, const std::string &key): key(key), stat(stat) {
-		stat.timer_start(key);
+		PerformanceStatistics::ProbeTimer &t = stat.shard().timers[id];
+		uint64_t n = t.calls.get();
+		t.calls.add();
+
+		if ((n & (LHF_PROBE_SAMPLE_INTERVAL - 1)) == 0) {
+			timer = &t;
+			start = probe_ticks();
+		}
 	}
 
-	~__CalcTime() {
-		stat.timer_end(key);
+	~__ProbeTimer() {
+		if (timer) {
+			uint64_t ticks = probe_ticks() - start;
+			timer->sampled.add();
+			timer->ticks.add(ticks);
+			timer->histogram[probe_bucket(ticks)].add();
+		}
 	}
 };
 
@@ -158,7 +669,8 @@ struct __CalcTime {
  *             scope.
  *
  * @param      __stat  PerformanceStatistics object
- * @param      __key   Identifier for this duration
+ * @param      __key   Identifier for this duration. It is resolved once per
+ *                     call site, so it must not change between calls.
  */
 
 /**
@@ -171,9 +683,10 @@ struct __CalcTime {
 
 #ifdef LHF_ENABLE_PERFORMANCE_METRICS
 #define __lhf_calc_time(__stat, __key) \
-	auto __LHF_TIMER_OBJECT__ = __CalcTime((__stat), (__key))
+	static const std::size_t __LHF_PROBE_ID__ = ::lhf::ProbeNameTable::timers().id((__key)); \
+	auto __LHF_TIMER_OBJECT__ = ::lhf::__ProbeTimer((__stat), __LHF_PROBE_ID__)
 #define __lhf_calc_functime(__stat) \
-	auto __LHF_TIMER_OBJECT__ = __CalcTime((__stat), __func__)
+	__lhf_calc_time((__stat), __func__)
 #else
 #define __lhf_calc_time(__stat, __key)
 #define __lhf_calc_functime(__stat)
@@ -181,4 +694,4 @@ struct __CalcTime {
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,972 @@
+/**
+ * @file trace.hpp
+ * @brief Compact binary format for streams of LHF operations, for recording
+ *        workloads and replaying them without text parsing.
+ *
+ * Layout (all integers little-endian):
+ *
+ * * Header (32 bytes): the magic `LHFTRACE`, `u32` version, `u32` element
+ *   arity, `u64` number of operations and `u64` number of corpus sets.
+ * * Records, each an opcode byte followed by its payload:
+ *   * `TRACE_CORPUS_SET`: a set, appended to the corpus.
+ *   * `TRACE_CORPUS_DUPLICATE`: varints `start` and `stop`; appends copies of
+ *     corpus entries `start` to `stop` (inclusive) to the corpus.
+ *   * `TRACE_UNION`, `TRACE_INTERSECTION`, `TRACE_DIFFERENCE`: two operands,
+ *     followed by the expected result set if `TRACE_HAS_RESULT` is set in the
+ *     opcode.
+ *
+ * An operand is a varint `v`: if `v` is odd, it refers to corpus entry
+ * `v >> 1`; if it is zero, a set follows inline. A set is its element count
+ * followed by the elements.
+ *
+ * Elements are tuples of `arity` signed integers (1 for plain sets, 2 for
+ * key-value pairs of nested sets), sorted lexicographically and unique. They
+ * are delta coded: the first component is stored as an unsigned delta from
+ * the previous element's first component (zigzag coded for the first
+ * element). For arity 2, the second component is stored as a delta minus one
+ * if the first component repeats, and zigzag coded otherwise.
+ *
+ * Traces recorded from a running LHF (see `TraceRecorder`, format version 2)
+ * have an arity of 0 in the header, and count instances in place of corpus
+ * sets. They refer to sets by the indices they had in the recorded LHF
+ * instead of by corpus entries. Their records are:
+ *
+ * * `TRACE_LIVE_INSTANCE`: varints `instance` and `n`, then the `n` instance
+ *   numbers of its nested children. Elements of the instance's sets have
+ *   arity `1 + n`: the key, then one child set index per child.
+ * * `TRACE_LIVE_REGISTER`: varints `instance` and `index`, followed by the
+ *   contents of the set if `TRACE_HAS_RESULT` is set in the opcode (the set
+ *   was new). Otherwise the set is already known from an earlier record.
+ * * `TRACE_LIVE_UNION`, `TRACE_LIVE_INTERSECTION`, `TRACE_LIVE_DIFFERENCE`:
+ *   varints `instance`, both operand indices and the result index.
+ *
+ * Sets in live records are in the order of the LHF, which need not be the
+ * integer order. The first component is stored as a zigzag coded delta from
+ * the previous element, and the other components as zigzag coded values.
+ */
+
+#ifndef LHF_TRACE_HPP
+#define LHF_TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LHF_TRACE_ENABLE_MMAP
+#endif
+
+namespace lhf {
+
+constexpr char TRACE_MAGIC[8] = { 'L', 'H', 'F', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint32_t TRACE_VERSION = 2;
+constexpr std::size_t TRACE_HEADER_SIZE = 32;
+
+/// Upper bound on the instance numbers accepted from a live trace.
+constexpr uint64_t TRACE_MAX_INSTANCES = 1 << 20;
+
+enum TraceOpcode : uint8_t {
+	TRACE_CORPUS_SET = 0x01,
+	TRACE_CORPUS_DUPLICATE = 0x02,
+	TRACE_UNION = 0x10,
+	TRACE_INTERSECTION = 0x11,
+	TRACE_DIFFERENCE = 0x12,
+	TRACE_LIVE_INSTANCE = 0x20,
+	TRACE_LIVE_REGISTER = 0x21,
+	TRACE_LIVE_UNION = 0x22,
+	TRACE_LIVE_INTERSECTION = 0x23,
+	TRACE_LIVE_DIFFERENCE = 0x24,
+
+	/// Flag on operation opcodes: the expected result follows. On
+	/// `TRACE_LIVE_REGISTER`: the contents of the set follow.
+	TRACE_HAS_RESULT = 0x80
+};
+
+struct TraceFormatError : public std::runtime_error {
+	TraceFormatError(const std::string &msg): std::runtime_error(msg) {}
+};
+
+struct TraceHeader {
+	uint32_t version = TRACE_VERSION;
+	uint32_t arity = 1;
+	uint64_t op_count = 0;
+	uint64_t corpus_count = 0;
+};
+
+inline uint64_t trace_zigzag(int64_t v) {
+	return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t trace_unzigzag(uint64_t v) {
+	return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+inline void trace_put_varint(std::string &out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back(static_cast<char>(static_cast<uint8_t>(v) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+inline void trace_put_header(std::string &out, const TraceHeader &h) {
+	out.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	for (int i = 0; i < 4; i++) {
+		out.push_back(static_cast<char>(h.version >> (8 * i)));
+	}
+	for (int i = 0; i < 4; i++) {
+		out.push_back(static_cast<char>(h.arity >> (8 * i)));
+	}
+	for (int i = 0; i < 8; i++) {
+		out.push_back(static_cast<char>(h.op_count >> (8 * i)));
+	}
+	for (int i = 0; i < 8; i++) {
+		out.push_back(static_cast<char>(h.corpus_count >> (8 * i)));
+	}
+}
+
+/**
+ * @brief      Appends a set of a live record: `count` tuples of `arity`
+ *             integers, in any order.
+ */
+inline void trace_put_tuples(std::string &out, const int64_t *data, std::size_t count, std::size_t arity) {
+	trace_put_varint(out, count);
+	int64_t prev = 0;
+	for (std::size_t i = 0; i < count; i++) {
+		const int64_t *e = data + i * arity;
+		trace_put_varint(out, trace_zigzag(static_cast<int64_t>(
+			static_cast<uint64_t>(e[0]) - static_cast<uint64_t>(prev))));
+		prev = e[0];
+		for (std::size_t j = 1; j < arity; j++) {
+			trace_put_varint(out, trace_zigzag(e[j]));
+		}
+	}
+}
+
+/**
+ * @brief      Nesting depth of recorded LHF calls on the current thread. An
+ *             LHF call made while another one is in progress (such as the
+ *             child unions of a nested union, or the registration of a
+ *             result) is part of the outer call, and is not recorded.
+ */
+struct TraceCallGuard {
+	static unsigned &depth() {
+		static thread_local unsigned d = 0;
+		return d;
+	}
+
+	static bool is_outermost() {
+		return depth() == 0;
+	}
+
+	TraceCallGuard() {
+		depth()++;
+	}
+
+	~TraceCallGuard() {
+		depth()--;
+	}
+
+	TraceCallGuard(const TraceCallGuard &) = delete;
+	TraceCallGuard &operator=(const TraceCallGuard &) = delete;
+};
+
+/**
+ * @brief      Appends the encoding of a trace to a stream.
+ */
+class TraceWriter {
+	std::ostream &out;
+	TraceHeader header;
+	std::string buffer;
+	std::vector<int64_t> sorted;
+
+	void put_byte(uint8_t b) {
+		buffer.push_back(static_cast<char>(b));
+	}
+
+	void put_varint(uint64_t v) {
+		trace_put_varint(buffer, v);
+	}
+
+	void flush_buffer() {
+		out.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+	/// Sorts and deduplicates `count` elements into `sorted`.
+	void normalize(const int64_t *data, std::size_t count) {
+		const std::size_t arity = header.arity;
+		std::vector<std::size_t> order(count);
+		for (std::size_t i = 0; i < count; i++) {
+			order[i] = i;
+		}
+
+		auto less = [&](std::size_t a, std::size_t b) {
+			return std::lexicographical_compare(
+				data + a * arity, data + (a + 1) * arity,
+				data + b * arity, data + (b + 1) * arity);
+		};
+		auto equal = [&](std::size_t a, std::size_t b) {
+			return std::equal(data + a * arity, data + (a + 1) * arity, data + b * arity);
+		};
+
+		std::sort(order.begin(), order.end(), less);
+		order.erase(std::unique(order.begin(), order.end(), equal), order.end());
+
+		sorted.clear();
+		for (std::size_t i : order) {
+			sorted.insert(sorted.end(), data + i * arity, data + (i + 1) * arity);
+		}
+	}
+
+	void write_header() {
+		trace_put_header(buffer, header);
+		flush_buffer();
+	}
+
+	void put_elements() {
+		const std::size_t arity = header.arity;
+		const std::size_t count = sorted.size() / arity;
+
+		put_varint(count);
+		for (std::size_t i = 0; i < count; i++) {
+			const int64_t *e = sorted.data() + i * arity;
+			const int64_t *prev = e - arity;
+
+			if (i == 0) {
+				put_varint(trace_zigzag(e[0]));
+			} else {
+				put_varint(static_cast<uint64_t>(e[0] - prev[0]));
+			}
+
+			if (arity == 2) {
+				if (i > 0 && e[0] == prev[0]) {
+					put_varint(static_cast<uint64_t>(e[1] - prev[1] - 1));
+				} else {
+					put_varint(trace_zigzag(e[1]));
+				}
+			}
+		}
+	}
+
+public:
+	/**
+	 * @brief      Writes a trace header. The counts are patched in by
+	 *             `finish()`, so the stream must be seekable.
+	 *
+	 * @param      out    The output stream
+	 * @param[in]  arity  Number of integers per element (1 or 2)
+	 */
+	TraceWriter(std::ostream &out, uint32_t arity = 1): out(out) {
+		if (arity != 1 && arity != 2) {
+			throw TraceFormatError("Trace element arity must be 1 or 2");
+		}
+		header.arity = arity;
+		write_header();
+	}
+
+	uint32_t arity() const {
+		return header.arity;
+	}
+
+	/**
+	 * @brief      Operand of an operation record: either a corpus entry, or
+	 *             `count` elements (of `arity` integers each) stored inline.
+	 */
+	struct Operand {
+		const int64_t *data = nullptr;
+		std::size_t count = 0;
+		uint64_t corpus_index = 0;
+		bool is_corpus = false;
+
+		static Operand corpus(uint64_t index) {
+			Operand o;
+			o.corpus_index = index;
+			o.is_corpus = true;
+			return o;
+		}
+
+		static Operand inline_set(const std::vector<int64_t> &elements, std::size_t arity) {
+			Operand o;
+			o.data = elements.data();
+			o.count = elements.size() / arity;
+			return o;
+		}
+	};
+
+	/// Appends a set to the corpus.
+	void corpus_set(const std::vector<int64_t> &elements) {
+		put_byte(TRACE_CORPUS_SET);
+		normalize(elements.data(), elements.size() / header.arity);
+		put_elements();
+		header.corpus_count++;
+		flush_buffer();
+	}
+
+	/// Appends copies of corpus entries `start` to `stop` to the corpus.
+	void corpus_duplicate(uint64_t start, uint64_t stop) {
+		put_byte(TRACE_CORPUS_DUPLICATE);
+		put_varint(start);
+		put_varint(stop);
+		header.corpus_count += stop - start + 1;
+		flush_buffer();
+	}
+
+	/**
+	 * @brief      Appends an operation record.
+	 *
+	 * @param[in]  op      `TRACE_UNION`, `TRACE_INTERSECTION` or
+	 *                     `TRACE_DIFFERENCE`
+	 * @param[in]  a       First operand
+	 * @param[in]  b       Second operand
+	 * @param[in]  result  Expected result, or `nullptr` if not recorded
+	 */
+	void operation(
+		TraceOpcode op,
+		const Operand &a,
+		const Operand &b,
+		const std::vector<int64_t> *result = nullptr) {
+		put_byte(op | (result ? TRACE_HAS_RESULT : 0));
+
+		for (const Operand *o : { &a, &b }) {
+			if (o->is_corpus) {
+				put_varint((o->corpus_index << 1) | 1);
+			} else {
+				normalize(o->data, o->count);
+				put_varint(0);
+				put_elements();
+			}
+		}
+
+		if (result) {
+			normalize(result->data(), result->size() / header.arity);
+			put_elements();
+		}
+
+		header.op_count++;
+		flush_buffer();
+	}
+
+	/**
+	 * @brief      Rewrites the header with the final counts.
+	 */
+	void finish() {
+		auto end = out.tellp();
+		out.seekp(0);
+		write_header();
+		out.seekp(end);
+		out.flush();
+	}
+};
+
+/**
+ * @brief      Records the operations of running LHFs into a live trace file
+ *             (see `LatticeHashForest::set_trace_recorder`).
+ *
+ *             Every thread appends records to its own buffer without
+ *             locking. Full buffers are handed to a background thread that
+ *             writes them to the file, so recording costs the encoding of a
+ *             few varints per operation. Records of one thread stay in
+ *             order; records of different threads are interleaved at chunk
+ *             granularity, in the order their buffers are handed to the
+ *             writer. A trace of several threads therefore does not
+ *             preserve the global order of their operations, only an order
+ *             consistent with each thread's own.
+ *
+ * @note       `finish()` (or the destructor) must only be called once no
+ *             thread records anymore.
+ */
+class TraceRecorder {
+	struct ThreadBuffer {
+		std::string data;
+		uint64_t op_count = 0;
+	};
+
+	std::ofstream out;
+	std::size_t chunk_size;
+	uint64_t id;
+
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::vector<std::string> queue;
+	bool stopping = false;
+	bool finished = false;
+	std::thread writer;
+
+	std::atomic<uint32_t> next_instance { 0 };
+
+	static uint64_t next_id() {
+		static std::atomic<uint64_t> counter { 1 };
+		return counter++;
+	}
+
+	/// The calling thread's buffer, created on first use.
+	ThreadBuffer &local() {
+		struct Entry {
+			uint64_t id;
+			ThreadBuffer *buffer;
+		};
+		static thread_local std::vector<Entry> cache;
+
+		if (!cache.empty() && cache.back().id == id) {
+			return *cache.back().buffer;
+		}
+
+		for (Entry &e : cache) {
+			if (e.id == id) {
+				std::swap(e, cache.back());
+				return *cache.back().buffer;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		buffers.back()->data.reserve(chunk_size);
+		cache.push_back({ id, buffers.back().get() });
+		return *buffers.back();
+	}
+
+	void hand_off(ThreadBuffer &b) {
+		std::string full;
+		full.reserve(chunk_size);
+		std::swap(full, b.data);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(full));
+		}
+		wakeup.notify_one();
+	}
+
+	void commit(ThreadBuffer &b) {
+		if (b.data.size() >= chunk_size) {
+			hand_off(b);
+		}
+	}
+
+	void run_writer() {
+		std::vector<std::string> pending;
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true) {
+			wakeup.wait(lock, [this]() { return stopping || !queue.empty(); });
+			std::swap(pending, queue);
+			bool done = stopping;
+
+			lock.unlock();
+			for (const std::string &chunk : pending) {
+				out.write(chunk.data(), chunk.size());
+			}
+			pending.clear();
+			lock.lock();
+
+			if (done && queue.empty()) {
+				return;
+			}
+		}
+	}
+
+public:
+	/**
+	 * @brief      Creates the trace file and starts the writer thread.
+	 *
+	 * @param[in]  path        The output file
+	 * @param[in]  chunk_size  Size at which a thread's buffer is handed to
+	 *                         the writer
+	 */
+	explicit TraceRecorder(const std::string &path, std::size_t chunk_size = 1 << 16):
+		out(path, std::ios::binary | std::ios::trunc),
+		chunk_size(chunk_size),
+		id(next_id()) {
+		if (!out) {
+			throw TraceFormatError("Could not open " + path);
+		}
+
+		TraceHeader h;
+		h.arity = 0;
+		std::string header;
+		trace_put_header(header, h);
+		out.write(header.data(), header.size());
+
+		writer = std::thread([this]() { run_writer(); });
+	}
+
+	TraceRecorder(const TraceRecorder &) = delete;
+	TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+	~TraceRecorder() {
+		finish();
+	}
+
+	/**
+	 * @brief      Declares a recorded LHF and returns its instance number.
+	 *             The record is written immediately, together with anything
+	 *             the calling thread has buffered.
+	 *
+	 * @param[in]  children  Instance numbers of the nested children
+	 */
+	uint32_t declare_instance(const std::vector<uint32_t> &children) {
+		uint32_t instance = next_instance++;
+		ThreadBuffer &b = local();
+
+		b.data.push_back(static_cast<char>(TRACE_LIVE_INSTANCE));
+		trace_put_varint(b.data, instance);
+		trace_put_varint(b.data, children.size());
+		for (uint32_t c : children) {
+			trace_put_varint(b.data, c);
+		}
+
+		hand_off(b);
+		return instance;
+	}
+
+	/**
+	 * @brief      Records a set registration.
+	 *
+	 * @param[in]  instance  The instance
+	 * @param[in]  index     Index of the set
+	 * @param[in]  elements  Contents of the set as tuples of the instance's
+	 *                       arity if the set is new, `nullptr` otherwise
+	 */
+	void record_register(uint32_t instance, uint64_t index, const std::vector<int64_t> *elements, std::size_t arity) {
+		ThreadBuffer &b = local();
+		b.data.push_back(static_cast<char>(TRACE_LIVE_REGISTER | (elements ? TRACE_HAS_RESULT : 0)));
+		trace_put_varint(b.data, instance);
+		trace_put_varint(b.data, index);
+		if (elements) {
+			trace_put_tuples(b.data, elements->data(), elements->size() / arity, arity);
+		}
+		b.op_count++;
+		commit(b);
+	}
+
+	/**
+	 * @brief      Records a binary operation.
+	 *
+	 * @param[in]  op        `TRACE_LIVE_UNION`, `TRACE_LIVE_INTERSECTION` or
+	 *                       `TRACE_LIVE_DIFFERENCE`
+	 */
+	void record_operation(TraceOpcode op, uint32_t instance, uint64_t a, uint64_t b, uint64_t result) {
+		ThreadBuffer &t = local();
+		t.data.push_back(static_cast<char>(op));
+		trace_put_varint(t.data, instance);
+		trace_put_varint(t.data, a);
+		trace_put_varint(t.data, b);
+		trace_put_varint(t.data, result);
+		t.op_count++;
+		commit(t);
+	}
+
+	/**
+	 * @brief      Hands the calling thread's buffered records to the writer.
+	 */
+	void flush_thread() {
+		ThreadBuffer &b = local();
+		if (!b.data.empty()) {
+			hand_off(b);
+		}
+	}
+
+	/**
+	 * @brief      Writes out all buffers, stops the writer thread and
+	 *             rewrites the header with the final operation count.
+	 */
+	void finish() {
+		if (finished) {
+			return;
+		}
+		finished = true;
+
+		TraceHeader h;
+		h.arity = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto &b : buffers) {
+				if (!b->data.empty()) {
+					queue.push_back(std::move(b->data));
+					b->data.clear();
+				}
+				h.op_count += b->op_count;
+			}
+			h.corpus_count = next_instance;
+			stopping = true;
+		}
+		wakeup.notify_one();
+		writer.join();
+
+		std::string header;
+		trace_put_header(header, h);
+		out.seekp(0);
+		out.write(header.data(), header.size());
+		out.close();
+	}
+};
+
+/**
+ * @brief      Decodes a trace from a memory buffer without copying it.
+ *             Decoded sets are kept in buffers that are reused between
+ *             records, so reading does not allocate once they have grown.
+ */
+class TraceReader {
+public:
+	/**
+	 * @brief      A decoded record. Inline sets point into the reader's
+	 *             buffers and are valid until the next call of `next()`.
+	 */
+	struct Record {
+		uint8_t opcode = 0;
+		bool has_result = false;
+
+		/// For `TRACE_CORPUS_DUPLICATE`, the first and last entry.
+		uint64_t start = 0;
+		uint64_t stop = 0;
+
+		struct Operand {
+			bool is_corpus = false;
+			uint64_t corpus_index = 0;
+			const std::vector<int64_t> *elements = nullptr;
+		};
+
+		/// Operands of operations. For `TRACE_CORPUS_SET`, `a` is the set.
+		Operand a, b;
+
+		/// The expected result, if `has_result` is set.
+		const std::vector<int64_t> *result = nullptr;
+
+		/// For live records, the recorded instance.
+		uint64_t instance = 0;
+
+		/// For live operations, the operand indices.
+		uint64_t left = 0;
+		uint64_t right = 0;
+
+		/// For `TRACE_LIVE_REGISTER` and live operations, the index of the
+		/// registered set or of the result.
+		uint64_t index = 0;
+
+		/// For `TRACE_LIVE_INSTANCE`, the instances of the nested children.
+		const std::vector<uint64_t> *children = nullptr;
+	};
+
+protected:
+	const uint8_t *begin;
+	const uint8_t *cursor;
+	const uint8_t *end;
+	TraceHeader header_data;
+	std::vector<int64_t> buffers[3];
+	std::vector<uint64_t> child_buffer;
+
+	/// Element arity of every instance declared so far in a live trace.
+	std::vector<uint32_t> instance_arity;
+
+	uint8_t get_byte() {
+		if (cursor == end) {
+			throw TraceFormatError("Unexpected end of trace");
+		}
+		return *cursor++;
+	}
+
+	uint64_t get_varint() {
+		uint64_t ret = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = get_byte();
+			ret |= static_cast<uint64_t>(b & 0x7f) << shift;
+			if (!(b & 0x80)) {
+				return ret;
+			}
+		}
+		throw TraceFormatError("Malformed varint in trace");
+	}
+
+	/**
+	 * @brief      Checks a count read from the trace before anything is
+	 *             allocated for it. Each of the `count` items takes at least
+	 *             `min_bytes` bytes, so a count that does not fit in the rest
+	 *             of the buffer is malformed.
+	 */
+	void check_count(uint64_t count, std::size_t min_bytes) const {
+		const std::size_t remaining = static_cast<std::size_t>(end - cursor);
+		if (min_bytes > 0 && count > remaining / min_bytes) {
+			throw TraceFormatError("Count in trace exceeds the remaining data");
+		}
+	}
+
+	uint64_t get_fixed(int bytes) {
+		uint64_t ret = 0;
+		for (int i = 0; i < bytes; i++) {
+			ret |= static_cast<uint64_t>(get_byte()) << (8 * i);
+		}
+		return ret;
+	}
+
+	void get_elements(std::vector<int64_t> &out) {
+		const std::size_t arity = header_data.arity;
+		uint64_t count = get_varint();
+		check_count(count, arity);
+		out.clear();
+		out.reserve(count * arity);
+
+		for (uint64_t i = 0; i < count; i++) {
+			int64_t first;
+			if (i == 0) {
+				first = trace_unzigzag(get_varint());
+			} else {
+				first = out[out.size() - arity] + static_cast<int64_t>(get_varint());
+			}
+
+			if (arity == 2) {
+				int64_t second;
+				if (i > 0 && first == out[out.size() - 2]) {
+					second = out.back() + static_cast<int64_t>(get_varint()) + 1;
+				} else {
+					second = trace_unzigzag(get_varint());
+				}
+				out.push_back(first);
+				out.push_back(second);
+			} else {
+				out.push_back(first);
+			}
+		}
+	}
+
+	void get_tuples(std::vector<int64_t> &out, std::size_t arity) {
+		uint64_t count = get_varint();
+		check_count(count, arity);
+		out.clear();
+		out.reserve(count * arity);
+
+		int64_t prev = 0;
+		for (uint64_t i = 0; i < count; i++) {
+			prev = static_cast<int64_t>(
+				static_cast<uint64_t>(prev) + static_cast<uint64_t>(trace_unzigzag(get_varint())));
+			out.push_back(prev);
+			for (std::size_t j = 1; j < arity; j++) {
+				out.push_back(trace_unzigzag(get_varint()));
+			}
+		}
+	}
+
+	uint32_t arity_of(uint64_t instance) const {
+		if (instance >= instance_arity.size() || instance_arity[instance] == 0) {
+			throw TraceFormatError("Reference to undeclared instance " + std::to_string(instance));
+		}
+		return instance_arity[instance];
+	}
+
+	void get_operand(Record::Operand &o, std::vector<int64_t> &buffer) {
+		uint64_t v = get_varint();
+		if (v & 1) {
+			o.is_corpus = true;
+			o.corpus_index = v >> 1;
+			o.elements = nullptr;
+		} else if (v != 0) {
+			throw TraceFormatError("Malformed operand in trace");
+		} else {
+			o.is_corpus = false;
+			get_elements(buffer);
+			o.elements = &buffer;
+		}
+	}
+
+public:
+	TraceReader(const void *data, std::size_t size):
+		begin(static_cast<const uint8_t *>(data)),
+		cursor(begin),
+		end(begin + size) {
+		if (size < TRACE_HEADER_SIZE || std::memcmp(begin, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+			throw TraceFormatError("Not an LHF trace");
+		}
+
+		cursor += sizeof(TRACE_MAGIC);
+		header_data.version = get_fixed(4);
+		header_data.arity = get_fixed(4);
+		header_data.op_count = get_fixed(8);
+		header_data.corpus_count = get_fixed(8);
+
+		if (header_data.version == 0 || header_data.version > TRACE_VERSION) {
+			throw TraceFormatError("Unsupported trace version " + std::to_string(header_data.version));
+		}
+		if (header_data.arity > 2 || (header_data.arity == 0 && header_data.version < 2)) {
+			throw TraceFormatError("Unsupported trace element arity");
+		}
+	}
+
+	const TraceHeader &header() const {
+		return header_data;
+	}
+
+	/// Whether this trace was recorded from a running LHF.
+	bool is_live() const {
+		return header_data.arity == 0;
+	}
+
+	/**
+	 * @brief      Decodes the next record.
+	 *
+	 * @return     `false` at the end of the trace.
+	 */
+	bool next(Record &r) {
+		if (cursor == end) {
+			return false;
+		}
+
+		uint8_t op = get_byte();
+		r.has_result = op & TRACE_HAS_RESULT;
+		r.opcode = op & ~TRACE_HAS_RESULT;
+		r.result = nullptr;
+
+		bool live_opcode = r.opcode >= TRACE_LIVE_INSTANCE && r.opcode <= TRACE_LIVE_DIFFERENCE;
+		if (live_opcode != is_live()) {
+			throw TraceFormatError("Unexpected trace opcode " + std::to_string(op));
+		}
+
+		switch (r.opcode) {
+		case TRACE_CORPUS_SET:
+			get_elements(buffers[0]);
+			r.a.is_corpus = false;
+			r.a.elements = &buffers[0];
+			break;
+		case TRACE_CORPUS_DUPLICATE:
+			r.start = get_varint();
+			r.stop = get_varint();
+			break;
+		case TRACE_UNION:
+		case TRACE_INTERSECTION:
+		case TRACE_DIFFERENCE:
+			get_operand(r.a, buffers[0]);
+			get_operand(r.b, buffers[1]);
+			if (r.has_result) {
+				get_elements(buffers[2]);
+				r.result = &buffers[2];
+			}
+			break;
+		case TRACE_LIVE_INSTANCE: {
+			r.instance = get_varint();
+			uint64_t n = get_varint();
+			if (n >= UINT32_MAX || r.instance >= TRACE_MAX_INSTANCES) {
+				throw TraceFormatError("Malformed instance declaration");
+			}
+			check_count(n, 1);
+			child_buffer.clear();
+			for (uint64_t i = 0; i < n; i++) {
+				child_buffer.push_back(get_varint());
+			}
+			r.children = &child_buffer;
+			if (r.instance >= instance_arity.size()) {
+				instance_arity.resize(r.instance + 1, 0);
+			}
+			instance_arity[r.instance] = 1 + n;
+			break;
+		}
+		case TRACE_LIVE_REGISTER:
+			r.instance = get_varint();
+			r.index = get_varint();
+			if (r.has_result) {
+				get_tuples(buffers[0], arity_of(r.instance));
+				r.a.is_corpus = false;
+				r.a.elements = &buffers[0];
+			} else {
+				arity_of(r.instance);
+			}
+			break;
+		case TRACE_LIVE_UNION:
+		case TRACE_LIVE_INTERSECTION:
+		case TRACE_LIVE_DIFFERENCE:
+			r.instance = get_varint();
+			arity_of(r.instance);
+			r.left = get_varint();
+			r.right = get_varint();
+			r.index = get_varint();
+			break;
+		default:
+			throw TraceFormatError("Unknown trace opcode " + std::to_string(op));
+		}
+
+		return true;
+	}
+};
+
+/**
+ * @brief      Read-only view of a whole file. Uses `mmap` where available,
+ *             and reads the file into memory otherwise.
+ */
+class TraceFile {
+	const void *data_ptr = nullptr;
+	std::size_t data_size = 0;
+	std::vector<char> fallback;
+
+public:
+	explicit TraceFile(const std::string &path) {
+#ifdef LHF_TRACE_ENABLE_MMAP
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw TraceFormatError("Could not open " + path);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) < 0) {
+			close(fd);
+			throw TraceFormatError("Could not stat " + path);
+		}
+
+		data_size = st.st_size;
+		if (data_size > 0) {
+			void *p = mmap(nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (p == MAP_FAILED) {
+				throw TraceFormatError("Could not map " + path);
+			}
+			madvise(p, data_size, MADV_SEQUENTIAL);
+			data_ptr = p;
+		} else {
+			close(fd);
+		}
+#else
+		std::ifstream in(path, std::ios::binary);
+		if (!in) {
+			throw TraceFormatError("Could not open " + path);
+		}
+		fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		data_ptr = fallback.data();
+		data_size = fallback.size();
+#endif
+	}
+
+	TraceFile(const TraceFile &) = delete;
+	TraceFile &operator=(const TraceFile &) = delete;
+
+	~TraceFile() {
+#ifdef LHF_TRACE_ENABLE_MMAP
+		if (data_ptr) {
+			munmap(const_cast<void *>(data_ptr), data_size);
+		}
+#endif
+	}
+
+	const void *data() const {
+		return data_ptr;
+	}
+
+	std::size_t size() const {
+		return data_size;
+	}
+};
+
+}
+
+#endif
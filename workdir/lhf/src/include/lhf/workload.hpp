@@ -0,0 +1,699 @@
+/**
+ * @file workload.hpp
+ * @brief Seedable generator of the synthetic set operation workloads used by
+ *        the `abstract` tests.
+ *
+ * It reproduces the distributions of the `benchmark.py` scripts:
+ *
+ * * `WORKLOAD_RANDOM` (the `random*` series): every operation has two freshly
+ *   generated operand sets.
+ * * `WORKLOAD_CLOSED_WORLD` (the `closed_world*` series): operations pick
+ *   their operands from a corpus of sets. The corpus grows by duplicating a
+ *   random range of itself (an `S` record) once every `corpus size`
+ *   operations, starting after ten times the initial size.
+ *
+ * Sets are drawn with `WORKLOAD_UNIFORM` (uniform size and elements),
+ * `WORKLOAD_NORMAL` (normally distributed size, elements and corpus operand
+ * indices) or, for closed-world workloads, `WORKLOAD_OPTIMISTIC` (a corpus
+ * with many repeated sets, and operations drawn from a fixed pool of operand
+ * pairs, so that most operations repeat). With an arity of 2, elements are
+ * pairs, as in the `*_pointsto` series.
+ *
+ * Generation is split into independent random streams derived from the seed
+ * (one per corpus set, one per random operation, and one for the sequence of
+ * closed-world operations), so the output depends on the seed only and not on
+ * the number of threads used.
+ */
+
+#ifndef LHF_WORKLOAD_HPP
+#define LHF_WORKLOAD_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace lhf {
+
+struct WorkloadError : public std::runtime_error {
+	WorkloadError(const std::string &msg): std::runtime_error(msg) {}
+};
+
+enum WorkloadKind {
+	WORKLOAD_RANDOM,
+	WORKLOAD_CLOSED_WORLD
+};
+
+enum WorkloadDistribution {
+	WORKLOAD_UNIFORM,
+	WORKLOAD_NORMAL,
+	WORKLOAD_OPTIMISTIC
+};
+
+/**
+ * @brief      Parameters of a generated workload. The names accepted by
+ *             `set()` are those of the `benchmark.py` options.
+ */
+struct WorkloadConfig {
+	WorkloadKind kind = WORKLOAD_CLOSED_WORLD;
+	WorkloadDistribution dist = WORKLOAD_UNIFORM;
+
+	/// Number of integers per element (1, or 2 for pairs).
+	uint32_t arity = 1;
+
+	/// Number of operations (`count`).
+	uint64_t count = 0;
+
+	/// Largest set size (`maxsize`).
+	int64_t max_size = 200;
+
+	/// Largest element value (`maxval`).
+	int64_t max_value = 10000;
+
+	/// Initial corpus size of closed-world workloads (`corpussize`).
+	uint64_t corpus_size = 300;
+
+	uint64_t seed = 1;
+
+	/// Number of generating threads, or 0 for one per hardware thread.
+	unsigned threads = 0;
+
+	/// Whether to compute the result of every operation.
+	bool results = true;
+
+	/**
+	 * @brief      Sets a parameter by name: `kind` (`random` or
+	 *             `closed_world`), `dist` (`uniform`, `normal` or
+	 *             `optimistic`), `pairs` (`0` or `1`), `count`, `maxsize`,
+	 *             `maxval`, `corpussize`, `seed`, `threads` or `results`
+	 *             (`0` or `1`).
+	 *
+	 * @return     `false` if there is no parameter called `key`.
+	 */
+	bool set(const std::string &key, const std::string &value) {
+		auto number = [&]() -> uint64_t {
+			try {
+				std::size_t end;
+				uint64_t v = std::stoull(value, &end);
+				if (end == value.size()) {
+					return v;
+				}
+			} catch (const std::logic_error &) {
+			}
+			throw WorkloadError("Expected a number for " + key + ": " + value);
+		};
+
+		if (key == "kind") {
+			if (value == "random") {
+				kind = WORKLOAD_RANDOM;
+			} else if (value == "closed_world") {
+				kind = WORKLOAD_CLOSED_WORLD;
+			} else {
+				throw WorkloadError("Unknown workload kind: " + value);
+			}
+		} else if (key == "dist") {
+			if (value == "uniform") {
+				dist = WORKLOAD_UNIFORM;
+			} else if (value == "normal") {
+				dist = WORKLOAD_NORMAL;
+			} else if (value == "optimistic") {
+				dist = WORKLOAD_OPTIMISTIC;
+			} else {
+				throw WorkloadError("Unknown distribution: " + value);
+			}
+		} else if (key == "pairs") {
+			arity = number() ? 2 : 1;
+		} else if (key == "count") {
+			count = number();
+		} else if (key == "maxsize") {
+			max_size = number();
+		} else if (key == "maxval") {
+			max_value = number();
+		} else if (key == "corpussize") {
+			corpus_size = number();
+		} else if (key == "seed") {
+			seed = number();
+		} else if (key == "threads") {
+			threads = number();
+		} else if (key == "results") {
+			results = number() != 0;
+		} else {
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief      Parses a comma separated list of `key=value` parameters (see
+	 *             `set()`). A key without a value is set to `1`.
+	 */
+	static WorkloadConfig parse(const std::string &spec) {
+		WorkloadConfig config;
+		std::size_t begin = 0;
+
+		while (begin < spec.size()) {
+			std::size_t end = spec.find(',', begin);
+			if (end == std::string::npos) {
+				end = spec.size();
+			}
+
+			std::string item = spec.substr(begin, end - begin);
+			std::size_t eq = item.find('=');
+			std::string key = item.substr(0, eq);
+			std::string value = eq == std::string::npos ? "1" : item.substr(eq + 1);
+
+			if (!key.empty() && !config.set(key, value)) {
+				throw WorkloadError("Unknown workload parameter: " + key);
+			}
+			begin = end + 1;
+		}
+
+		return config;
+	}
+};
+
+/**
+ * @brief      Small and fast random bit generator (xoshiro256**), seeded from
+ *             a seed and a stream number with splitmix64. Seeding is cheap,
+ *             so every corpus set and operation can have its own stream.
+ */
+class WorkloadRandom {
+	uint64_t s[4];
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static uint64_t splitmix(uint64_t &x) {
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+public:
+	using result_type = uint64_t;
+
+	WorkloadRandom(uint64_t seed, uint64_t stream) {
+		uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+		for (uint64_t &w : s) {
+			w = splitmix(x);
+		}
+	}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return UINT64_MAX;
+	}
+
+	result_type operator()() {
+		uint64_t ret = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return ret;
+	}
+
+	/// Uniform integer in `[lo, hi]`.
+	int64_t range(int64_t lo, int64_t hi) {
+		return std::uniform_int_distribution<int64_t>(lo, hi)(*this);
+	}
+
+	/**
+	 * @brief      The absolute value of a rounded normal variate, clamped to
+	 *             `[lo, hi]` (`generate_normal_int` of `benchmark.py`).
+	 */
+	int64_t normal(int64_t mean, int64_t stddev, int64_t lo, int64_t hi) {
+		double v = stddev > 0
+			? std::normal_distribution<double>(mean, stddev)(*this)
+			: double(mean);
+		int64_t ret = std::llabs(std::llround(v));
+		return std::min(std::max(ret, lo), hi);
+	}
+};
+
+/**
+ * @brief      Generates workloads into a sink with the interface of
+ *             `TraceWriter`: `corpus_set`, `corpus_duplicate` and
+ *             `operation`.
+ */
+class WorkloadGenerator {
+public:
+	/// Element of a generated set. The second component is 0 for arity 1.
+	using Element = std::array<int64_t, 2>;
+	using Set = std::vector<Element>;
+
+private:
+	/// Random stream numbers. Streams of corpus sets and random operations
+	/// are offset by their index.
+	enum : uint64_t {
+		STREAM_SCHEDULE = 0,
+		STREAM_FILL = 1,
+		STREAM_CORPUS = uint64_t(1) << 40,
+		STREAM_OPERATION = uint64_t(2) << 40
+	};
+
+	/// Number of operations generated in parallel before they are written.
+	static constexpr std::size_t BATCH_SIZE = 1 << 14;
+
+	struct Operation {
+		TraceOpcode op;
+		uint64_t a, b;
+		Set left, right, result;
+	};
+
+	WorkloadConfig config;
+	unsigned threads;
+
+	/// Divisor of the standard deviation of the first component of normal
+	/// pairs: the `closed_world_pointsto` script narrows it more than the
+	/// `random_pointsto` one.
+	int64_t pair_key_divisor() const {
+		return config.kind == WORKLOAD_CLOSED_WORLD ? 8 : 2;
+	}
+
+	/**
+	 * @brief      Draws elements with `draw` until there are `size` distinct
+	 *             ones (or too many draws were needed), and returns them
+	 *             sorted. Duplicates are removed a round at a time, which is
+	 *             cheaper than a hash set for the sparse sets generated here.
+	 */
+	template<typename T, typename Draw>
+	static std::vector<T> distinct(std::size_t size, Draw &&draw) {
+		std::vector<T> ret;
+		std::size_t attempts = 0;
+		const std::size_t max_attempts = 64 * size + 64;
+
+		while (ret.size() < size && attempts < max_attempts) {
+			while (ret.size() < size && attempts++ < max_attempts) {
+				ret.push_back(draw());
+			}
+			std::sort(ret.begin(), ret.end());
+			ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+		}
+		return ret;
+	}
+
+	Set uniform_set(WorkloadRandom &rng) const {
+		const int64_t universe = config.max_value + 1;
+		int64_t size = rng.range(0, config.max_size);
+		int64_t values = std::min<int64_t>(size * config.arity, universe);
+
+		std::vector<int64_t> picked = distinct<int64_t>(values, [&]() {
+			return rng.range(0, universe - 1);
+		});
+
+		Set ret;
+		if (config.arity == 2) {
+			// Pair up the sample in random order.
+			std::shuffle(picked.begin(), picked.end(), rng);
+			for (std::size_t i = 0; i + 1 < picked.size(); i += 2) {
+				ret.push_back({ picked[i], picked[i + 1] });
+			}
+			std::sort(ret.begin(), ret.end());
+		} else {
+			for (int64_t v : picked) {
+				ret.push_back({ v, 0 });
+			}
+		}
+		return ret;
+	}
+
+	Set normal_set(WorkloadRandom &rng) const {
+		const int64_t max = config.max_value;
+		const int64_t mean = max / 2;
+		const int64_t stddev = max / 4;
+
+		int64_t size = rng.normal(0, config.max_size / 2, 0, config.max_size);
+		if (config.arity == 1) {
+			size = std::min(size, max + 1);
+		}
+
+		return distinct<Element>(size, [&]() -> Element {
+			if (config.arity == 2) {
+				int64_t key = rng.normal(mean, stddev / pair_key_divisor(), 0, max);
+				return { key, rng.normal(mean, stddev, 0, max) };
+			}
+			return { rng.normal(mean, stddev, 0, max), 0 };
+		});
+	}
+
+	Set make_set(WorkloadRandom &rng) const {
+		return config.dist == WORKLOAD_NORMAL ? normal_set(rng) : uniform_set(rng);
+	}
+
+	static TraceOpcode random_opcode(WorkloadRandom &rng) {
+		static const TraceOpcode ops[] = { TRACE_UNION, TRACE_INTERSECTION, TRACE_DIFFERENCE };
+		return ops[rng.range(0, 2)];
+	}
+
+	static void apply(TraceOpcode op, const Set &a, const Set &b, Set &out) {
+		out.clear();
+		auto it = std::back_inserter(out);
+		switch (op) {
+		case TRACE_UNION:
+			std::set_union(a.begin(), a.end(), b.begin(), b.end(), it);
+			break;
+		case TRACE_INTERSECTION:
+			std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), it);
+			break;
+		default:
+			std::set_difference(a.begin(), a.end(), b.begin(), b.end(), it);
+			break;
+		}
+	}
+
+	/// Runs `f(i)` for every `i` in `[0, n)`, split over the threads.
+	template<typename F>
+	void parallel_for(std::size_t n, F &&f) const {
+		std::size_t workers = std::min<std::size_t>(threads, n);
+		if (workers <= 1) {
+			for (std::size_t i = 0; i < n; i++) {
+				f(i);
+			}
+			return;
+		}
+
+		std::vector<std::thread> pool;
+		for (std::size_t w = 0; w < workers; w++) {
+			pool.emplace_back([&, w]() {
+				for (std::size_t i = w * n / workers; i < (w + 1) * n / workers; i++) {
+					f(i);
+				}
+			});
+		}
+		for (auto &t : pool) {
+			t.join();
+		}
+	}
+
+	void flatten(const Set &s, std::vector<int64_t> &out) const {
+		out.clear();
+		for (const Element &e : s) {
+			out.push_back(e[0]);
+			if (config.arity == 2) {
+				out.push_back(e[1]);
+			}
+		}
+	}
+
+	template<typename Sink>
+	void write_batch(Sink &sink, std::vector<Operation> &batch, std::size_t n, bool corpus) const {
+		std::vector<int64_t> left, right, result;
+		for (std::size_t i = 0; i < n; i++) {
+			Operation &o = batch[i];
+			if (config.results) {
+				flatten(o.result, result);
+			}
+
+			if (corpus) {
+				sink.operation(
+					o.op,
+					TraceWriter::Operand::corpus(o.a),
+					TraceWriter::Operand::corpus(o.b),
+					config.results ? &result : nullptr);
+			} else {
+				flatten(o.left, left);
+				flatten(o.right, right);
+				sink.operation(
+					o.op,
+					TraceWriter::Operand::inline_set(left, config.arity),
+					TraceWriter::Operand::inline_set(right, config.arity),
+					config.results ? &result : nullptr);
+			}
+		}
+	}
+
+	template<typename Sink>
+	void generate_random(Sink &sink) const {
+		std::vector<Operation> batch(BATCH_SIZE);
+
+		for (uint64_t first = 0; first < config.count; first += BATCH_SIZE) {
+			std::size_t n = std::min<uint64_t>(BATCH_SIZE, config.count - first);
+
+			parallel_for(n, [&](std::size_t i) {
+				WorkloadRandom rng(config.seed, STREAM_OPERATION + first + i);
+				Operation &o = batch[i];
+				o.left = make_set(rng);
+				o.right = make_set(rng);
+				o.op = random_opcode(rng);
+				if (config.results) {
+					apply(o.op, o.left, o.right, o.result);
+				}
+			});
+
+			write_batch(sink, batch, n, false);
+		}
+	}
+
+	template<typename Sink>
+	void generate_closed_world(Sink &sink) const {
+		const uint64_t initial = std::max<uint64_t>(config.corpus_size, 1);
+		WorkloadRandom rng(config.seed, STREAM_SCHEDULE);
+
+		// Distinct sets, and the distinct set of every corpus entry.
+		std::vector<Set> sets;
+		std::vector<uint64_t> origin;
+
+		// Pool of operations of the optimistic distribution.
+		struct Candidate {
+			uint64_t a, b;
+			TraceOpcode op;
+		};
+		std::vector<Candidate> candidates;
+
+		auto add_candidates = [&](uint64_t n) {
+			for (uint64_t i = 0; i < n; i++) {
+				uint64_t a = rng.range(0, origin.size() - 1);
+				uint64_t b = rng.range(0, origin.size() - 1);
+				candidates.push_back({ a, b, random_opcode(rng) });
+			}
+		};
+
+		if (config.dist == WORKLOAD_OPTIMISTIC) {
+			// A quarter as many distinct sets as corpus entries, spread over
+			// three quarters of the corpus; the other entries stay empty.
+			sets.resize(1 + initial / 4);
+			parallel_for(initial / 4, [&](std::size_t i) {
+				WorkloadRandom set_rng(config.seed, STREAM_CORPUS + i);
+				sets[i + 1] = uniform_set(set_rng);
+			});
+
+			origin.assign(initial, 0);
+			WorkloadRandom fill(config.seed, STREAM_FILL);
+			if (initial / 4 > 0) {
+				for (uint64_t i = 0; i < initial * 3 / 4; i++) {
+					uint64_t slot = fill.range(0, initial - 1);
+					origin[slot] = 1 + fill.range(0, initial / 4 - 1);
+				}
+			}
+
+			add_candidates(initial > 1 ? rng.range(1, initial - 1) : 1);
+		} else {
+			sets.resize(initial);
+			parallel_for(initial, [&](std::size_t i) {
+				WorkloadRandom set_rng(config.seed, STREAM_CORPUS + i);
+				sets[i] = make_set(set_rng);
+			});
+
+			origin.resize(initial);
+			for (uint64_t i = 0; i < initial; i++) {
+				origin[i] = i;
+			}
+		}
+
+		std::vector<int64_t> flat;
+		for (uint64_t o : origin) {
+			flatten(sets[o], flat);
+			sink.corpus_set(flat);
+		}
+
+		std::vector<Operation> batch(BATCH_SIZE);
+		std::size_t pending = 0;
+
+		auto drain = [&]() {
+			if (config.results) {
+				parallel_for(pending, [&](std::size_t i) {
+					Operation &o = batch[i];
+					apply(o.op, sets[origin[o.a]], sets[origin[o.b]], o.result);
+				});
+			}
+			write_batch(sink, batch, pending, true);
+			pending = 0;
+		};
+
+		uint64_t next_increment = origin.size() * 10;
+
+		for (uint64_t n = 0; n < config.count; n++) {
+			if (next_increment == 0) {
+				uint64_t start = rng.range(0, origin.size() - 1);
+				uint64_t stop = rng.range(start, origin.size() - 1);
+
+				// Corpus duplicates must follow the operations before them.
+				drain();
+				sink.corpus_duplicate(start, stop);
+
+				for (uint64_t i = start; i <= stop; i++) {
+					origin.push_back(origin[i]);
+				}
+				next_increment = origin.size();
+
+				if (config.dist == WORKLOAD_OPTIMISTIC) {
+					add_candidates(rng.range(0, stop - start));
+				}
+			} else {
+				next_increment--;
+			}
+
+			Operation &o = batch[pending++];
+			if (config.dist == WORKLOAD_OPTIMISTIC) {
+				const Candidate &c = candidates[rng.range(0, candidates.size() - 1)];
+				o.a = c.a;
+				o.b = c.b;
+				o.op = c.op;
+			} else {
+				const int64_t last = origin.size() - 1;
+				if (config.dist == WORKLOAD_NORMAL) {
+					o.a = rng.normal(0, last / 2, 0, last);
+					o.b = rng.normal(0, last / 2, 0, last);
+				} else {
+					o.a = rng.range(0, last);
+					o.b = rng.range(0, last);
+				}
+				o.op = random_opcode(rng);
+			}
+
+			if (pending == BATCH_SIZE) {
+				drain();
+			}
+		}
+
+		drain();
+	}
+
+public:
+	explicit WorkloadGenerator(const WorkloadConfig &config):
+		config(config),
+		threads(config.threads ? config.threads : std::max(1u, std::thread::hardware_concurrency())) {
+		if (config.arity != 1 && config.arity != 2) {
+			throw WorkloadError("Workload element arity must be 1 or 2");
+		}
+		if (config.kind == WORKLOAD_RANDOM && config.dist == WORKLOAD_OPTIMISTIC) {
+			throw WorkloadError("The optimistic distribution needs a closed-world workload");
+		}
+	}
+
+	const WorkloadConfig &workload() const {
+		return config;
+	}
+
+	/**
+	 * @brief      Generates the whole workload into `sink`.
+	 */
+	template<typename Sink>
+	void generate(Sink &sink) const {
+		if (config.kind == WORKLOAD_RANDOM) {
+			generate_random(sink);
+		} else {
+			generate_closed_world(sink);
+		}
+	}
+};
+
+/**
+ * @brief      Sink that writes a workload in the text format read by the
+ *             `abstract` test programs and `trace_convert`.
+ */
+class WorkloadTextWriter {
+	std::ostream &out;
+	const WorkloadConfig &config;
+	bool counted = false;
+	bool corpus_started = false;
+
+	void put_set(const int64_t *data, std::size_t count) {
+		out << count;
+		for (std::size_t i = 0; i < count * config.arity; i++) {
+			out << ' ' << data[i];
+		}
+		out << '\n';
+	}
+
+	void put_count() {
+		if (config.kind == WORKLOAD_CLOSED_WORLD && !corpus_started) {
+			out << 0 << '\n';
+			corpus_started = true;
+		}
+		if (!counted) {
+			out << config.count << '\n';
+			counted = true;
+		}
+	}
+
+public:
+	/**
+	 * @param      out     The output stream
+	 * @param[in]  config  The workload being written. Its operations must
+	 *                     have results.
+	 */
+	WorkloadTextWriter(std::ostream &out, const WorkloadConfig &config): out(out), config(config) {
+		if (!config.results) {
+			throw WorkloadError("Text workloads need operation results");
+		}
+	}
+
+	void corpus_set(const std::vector<int64_t> &elements) {
+		if (!corpus_started) {
+			out << std::max<uint64_t>(config.corpus_size, 1) << '\n';
+			corpus_started = true;
+		}
+		put_set(elements.data(), elements.size() / config.arity);
+	}
+
+	void corpus_duplicate(uint64_t start, uint64_t stop) {
+		put_count();
+		out << "S " << start << ' ' << stop << '\n';
+	}
+
+	void operation(
+		TraceOpcode op,
+		const TraceWriter::Operand &a,
+		const TraceWriter::Operand &b,
+		const std::vector<int64_t> *result) {
+		put_count();
+		out << (op == TRACE_UNION ? 'U' : op == TRACE_INTERSECTION ? 'I' : 'D') << '\n';
+
+		for (const TraceWriter::Operand *o : { &a, &b }) {
+			if (o->is_corpus) {
+				out << o->corpus_index << '\n';
+			} else {
+				put_set(o->data, o->count);
+			}
+		}
+
+		put_set(result->data(), result->size() / config.arity);
+	}
+
+	void finish() {
+		put_count();
+		out.flush();
+	}
+};
+
+}
+
+#endif
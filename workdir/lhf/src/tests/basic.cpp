@@ -2,6 +2,8 @@
 #include "lhf/lhf.hpp"
 #include <gtest/gtest.h>
 #include <iostream>
+#include <random>
+#include <set>
 
 using LHF = LHFVerify<int>;
 using Index = typename LHF::Index;
@@ -306,4 +308,203 @@ TEST(LHF_BasicChecks, property_set_out_of_bounds_throws_exception) {
 	l.register_set_single(5);
 	ASSERT_THROW(l.get_value(Index(99999999)), lhf::AssertError);
 }
-#endif
\ No newline at end of file
+#endif
+
+struct DoubleTransform {
+	static constexpr bool is_order_preserving = true;
+	long operator()(const LHF::PropertyElement &p) const {
+		return 2L * p.get_value();
+	}
+};
+
+struct ModuloTransform {
+	static constexpr bool is_order_preserving = false;
+	int operator()(const LHF::PropertyElement &p) const {
+		return -(p.get_value() % 3);
+	}
+};
+
+TEST(LHF_BasicChecks, set_transform_check) {
+	using TargetLHF = lhf::LatticeHashForest<long>;
+	LHF l;
+	TargetLHF t;
+
+	Index a = l.register_set({ 1, 2, 3, 4, 5 });
+	TargetLHF::Index b = l.set_transform<DoubleTransform>(a, t);
+	ASSERT_EQ(b, t.register_set({ 2, 4, 6, 8, 10 }));
+	ASSERT_EQ(b, l.set_transform<DoubleTransform>(a, t));
+	ASSERT_TRUE(l.set_transform<DoubleTransform>(Index(lhf::EMPTY_SET_VALUE), t).is_empty());
+
+	Index c = l.set_transform<ModuloTransform>(a, l);
+	ASSERT_EQ(c, l.register_set({ -2, -1, 0 }));
+	ASSERT_EQ(c, l.set_transform<ModuloTransform>(a, l));
+	ASSERT_EQ(l.set_transform<ModuloTransform>(l.register_set({ 3, 6, 9 }), l), l.register_set({ 0 }));
+}
+
+struct ScaleTransform {
+	static constexpr bool is_order_preserving = true;
+	long factor;
+	long operator()(const LHF::PropertyElement &p) const {
+		return factor * p.get_value();
+	}
+	std::uint64_t state_key() const {
+		return factor;
+	}
+};
+
+TEST(LHF_BasicChecks, set_transform_separates_targets_and_state) {
+	using TargetLHF = lhf::LatticeHashForest<long>;
+	LHF l;
+	TargetLHF t1;
+	TargetLHF t2;
+
+	// Pad t2 so that its indices differ from those of t1.
+	t2.register_set({ 100 });
+	t2.register_set({ 200 });
+
+	Index a = l.register_set({ 1, 2, 3 });
+	TargetLHF::Index b1 = l.set_transform<DoubleTransform>(a, t1);
+	TargetLHF::Index b2 = l.set_transform<DoubleTransform>(a, t2);
+	ASSERT_EQ(b1, t1.register_set({ 2, 4, 6 }));
+	ASSERT_EQ(b2, t2.register_set({ 2, 4, 6 }));
+	ASSERT_NE(b1, b2);
+	ASSERT_EQ(b1, l.set_transform<DoubleTransform>(a, t1));
+	ASSERT_EQ(b2, l.set_transform<DoubleTransform>(a, t2));
+
+	TargetLHF::Index c3 = l.set_transform(a, t1, ScaleTransform{3});
+	TargetLHF::Index c5 = l.set_transform(a, t1, ScaleTransform{5});
+	ASSERT_EQ(c3, t1.register_set({ 3, 6, 9 }));
+	ASSERT_EQ(c5, t1.register_set({ 5, 10, 15 }));
+	ASSERT_EQ(c3, l.set_transform(a, t1, ScaleTransform{3}));
+}
+
+TEST(LHF_BasicChecks, transient_check) {
+	LHF l;
+	Index a = l.register_set({ 1, 2, 3 });
+	lhf::Size count = l.property_set_count();
+
+	LHF::Transient t = l.transient(a);
+	t.insert(5);
+	t.insert(0);
+	t.insert(2);
+	t.remove(1);
+	t.remove(7);
+	t.update(3);
+	ASSERT_TRUE(t.contains(5));
+	ASSERT_FALSE(t.contains(1));
+	ASSERT_EQ(t.size(), 4);
+
+	// Nothing is registered before the commit.
+	ASSERT_EQ(l.property_set_count(), count);
+	Index b = t.commit();
+	ASSERT_EQ(l.property_set_count(), count + 1);
+	ASSERT_EQ(b, l.register_set({ 0, 2, 3, 5 }));
+
+	ASSERT_EQ(l.transient(a).commit(), a);
+	ASSERT_TRUE(l.transient().commit().is_empty());
+
+	for (int i : { 0, 2, 3, 5 }) {
+		t.remove(i);
+	}
+	ASSERT_TRUE(t.empty());
+	ASSERT_TRUE(t.commit().is_empty());
+}
+
+TEST(LHF_BasicChecks, transient_matches_set_randomized) {
+	LHF l;
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> key(0, 200);
+	std::uniform_int_distribution<int> op(0, 9);
+
+	std::set<int> expected = { 3, 50, 120 };
+	LHF::Transient t = l.transient(l.register_set(expected.begin(), expected.end()));
+
+	// Updates interleaved with occasional queries, which merge the staged
+	// updates in the middle of the batch.
+	for (int i = 0; i < 5000; i++) {
+		int k = key(gen);
+		int o = op(gen);
+		if (o < 5) {
+			t.insert(k);
+			expected.insert(k);
+		} else if (o < 7) {
+			t.update(k);
+			expected.insert(k);
+		} else if (o < 9) {
+			t.remove(k);
+			expected.erase(k);
+		} else {
+			ASSERT_EQ(t.contains(k), expected.count(k) > 0);
+		}
+	}
+
+	ASSERT_EQ(t.size(), expected.size());
+	ASSERT_EQ(t.commit(), l.register_set(expected.begin(), expected.end()));
+}
+
+struct ReverseLess {
+	bool operator()(const int &a, const int &b) const { return a > b; }
+};
+
+struct ModEqual {
+	bool operator()(const int &a, const int &b) const { return a % 10 == b % 10; }
+};
+
+TEST(LHF_BasicChecks, bytewise_set_hash_equal_check) {
+	using BytewiseLHF = lhf::LatticeHashForest<int>;
+	using CustomLHF = lhf::LatticeHashForest<int, ReverseLess, lhf::DefaultHash<int>, ModEqual>;
+	ASSERT_TRUE(BytewiseLHF::PropertyElement::is_bytewise);
+	ASSERT_TRUE(lhf::LatticeHashForest<int *>::PropertyElement::is_bytewise);
+	ASSERT_FALSE(lhf::LatticeHashForest<double>::PropertyElement::is_bytewise);
+	ASSERT_FALSE(CustomLHF::PropertyElement::is_bytewise);
+
+	BytewiseLHF::PropertySet a = { 1, 2, 3, 100, 200, 300, 1000, 2000, 3000, 10000, 20000, 30000, 40000 };
+	BytewiseLHF::PropertySet b = a;
+	BytewiseLHF::PropertySetHash hash;
+	BytewiseLHF::PropertySetFullEqual equal;
+	ASSERT_EQ(hash(&a), hash(&b));
+	ASSERT_TRUE(equal(&a, &b));
+	b.back() = 40001;
+	ASSERT_NE(hash(&a), hash(&b));
+	ASSERT_FALSE(equal(&a, &b));
+
+	LHF l;
+	Index x = l.register_set({ 1, 2, 3 });
+	Index y = l.register_set({ 4, 5, 6, 7 });
+	ASSERT_EQ(l.set_union(x, y), l.register_set({ 1, 2, 3, 4, 5, 6, 7 }));
+	ASSERT_EQ(l.set_union(y, l.register_set({ 8, 9 })), l.register_set({ 4, 5, 6, 7, 8, 9 }));
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	ASSERT_EQ(l.hash_collisions(), 0);
+#endif
+}
+
+TEST(LHF_BasicChecks, index_width_check) {
+	ASSERT_EQ(sizeof(lhf::OperationNode), 2 * sizeof(lhf::IndexValue));
+	ASSERT_EQ(sizeof(Index), sizeof(lhf::IndexValue));
+	ASSERT_EQ(lhf::to_index_value(1234), 1234u);
+#ifdef LHF_ENABLE_32BIT_INDEX
+	ASSERT_EQ(sizeof(lhf::IndexValue), 4u);
+	ASSERT_THROW(lhf::to_index_value(lhf::Size(1) << 32), lhf::IndexOverflowError);
+#endif
+}
+
+TEST(LHF_BasicChecks, memory_usage_check) {
+	LHF l;
+	lhf::MemoryUsage empty = l.memory_usage();
+	ASSERT_EQ(empty.property_sets, l.property_set_count());
+	ASSERT_TRUE(empty.children.empty());
+
+	Index x = l.register_set({ 1, 2, 3 });
+	Index y = l.register_set({ 4, 5, 6, 7 });
+	l.set_union(x, y);
+
+	lhf::MemoryUsage m = l.memory_usage();
+	ASSERT_EQ(m.property_sets, l.property_set_count());
+	ASSERT_GE(m.payload_bytes, 3 * sizeof(LHF::PropertySet) + 14 * sizeof(int));
+	ASSERT_GE(m.holder_bytes, l.property_set_count() * sizeof(void *));
+	ASSERT_EQ(m.property_set_map.entries, l.property_set_count());
+	ASSERT_EQ(m.operation_maps.at("unions").entries, 1);
+	ASSERT_EQ(m.operation_maps.at("intersections").bytes(), empty.operation_maps.at("intersections").bytes());
+	ASSERT_GT(m.own_bytes(), empty.own_bytes());
+	ASSERT_EQ(m.own_bytes(), m.total_bytes());
+}
@@ -0,0 +1,93 @@
+#include "lhf/lhf.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using IntDedup = lhf::Deduplicator<int>;
+using StringDedup = lhf::Deduplicator<std::string>;
+
+TEST(LHF_DeduplicatorChecks, dense_stable_indices) {
+	IntDedup d;
+	std::vector<const int *> refs;
+
+	for (int i = 0; i < 10000; i++) {
+		ASSERT_EQ(d.register_value(i * 7).value, lhf::IndexValue(i));
+		refs.push_back(&d.get_value(IntDedup::Index(i)));
+	}
+
+	ASSERT_EQ(d.size(), 10000u);
+	for (int i = 0; i < 10000; i++) {
+		ASSERT_EQ(d.register_value(i * 7).value, lhf::IndexValue(i));
+		// Values never move as the storage grows.
+		ASSERT_EQ(&d.get_value(IntDedup::Index(i)), refs[i]);
+		ASSERT_EQ(*refs[i], i * 7);
+	}
+
+	ASSERT_EQ(d.size(), 10000u);
+	ASSERT_TRUE(d.find(7 * 42).is_present());
+	ASSERT_EQ(d.find(7 * 42).get(), IntDedup::Index(42));
+	ASSERT_FALSE(d.find(1).is_present());
+	ASSERT_EQ(d.size(), 10000u);
+}
+
+TEST(LHF_DeduplicatorChecks, heterogeneous_string_lookup) {
+	StringDedup d;
+	std::string owned = "alpha";
+
+	StringDedup::Index a = d.register_value(owned);
+	ASSERT_EQ(d.register_value(std::string_view("alpha")), a);
+	ASSERT_EQ(d.register_value("alpha"), a);
+
+	std::string_view b_view = std::string_view("xbeta").substr(1);
+	StringDedup::Index b = d.register_value(b_view);
+	ASSERT_NE(a, b);
+	ASSERT_EQ(d.get_value(b), "beta");
+	ASSERT_EQ(d.find(std::string("beta")).get(), b);
+	ASSERT_FALSE(d.find(std::string_view("gamma")).is_present());
+	ASSERT_EQ(d.size(), 2u);
+}
+
+#ifdef LHF_ENABLE_PARALLEL
+
+TEST(LHF_DeduplicatorChecks, concurrent_registration) {
+	constexpr int threads = 4;
+	constexpr int values = 20000;
+	lhf::ConcurrentDeduplicator<std::string> d;
+	std::vector<std::vector<lhf::IndexValue>> seen(threads);
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++) {
+		workers.emplace_back([&, t]() {
+			// Every thread registers every value, in a different order.
+			for (int i = 0; i < values; i++) {
+				int v = (i * (2 * t + 1)) % values;
+				lhf::IndexValue idx = d.register_value(std::to_string(v)).value;
+				ASSERT_EQ(d.get_value(idx), std::to_string(v));
+				seen[t].push_back(idx);
+			}
+		});
+	}
+	for (auto &w : workers) {
+		w.join();
+	}
+
+	// Indices are dense and agree between threads.
+	ASSERT_EQ(d.size(), std::size_t(values));
+	std::vector<bool> used(values, false);
+	for (int i = 0; i < values; i++) {
+		lhf::IndexValue idx = d.find(std::to_string(i)).get().value;
+		ASSERT_LT(idx, lhf::IndexValue(values));
+		ASSERT_FALSE(used[idx]);
+		used[idx] = true;
+	}
+	for (int t = 0; t < threads; t++) {
+		for (int i = 0; i < values; i++) {
+			int v = (i * (2 * t + 1)) % values;
+			ASSERT_EQ(seen[t][i], d.find(std::to_string(v)).get().value);
+		}
+	}
+}
+
+#endif
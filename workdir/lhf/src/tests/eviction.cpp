@@ -47,4 +47,24 @@ TEST(LHF_EvictionChecks, eviction_operation_test) {
 	ASSERT_FALSE(l.is_evicted(c));
 }
 
+struct NegateTransform {
+	static constexpr bool is_order_preserving = false;
+	int operator()(const LHF::PropertyElement &p) const {
+		return -p.get_value();
+	}
+};
+
+TEST(LHF_EvictionChecks, eviction_transform_test) {
+	LHF l;
+	LHF t;
+	Index a = l.register_set({1, 2});
+	Index c = l.set_transform<NegateTransform>(a, t);
+
+	t.evict_set(c);
+	ASSERT_TRUE(t.is_evicted(c));
+	ASSERT_EQ(l.set_transform<NegateTransform>(a, t), c);
+	ASSERT_FALSE(t.is_evicted(c));
+	ASSERT_EQ(t.get_value(c), t.get_value(t.register_set({-2, -1})));
+}
+
 #endif
\ No newline at end of file
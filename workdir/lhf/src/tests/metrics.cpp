@@ -0,0 +1,147 @@
+#include "lhf/lhf.hpp"
+#include "lhf/metrics.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using LHF = lhf::LatticeHashForest<int>;
+
+static std::string read_file(const std::string &path) {
+	std::ifstream in(path);
+	std::stringstream s;
+	s << in.rdbuf();
+	return s.str();
+}
+
+TEST(LHF_MetricsChecks, report_contents) {
+	LHF l;
+	LHF::Index a = l.register_set({ 1, 2, 3 });
+	LHF::Index b = l.register_set({ 4 });
+	l.set_union(a, b);
+	l.set_union(a, b);
+
+	lhf::MetricsReport r = l.metrics();
+	ASSERT_EQ(r.property_set_count, l.property_set_count());
+	ASSERT_EQ(r.set_size.max, 4);
+	ASSERT_EQ(r.maps.at("property_sets").entries, l.property_set_count());
+	ASSERT_EQ(r.maps.at("unions").entries, 1);
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+	ASSERT_EQ(r.operations.at("unions").hits, 1);
+	ASSERT_EQ(r.operations.at("unions").cold_misses, 1);
+	ASSERT_DOUBLE_EQ(r.operations.at("unions").hit_ratio(), 0.5);
+#endif
+}
+
+TEST(LHF_MetricsChecks, serializers) {
+	LHF l;
+	l.set_union(l.register_set({ 1 }), l.register_set({ 2 }));
+	lhf::MetricsReport r = l.metrics();
+
+	std::string json = lhf::metrics_to_json(r, "pts", { 12, 0.5 });
+	ASSERT_EQ(json.find('\n'), std::string::npos);
+	ASSERT_NE(json.find("\"lhf\":\"pts\""), std::string::npos);
+	ASSERT_NE(json.find("\"property_sets\":4"), std::string::npos);
+	ASSERT_NE(json.find("\"set_growth_per_s\":0.5"), std::string::npos);
+	ASSERT_NE(json.find("\"dropped_probes\":[]"), std::string::npos);
+
+	std::string prom = lhf::metrics_to_prometheus({ { "pts", r } });
+	ASSERT_NE(prom.find("# TYPE lhf_property_sets gauge\n"), std::string::npos);
+	ASSERT_NE(prom.find("lhf_property_sets{lhf=\"pts\"} 4\n"), std::string::npos);
+	ASSERT_NE(prom.find("lhf_map_entries{lhf=\"pts\",map=\"unions\"} 1\n"), std::string::npos);
+	ASSERT_NE(prom.find("lhf_dropped_probes{lhf=\"pts\"} 0\n"), std::string::npos);
+}
+
+TEST(LHF_MetricsChecks, writer_interval_and_files) {
+	LHF l;
+	l.register_set({ 1, 2 });
+
+	std::string json_path = testing::TempDir() + "lhf_metrics_test.jsonl";
+	std::string prom_path = testing::TempDir() + "lhf_metrics_test.prom";
+	std::remove(json_path.c_str());
+
+	lhf::MetricsWriter json(lhf::MetricsWriter::JSON_LINES, json_path, 3600);
+	json.add("main", l);
+
+	ASSERT_FALSE(json.poll());
+	json.enable();
+	ASSERT_TRUE(json.poll());
+	ASSERT_FALSE(json.poll());
+	json.write();
+
+	std::string contents = read_file(json_path);
+	ASSERT_EQ(std::count(contents.begin(), contents.end(), '\n'), 2);
+
+	lhf::MetricsWriter prom(lhf::MetricsWriter::PROMETHEUS, prom_path, 0);
+	prom.add("main", l);
+	prom.enable();
+	ASSERT_TRUE(prom.poll());
+	ASSERT_EQ(read_file(prom_path), prom.latest_output());
+
+	std::remove(json_path.c_str());
+	std::remove(prom_path.c_str());
+}
+
+#ifdef LHF_METRICS_ENABLE_SOCKET
+static int connect_unix(const std::string &path) {
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	std::copy(path.begin(), path.end(), addr.sun_path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+TEST(LHF_MetricsChecks, socket_clients) {
+	LHF l;
+	l.register_set({ 1, 2 });
+
+	std::string sock_path = testing::TempDir() + "lhf_metrics_test.sock";
+	lhf::MetricsWriter prom(lhf::MetricsWriter::PROMETHEUS, "", 0);
+	prom.add("main", l);
+	ASSERT_TRUE(prom.listen_unix(sock_path));
+	prom.enable();
+	ASSERT_TRUE(prom.poll());
+
+	// A well-behaved client receives the whole exposition.
+	int fd = connect_unix(sock_path);
+	ASSERT_GE(fd, 0);
+	prom.poll();
+	std::string received;
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		received.append(buf, n);
+	}
+	close(fd);
+	ASSERT_EQ(received, prom.latest_output());
+
+	// A client that disconnects before it is served must not raise SIGPIPE.
+	fd = connect_unix(sock_path);
+	ASSERT_GE(fd, 0);
+	close(fd);
+	prom.poll();
+
+	// A client that never reads must not block poll() once the exposition
+	// exceeds the socket buffer.
+	for (int i = 0; i < 2000; i++) {
+		prom.add("lhf_" + std::to_string(i), l);
+	}
+	prom.write();
+	ASSERT_GT(prom.latest_output().size(), 1u << 20);
+	fd = connect_unix(sock_path);
+	ASSERT_GE(fd, 0);
+	prom.poll();
+	close(fd);
+}
+#endif
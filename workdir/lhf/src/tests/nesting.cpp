@@ -0,0 +1,221 @@
+#include "lhf/lhf.hpp"
+#include <gtest/gtest.h>
+#include <random>
+
+using ChildLHF = lhf::LatticeHashForest<int>;
+using ChildIndex = typename ChildLHF::Index;
+
+template<template<typename, typename...> typename Nesting>
+using NestedLHF =
+	lhf::LatticeHashForest<
+		int,
+		lhf::DefaultLess<int>,
+		lhf::DefaultHash<int>,
+		lhf::DefaultEqual<int>,
+		lhf::DefaultPrinter<int>,
+		Nesting<int, ChildLHF, ChildLHF>>;
+
+using AoSLHF = NestedLHF<lhf::NestingBase>;
+using SoALHF = NestedLHF<lhf::NestingSoA>;
+
+template<typename LHF>
+std::string to_string(const LHF &l, const typename LHF::Index &idx) {
+	return l.property_set_to_string(idx);
+}
+
+TEST(LHF_NestingChecks, soa_layout_selected) {
+	ASSERT_FALSE(AoSLHF::soa_layout);
+	ASSERT_TRUE(SoALHF::soa_layout);
+	ASSERT_TRUE(lhf::is_soa_property_set<SoALHF::PropertySet>::value);
+	ASSERT_FALSE(lhf::is_soa_property_set<AoSLHF::PropertySet>::value);
+}
+
+TEST(LHF_NestingChecks, soa_set_basic_operations) {
+	ChildLHF c1, c2;
+	SoALHF l({c1, c2});
+
+	ChildIndex a = c1.register_set({ 1, 2 });
+	ChildIndex b = c2.register_set({ 3 });
+	ChildIndex c = c1.register_set({ 4 });
+
+	SoALHF::Index x = l.register_set({ { 1, { a, b } }, { 5, { c, b } } });
+	SoALHF::Index y = l.register_set({ { 1, { c, {} } }, { 7, { a, a } } });
+
+	ASSERT_EQ(x, l.register_set({ { 1, { a, b } }, { 5, { c, b } } }));
+	ASSERT_NE(x, l.register_set({ { 1, { a, b } }, { 5, { c, c } } }));
+	ASSERT_EQ(l.size_of(x), 2);
+
+	SoALHF::Index u = l.set_union(x, y);
+	ASSERT_EQ(u, l.register_set({
+		{ 1, { c1.register_set({ 1, 2, 4 }), b } },
+		{ 5, { c, b } },
+		{ 7, { a, a } } }));
+
+	ASSERT_EQ(l.set_intersection(x, y), l.register_set({ { 1, { {}, {} } } }));
+	ASSERT_EQ(l.set_difference(x, y), x);
+
+	ASSERT_TRUE(l.find_key(u, 7).is_present());
+	ASSERT_EQ(l.find_key(u, 7).get().get_value(), std::make_tuple(a, a));
+	ASSERT_FALSE(l.find_key(u, 6).is_present());
+	ASSERT_TRUE(l.contains(u, { 5, { c, b } }));
+	ASSERT_EQ(l.set_remove_single_key(u, 5), l.register_set({
+		{ 1, { c1.register_set({ 1, 2, 4 }), b } },
+		{ 7, { a, a } } }));
+
+	ASSERT_THROW(l.register_set({ { 5, { a, b } }, { 1, { a, b } } }), lhf::AssertError);
+}
+
+TEST(LHF_NestingChecks, memory_usage_recurses) {
+	ChildLHF c1, c2;
+	SoALHF l({c1, c2});
+
+	ChildIndex a = c1.register_set({ 1, 2 });
+	ChildIndex b = c2.register_set({ 3 });
+	l.register_set({ { 1, { a, b } }, { 5, { a, b } } });
+
+	lhf::MemoryUsage m = l.memory_usage();
+	ASSERT_EQ(m.children.size(), 2);
+	ASSERT_EQ(m.children[0].property_sets, c1.property_set_count());
+	ASSERT_EQ(m.children[1].property_sets, c2.property_set_count());
+	ASSERT_EQ(m.total_bytes(), m.own_bytes() + c1.memory_usage().total_bytes() + c2.memory_usage().total_bytes());
+	ASSERT_GE(m.payload_bytes, 2 * (sizeof(int) + 2 * sizeof(ChildIndex)));
+}
+
+TEST(LHF_NestingChecks, soa_matches_aos_randomized) {
+	ChildLHF ac1, ac2, sc1, sc2;
+	AoSLHF aos({ac1, ac2});
+	SoALHF soa({sc1, sc2});
+
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<int> key(0, 40);
+	std::uniform_int_distribution<int> count(0, 12);
+
+	std::vector<AoSLHF::Index> aos_sets;
+	std::vector<SoALHF::Index> soa_sets;
+
+	for (int i = 0; i < 64; i++) {
+		std::map<int, std::pair<std::set<int>, std::set<int>>> elems;
+		int n = count(gen);
+		for (int j = 0; j < n; j++) {
+			auto &e = elems[key(gen)];
+			e.first.insert(key(gen));
+			e.second.insert(key(gen));
+		}
+
+		AoSLHF::PropertySet as;
+		SoALHF::PropertySet ss;
+		for (auto &e : elems) {
+			as.push_back({ e.first, {
+				ac1.register_set(e.second.first.begin(), e.second.first.end()),
+				ac2.register_set(e.second.second.begin(), e.second.second.end()) } });
+			ss.push_back({ e.first, {
+				sc1.register_set(e.second.first.begin(), e.second.first.end()),
+				sc2.register_set(e.second.second.begin(), e.second.second.end()) } });
+		}
+
+		aos_sets.push_back(aos.register_set(as));
+		soa_sets.push_back(soa.register_set(ss));
+	}
+
+	for (size_t i = 0; i < aos_sets.size(); i++) {
+		for (size_t j = 0; j < aos_sets.size(); j++) {
+			ASSERT_EQ(
+				to_string(aos, aos.set_union(aos_sets[i], aos_sets[j])),
+				to_string(soa, soa.set_union(soa_sets[i], soa_sets[j])));
+			ASSERT_EQ(
+				to_string(aos, aos.set_intersection(aos_sets[i], aos_sets[j])),
+				to_string(soa, soa.set_intersection(soa_sets[i], soa_sets[j])));
+			ASSERT_EQ(
+				to_string(aos, aos.set_difference(aos_sets[i], aos_sets[j])),
+				to_string(soa, soa.set_difference(soa_sets[i], soa_sets[j])));
+		}
+	}
+
+	ASSERT_EQ(aos.property_set_count(), soa.property_set_count());
+}
+
+template<typename LHF>
+void check_restrict_keys() {
+	ChildLHF c1, c2;
+	LHF l({c1, c2});
+	ChildLHF keys;
+
+	ChildIndex a = c1.register_set({ 1, 2 });
+	ChildIndex b = c2.register_set({ 3 });
+
+	typename LHF::Index x = l.register_set({ { 1, { a, b } }, { 4, { b, a } }, { 9, { a, a } } });
+
+	ChildIndex k = keys.register_set({ 0, 4, 9, 12 });
+	typename LHF::Index r = l.set_restrict_keys(x, keys, k);
+	ASSERT_EQ(r, l.register_set({ { 4, { b, a } }, { 9, { a, a } } }));
+	ASSERT_EQ(r, l.set_restrict_keys(x, keys, k));
+
+	ASSERT_EQ(l.set_restrict_keys(x, keys, keys.register_set({ 1, 4, 9 })), x);
+	ASSERT_TRUE(l.set_restrict_keys(x, keys, keys.register_set({ 2, 3 })).is_empty());
+	ASSERT_TRUE(l.set_restrict_keys(x, keys, ChildIndex(lhf::EMPTY_SET_VALUE)).is_empty());
+	ASSERT_TRUE(l.set_restrict_keys(typename LHF::Index(lhf::EMPTY_SET_VALUE), keys, k).is_empty());
+
+	// The same key set index in another key LHF names different keys.
+	ChildLHF other_keys;
+	ChildIndex k2 = other_keys.register_set({ 1 });
+	ASSERT_EQ(k2, k);
+	ASSERT_EQ(l.set_restrict_keys(x, other_keys, k2), l.register_set({ { 1, { a, b } } }));
+	ASSERT_EQ(r, l.set_restrict_keys(x, keys, k));
+}
+
+TEST(LHF_NestingChecks, restrict_keys_aos) {
+	check_restrict_keys<AoSLHF>();
+}
+
+TEST(LHF_NestingChecks, restrict_keys_soa) {
+	check_restrict_keys<SoALHF>();
+}
+
+template<typename LHF>
+void check_transient() {
+	ChildLHF c1, c2;
+	LHF l({c1, c2});
+
+	ChildIndex a = c1.register_set({ 1, 2 });
+	ChildIndex b = c2.register_set({ 3 });
+
+	typename LHF::Index x = l.register_set({ { 1, { a, b } }, { 4, { a, b } } });
+
+	ChildIndex c = c1.register_set({ 7 });
+	lhf::Size count_1 = c1.property_set_count();
+	lhf::Size count_2 = c2.property_set_count();
+
+	typename LHF::Transient t = l.transient(x);
+	t.insert({ 1, { c, ChildIndex() } });
+	t.template insert_child<0>(4, 8);
+	t.template insert_child<0>(4, 9);
+	t.template insert_child<1>(6, 5);
+	t.template insert_child<1>(9, 5);
+	t.update({ 9, { a, ChildIndex() } });
+	t.remove(2);
+
+	// No child set is registered before commit.
+	ASSERT_EQ(c1.property_set_count(), count_1);
+	ASSERT_EQ(c2.property_set_count(), count_2);
+
+	typename LHF::Index y = t.commit();
+	// The merged children of key 1 and the pending children of key 4 are
+	// registered as one set each.
+	ASSERT_EQ(c1.property_set_count(), count_1 + 2);
+	ASSERT_EQ(c2.property_set_count(), count_2 + 1);
+	ASSERT_EQ(y, l.register_set({
+		{ 1, { c1.register_set({ 1, 2, 7 }), b } },
+		{ 4, { c1.register_set({ 1, 2, 8, 9 }), b } },
+		{ 6, { ChildIndex(), c2.register_set({ 5 }) } },
+		{ 9, { a, ChildIndex() } } }));
+
+	ASSERT_EQ(l.transient(x).commit(), x);
+}
+
+TEST(LHF_NestingChecks, transient_aos) {
+	check_transient<AoSLHF>();
+}
+
+TEST(LHF_NestingChecks, transient_soa) {
+	check_transient<SoALHF>();
+}
@@ -0,0 +1,91 @@
+#include "lhf/lhf.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+#ifdef LHF_ENABLE_PERFORMANCE_METRICS
+
+using LHF = lhf::LatticeHashForest<int>;
+using Index = LHF::Index;
+
+static void timed_function(lhf::PerformanceStatistics &stat) {
+	__lhf_calc_time(stat, "timed_function");
+}
+
+TEST(LHF_ProfilingChecks, operation_counters) {
+	LHF l;
+	Index a = l.register_set({ 1, 2 });
+	Index b = l.register_set({ 3 });
+	l.set_union(a, b);
+	l.set_union(a, b);
+	l.set_union(a, a);
+	l.set_union(a, Index());
+
+	auto snap = l.perf_snapshot();
+	lhf::OperationPerf &u = snap.operations["unions"];
+	ASSERT_EQ(u.hits, 1u);
+	ASSERT_EQ(u.equal_hits, 1u);
+	ASSERT_EQ(u.empty_hits, 1u);
+	ASSERT_EQ(u.cold_misses + u.edge_misses, 1u);
+
+	// Counters belong to their instance.
+	LHF m;
+	ASSERT_EQ(m.perf_snapshot().operations.count("unions"), 0u);
+}
+
+TEST(LHF_ProfilingChecks, timers_merge_threads) {
+	constexpr int calls = 1000;
+	lhf::PerformanceStatistics stat;
+
+	auto worker = [&stat]() {
+		for (int i = 0; i < calls; i++) {
+			timed_function(stat);
+		}
+	};
+
+	std::thread t1(worker);
+	std::thread t2(worker);
+	t1.join();
+	t2.join();
+
+	auto snap = stat.snapshot();
+	ASSERT_EQ(snap.timers.size(), 1u);
+	const auto &t = snap.timers[0];
+	ASSERT_EQ(t.name, "timed_function");
+	ASSERT_EQ(t.calls, 2u * calls);
+
+	lhf::PerformanceStatistics::Count per_thread =
+		(calls + LHF_PROBE_SAMPLE_INTERVAL - 1) / LHF_PROBE_SAMPLE_INTERVAL;
+	ASSERT_EQ(t.sampled, 2 * per_thread);
+
+	lhf::PerformanceStatistics::Count in_histogram = 0;
+	for (auto c : t.histogram) {
+		in_histogram += c;
+	}
+	ASSERT_EQ(in_histogram, t.sampled);
+	ASSERT_LE(t.percentile_ns(0.5), t.percentile_ns(0.99));
+}
+
+TEST(LHF_ProfilingChecks, probe_name_table_overflow) {
+	lhf::ProbeNameTable table(2);
+	ASSERT_EQ(table.id("a"), 0u);
+	ASSERT_EQ(table.id("b"), 1u);
+	ASSERT_EQ(table.id("a"), 0u);
+
+#ifdef LHF_ENABLE_DEBUG
+	ASSERT_THROW(table.id("c"), std::length_error);
+#else
+	ASSERT_EQ(table.id("c"), table.max_size());
+#endif
+	ASSERT_EQ(table.size(), 2u);
+	ASSERT_EQ(table.overflowed(), std::vector<std::string>({ "c" }));
+}
+
+TEST(LHF_ProfilingChecks, probe_bucket) {
+	ASSERT_EQ(lhf::probe_bucket(0), 0u);
+	ASSERT_EQ(lhf::probe_bucket(1), 1u);
+	ASSERT_EQ(lhf::probe_bucket(1023), 10u);
+	ASSERT_EQ(lhf::probe_bucket(1024), 11u);
+	ASSERT_EQ(lhf::probe_bucket(~uint64_t(0)), LHF_PROBE_HISTOGRAM_BUCKETS - 1u);
+}
+
+#endif
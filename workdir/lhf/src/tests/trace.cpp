@@ -0,0 +1,304 @@
+#ifndef LHF_ENABLE_TRACE_RECORDING
+#define LHF_ENABLE_TRACE_RECORDING
+#endif
+
+#include "lhf/lhf.hpp"
+#include "lhf/trace.hpp"
+#include "lhf/workload.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+TEST(LHF_TraceChecks, round_trip) {
+	std::stringstream s;
+	lhf::TraceWriter w(s);
+
+	std::vector<int64_t> a = { 7, -3, 1000000, 7, 0 };
+	std::vector<int64_t> b = {};
+	std::vector<int64_t> r = { -3, 0, 7, 1000000 };
+
+	w.corpus_set(a);
+	w.corpus_duplicate(0, 0);
+	w.operation(
+		lhf::TRACE_UNION,
+		lhf::TraceWriter::Operand::corpus(1),
+		lhf::TraceWriter::Operand::inline_set(b, 1),
+		&r);
+	w.operation(
+		lhf::TRACE_DIFFERENCE,
+		lhf::TraceWriter::Operand::inline_set(a, 1),
+		lhf::TraceWriter::Operand::corpus(0));
+	w.finish();
+
+	std::string data = s.str();
+	lhf::TraceReader reader(data.data(), data.size());
+	ASSERT_EQ(reader.header().arity, 1u);
+	ASSERT_EQ(reader.header().op_count, 2u);
+	ASSERT_EQ(reader.header().corpus_count, 2u);
+
+	lhf::TraceReader::Record rec;
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_EQ(rec.opcode, lhf::TRACE_CORPUS_SET);
+	ASSERT_EQ(*rec.a.elements, r);
+
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_EQ(rec.opcode, lhf::TRACE_CORPUS_DUPLICATE);
+	ASSERT_EQ(rec.start, 0u);
+	ASSERT_EQ(rec.stop, 0u);
+
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_EQ(rec.opcode, lhf::TRACE_UNION);
+	ASSERT_TRUE(rec.a.is_corpus);
+	ASSERT_EQ(rec.a.corpus_index, 1u);
+	ASSERT_FALSE(rec.b.is_corpus);
+	ASSERT_TRUE(rec.b.elements->empty());
+	ASSERT_TRUE(rec.has_result);
+	ASSERT_EQ(*rec.result, r);
+
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_EQ(rec.opcode, lhf::TRACE_DIFFERENCE);
+	ASSERT_EQ(*rec.a.elements, r);
+	ASSERT_FALSE(rec.has_result);
+
+	ASSERT_FALSE(reader.next(rec));
+}
+
+TEST(LHF_TraceChecks, pairs_and_errors) {
+	std::stringstream s;
+	lhf::TraceWriter w(s, 2);
+	w.corpus_set({ 5, 2, 1, 9, 5, 1, 1, -4 });
+	w.finish();
+
+	std::string data = s.str();
+	lhf::TraceReader reader(data.data(), data.size());
+	lhf::TraceReader::Record rec;
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_EQ(*rec.a.elements, std::vector<int64_t>({ 1, -4, 1, 9, 5, 1, 5, 2 }));
+
+	ASSERT_THROW(lhf::TraceReader("garbage", 7), lhf::TraceFormatError);
+	ASSERT_THROW(lhf::TraceReader(data.data(), data.size() - 1).next(rec), lhf::TraceFormatError);
+}
+
+TEST(LHF_TraceChecks, corrupt_counts) {
+	lhf::TraceReader::Record rec;
+
+	// A set whose element count exceeds the rest of the trace.
+	std::stringstream s;
+	lhf::TraceWriter w(s);
+	w.finish();
+	std::string data = s.str();
+	data += static_cast<char>(lhf::TRACE_CORPUS_SET);
+	lhf::trace_put_varint(data, uint64_t(1) << 62);
+	ASSERT_THROW(lhf::TraceReader(data.data(), data.size()).next(rec), lhf::TraceFormatError);
+
+	// Live traces: an out-of-range instance number, a child count that
+	// exceeds the rest of the trace and a tuple count that does.
+	std::string live(lhf::TRACE_MAGIC, sizeof(lhf::TRACE_MAGIC));
+	live += std::string("\x02\0\0\0", 4) + std::string(20, '\0');
+	ASSERT_EQ(live.size(), lhf::TRACE_HEADER_SIZE);
+
+	std::string huge_instance = live;
+	huge_instance += static_cast<char>(lhf::TRACE_LIVE_INSTANCE);
+	lhf::trace_put_varint(huge_instance, UINT32_MAX - 1);
+	lhf::trace_put_varint(huge_instance, 0);
+	ASSERT_THROW(
+		lhf::TraceReader(huge_instance.data(), huge_instance.size()).next(rec),
+		lhf::TraceFormatError);
+
+	std::string many_children = live;
+	many_children += static_cast<char>(lhf::TRACE_LIVE_INSTANCE);
+	lhf::trace_put_varint(many_children, 0);
+	lhf::trace_put_varint(many_children, 1000);
+	ASSERT_THROW(
+		lhf::TraceReader(many_children.data(), many_children.size()).next(rec),
+		lhf::TraceFormatError);
+
+	std::string many_tuples = live;
+	many_tuples += static_cast<char>(lhf::TRACE_LIVE_INSTANCE);
+	lhf::trace_put_varint(many_tuples, 0);
+	lhf::trace_put_varint(many_tuples, 0);
+	many_tuples += static_cast<char>(lhf::TRACE_LIVE_REGISTER | lhf::TRACE_HAS_RESULT);
+	lhf::trace_put_varint(many_tuples, 0);
+	lhf::trace_put_varint(many_tuples, 1);
+	lhf::trace_put_varint(many_tuples, UINT64_MAX / 2);
+	lhf::TraceReader reader(many_tuples.data(), many_tuples.size());
+	ASSERT_TRUE(reader.next(rec));
+	ASSERT_THROW(reader.next(rec), lhf::TraceFormatError);
+}
+
+TEST(LHF_TraceChecks, recording) {
+	using ChildLHF = lhf::LatticeHashForest<int>;
+	using LHF =
+		lhf::LatticeHashForest<
+			int,
+			lhf::DefaultLess<int>,
+			lhf::DefaultHash<int>,
+			lhf::DefaultEqual<int>,
+			lhf::DefaultPrinter<int>,
+			lhf::NestingBase<int, ChildLHF>>;
+
+	std::string path = testing::TempDir() + "lhf_recording.lhft";
+
+	ChildLHF child;
+	LHF l(std::tie(child));
+
+	// Registered before attaching, so recorded as part of the snapshot.
+	auto c1 = child.register_set({ 1, 2 });
+
+	LHF::Index a, b, u;
+	{
+		lhf::TraceRecorder recorder(path, 16);
+		l.set_trace_recorder(&recorder);
+		ASSERT_EQ(child.trace_instance_id(), 0u);
+		ASSERT_EQ(l.trace_instance_id(), 1u);
+
+		auto c2 = child.register_set({ 3 });
+		a = l.register_set({ { 5, { c1 } } });
+		b = l.register_set({ { 5, { c2 } }, { 7, { c1 } } });
+		l.register_set({ { 5, { c1 } } });
+		u = l.set_union(a, b);
+		l.set_union(a, b);
+
+		l.set_trace_recorder(nullptr);
+		l.set_difference(u, a);
+	}
+
+	lhf::TraceFile file(path);
+	lhf::TraceReader reader(file.data(), file.size());
+	ASSERT_TRUE(reader.is_live());
+	ASSERT_EQ(reader.header().op_count, 7u);
+	ASSERT_EQ(reader.header().corpus_count, 2u);
+
+	lhf::TraceReader::Record r;
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_INSTANCE);
+	ASSERT_EQ(r.instance, 0u);
+	ASSERT_TRUE(r.children->empty());
+
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_REGISTER);
+	ASSERT_TRUE(r.has_result);
+	ASSERT_EQ(r.index, c1.value);
+	ASSERT_EQ(*r.a.elements, std::vector<int64_t>({ 1, 2 }));
+
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_INSTANCE);
+	ASSERT_EQ(r.instance, 1u);
+	ASSERT_EQ(*r.children, std::vector<uint64_t>({ 0 }));
+
+	// The child registration, then the parent's sets as (key, child) pairs.
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_REGISTER);
+	ASSERT_EQ(r.instance, 0u);
+
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.instance, 1u);
+	ASSERT_EQ(r.index, a.value);
+	ASSERT_EQ(*r.a.elements, std::vector<int64_t>({ 5, int64_t(c1.value) }));
+
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.index, b.value);
+	ASSERT_TRUE(r.has_result);
+
+	ASSERT_TRUE(reader.next(r));
+	ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_REGISTER);
+	ASSERT_EQ(r.index, a.value);
+	ASSERT_FALSE(r.has_result);
+
+	// Both unions are recorded, but not the child union or the registration
+	// of the result inside the first one, nor anything after detaching.
+	for (int i = 0; i < 2; i++) {
+		ASSERT_TRUE(reader.next(r));
+		ASSERT_EQ(r.opcode, lhf::TRACE_LIVE_UNION);
+		ASSERT_EQ(r.instance, 1u);
+		ASSERT_EQ(r.left, a.value);
+		ASSERT_EQ(r.right, b.value);
+		ASSERT_EQ(r.index, u.value);
+	}
+
+	ASSERT_FALSE(reader.next(r));
+	std::remove(path.c_str());
+}
+
+static std::string generate_trace(const lhf::WorkloadConfig &config) {
+	std::stringstream s;
+	lhf::TraceWriter w(s, config.arity);
+	lhf::WorkloadGenerator(config).generate(w);
+	w.finish();
+	return s.str();
+}
+
+TEST(LHF_TraceChecks, workload_generation) {
+	for (const char *spec : {
+			"kind=random,count=500,maxsize=40,maxval=300",
+			"kind=closed_world,count=3000,maxsize=40,maxval=300,corpussize=50,dist=normal,pairs",
+			"kind=closed_world,count=3000,maxsize=40,maxval=300,corpussize=50,dist=optimistic" }) {
+		lhf::WorkloadConfig config = lhf::WorkloadConfig::parse(spec);
+
+		// The output does not depend on the number of threads.
+		config.threads = 1;
+		std::string data = generate_trace(config);
+		config.threads = 3;
+		ASSERT_EQ(data, generate_trace(config)) << spec;
+
+		lhf::TraceReader reader(data.data(), data.size());
+		ASSERT_EQ(reader.header().op_count, config.count);
+
+		// Every result must match the operation on its operands.
+		std::vector<std::vector<int64_t>> corpus;
+		lhf::TraceReader::Record rec;
+		uint64_t duplicates = 0;
+
+		auto tuples = [&](const std::vector<int64_t> &v) {
+			std::vector<std::pair<int64_t, int64_t>> ret;
+			for (std::size_t i = 0; i < v.size(); i += config.arity) {
+				ret.push_back({ v[i], config.arity == 2 ? v[i + 1] : 0 });
+			}
+			return ret;
+		};
+
+		while (reader.next(rec)) {
+			if (rec.opcode == lhf::TRACE_CORPUS_SET) {
+				corpus.push_back(*rec.a.elements);
+				continue;
+			} else if (rec.opcode == lhf::TRACE_CORPUS_DUPLICATE) {
+				ASSERT_LE(rec.start, rec.stop);
+				ASSERT_LT(rec.stop, corpus.size());
+				for (uint64_t i = rec.start; i <= rec.stop; i++) {
+					corpus.push_back(corpus[i]);
+				}
+				duplicates++;
+				continue;
+			}
+
+			auto a = tuples(rec.a.is_corpus ? corpus.at(rec.a.corpus_index) : *rec.a.elements);
+			auto b = tuples(rec.b.is_corpus ? corpus.at(rec.b.corpus_index) : *rec.b.elements);
+			decltype(a) expected;
+			auto out = std::back_inserter(expected);
+
+			switch (rec.opcode & ~lhf::TRACE_HAS_RESULT) {
+			case lhf::TRACE_UNION:
+				std::set_union(a.begin(), a.end(), b.begin(), b.end(), out);
+				break;
+			case lhf::TRACE_INTERSECTION:
+				std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out);
+				break;
+			default:
+				std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+				break;
+			}
+
+			ASSERT_TRUE(rec.has_result);
+			ASSERT_EQ(tuples(*rec.result), expected) << spec;
+		}
+
+		if (config.kind == lhf::WORKLOAD_CLOSED_WORLD) {
+			ASSERT_EQ(reader.header().corpus_count, corpus.size());
+			ASSERT_GT(duplicates, 0u) << spec;
+		}
+	}
+
+	ASSERT_THROW(lhf::WorkloadConfig::parse("count=x"), lhf::WorkloadError);
+	ASSERT_THROW(lhf::WorkloadConfig::parse("colour=1"), lhf::WorkloadError);
+}